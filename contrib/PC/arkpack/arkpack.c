@@ -0,0 +1,166 @@
+/*
+ * arkpack.c
+ *
+ * Builds FLASH0.ARK style packs and pspbtcnf binaries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arkpack.h"
+
+void buf_put(buffer *b, const void *data, size_t size)
+{
+    if(b->size + size > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+
+        while(cap < b->size + size) {
+            cap *= 2;
+        }
+
+        b->data = realloc(b->data, cap);
+
+        if(b->data == NULL) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+
+        b->cap = cap;
+    }
+
+    memcpy(b->data + b->size, data, size);
+    b->size += size;
+}
+
+void buf_put32(buffer *b, u32 v)
+{
+    u8 d[4] = { v, v >> 8, v >> 16, v >> 24 };
+    buf_put(b, d, 4);
+}
+
+void buf_put16(buffer *b, u16 v)
+{
+    u8 d[2] = { v, v >> 8 };
+    buf_put(b, d, 2);
+}
+
+void buf_put8(buffer *b, u8 v)
+{
+    buf_put(b, &v, 1);
+}
+
+void buf_free(buffer *b)
+{
+    free(b->data);
+    memset(b, 0, sizeof(buffer));
+}
+
+u8 *read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    u8 *data;
+    long len;
+
+    if(fp == NULL) {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    data = malloc(len + 1);
+
+    if(data == NULL || fread(data, 1, len, fp) != (size_t)len) {
+        free(data);
+        fclose(fp);
+
+        return NULL;
+    }
+
+    data[len] = 0;
+    *size = len;
+    fclose(fp);
+
+    return data;
+}
+
+int write_file_if_changed(const char *path, const void *data, size_t size)
+{
+    size_t old_size;
+    u8 *old = read_file(path, &old_size);
+    FILE *fp;
+
+    if(old != NULL) {
+        int same = (old_size == size && memcmp(old, data, size) == 0);
+        free(old);
+
+        if(same) {
+            return 0;
+        }
+    }
+
+    fp = fopen(path, "wb");
+
+    if(fp == NULL) {
+        return -1;
+    }
+
+    if(fwrite(data, 1, size, fp) != size) {
+        fclose(fp);
+
+        return -1;
+    }
+
+    fclose(fp);
+
+    return 1;
+}
+
+static void usage(const char *exe)
+{
+    printf("Usage: %s <mode> args...\n", exe);
+    printf(" mode: -p <output filename> <list> [-s] : pack\n");
+    printf(" mode: -e <input> : extract all modules from pack\n");
+    printf(" mode: btcnf <build|extract> <btcnf.txt|btcnf.bin> : boot config\n");
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(strcmp(argv[1], "-p") == 0) {
+        if(argc < 4) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        return pack_main(argc - 2, argv + 2);
+    }
+
+    if(strcmp(argv[1], "-e") == 0) {
+        if(argc < 3) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        return unpack_main(argc - 2, argv + 2);
+    }
+
+    if(strcmp(argv[1], "btcnf") == 0) {
+        if(argc < 4) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        return btcnf_main(argc - 2, argv + 2);
+    }
+
+    usage(argv[0]);
+
+    return 1;
+}
@@ -0,0 +1,41 @@
+/*
+ * arkpack.h
+ *
+ * Native replacement for contrib/PC/pack/pack.py and contrib/PC/btcnf/btcnf.py,
+ * producing byte-identical output.
+ */
+
+#ifndef ARKPACK_H_
+#define ARKPACK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef struct
+{
+    u8 *data;
+    size_t size;
+    size_t cap;
+} buffer;
+
+/* growable output buffer */
+void buf_put(buffer *b, const void *data, size_t size);
+void buf_put32(buffer *b, u32 v);
+void buf_put16(buffer *b, u16 v);
+void buf_put8(buffer *b, u8 v);
+void buf_free(buffer *b);
+
+u8 *read_file(const char *path, size_t *size);
+/* returns 1 if the file was written, 0 if it already had this content, -1 on error */
+int write_file_if_changed(const char *path, const void *data, size_t size);
+
+int btcnf_main(int argc, char **argv);
+int pack_main(int argc, char **argv);
+int unpack_main(int argc, char **argv);
+
+#endif /* ARKPACK_H_ */
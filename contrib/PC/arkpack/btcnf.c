@@ -0,0 +1,420 @@
+/*
+ * btcnf.c
+ *
+ * pspbtcnf text <-> binary, same rules as contrib/PC/btcnf/btcnf.py
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "arkpack.h"
+
+#define BTCNF_MAGIC 0x0F803001
+
+#define SECT_VSH     1
+#define SECT_GAME    2
+#define SECT_UPDATER 4
+#define SECT_POPS    8
+#define SECT_LICENSE 0x10
+#define SECT_APP     0x20
+#define SECT_UMDEMU  0x40
+#define SECT_MLNAPP  0x80
+
+#define TYPE_PERCENT    2
+#define TYPE_TWOPERCENT 4
+#define TYPE_DOLLAR     0x8000
+
+#define HEADER_SIZE 0x40
+#define ENTRY_SIZE  0x20 /* both mode and module entries */
+
+static const struct { u32 flag; u32 mode; char letter; } modes_def[] = {
+    { SECT_VSH,     2, 'V' },
+    { SECT_GAME,    1, 'G' },
+    { SECT_UPDATER, 3, 'U' },
+    { SECT_POPS,    4, 'P' },
+    { SECT_LICENSE, 5, 'L' },
+    { SECT_APP,     6, 'A' },
+    { SECT_UMDEMU,  7, 'E' },
+    { SECT_MLNAPP,  8, 'M' },
+};
+
+#define N_MODES (sizeof(modes_def)/sizeof(modes_def[0]))
+
+typedef struct
+{
+    char *path;
+    u32 flags;
+    u32 stroffset;
+} module;
+
+typedef struct
+{
+    u32 fw_version;
+    module *modules;
+    int n_modules;
+} btcnf;
+
+static void add_module(btcnf *cnf, const char *path, size_t len, u32 flags)
+{
+    module *m;
+
+    cnf->modules = realloc(cnf->modules, sizeof(module) * (cnf->n_modules + 1));
+    m = &cnf->modules[cnf->n_modules++];
+    m->path = malloc(len + 1);
+    memcpy(m->path, path, len);
+    m->path[len] = 0;
+    m->flags = flags;
+    m->stroffset = 0;
+}
+
+static void free_btcnf(btcnf *cnf)
+{
+    int i;
+
+    for(i=0; i<cnf->n_modules; i++) {
+        free(cnf->modules[i].path);
+    }
+
+    free(cnf->modules);
+}
+
+/* python's str.strip(), in place */
+static char *strip(char *s)
+{
+    char *e;
+
+    while(*s && isspace((unsigned char)*s)) s++;
+
+    e = s + strlen(s);
+    while(e > s && isspace((unsigned char)e[-1])) e--;
+    *e = 0;
+
+    return s;
+}
+
+static int parse_line(btcnf *cnf, char *raw)
+{
+    char *line, *sp, *mode, *mode_end, *path;
+    u32 flags, btmode = 0;
+    size_t path_len;
+    unsigned i;
+
+    if(raw[0] == '#') {
+        return 0;
+    }
+
+    line = strip(raw);
+
+    if(strncmp(line, "$%%", 3) == 0)     flags = 0x8004;
+    else if(strncmp(line, "$%", 2) == 0) flags = 0x8002;
+    else if(line[0] == '$')              flags = 0x8001;
+    else if(strncmp(line, "%%", 2) == 0) flags = 4;
+    else if(line[0] == '%')              flags = 2;
+    else                                 flags = 1;
+
+    // "<path> <modes>", split on single spaces
+    sp = strchr(line, ' ');
+
+    if(sp == NULL) {
+        return -1;
+    }
+
+    *sp = 0;
+    mode = sp + 1;
+    mode_end = strchr(mode, ' ');
+    if(mode_end) *mode_end = 0;
+
+    for(i=0; i<N_MODES; i++) {
+        const char *c;
+
+        for(c=mode; *c; c++) {
+            if(toupper((unsigned char)*c) == modes_def[i].letter) {
+                btmode |= modes_def[i].flag;
+                break;
+            }
+        }
+    }
+
+    // from the first '/', the python find() == -1 case keeps only the last character
+    path = strchr(line, '/');
+    path_len = strlen(line);
+
+    if(path == NULL) {
+        path = (path_len > 0) ? line + path_len - 1 : line;
+    }
+
+    add_module(cnf, path, strlen(path), (flags << 16) | btmode);
+
+    return 0;
+}
+
+static char *next_line(char **p)
+{
+    char *s = *p, *e;
+
+    if(*s == 0) {
+        return NULL;
+    }
+
+    e = strchr(s, '\n');
+
+    if(e) {
+        *e = 0;
+        *p = e + 1;
+    }
+    else {
+        *p = s + strlen(s);
+    }
+
+    return s;
+}
+
+static int load_text(btcnf *cnf, const char *fn)
+{
+    size_t size;
+    char *text = (char *)read_file(fn, &size);
+    char *p = text, *line, *end;
+    int ret = 0;
+
+    if(text == NULL) {
+        printf("Cannot open %s\n", fn);
+        return -1;
+    }
+
+    do {
+        line = next_line(&p);
+        line = line ? strip(line) : "";
+    } while(line[0] == '#');
+
+    cnf->fw_version = strtoul(line, &end, 16);
+
+    if(end == line || *end != 0) {
+        printf("%s: bad firmware version '%s'\n", fn, line);
+        free(text);
+        return -1;
+    }
+
+    while((line = next_line(&p)) != NULL) {
+        if(parse_line(cnf, line) < 0) {
+            printf("%s: bad line '%s'\n", fn, line);
+            ret = -1;
+            break;
+        }
+    }
+
+    free(text);
+
+    return ret;
+}
+
+static void build_bin(btcnf *cnf, buffer *out)
+{
+    u32 used[N_MODES];
+    u32 modestart, modulestart, modnamestart, modulesend;
+    u32 nmodes = 0;
+    unsigned i;
+    int j, k;
+    buffer strings = { 0 };
+
+    for(i=0; i<N_MODES; i++) {
+        for(j=0; j<cnf->n_modules; j++) {
+            if(cnf->modules[j].flags & modes_def[i].flag) {
+                used[nmodes++] = i;
+                break;
+            }
+        }
+    }
+
+    // unique paths in order of first use
+    for(j=0; j<cnf->n_modules; j++) {
+        for(k=0; k<j; k++) {
+            if(strcmp(cnf->modules[k].path, cnf->modules[j].path) == 0) {
+                break;
+            }
+        }
+
+        if(k < j) {
+            cnf->modules[j].stroffset = cnf->modules[k].stroffset;
+            continue;
+        }
+
+        cnf->modules[j].stroffset = strings.size;
+        buf_put(&strings, cnf->modules[j].path, strlen(cnf->modules[j].path) + 1);
+    }
+
+    modestart = HEADER_SIZE;
+    modulestart = modestart + nmodes * ENTRY_SIZE;
+    modnamestart = modulestart + cnf->n_modules * ENTRY_SIZE;
+    modulesend = modnamestart + strings.size;
+
+    u32 header[16] = {
+        BTCNF_MAGIC, cnf->fw_version, 0x6B8B4567, 0x327B23C6,
+        modestart, nmodes, 0x643C9869, 0x66334873,
+        modulestart, cnf->n_modules, 0x74B0DC51, 0x19495CFF,
+        modnamestart, modulesend, 0x2AE8944A, 0x625558EC,
+    };
+
+    for(i=0; i<16; i++) {
+        buf_put32(out, header[i]);
+    }
+
+    for(i=0; i<nmodes; i++) {
+        buf_put16(out, cnf->n_modules);
+        buf_put16(out, 0);
+        buf_put32(out, modes_def[used[i]].flag);
+        buf_put32(out, modes_def[used[i]].mode);
+        for(k=0; k<20; k++) buf_put8(out, 0);
+    }
+
+    for(j=0; j<cnf->n_modules; j++) {
+        buf_put32(out, cnf->modules[j].stroffset);
+        buf_put32(out, 0);
+        buf_put32(out, cnf->modules[j].flags);
+        buf_put32(out, 0);
+        for(k=0; k<16; k++) buf_put8(out, 0);
+    }
+
+    buf_put(out, strings.data, strings.size);
+    buf_free(&strings);
+}
+
+static u32 get32(const u8 *data, size_t size, size_t off)
+{
+    if(off + 4 > size) {
+        return 0;
+    }
+
+    return data[off] | (data[off+1] << 8) | (data[off+2] << 16) | ((u32)data[off+3] << 24);
+}
+
+static int load_bin(btcnf *cnf, const char *fn)
+{
+    size_t size, off;
+    u8 *data = read_file(fn, &size);
+    u32 i, nmodules, modulestart, modnamestart;
+
+    if(data == NULL) {
+        printf("Cannot open %s\n", fn);
+        return -1;
+    }
+
+    if(get32(data, size, 0) != BTCNF_MAGIC) {
+        printf("Not a pspbtcnf file did you decrypt it first?\n");
+        free(data);
+        return -1;
+    }
+
+    cnf->fw_version = get32(data, size, 4);
+    modulestart = get32(data, size, 0x20);
+    nmodules = get32(data, size, 0x24);
+    modnamestart = get32(data, size, 0x30);
+
+    for(i=0; i<nmodules; i++) {
+        size_t pos = modulestart + i * ENTRY_SIZE;
+        size_t len = 0;
+
+        off = modnamestart + get32(data, size, pos);
+        while(off + len < size && data[off + len] != 0) len++;
+
+        add_module(cnf, (off < size) ? (char *)data + off : "", (off < size) ? len : 0, get32(data, size, pos + 8));
+    }
+
+    free(data);
+
+    return 0;
+}
+
+static void build_text(btcnf *cnf, buffer *out)
+{
+    char tmp[16];
+    unsigned i;
+    int j;
+
+    snprintf(tmp, sizeof(tmp), "0x%08X\n", cnf->fw_version);
+    buf_put(out, tmp, strlen(tmp));
+
+    for(j=0; j<cnf->n_modules; j++) {
+        module *m = &cnf->modules[j];
+        u32 loadmode = m->flags >> 16;
+
+        if(loadmode & TYPE_DOLLAR) buf_put8(out, '$');
+        if(loadmode & TYPE_PERCENT) buf_put8(out, '%');
+        if(loadmode & TYPE_TWOPERCENT) buf_put(out, "%%", 2);
+
+        buf_put(out, m->path, strlen(m->path));
+        buf_put8(out, ' ');
+
+        for(i=0; i<N_MODES; i++) {
+            if(m->flags & modes_def[i].flag) buf_put8(out, modes_def[i].letter);
+        }
+
+        buf_put8(out, '\n');
+    }
+}
+
+/* os.path.splitext(fn)[0] + ext */
+static char *replace_ext(const char *fn, const char *ext)
+{
+    const char *base = strrchr(fn, '/');
+    const char *dot;
+    size_t len;
+    char *res;
+
+    base = base ? base + 1 : fn;
+    while(*base == '.') base++;
+
+    dot = strrchr(base, '.');
+    len = dot ? (size_t)(dot - fn) : strlen(fn);
+
+    res = malloc(len + strlen(ext) + 1);
+    memcpy(res, fn, len);
+    strcpy(res + len, ext);
+
+    return res;
+}
+
+int btcnf_main(int argc, char **argv)
+{
+    const char *cmd = argv[0];
+    const char *fn = argv[1];
+    btcnf cnf = { 0 };
+    buffer out = { 0 };
+    char *nfn;
+    int ret;
+
+    if(strcasecmp(cmd, "build") == 0) {
+        nfn = replace_ext(fn, ".bin");
+        ret = load_text(&cnf, fn);
+        if(ret == 0) build_bin(&cnf, &out);
+    }
+    else if(strcasecmp(cmd, "extract") == 0 || strcasecmp(cmd, "ext") == 0) {
+        nfn = replace_ext(fn, ".txt");
+        ret = load_bin(&cnf, fn);
+        if(ret == 0) build_text(&cnf, &out);
+    }
+    else {
+        printf("Usage: btcnf <build|extract> <btcnf.bin|btcnf.txt>\n");
+        return 1;
+    }
+
+    if(ret == 0) {
+        // leave an up to date output alone so its timestamp doesn't trigger rebuilds
+        ret = write_file_if_changed(nfn, out.data, out.size);
+
+        if(ret < 0) {
+            printf("Cannot write %s\n", nfn);
+        }
+        else {
+            printf("%s done%s\n", nfn, ret ? "" : " (unchanged)");
+            ret = 0;
+        }
+    }
+
+    buf_free(&out);
+    free_btcnf(&cnf);
+    free(nfn);
+
+    return (ret != 0);
+}
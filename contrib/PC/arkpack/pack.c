@@ -0,0 +1,230 @@
+/*
+ * pack.c
+ *
+ * FLASH0.ARK packer, same format and list syntax as contrib/PC/pack/pack.py:
+ *
+ *   u32 file count
+ *   per file: u32 size, u8 name length, name, content
+ *
+ * An output that already has the packed content is left untouched.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arkpack.h"
+
+typedef struct
+{
+    char *vpath;
+    char *fpath;
+    u8 *data;
+    size_t size;
+} pack_entry;
+
+typedef struct
+{
+    pack_entry *entries;
+    int count;
+} pack_list;
+
+static void add_entry(pack_list *list, const char *vpath, size_t vlen, const char *fpath)
+{
+    pack_entry *e;
+
+    list->entries = realloc(list->entries, sizeof(pack_entry) * (list->count + 1));
+    e = &list->entries[list->count++];
+    memset(e, 0, sizeof(pack_entry));
+
+    e->vpath = malloc(vlen + 1);
+    memcpy(e->vpath, vpath, vlen);
+    e->vpath[vlen] = 0;
+    e->fpath = strdup(fpath);
+}
+
+static void free_list(pack_list *list)
+{
+    int i;
+
+    for(i=0; i<list->count; i++) {
+        free(list->entries[i].vpath);
+        free(list->entries[i].fpath);
+        free(list->entries[i].data);
+    }
+
+    free(list->entries);
+}
+
+/* "<vpath>,<fpath>" per line, comments start with '#', anything else is ignored */
+static int read_config(pack_list *list, const char *path)
+{
+    size_t size;
+    char *text = (char *)read_file(path, &size);
+    char *p = text;
+
+    if(text == NULL) {
+        printf("Cannot open %s\n", path);
+        return -1;
+    }
+
+    while(*p) {
+        char *line = p, *end = strchr(p, '\n'), *comma, *e;
+
+        if(end) {
+            *end = 0;
+            p = end + 1;
+        }
+        else {
+            p += strlen(p);
+        }
+
+        if(line[0] == '#') {
+            continue;
+        }
+
+        while(*line == ' ' || *line == '\t' || *line == '\r') line++;
+        e = line + strlen(line);
+        while(e > line && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r')) e--;
+        *e = 0;
+
+        // exactly one comma, like python's two-value unpack
+        comma = strchr(line, ',');
+
+        if(comma == NULL || strchr(comma + 1, ',') != NULL) {
+            continue;
+        }
+
+        *comma = 0;
+        add_entry(list, line, comma - line, comma + 1);
+    }
+
+    free(text);
+
+    return 0;
+}
+
+int pack_main(int argc, char **argv)
+{
+    const char *output = argv[0];
+    const char *config = argv[1];
+    pack_list list = { 0 };
+    buffer pack = { 0 };
+    int no_delete = 0;
+    int i, written, ret = 1;
+
+    for(i=2; i<argc; i++) {
+        if(strcmp(argv[i], "-s") == 0) {
+            no_delete = 1;
+        }
+    }
+
+    if(read_config(&list, config) < 0) {
+        goto out;
+    }
+
+    for(i=0; i<list.count; i++) {
+        pack_entry *e = &list.entries[i];
+
+        if(strlen(e->vpath) > 255) {
+            printf("%s: name too long\n", e->vpath);
+            goto out;
+        }
+
+        e->data = read_file(e->fpath, &e->size);
+
+        if(e->data == NULL) {
+            printf("Cannot open %s\n", e->fpath);
+            goto out;
+        }
+    }
+
+    buf_put32(&pack, list.count);
+
+    for(i=0; i<list.count; i++) {
+        pack_entry *e = &list.entries[i];
+
+        printf("Adding %s as %s\n", e->fpath, e->vpath);
+        buf_put32(&pack, e->size);
+        buf_put8(&pack, strlen(e->vpath));
+        buf_put(&pack, e->vpath, strlen(e->vpath));
+        buf_put(&pack, e->data, e->size);
+    }
+
+    written = write_file_if_changed(output, pack.data, pack.size);
+
+    if(written < 0) {
+        printf("Cannot write %s\n", output);
+        goto out;
+    }
+
+    if(written == 0) {
+        printf("%s is up to date\n", output);
+    }
+
+    // pack.py consumes its inputs
+    if(!no_delete) {
+        for(i=0; i<list.count; i++) {
+            remove(list.entries[i].fpath);
+        }
+    }
+
+    ret = 0;
+
+out:
+    buf_free(&pack);
+    free_list(&list);
+
+    return ret;
+}
+
+int unpack_main(int argc, char **argv)
+{
+    size_t size, pos = 4;
+    u8 *data = read_file(argv[0], &size);
+
+    if(data == NULL) {
+        printf("Cannot open %s\n", argv[0]);
+        return 1;
+    }
+
+    while(pos + 5 <= size) {
+        u32 file_size = data[pos] | (data[pos+1] << 8) | (data[pos+2] << 16) | ((u32)data[pos+3] << 24);
+        u32 name_len = data[pos+4];
+        char name[256], *base;
+
+        pos += 5;
+
+        if(name_len == 0 || pos + name_len > size) {
+            break;
+        }
+
+        memcpy(name, data + pos, name_len);
+        name[name_len] = 0;
+        pos += name_len;
+
+        if(file_size == 0 || pos >= size) {
+            break;
+        }
+
+        if(pos + file_size > size) {
+            file_size = size - pos;
+        }
+
+        base = strrchr(name, '/');
+        base = base ? base + 1 : name;
+
+        if(write_file_if_changed(base, data + pos, file_size) < 0) {
+            printf("Cannot write %s\n", base);
+        }
+        else {
+            printf("Saved %s as %s\n", name, base);
+        }
+
+        pos += file_size;
+    }
+
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#!/bin/sh
+#
+# arkpack against the Python scripts it replaces:
+# - every boot config source in the tree, through btcnf.py and arkpack btcnf
+# - a FLASH0-sized pack, with and without -s, through pack.py and arkpack -p
+# - an unchanged pack must not be rewritten, a changed input must be
+# then times the btcnf and pack steps of a whole dist/ build with both.
+#
+# usage: sh test/compat.sh   (from contrib/PC/arkpack, or "make check")
+#
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+ARKROOT=$(cd "$HERE/../../../.." && pwd)
+PYTHON=${PYTHON:-python3}
+ARKPACK="$HERE/../arkpack"
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+failed=0
+
+fail()
+{
+	echo "FAIL: $*"
+	failed=1
+}
+
+# boot configs
+
+mkdir "$TMP/py" "$TMP/c"
+n=0
+for txt in $(cd "$ARKROOT" && find core loader extras -name '*.txt' -path '*btcnf*' | sort); do
+	# 1.50 kernel configs are plain module lists, not btcnf sources
+	head -n 1 "$ARKROOT/$txt" | grep -q '^0x' || continue
+	name=$(echo "$txt" | tr '/' '_')
+	cp "$ARKROOT/$txt" "$TMP/py/$name"
+	cp "$ARKROOT/$txt" "$TMP/c/$name"
+	"$PYTHON" "$ARKROOT/contrib/PC/btcnf/btcnf.py" build "$TMP/py/$name" > /dev/null
+	"$ARKPACK" btcnf build "$TMP/c/$name" > /dev/null
+	bin=${name%.txt}.bin
+	cmp -s "$TMP/py/$bin" "$TMP/c/$bin" || fail "btcnf $txt"
+
+	# and back to text
+	rm "$TMP/py/$name" "$TMP/c/$name"
+	"$PYTHON" "$ARKROOT/contrib/PC/btcnf/btcnf.py" extract "$TMP/py/$bin" > /dev/null
+	"$ARKPACK" btcnf extract "$TMP/c/$bin" > /dev/null
+	cmp -s "$TMP/py/$name" "$TMP/c/$name" || fail "btcnf extract $txt"
+	n=$((n + 1))
+done
+echo "btcnf: $n configs"
+
+# packs: the FLASH0 list with random contents of typical module sizes
+
+mkdir "$TMP/src"
+: > "$TMP/list"
+i=0
+while read -r line || [ -n "$line" ]; do
+	name=${line%%,*}
+	size=$(( (i * 7919 % 200 + 1) * 1024 + i * 13 ))
+	head -c $size /dev/urandom > "$TMP/src/f$i"
+	echo "$name,in/f$i" >> "$TMP/list"
+	i=$((i + 1))
+done < "$ARKROOT/contrib/PC/pack/packlist.txt"
+
+# without -s both remove their inputs, so each run gets a fresh copy
+pack()
+{
+	rm -rf "$TMP/in" && cp -r "$TMP/src" "$TMP/in"
+	(cd "$TMP" && "$@" > /dev/null)
+}
+
+for keep in "" "-s"; do
+	pack "$PYTHON" "$ARKROOT/contrib/PC/pack/pack.py" -p py.ark list $keep
+	pack "$ARKPACK" -p c.ark list $keep
+	cmp -s "$TMP/py.ark" "$TMP/c.ark" || fail "pack ${keep:-without -s}"
+	if [ -z "$keep" ] && [ -e "$TMP/in/f0" ]; then fail "pack kept its inputs without -s"; fi
+	if [ -n "$keep" ] && [ ! -e "$TMP/in/f0" ]; then fail "pack -s removed its inputs"; fi
+done
+echo "pack: $i files"
+
+# incremental: same inputs leave the pack alone, a changed one rewrites it
+
+pack "$ARKPACK" -p c.ark list
+touch -d '2000-01-01' "$TMP/c.ark"
+pack "$ARKPACK" -p c.ark list
+[ "$(date -r "$TMP/c.ark" +%Y)" = 2000 ] || fail "unchanged pack was rewritten"
+
+head -c 100 /dev/urandom >> "$TMP/src/f3"
+pack "$ARKPACK" -p c.ark list
+[ "$(date -r "$TMP/c.ark" +%Y)" != 2000 ] || fail "changed input did not rewrite the pack"
+pack "$PYTHON" "$ARKROOT/contrib/PC/pack/pack.py" -p py.ark list
+cmp -s "$TMP/py.ark" "$TMP/c.ark" || fail "pack after an input changed"
+echo "unchanged output: ok"
+
+# timing: what a dist/ build runs through these tools. every btcnf config
+# above, FLASH0.ARK from the FLASH0 list and ARK_01234.PKG from the updater
+# list, which holds FLASH0.ARK. The pops modules come from contrib/PSP,
+# THEME.ARK is as big as its theme folder, the other modules are the
+# stand-ins above. -s so the inputs stay in place between runs.
+
+mkdir "$TMP/dist" "$TMP/dist/in" "$TMP/dist/cfg"
+for txt in $(cd "$ARKROOT" && find core loader extras -name '*.txt' -path '*btcnf*' | sort); do
+	head -n 1 "$ARKROOT/$txt" | grep -q '^0x' || continue
+	cp "$ARKROOT/$txt" "$TMP/dist/cfg/$(echo "$txt" | tr '/' '_')"
+done
+cp -r "$TMP/src" "$TMP/dist/flash0"
+sed 's#,in/#,flash0/#' "$TMP/list" > "$TMP/dist/flash0.txt"
+: > "$TMP/dist/pkg.txt"
+i=0
+while read -r line || [ -n "$line" ]; do
+	name=${line%%,*}
+	case $name in
+	FLASH0.ARK) echo "$name,FLASH0.ARK" >> "$TMP/dist/pkg.txt"; continue ;;
+	POPS.PRX) cp "$ARKROOT/contrib/PSP/pops_01g.prx" "$TMP/dist/in/$name" ;;
+	POPSMAN.PRX) cp "$ARKROOT/contrib/PSP/popsman.prx" "$TMP/dist/in/$name" ;;
+	MEDIASYN.PRX) cp "$ARKROOT/contrib/PSP/mediasync.prx" "$TMP/dist/in/$name" ;;
+	THEME.ARK) head -c $(du -sb "$ARKROOT/extras/menus/arkMenu/themes/ARK_Revamped" | cut -f1) /dev/urandom > "$TMP/dist/in/$name" ;;
+	*) head -c $(( (i * 7919 % 200 + 1) * 1024 + i * 13 )) /dev/urandom > "$TMP/dist/in/$name" ;;
+	esac
+	echo "$name,in/$name" >> "$TMP/dist/pkg.txt"
+	i=$((i + 1))
+done < "$ARKROOT/extras/apps/updater/packlist.txt"
+
+dist_py()
+{
+	for txt in cfg/*.txt; do
+		"$PYTHON" "$ARKROOT/contrib/PC/btcnf/btcnf.py" build "$txt"
+	done
+	"$PYTHON" "$ARKROOT/contrib/PC/pack/pack.py" -p FLASH0.ARK flash0.txt -s
+	"$PYTHON" "$ARKROOT/contrib/PC/pack/pack.py" -p ARK_01234.PKG pkg.txt -s
+}
+
+dist_c()
+{
+	for txt in cfg/*.txt; do
+		"$ARKPACK" btcnf build "$txt"
+	done
+	"$ARKPACK" -p FLASH0.ARK flash0.txt -s
+	"$ARKPACK" -p ARK_01234.PKG pkg.txt -s
+}
+
+elapsed()
+{
+	start=$(date +%s%N)
+	for run in 1 2 3 4 5; do
+		[ "$1" = fresh ] && rm -f "$TMP"/dist/cfg/*.bin "$TMP/dist/FLASH0.ARK" "$TMP/dist/ARK_01234.PKG"
+		(cd "$TMP/dist" && $2 > /dev/null)
+	done
+	echo $(( ($(date +%s%N) - start) / 5000000 ))
+}
+
+t_py=$(elapsed fresh dist_py)
+cp "$TMP/dist/ARK_01234.PKG" "$TMP/py.pkg"
+t_c=$(elapsed fresh dist_c)
+cmp -s "$TMP/dist/ARK_01234.PKG" "$TMP/py.pkg" || fail "dist ARK_01234.PKG"
+t_same=$(elapsed same dist_c)
+echo "dist steps ($(ls "$TMP"/dist/cfg/*.bin | wc -l) btcnf, FLASH0.ARK $(du -k "$TMP/dist/FLASH0.ARK" | cut -f1)KB, ARK_01234.PKG $(du -k "$TMP/dist/ARK_01234.PKG" | cut -f1)KB):"
+echo "  python ${t_py}ms, arkpack ${t_c}ms, arkpack with nothing changed ${t_same}ms"
+
+if [ $failed -ne 0 ]; then
+	exit 1
+fi
+echo "ok"
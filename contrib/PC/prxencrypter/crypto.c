@@ -73,7 +73,13 @@
 #include "types.h"
 #include "crypto.h"
 
-#undef FULL_UNROLL
+#define FULL_UNROLL
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_AESNI
+#include <wmmintrin.h>
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif
 
 
 //CMAC GLOBS
@@ -1320,9 +1326,110 @@ rijndael_encrypt(rijndael_ctx *ctx, const u8 *src, u8 *dst)
     rijndaelEncrypt(ctx->ek, ctx->Nr, src, dst);
 }
 
+/* AES backend selection */
+
+static int aes_backend = AES_BACKEND_AUTO;
+
+static int aesni_supported(void)
+{
+#ifdef HAVE_AESNI
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+#else
+    return 0;
+#endif
+}
+
+/* call before spawning threads, AES_BACKEND_AUTO is resolved here */
+int AES_set_backend(int backend)
+{
+    if (backend == AES_BACKEND_AUTO)
+        backend = aesni_supported() ? AES_BACKEND_AESNI : AES_BACKEND_TABLE;
+
+    if (backend == AES_BACKEND_AESNI && !aesni_supported())
+        return -1;
+
+    aes_backend = backend;
+    return 0;
+}
+
+const char *AES_get_backend_name(void)
+{
+    if (aes_backend == AES_BACKEND_AUTO)
+        AES_set_backend(AES_BACKEND_AUTO);
+
+    return (aes_backend == AES_BACKEND_AESNI) ? "aes-ni" : "table";
+}
+
+static int use_aesni(void)
+{
+    if (aes_backend == AES_BACKEND_AUTO)
+        AES_set_backend(AES_BACKEND_AUTO);
+
+    return aes_backend == AES_BACKEND_AESNI;
+}
+
+#ifdef HAVE_AESNI
+/* the round keys are the same as ek[], just stored in byte order */
+
+static AESNI_TARGET inline __m128i aesni_encrypt_block(const u8 *rk, int Nr, __m128i block)
+{
+    int r;
+
+    block = _mm_xor_si128(block, _mm_load_si128((const __m128i *)rk));
+    for (r = 1; r < Nr; r++)
+        block = _mm_aesenc_si128(block, _mm_load_si128((const __m128i *)(rk + 16*r)));
+
+    return _mm_aesenclast_si128(block, _mm_load_si128((const __m128i *)(rk + 16*Nr)));
+}
+
+static AESNI_TARGET void aesni_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst)
+{
+    __m128i block = _mm_loadu_si128((const __m128i *)src);
+    _mm_storeu_si128((__m128i *)dst, aesni_encrypt_block(ctx->rk, ctx->Nr, block));
+}
+
+static AESNI_TARGET void aesni_cbc_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst, int size)
+{
+    __m128i chain = _mm_setzero_si128();
+    int i;
+
+    for (i = 0; i < size; i += 16)
+    {
+        chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i *)(src + i)));
+        chain = aesni_encrypt_block(ctx->rk, ctx->Nr, chain);
+        _mm_storeu_si128((__m128i *)(dst + i), chain);
+    }
+}
+
+/* X := AES(X ^ M) over n full blocks */
+static AESNI_TARGET void aesni_cmac_blocks(AES_ctx *ctx, const u8 *input, int n, u8 *X)
+{
+    __m128i chain = _mm_loadu_si128((const __m128i *)X);
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i *)(input + 16*i)));
+        chain = aesni_encrypt_block(ctx->rk, ctx->Nr, chain);
+    }
+
+    _mm_storeu_si128((__m128i *)X, chain);
+}
+#endif
+
 int AES_set_key(AES_ctx *ctx, const u8 *key, int bits)
 {
-    return rijndael_set_key((rijndael_ctx *)ctx, key, bits);
+    int i, ret;
+
+    ret = rijndael_set_key((rijndael_ctx *)ctx, key, bits);
+    if (ret != 0)
+        return ret;
+
+    for (i = 0; i < 4*(ctx->Nr + 1); i++)
+        PUTU32(ctx->rk + 4*i, ctx->ek[i]);
+
+    return 0;
 }
 
 void AES_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst)
@@ -1332,6 +1439,13 @@ void AES_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst)
 
 void AES_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst)
 {
+#ifdef HAVE_AESNI
+    if (use_aesni())
+    {
+        aesni_encrypt(ctx, src, dst);
+        return;
+    }
+#endif
     return rijndaelEncrypt(ctx->ek, ctx->Nr, src, dst);
 }
 
@@ -1350,6 +1464,15 @@ void AES_cbc_encrypt(AES_ctx *ctx, u8 *src, u8 *dst, int size)
     u8 block_buff[16];
 
     int i;
+
+#ifdef HAVE_AESNI
+    if (use_aesni())
+    {
+        aesni_cbc_encrypt(ctx, src, dst, size);
+        return;
+    }
+#endif
+
     for(i = 0; i < size; i+=16)
     {
         //step 1: copy block to dst
@@ -1489,6 +1612,13 @@ void AES_CMAC (AES_ctx *ctx, unsigned char *input, int length, unsigned char *ma
     }
 
     for ( i=0; i<16; i++ ) X[i] = 0;
+#ifdef HAVE_AESNI
+    if ( use_aesni() )
+    {
+        aesni_cmac_blocks(ctx, input, n-1, X);
+    }
+    else
+#endif
     for ( i=0; i<n-1; i++ )
     {
         xor_128(X,&input[16*i],Y); /* Y := Mi (+) X  */
@@ -1865,6 +1995,13 @@ void AES_CMAC_forge (AES_ctx *ctx, unsigned char *input, int length, unsigned ch
     }
 
     for ( i=0; i<16; i++ ) X[i] = 0;
+#ifdef HAVE_AESNI
+    if ( use_aesni() )
+    {
+        aesni_cmac_blocks(ctx, input, n-1, X);
+    }
+    else
+#endif
     for ( i=0; i<n-1; i++ )
     {
          xor_128(X,&input[16*i],Y); /* Y := Mi (+) X  */
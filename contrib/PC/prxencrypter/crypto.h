@@ -30,13 +30,25 @@ typedef struct
     int    Nr;            /* key-length-dependent number of rounds */
     u32    ek[4*(AES_MAXROUNDS + 1)];    /* encrypt key schedule */
     u32    dk[4*(AES_MAXROUNDS + 1)];    /* decrypt key schedule */
+    u8     rk[16*(AES_MAXROUNDS + 1)] __attribute__((aligned(16)));    /* encrypt key schedule in byte order (AES-NI) */
 } AES_ctx;
 
+/* AES block cipher implementation used by the AES_* functions */
+enum
+{
+    AES_BACKEND_AUTO,    /* AES-NI when the cpu has it, tables otherwise */
+    AES_BACKEND_TABLE,   /* portable T-table code */
+    AES_BACKEND_AESNI,   /* x86 AES instructions */
+};
+
 int rijndael_set_key(rijndael_ctx *, const u8 *, int);
 int    rijndael_set_key_enc_only(rijndael_ctx *, const u8 *, int);
 void rijndael_decrypt(rijndael_ctx *, const u8 *, u8 *);
 void rijndael_encrypt(rijndael_ctx *, const u8 *, u8 *);
 
+int AES_set_backend(int backend);
+const char *AES_get_backend_name(void);
+
 int AES_set_key(AES_ctx *ctx, const u8 *key, int bits);
 void AES_encrypt(AES_ctx *ctx, const u8 *src, u8 *dst);
 void AES_decrypt(AES_ctx *ctx, const u8 *src, u8 *dst);
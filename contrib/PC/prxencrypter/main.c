@@ -3,11 +3,14 @@
 #include <string.h>
 #include <time.h>
 #include <zlib.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "types.h"
 #include "endian.h"
 #include "kirk_engine.h"
 #include "psp_headers.h"
+#include "crypto.h"
 
 // 5MB application
 unsigned char pspHeader_big[336] =
@@ -157,37 +160,50 @@ Header_List header_list[] = {
     {    pspHeader_big    , kirkHeader_big    },
 };
 
-u8 in_buffer[1024*1024*10];
-u8 out_buffer[1024*1024*10];
-
-u8 kirk_raw[1024*1024*10];
-u8 kirk_enc[1024*1024*10];
-u8 elf[1024*1024*10];
-
 typedef struct header_keys
 {
     u8 AES[16];
     u8 CMAC[16];
 }header_keys;
 
-int load_elf(char *elff)
+typedef struct prx_job
+{
+    const char *input;
+    const char *output;
+    int result;
+    int size;
+} prx_job;
+
+static prx_job *jobs;
+static int job_count;
+static int job_next;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+u8 *load_elf(const char *elff, int *size)
 {
     FILE *fp = fopen(elff, "rb");
+    u8 *data;
 
     if(fp == NULL) {
-        return -1;
+        return NULL;
     }
 
     fseek(fp, 0, SEEK_END);
-    int size = ftell(fp);
+    *size = ftell(fp);
     fseek(fp, 0, SEEK_SET);
-    fread(elf, 1, size, fp);
+
+    data = malloc(*size + 1);
+
+    if(data != NULL) {
+        fread(data, 1, *size, fp);
+    }
+
     fclose(fp);
 
-    return size;
+    return data;
 }
 
-int dumpFile(char *name, void *in, int size)
+int dumpFile(const char *name, void *in, int size)
 {
     FILE *fp = fopen(name, "wb");
 
@@ -293,45 +309,52 @@ int gzip_compress(u8 *dst, const u8 *src, int size)
     return 0;
 }
 
-int main(int argc, char **argv)
+int encrypt_prx(const char *input, const char *output)
 {
     header_keys keys;
     u8 rawkheaderBk[0x90];
+    u8 *file, *elf, *kirk_raw, *kirk_enc, *out;
+    int elfSize, elfBufSize, bufSize, ret = -1;
 
-    if(argc < 2)
-    {
-        printf("USAGE: [exe] [prx]\n");
-        return 0;
-    }
-
-    memset(in_buffer, 0, sizeof(in_buffer));
-    memset(out_buffer, 0, sizeof(out_buffer));
-    memset(kirk_raw, 0, sizeof(kirk_raw));
-    memset(kirk_enc, 0, sizeof(kirk_enc));
-    memset(elf, 0, sizeof(elf));
+    file = load_elf(input, &elfSize);
 
-    kirk_init();
+    if(file == NULL) {
+        printf("Cannot open %s\n", input);
 
-    int elfSize = load_elf(argv[1]);
-
-    if(elfSize < 0) {
-        printf("Cannot open %s\n", argv[1]);
-
-        return 0;
+        return -1;
     }
 
     Header_List *target_header = get_header_list( elfSize );
 
     if( target_header == NULL ) {
         printf("PRX SIGNER: Elf is to big\n");
+        free(file);
 
-        return 0;
+        return -1;
     }
 
     u8 *kirkHeader    = target_header->kirkHeader;
     u8 *pspHeader    = target_header->pspHeader;
     int krawSize = get_kirk_size(kirkHeader);
 
+    // compressed headers use their own elf size, which can be past the end of the file:
+    // the rest stays zero, and the gzip output may overwrite just the start of the buffer
+    elfBufSize = (elfSize > get_elf_size(pspHeader)) ? elfSize : get_elf_size(pspHeader);
+    elfBufSize = elfBufSize*2 + 0x1000;
+    bufSize = krawSize + elfBufSize + 0x150;
+
+    elf = calloc(1, elfBufSize);
+    kirk_raw = calloc(1, bufSize);
+    kirk_enc = calloc(1, bufSize);
+    out = malloc(bufSize);
+
+    if(elf == NULL || kirk_raw == NULL || kirk_enc == NULL || out == NULL) {
+        printf("PRX SIGNER: Out of memory\n");
+        goto done;
+    }
+
+    memcpy(elf, file, elfSize);
+
     if (is_compressed(pspHeader)) {
         elfSize = get_elf_size(pspHeader);
         gzip_compress(elf, elf, elfSize);
@@ -344,23 +367,215 @@ int main(int argc, char **argv)
     memcpy(kirk_raw, &keys, sizeof(header_keys));
     memcpy(kirk_raw+0x110, elf, elfSize);
 
-    if(kirk_CMD0(kirk_enc, kirk_raw, sizeof(kirk_enc), 0) != 0)
+    if(kirk_CMD0(kirk_enc, kirk_raw, bufSize, 0) != 0)
     {
         printf("PRX SIGNER: Could not encrypt elf\n");
-        return 0;
+        goto done;
     }
 
     memcpy(kirk_enc, rawkheaderBk, sizeof(rawkheaderBk));
 
-    if(kirk_forge(kirk_enc, sizeof(kirk_enc)) != 0)
+    if(kirk_forge(kirk_enc, bufSize) != 0)
     {
         printf("PRX SIGNER: Could not forge cmac block\n");
+        goto done;
+    }
+
+    memcpy(out, pspHeader, 0x150);
+    memcpy(out+0x150, kirk_enc+0x110, krawSize-0x110);
+
+    ret = dumpFile(output, out, (krawSize-0x110)+0x150);
+
+    if(ret == 0) {
+        ret = (krawSize-0x110)+0x150;
+    }
+
+done:
+    free(out);
+    free(kirk_raw);
+    free(kirk_enc);
+    free(elf);
+    free(file);
+
+    return ret;
+}
+
+static void *encrypt_worker(void *arg)
+{
+    while(1)
+    {
+        pthread_mutex_lock(&job_lock);
+        int i = job_next++;
+        pthread_mutex_unlock(&job_lock);
+
+        if(i >= job_count) break;
+
+        jobs[i].result = encrypt_prx(jobs[i].input, jobs[i].output);
+        jobs[i].size = jobs[i].result;
+    }
+
+    return NULL;
+}
+
+static int run_jobs(int threads)
+{
+    pthread_t *pool;
+    int i, failed = 0;
+
+    job_next = 0;
+
+    if(threads > job_count) threads = job_count;
+    if(threads < 1) threads = 1;
+
+    pool = malloc(sizeof(pthread_t) * threads);
+
+    for(i=0; i<threads; i++) {
+        if(pthread_create(&pool[i], NULL, encrypt_worker, NULL) != 0) {
+            break;
+        }
+    }
+
+    // couldn't start any thread, do the work here
+    if(i == 0) {
+        encrypt_worker(NULL);
+    }
+
+    while(i-- > 0) {
+        pthread_join(pool[i], NULL);
+    }
+
+    free(pool);
+
+    for(i=0; i<job_count; i++) {
+        if(jobs[i].result < 0) {
+            printf("PRX SIGNER: %s failed\n", jobs[i].input);
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void benchmark(int threads)
+{
+    const int size = 16*1024*1024;
+    const u8 key[16] = { 0 };
+    u8 mac[16];
+    AES_ctx ctx;
+    u8 *buf = calloc(1, size);
+    int backend, i;
+    double t;
+
+    for(backend=AES_BACKEND_TABLE; backend<=AES_BACKEND_AESNI; backend++)
+    {
+        if(AES_set_backend(backend) != 0) {
+            continue;
+        }
+
+        AES_set_key(&ctx, key, 128);
+
+        t = now_seconds();
+        AES_CMAC(&ctx, buf, size, mac);
+        t = now_seconds() - t;
+        printf("CMAC (%s): %.1f MB/s\n", AES_get_backend_name(), size / t / (1024*1024));
+
+        if(job_count == 0) {
+            continue;
+        }
+
+        long long total = 0;
+        t = now_seconds();
+        run_jobs(threads);
+        t = now_seconds() - t;
+        for(i=0; i<job_count; i++) {
+            if(jobs[i].size > 0) total += jobs[i].size;
+        }
+        printf("modules (%s, %d threads): %d in %.3fs, %.1f MB/s\n", AES_get_backend_name(), threads, job_count, t, total / t / (1024*1024));
+    }
+
+    AES_set_backend(AES_BACKEND_AUTO);
+    free(buf);
+}
+
+static void usage(void)
+{
+    printf("USAGE: [exe] [prx]\n");
+    printf("       [exe] [-j threads] [-t] [-b] [prx] [out] [prx] [out] ...\n");
+    printf("  -j  number of worker threads (default: number of cpus)\n");
+    printf("  -t  use the portable AES code even if the cpu has AES instructions\n");
+    printf("  -b  report CMAC and module encryption throughput\n");
+}
+
+int main(int argc, char **argv)
+{
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int bench = 0;
+    int i, n;
+
+    for(i=1; i<argc && argv[i][0] == '-'; i++)
+    {
+        if(strcmp(argv[i], "-j") == 0 && i+1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-t") == 0) {
+            AES_set_backend(AES_BACKEND_TABLE);
+        }
+        else if(strcmp(argv[i], "-b") == 0) {
+            bench = 1;
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+
+    n = argc - i;
+
+    if(n < 1 && !bench)
+    {
+        usage();
+        return 0;
+    }
+
+    // a single prx keeps the old behaviour of writing ./data.psp
+    if(n > 1 && (n % 2) != 0)
+    {
+        usage();
+        return 0;
+    }
+
+    kirk_init();
+    AES_get_backend_name();
+
+    job_count = (n > 1) ? n/2 : n;
+    jobs = calloc(job_count+1, sizeof(prx_job));
+
+    if(n == 1) {
+        jobs[0].input = argv[i];
+        jobs[0].output = "./data.psp";
+    }
+    else {
+        for(n=0; n<job_count; n++) {
+            jobs[n].input = argv[i + 2*n];
+            jobs[n].output = argv[i + 2*n + 1];
+        }
+    }
 
+    if(bench) {
+        benchmark(threads);
+        free(jobs);
         return 0;
     }
 
-    memcpy(out_buffer, pspHeader, 0x150);
-    memcpy(out_buffer+0x150, kirk_enc+0x110, krawSize-0x110);
+    n = run_jobs(threads);
+    free(jobs);
 
-    return dumpFile("./data.psp", out_buffer, (krawSize-0x110)+0x150);
+    return (n != 0);
 }
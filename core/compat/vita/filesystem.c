@@ -34,34 +34,24 @@
 
 extern RebootConfigARK* reboot_config;
 
-// sceIoDread Open List Item
+// IoFileMgr Descriptor Count
+#define MAX_OPEN_DIRECTORIES 64
+
+// sceIoDread Open Table Item
 typedef struct OpenDirectory
 {
-    // Previous Item in List
-    struct OpenDirectory * prev;
-    // Next Item in List
-    struct OpenDirectory * next;
-    // Directory File Descriptor
+    // Directory File Descriptor (-1 if unused)
     int fd;
-    // Directory IO Stage
+    // Directory IO Stage (2 once "." and ".." were returned)
     int stage;
-    // sceIoDopen Path
-    char * path;
+    // Folder Status for the fake Entries
+    SceIoStat stat;
 } OpenDirectory;
 
-// Open Directory List
-OpenDirectory * opendirs = NULL;
-
-// Directory IO Semaphore
-static SceUID dreadSema = -1;
-
-// Directory IO Semaphore Lock
-void dreadLock();
-
-// Directory IO Semaphore Unlock
-void dreadUnlock();
+// Open Directory Table (indexed by Descriptor, each Slot only touched by its Descriptor's Owner)
+static OpenDirectory opendirs[MAX_OPEN_DIRECTORIES];
 
-// Directory List Scanner
+// Directory Table Lookup
 OpenDirectory * findOpenDirectory(int fd);
 
 // sceIoAddDrv Hook
@@ -102,8 +92,10 @@ int (* _sceIoUnassign)(const char *dev);
 int (* _sceIoAssign)(const char *dev1, const char *dev2, const char *dev3, int mode, void* unk1, long unk2);
 
 void initFileSystem(){
-    // Create Semaphore
-    dreadSema = sceKernelCreateSema("sceIoDreadSema", 0, 1, 1, NULL);
+    // Empty Directory Table
+    int i;
+    for (i = 0; i < MAX_OPEN_DIRECTORIES; i++)
+        opendirs[i].fd = -1;
 
     // patch Driver
     u32 IoAddDrv = sctrlHENFindFunction("sceIOFileManager", "IoFileMgrForKernel", 0x8E982A74);
@@ -296,43 +288,19 @@ int sceIoAssignHook(const char *dev1, const char *dev2, const char *dev3, int mo
     return _sceIoAssign(dev1, dev2, dev3, mode, unk1, unk2);
 }
 
-// Directory IO Semaphore Lock
-void dreadLock()
+// Directory Table Lookup
+OpenDirectory * findOpenDirectory(int fd)
 {
-    // Elevate Permission Level
-    unsigned int k1 = pspSdkSetK1(0);
-    
-    // Wait for Semaphore & Lock It
-    sceKernelWaitSema(dreadSema, 1, 0);
-    
-    // Restore Permission Level
-    pspSdkSetK1(k1);
-}
+    // Descriptor out of Range
+    if (fd < 0 || fd >= MAX_OPEN_DIRECTORIES)
+        return NULL;
 
-// Directory IO Semaphore Unlock
-void dreadUnlock()
-{
-    // Elevate Permission Level
-    unsigned int k1 = pspSdkSetK1(0);
-    
-    // Unlock Semaphore
-    sceKernelSignalSema(dreadSema, 1);
-    
-    // Restore Permission Level
-    pspSdkSetK1(k1);
-}
+    OpenDirectory * item = &opendirs[fd];
 
-// Directory List Scanner
-OpenDirectory * findOpenDirectory(int fd)
-{
-    // Iterate Open Directory List
-    OpenDirectory * item = opendirs;
+    // Matching File Descriptor
+    if (item->fd == fd)
+        return item;
 
-    for(; item != NULL; item = item->next) {
-        // Matching File Descriptor
-        if (item->fd == fd)
-            return item;
-    }
     // Directory not found
     return NULL;
 }
@@ -344,51 +312,36 @@ int sceIoDopenHook(const char * dirname)
     int result = sceIoDopen(dirname);
 
     // Open Success
-    if (result >= 0 && 0 == strncmp(dirname, "ms0:/", 4)) {
-        // Allocate Memory
-        OpenDirectory * item = (OpenDirectory *)oe_malloc(sizeof(OpenDirectory));
-        
-        // Allocate Success
-        if (item != NULL) {
-            // Clear Memory
-            memset(item, 0, sizeof(OpenDirectory));
-            
-            // Save Descriptor
-            item->fd = result;
+    if (result >= 0 && result < MAX_OPEN_DIRECTORIES) {
+        OpenDirectory * item = &opendirs[result];
+
+        // Forget the previous Owner of this Descriptor, it may have been closed without our Dclose Hook
+        item->fd = -1;
+
+        // Memory Stick Directory
+        if (0 == strncmp(dirname, "ms0:/", 4)) {
+            char path[256];
+            int len;
+
+            // Copy Path without trailing Slashes
+            strncpy(path, dirname, sizeof(path) - 1);
+            path[sizeof(path) - 1] = 0;
+            len = strlen(path);
+
+            while (len > 0 && path[len-1] == '/')
+                path[--len] = 0;
+
+            // Elevate Permission Level
+            unsigned int k1 = pspSdkSetK1(0);
 
-            item->path = (char*)oe_malloc(strlen(dirname) + 1);
-
-            if (item->path == NULL) {
-                oe_free(item);
-                return result;
-            }
-
-            strcpy(item->path, dirname);
-
-            {
-                int len = strlen(item->path);
-
-                while (len > 0 && item->path[len-1] == '/') {
-                    item->path[len-1] = '\0';
-                    len = strlen(item->path);
-                }
-            }
-            
-            // Lock Semaphore
-            dreadLock();
-            
-            // Link Item into List
-            item->next = opendirs;
-
-            if (opendirs != NULL)
-                opendirs->prev = item;
-            
-            // Replace List Start Node
-            opendirs = item;
-            
-            // Unlock Semaphore
-            dreadUnlock();
-            
+            // Fetch Folder Status once for "." and ".."
+            item->stage = (sceIoGetstat(path, &item->stat) == 0) ? 0 : 2;
+
+            // Restore Permission Level
+            pspSdkSetK1(k1);
+
+            // Publish Descriptor last, the Caller doesn't know it yet
+            item->fd = result;
         }
     }
     
@@ -399,60 +352,31 @@ int sceIoDopenHook(const char * dirname)
 // sceIoDread Hook
 int sceIoDreadHook(int fd, SceIoDirent * dir)
 {
-
-    // Lock List Access
-    dreadLock();
-    
-    // Find Directory in List
+    // Find Directory in Table
     OpenDirectory * item = findOpenDirectory(fd);
     
-    // Found Directory in List
-    if (item != NULL) {
-        // Fake Directory Stage
-        if (item->stage < 2) {
-            // Kernel Address Status Structure
-            static SceIoStat stat;
-            int err;
-            
-            // Elevate Permission Level
-            unsigned int k1 = pspSdkSetK1(0);
-            
-            // Fetch Folder Status
-            err = sceIoGetstat(item->path, &stat);
-
-            // Restore Permission Level
-            pspSdkSetK1(k1);
-
-            // Valid Output Argument
-            if (err == 0 && dir != NULL) {
-                // Clear Memory
-                memset(dir, 0, sizeof(SceIoDirent));
-                
-                // Copy Status
-                memcpy(&dir->d_stat, &stat, sizeof(stat));
-                
-                dir->d_name[0] = '.';
-                dir->d_name[1] = '.';
-                
-                // Fake "." Output Stage
-                if (item->stage == 0) {
-                    dir->d_name[1] = 0;
-                }
-                
-                // Move to next Stage
-                item->stage++;
-                
-                // Unlock List Access
-                dreadUnlock();
-                
-                // Return "More files"
-                return 1;
-            }
+    // Fake Directory Stage
+    if (item != NULL && item->stage < 2 && dir != NULL) {
+        // Clear Memory
+        memset(dir, 0, sizeof(SceIoDirent));
+        
+        // Copy Status
+        memcpy(&dir->d_stat, &item->stat, sizeof(item->stat));
+        
+        dir->d_name[0] = '.';
+        dir->d_name[1] = '.';
+        
+        // Fake "." Output Stage
+        if (item->stage == 0) {
+            dir->d_name[1] = 0;
         }
+        
+        // Move to next Stage
+        item->stage++;
+        
+        // Return "More files"
+        return 1;
     }
-
-    // Unlock List Access
-    dreadUnlock();
     
     // Forward Call
     return sceIoDread(fd, dir);
@@ -461,32 +385,9 @@ int sceIoDreadHook(int fd, SceIoDirent * dir)
 // sceIoDclose Hook
 int sceIoDcloseHook(int fd)
 {
-    // Lock Semaphore
-    dreadLock();
-    
-    // Find Directory in List
-    OpenDirectory * item = findOpenDirectory(fd);
-    
-    // Found Directory in List
-    if (item != NULL) {
-        // Unlink Item from List
-        if (item->prev != NULL)
-            item->prev->next = item->next;
-        else
-            opendirs = item->next;
-
-        if (item->next != NULL)
-            item->next->prev = item->prev;
-
-        // Free path string
-        oe_free(item->path);
-        
-        // Return Memory to Heap
-        oe_free(item);
-    }
-    
-    // Unlock Semaphore
-    dreadUnlock();
+    // Release Slot before the Descriptor can be reused, whoever opened it
+    if (fd >= 0 && fd < MAX_OPEN_DIRECTORIES)
+        opendirs[fd].fd = -1;
         
     // Forward Call
     return sceIoDclose(fd);
@@ -0,0 +1,251 @@
+/*
+    host test for the Vita sceIoDopen/Dread/Dclose hooks (filesystem.c)
+
+    The Makefile cuts the descriptor table and the three hooks out of
+    filesystem.c into dirhooks.h; they run here against a fake IO manager
+    that hands out the lowest free descriptor like IoFileMgr does.
+    - ms0: listings start with exactly one "." and one "..", others don't
+    - a descriptor closed without the Dclose hook, before or after the
+      fake entries were read, lists like a fresh one when it is handed
+      out again for ms0 or anything else
+    - reader threads open, list and close at random, some stopping early
+      or closing behind the hooks' back, and every listing is checked
+
+    dirtest         runs the checks, fails on a wrong listing
+    dirtest -b      listings per second for 1-8 readers; the getstat
+                    (200us) and every dread (20us) sleep
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef struct
+{
+    uint16_t year, month, day, hour, minute, second;
+    uint32_t microsecond;
+} ScePspDateTime;
+
+typedef struct
+{
+    int st_mode;
+    unsigned int st_attr;
+    int64_t st_size;
+    ScePspDateTime st_ctime, st_atime, st_mtime;
+    unsigned int st_private[6];
+} SceIoStat;
+
+typedef struct
+{
+    SceIoStat d_stat;
+    char d_name[256];
+    void * d_private;
+    int dummy;
+} SceIoDirent;
+
+#define MAX_FDS 64
+#define ENTRIES 40
+
+static pthread_mutex_t fd_lock = PTHREAD_MUTEX_INITIALIZER;
+static int fd_used[MAX_FDS], fd_pos[MAX_FDS];
+static int sleeping;
+static long bad;
+
+static unsigned int pspSdkSetK1(unsigned int k1)
+{
+    return 0;
+}
+
+static void io_wait(long ns)
+{
+    struct timespec t = { 0, ns };
+
+    if (sleeping)
+        nanosleep(&t, NULL);
+}
+
+static int sceIoGetstat(const char * path, SceIoStat * stat)
+{
+    memset(stat, 0, sizeof(*stat));
+    stat->st_mode = 0x11FF;
+    io_wait(200000);
+    return 0;
+}
+
+static int sceIoDopen(const char * path)
+{
+    int fd;
+
+    pthread_mutex_lock(&fd_lock);
+    for (fd = 3; fd < MAX_FDS && fd_used[fd]; fd++)
+        ;
+    if (fd < MAX_FDS) {
+        fd_used[fd] = 1;
+        fd_pos[fd] = 0;
+    }
+    pthread_mutex_unlock(&fd_lock);
+
+    return (fd < MAX_FDS) ? fd : -1;
+}
+
+static int sceIoDread(int fd, SceIoDirent * dir)
+{
+    if (fd_pos[fd] >= ENTRIES)
+        return 0;
+
+    memset(dir, 0, sizeof(*dir));
+    snprintf(dir->d_name, sizeof(dir->d_name), "ENTRY%02d", fd_pos[fd]++);
+    io_wait(20000);
+    return 1;
+}
+
+static int sceIoDclose(int fd)
+{
+    pthread_mutex_lock(&fd_lock);
+    fd_used[fd] = 0;
+    pthread_mutex_unlock(&fd_lock);
+    return 0;
+}
+
+#include "dirhooks.h"
+
+static void init(void)
+{
+    int i;
+
+    for (i = 0; i < MAX_OPEN_DIRECTORIES; i++)
+        opendirs[i].fd = -1;
+}
+
+// list up to max entries of dirname through the hooks (all if max < 0),
+// 0 if they came out as expected
+static int list(const char * dirname, int max, int hooked_close)
+{
+    SceIoDirent dir;
+    int fd = sceIoDopenHook(dirname);
+    int fake = (strncmp(dirname, "ms0:/", 4) == 0);
+    int n = 0, ok = 1;
+
+    if (fd < 0)
+        return -1;
+
+    while (n != max && sceIoDreadHook(fd, &dir) > 0) {
+        const char * want = (fake && n == 0) ? "." : (fake && n == 1) ? ".." : NULL;
+
+        if (want != NULL)
+            ok &= (strcmp(dir.d_name, want) == 0 && dir.d_stat.st_mode == 0x11FF);
+        else
+            ok &= (dir.d_name[0] != '.');
+        n++;
+    }
+
+    if (max < 0)
+        ok &= (n == ENTRIES + (fake ? 2 : 0));
+
+    if (hooked_close)
+        sceIoDcloseHook(fd);
+    else
+        sceIoDclose(fd);
+
+    return ok ? 0 : -1;
+}
+
+static void expect(const char * what, int res)
+{
+    if (res != 0) {
+        printf("  %s: wrong listing\n", what);
+        bad++;
+    }
+}
+
+static void test_reuse(void)
+{
+    init();
+
+    expect("ms0 listing", list("ms0:/PSP/GAME/", -1, 1));
+    expect("flash0 listing", list("flash0:/vsh/", -1, 1));
+
+    // closed behind the hooks' back, the next open gets the same descriptor
+    expect("ms0, left in the table", list("ms0:/PSP/GAME", 0, 0));
+    expect("flash0 on a stale descriptor", list("flash0:/kd/", -1, 1));
+
+    expect("ms0, left in the table", list("ms0:/PSP/SAVEDATA/", 1, 0));
+    expect("ms0 on a stale descriptor", list("ms0:/ISO/", -1, 1));
+
+    expect("ms0, left in the table", list("ms0:/PSP/", -1, 0));
+    expect("ms0 on a stale descriptor", list("ms0:/", -1, 1));
+}
+
+static volatile int stop;
+
+static void * reader(void * arg)
+{
+    long * count = arg;
+    unsigned int seed = (unsigned int)(uintptr_t)arg;
+
+    while (!stop) {
+        // the benchmark always lists ms0 to the end and closes through the hook
+        int r = sleeping ? 7 : rand_r(&seed);
+        const char * dirname = (r & 1) ? "ms0:/PSP/GAME/" : "host0:/";
+
+        if (list(dirname, (r & 8) ? (r >> 4) % 3 : -1, (r & 6) != 0) != 0)
+            __sync_fetch_and_add(&bad, 1);
+
+        (*count)++;
+    }
+
+    return NULL;
+}
+
+static long run_readers(int threads, long ms)
+{
+    pthread_t th[8];
+    long count[8] = { 0 }, total = 0;
+    struct timespec t = { ms / 1000, (ms % 1000) * 1000000 };
+    int i;
+
+    init();
+    stop = 0;
+
+    for (i = 0; i < threads; i++)
+        pthread_create(&th[i], NULL, reader, &count[i]);
+
+    nanosleep(&t, NULL);
+    stop = 1;
+
+    for (i = 0; i < threads; i++) {
+        pthread_join(th[i], NULL);
+        total += count[i];
+    }
+
+    return total;
+}
+
+int main(int argc, char ** argv)
+{
+    int threads;
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        sleeping = 1;
+        for (threads = 1; threads <= 8; threads *= 2)
+            printf("%d readers: %5ld listings/s\n", threads, run_readers(threads, 1000));
+        printf(bad ? "FAILED\n" : "ok\n");
+        return bad != 0;
+    }
+
+    test_reuse();
+
+    for (threads = 1; threads <= 8; threads *= 2) {
+        long listings = run_readers(threads, 300);
+        printf("%d readers: %ld listings\n", threads, listings);
+    }
+
+    if (bad)
+        printf("%ld wrong listings\n", bad);
+
+    printf(bad ? "FAILED\n" : "ok\n");
+    return bad != 0;
+}
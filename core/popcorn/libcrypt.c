@@ -1,253 +1,286 @@
 #include <pspkernel.h>
+#include <string.h>
+#include <macros.h>
+
+// LibCrypt protected titles and their magic word, sorted by disc id.
+// The id "_SLES_01234" is packed as (prefix << 17) | 1234 so a lookup is a
+// binary search over integers, keep the table sorted when adding titles.
+
+#define LIBCRYPT_SCES 0
+#define LIBCRYPT_SLES 1
+#define LIBCRYPT_ID(prefix, number) ((LIBCRYPT_##prefix << 17) | (number))
+
+#define DISCID_LEN 11 // "_SLES_01234"
 
 struct mw {
-       char *discid;
-       u32 mw;
+    u32 id;
+    u32 mw;
 };
 
-struct mw magic_words[] = {
-       {"_SCES_00311", 34730},
-       {"_SCES_01431", 25927},
-       {"_SCES_01444", 48452},
-       {"_SCES_01492", 53610},
-       {"_SCES_01493", 6522},
-       {"_SCES_01494", 43686},
-       {"_SCES_01495", 3671},
-       {"_SCES_01516", 17654},
-       {"_SCES_01517", 44677},
-       {"_SCES_01518", 39975},
-       {"_SCES_01519", 13899},
-       {"_SCES_01564", 52929},
-       {"_SCES_01695", 35306},
-       {"_SCES_01700", 18199},
-       {"_SCES_01701", 50334},
-       {"_SCES_01702", 26410},
-       {"_SCES_01703", 34879},
-       {"_SCES_01704", 52786},
-       {"_SCES_01763", 2415},
-       {"_SCES_01882", 45924},
-       {"_SCES_01909", 59272},
-       {"_SCES_01979", 3485},
-       {"_SCES_02004", 50231},
-       {"_SCES_02005", 37175},
-       {"_SCES_02006", 30036},
-       {"_SCES_02007", 59014},
-       {"_SCES_02028", 39636},
-       {"_SCES_02029", 9910},
-       {"_SCES_02030", 9177},
-       {"_SCES_02031", 54053},
-       {"_SCES_02080", 40416},
-       {"_SCES_02104", 29771},
-       {"_SCES_02105", 41841},
-       {"_SCES_02181", 32132},
-       {"_SCES_02182", 43213},
-       {"_SCES_02184", 7772},
-       {"_SCES_02185", 29924},
-       {"_SCES_02222", 42232},
-       {"_SCES_02264", 3646},
-       {"_SCES_02269", 30215},
-       {"_SCES_02290", 4823},
-       {"_SCES_02365", 7388},
-       {"_SCES_02366", 54984},
-       {"_SCES_02367", 38566},
-       {"_SCES_02368", 23591},
-       {"_SCES_02369", 56357},
-       {"_SCES_02430", 45401},
-       {"_SCES_02431", 30834},
-       {"_SCES_02432", 5038},
-       {"_SCES_02433", 46347},
-       {"_SCES_02487", 31440},
-       {"_SCES_02488", 35215},
-       {"_SCES_02489", 9706},
-       {"_SCES_02490", 3948},
-       {"_SCES_02491", 61467},
-       {"_SCES_02544", 14871},
-       {"_SCES_02545", 43372},
-       {"_SCES_02546", 14218},
-       {"_SCES_02834", 59176},
-       {"_SCES_02835", 13978},
-       {"_SLES_00017", 58040},
-       {"_SLES_00995", 35761},
-       {"_SLES_01041", 25367},
-       {"_SLES_01226", 999},
-       {"_SLES_01241", 58131},
-       {"_SLES_01301", 46882},
-       {"_SLES_01362", 27814},
-       {"_SLES_01545", 42318},
-       {"_SLES_01715", 42228},
-       {"_SLES_01733", 45165},
-       {"_SLES_01906", 5357},
-       {"_SLES_01907", 49390},
-       {"_SLES_01943", 28775},
-       {"_SLES_02024", 7025},
-       {"_SLES_02025", 51790},
-       {"_SLES_02026", 4463},
-       {"_SLES_02027", 14947},
-       {"_SLES_02061", 35509},
-       {"_SLES_02071", 10037},
-       {"_SLES_02080", 40416},
-       {"_SLES_02081", 26679},
-       {"_SLES_02082", 27019},
-       {"_SLES_02083", 38093},
-       {"_SLES_02084", 17597},
-       {"_SLES_02086", 5876},
-       {"_SLES_02112", 44868},
-       {"_SLES_02113", 22679},
-       {"_SLES_02118", 28080},
-       {"_SLES_02207", 14956},
-       {"_SLES_02208", 29097},
-       {"_SLES_02209", 9942},
-       {"_SLES_02210", 25389},
-       {"_SLES_02211", 6743},
-       {"_SLES_02292", 34546},
-       {"_SLES_02293", 47749},
-       {"_SLES_02328", 16162},
-       {"_SLES_02329", 40248},
-       {"_SLES_02330", 57405},
-       {"_SLES_02354", 25833},
-       {"_SLES_02355", 19174},
-       {"_SLES_02395", 43689},
-       {"_SLES_02396", 42346},
-       {"_SLES_02402", 43578},
-       {"_SLES_02529", 44400},
-       {"_SLES_02530", 31779},
-       {"_SLES_02531", 44216},
-       {"_SLES_02532", 7229},
-       {"_SLES_02533", 60042},
-       {"_SLES_02538", 25427},
-       {"_SLES_02558", 54752},
-       {"_SLES_02559", 22293},
-       {"_SLES_02560", 56104},
-       {"_SLES_02561", 60037},
-       {"_SLES_02562", 15764},
-       {"_SLES_02563", 19299},
-       {"_SLES_02572", 14684},
-       {"_SLES_02573", 21859},
-       {"_SLES_02681", 7367},
-       {"_SLES_02688", 29544},
-       {"_SLES_02689", 57810},
-       {"_SLES_02698", 7325},
-       {"_SLES_02700", 10200},
-       {"_SLES_02704", 28958},
-       {"_SLES_02705", 19117},
-       {"_SLES_02706", 7857},
-       {"_SLES_02707", 44337},
-       {"_SLES_02708", 24260},
-       {"_SLES_02722", 46730},
-       {"_SLES_02723", 4080},
-       {"_SLES_02724", 52884},
-       {"_SLES_02733", 46605},
-       {"_SLES_02754", 8129},
-       {"_SLES_02755", 22807},
-       {"_SLES_02756", 57462},
-       {"_SLES_02763", 30886},
-       {"_SLES_02766", 38991},
-       {"_SLES_02767", 43845},
-       {"_SLES_02768", 40296},
-       {"_SLES_02769", 12510},
-       {"_SLES_02824", 45957},
-       {"_SLES_02830", 25276},
-       {"_SLES_02831", 1502},
-       {"_SLES_02839", 51993},
-       {"_SLES_02857", 24330},
-       {"_SLES_02858", 15898},
-       {"_SLES_02859", 9566},
-       {"_SLES_02860", 42898},
-       {"_SLES_02861", 51420},
-       {"_SLES_02862", 50129},
-       {"_SLES_02965", 46792},
-       {"_SLES_02966", 52897},
-       {"_SLES_02967", 29274},
-       {"_SLES_02968", 58646},
-       {"_SLES_02969", 60513},
-       {"_SLES_02975", 31377},
-       {"_SLES_02976", 25927},
-       {"_SLES_02977", 47245},
-       {"_SLES_02978", 23315},
-       {"_SLES_02979", 12106},
-       {"_SLES_03061", 3198},
-       {"_SLES_03062", 45261},
-       {"_SLES_03189", 19404},
-       {"_SLES_03190", 28943},
-       {"_SLES_03191", 27285},
-       {"_SLES_03241", 31618},
-       {"_SLES_03242", 42856},
-       {"_SLES_03243", 10097},
-       {"_SLES_03244", 5527},
-       {"_SLES_03245", 1495},
-       {"_SLES_03324", 52529},
-       {"_SLES_03489", 37039},
-       {"_SLES_03519", 47892},
-       {"_SLES_03520", 38520},
-       {"_SLES_03521", 64288},
-       {"_SLES_03522", 51982},
-       {"_SLES_03523", 12540},
-       {"_SLES_03530", 37872},
-       {"_SLES_03603", 23241},
-       {"_SLES_03604", 6510},
-       {"_SLES_03605", 61778},
-       {"_SLES_03606", 50644},
-       {"_SLES_03607", 35387},
-       {"_SLES_03626", 20259},
-       {"_SLES_03648", 26937},
-       {"_SLES_12080", 40416},
-       {"_SLES_12081", 26679},
-       {"_SLES_12082", 27019},
-       {"_SLES_12083", 38093},
-       {"_SLES_12084", 17597},
-       {"_SLES_12328", 19180},
-       {"_SLES_12329", 40248},
-       {"_SLES_12330", 56835},
-       {"_SLES_12558", 54752},
-       {"_SLES_12559", 22293},
-       {"_SLES_12560", 56104},
-       {"_SLES_12561", 60037},
-       {"_SLES_12562", 15764},
-       {"_SLES_12965", 41427},
-       {"_SLES_12966", 38705},
-       {"_SLES_12967", 55574},
-       {"_SLES_12968", 21583},
-       {"_SLES_12969", 25691},
-       {"_SLES_22080", 40416},
-       {"_SLES_22081", 26679},
-       {"_SLES_22082", 27019},
-       {"_SLES_22083", 38093},
-       {"_SLES_22084", 17597},
-       {"_SLES_22328", 28883},
-       {"_SLES_22329", 40248},
-       {"_SLES_22330", 9067},
-       {"_SLES_22965", 28098},
-       {"_SLES_22966", 51315},
-       {"_SLES_22967", 6581},
-       {"_SLES_22968", 16847},
-       {"_SLES_22969", 26166},
-       {"_SLES_32080", 40416},
-       {"_SLES_32081", 26679},
-       {"_SLES_32082", 27019},
-       {"_SLES_32083", 38093},
-       {"_SLES_32084", 17597},
-       {"_SLES_32965", 7877},
-       {"_SLES_32966", 13777},
-       {"_SLES_32967", 21709},
-       {"_SLES_32968", 50717},
-       {"_SLES_32969", 59587},
+static const struct mw magic_words[] = {
+    { LIBCRYPT_ID(SCES, 311), 34730 },
+    { LIBCRYPT_ID(SCES, 1431), 25927 },
+    { LIBCRYPT_ID(SCES, 1444), 48452 },
+    { LIBCRYPT_ID(SCES, 1492), 53610 },
+    { LIBCRYPT_ID(SCES, 1493), 6522 },
+    { LIBCRYPT_ID(SCES, 1494), 43686 },
+    { LIBCRYPT_ID(SCES, 1495), 3671 },
+    { LIBCRYPT_ID(SCES, 1516), 17654 },
+    { LIBCRYPT_ID(SCES, 1517), 44677 },
+    { LIBCRYPT_ID(SCES, 1518), 39975 },
+    { LIBCRYPT_ID(SCES, 1519), 13899 },
+    { LIBCRYPT_ID(SCES, 1564), 52929 },
+    { LIBCRYPT_ID(SCES, 1695), 35306 },
+    { LIBCRYPT_ID(SCES, 1700), 18199 },
+    { LIBCRYPT_ID(SCES, 1701), 50334 },
+    { LIBCRYPT_ID(SCES, 1702), 26410 },
+    { LIBCRYPT_ID(SCES, 1703), 34879 },
+    { LIBCRYPT_ID(SCES, 1704), 52786 },
+    { LIBCRYPT_ID(SCES, 1763), 2415 },
+    { LIBCRYPT_ID(SCES, 1882), 45924 },
+    { LIBCRYPT_ID(SCES, 1909), 59272 },
+    { LIBCRYPT_ID(SCES, 1979), 3485 },
+    { LIBCRYPT_ID(SCES, 2004), 50231 },
+    { LIBCRYPT_ID(SCES, 2005), 37175 },
+    { LIBCRYPT_ID(SCES, 2006), 30036 },
+    { LIBCRYPT_ID(SCES, 2007), 59014 },
+    { LIBCRYPT_ID(SCES, 2028), 39636 },
+    { LIBCRYPT_ID(SCES, 2029), 9910 },
+    { LIBCRYPT_ID(SCES, 2030), 9177 },
+    { LIBCRYPT_ID(SCES, 2031), 54053 },
+    { LIBCRYPT_ID(SCES, 2080), 40416 },
+    { LIBCRYPT_ID(SCES, 2104), 29771 },
+    { LIBCRYPT_ID(SCES, 2105), 41841 },
+    { LIBCRYPT_ID(SCES, 2181), 32132 },
+    { LIBCRYPT_ID(SCES, 2182), 43213 },
+    { LIBCRYPT_ID(SCES, 2184), 7772 },
+    { LIBCRYPT_ID(SCES, 2185), 29924 },
+    { LIBCRYPT_ID(SCES, 2222), 42232 },
+    { LIBCRYPT_ID(SCES, 2264), 3646 },
+    { LIBCRYPT_ID(SCES, 2269), 30215 },
+    { LIBCRYPT_ID(SCES, 2290), 4823 },
+    { LIBCRYPT_ID(SCES, 2365), 7388 },
+    { LIBCRYPT_ID(SCES, 2366), 54984 },
+    { LIBCRYPT_ID(SCES, 2367), 38566 },
+    { LIBCRYPT_ID(SCES, 2368), 23591 },
+    { LIBCRYPT_ID(SCES, 2369), 56357 },
+    { LIBCRYPT_ID(SCES, 2430), 45401 },
+    { LIBCRYPT_ID(SCES, 2431), 30834 },
+    { LIBCRYPT_ID(SCES, 2432), 5038 },
+    { LIBCRYPT_ID(SCES, 2433), 46347 },
+    { LIBCRYPT_ID(SCES, 2487), 31440 },
+    { LIBCRYPT_ID(SCES, 2488), 35215 },
+    { LIBCRYPT_ID(SCES, 2489), 9706 },
+    { LIBCRYPT_ID(SCES, 2490), 3948 },
+    { LIBCRYPT_ID(SCES, 2491), 61467 },
+    { LIBCRYPT_ID(SCES, 2544), 14871 },
+    { LIBCRYPT_ID(SCES, 2545), 43372 },
+    { LIBCRYPT_ID(SCES, 2546), 14218 },
+    { LIBCRYPT_ID(SCES, 2834), 59176 },
+    { LIBCRYPT_ID(SCES, 2835), 13978 },
+    { LIBCRYPT_ID(SLES, 17), 58040 },
+    { LIBCRYPT_ID(SLES, 995), 35761 },
+    { LIBCRYPT_ID(SLES, 1041), 25367 },
+    { LIBCRYPT_ID(SLES, 1226), 999 },
+    { LIBCRYPT_ID(SLES, 1241), 58131 },
+    { LIBCRYPT_ID(SLES, 1301), 46882 },
+    { LIBCRYPT_ID(SLES, 1362), 27814 },
+    { LIBCRYPT_ID(SLES, 1545), 42318 },
+    { LIBCRYPT_ID(SLES, 1715), 42228 },
+    { LIBCRYPT_ID(SLES, 1733), 45165 },
+    { LIBCRYPT_ID(SLES, 1906), 5357 },
+    { LIBCRYPT_ID(SLES, 1907), 49390 },
+    { LIBCRYPT_ID(SLES, 1943), 28775 },
+    { LIBCRYPT_ID(SLES, 2024), 7025 },
+    { LIBCRYPT_ID(SLES, 2025), 51790 },
+    { LIBCRYPT_ID(SLES, 2026), 4463 },
+    { LIBCRYPT_ID(SLES, 2027), 14947 },
+    { LIBCRYPT_ID(SLES, 2061), 35509 },
+    { LIBCRYPT_ID(SLES, 2071), 10037 },
+    { LIBCRYPT_ID(SLES, 2080), 40416 },
+    { LIBCRYPT_ID(SLES, 2081), 26679 },
+    { LIBCRYPT_ID(SLES, 2082), 27019 },
+    { LIBCRYPT_ID(SLES, 2083), 38093 },
+    { LIBCRYPT_ID(SLES, 2084), 17597 },
+    { LIBCRYPT_ID(SLES, 2086), 5876 },
+    { LIBCRYPT_ID(SLES, 2112), 44868 },
+    { LIBCRYPT_ID(SLES, 2113), 22679 },
+    { LIBCRYPT_ID(SLES, 2118), 28080 },
+    { LIBCRYPT_ID(SLES, 2207), 14956 },
+    { LIBCRYPT_ID(SLES, 2208), 29097 },
+    { LIBCRYPT_ID(SLES, 2209), 9942 },
+    { LIBCRYPT_ID(SLES, 2210), 25389 },
+    { LIBCRYPT_ID(SLES, 2211), 6743 },
+    { LIBCRYPT_ID(SLES, 2292), 34546 },
+    { LIBCRYPT_ID(SLES, 2293), 47749 },
+    { LIBCRYPT_ID(SLES, 2328), 16162 },
+    { LIBCRYPT_ID(SLES, 2329), 40248 },
+    { LIBCRYPT_ID(SLES, 2330), 57405 },
+    { LIBCRYPT_ID(SLES, 2354), 25833 },
+    { LIBCRYPT_ID(SLES, 2355), 19174 },
+    { LIBCRYPT_ID(SLES, 2395), 43689 },
+    { LIBCRYPT_ID(SLES, 2396), 42346 },
+    { LIBCRYPT_ID(SLES, 2402), 43578 },
+    { LIBCRYPT_ID(SLES, 2529), 44400 },
+    { LIBCRYPT_ID(SLES, 2530), 31779 },
+    { LIBCRYPT_ID(SLES, 2531), 44216 },
+    { LIBCRYPT_ID(SLES, 2532), 7229 },
+    { LIBCRYPT_ID(SLES, 2533), 60042 },
+    { LIBCRYPT_ID(SLES, 2538), 25427 },
+    { LIBCRYPT_ID(SLES, 2558), 54752 },
+    { LIBCRYPT_ID(SLES, 2559), 22293 },
+    { LIBCRYPT_ID(SLES, 2560), 56104 },
+    { LIBCRYPT_ID(SLES, 2561), 60037 },
+    { LIBCRYPT_ID(SLES, 2562), 15764 },
+    { LIBCRYPT_ID(SLES, 2563), 19299 },
+    { LIBCRYPT_ID(SLES, 2572), 14684 },
+    { LIBCRYPT_ID(SLES, 2573), 21859 },
+    { LIBCRYPT_ID(SLES, 2681), 7367 },
+    { LIBCRYPT_ID(SLES, 2688), 29544 },
+    { LIBCRYPT_ID(SLES, 2689), 57810 },
+    { LIBCRYPT_ID(SLES, 2698), 7325 },
+    { LIBCRYPT_ID(SLES, 2700), 10200 },
+    { LIBCRYPT_ID(SLES, 2704), 28958 },
+    { LIBCRYPT_ID(SLES, 2705), 19117 },
+    { LIBCRYPT_ID(SLES, 2706), 7857 },
+    { LIBCRYPT_ID(SLES, 2707), 44337 },
+    { LIBCRYPT_ID(SLES, 2708), 24260 },
+    { LIBCRYPT_ID(SLES, 2722), 46730 },
+    { LIBCRYPT_ID(SLES, 2723), 4080 },
+    { LIBCRYPT_ID(SLES, 2724), 52884 },
+    { LIBCRYPT_ID(SLES, 2733), 46605 },
+    { LIBCRYPT_ID(SLES, 2754), 8129 },
+    { LIBCRYPT_ID(SLES, 2755), 22807 },
+    { LIBCRYPT_ID(SLES, 2756), 57462 },
+    { LIBCRYPT_ID(SLES, 2763), 30886 },
+    { LIBCRYPT_ID(SLES, 2766), 38991 },
+    { LIBCRYPT_ID(SLES, 2767), 43845 },
+    { LIBCRYPT_ID(SLES, 2768), 40296 },
+    { LIBCRYPT_ID(SLES, 2769), 12510 },
+    { LIBCRYPT_ID(SLES, 2824), 45957 },
+    { LIBCRYPT_ID(SLES, 2830), 25276 },
+    { LIBCRYPT_ID(SLES, 2831), 1502 },
+    { LIBCRYPT_ID(SLES, 2839), 51993 },
+    { LIBCRYPT_ID(SLES, 2857), 24330 },
+    { LIBCRYPT_ID(SLES, 2858), 15898 },
+    { LIBCRYPT_ID(SLES, 2859), 9566 },
+    { LIBCRYPT_ID(SLES, 2860), 42898 },
+    { LIBCRYPT_ID(SLES, 2861), 51420 },
+    { LIBCRYPT_ID(SLES, 2862), 50129 },
+    { LIBCRYPT_ID(SLES, 2965), 46792 },
+    { LIBCRYPT_ID(SLES, 2966), 52897 },
+    { LIBCRYPT_ID(SLES, 2967), 29274 },
+    { LIBCRYPT_ID(SLES, 2968), 58646 },
+    { LIBCRYPT_ID(SLES, 2969), 60513 },
+    { LIBCRYPT_ID(SLES, 2975), 31377 },
+    { LIBCRYPT_ID(SLES, 2976), 25927 },
+    { LIBCRYPT_ID(SLES, 2977), 47245 },
+    { LIBCRYPT_ID(SLES, 2978), 23315 },
+    { LIBCRYPT_ID(SLES, 2979), 12106 },
+    { LIBCRYPT_ID(SLES, 3061), 3198 },
+    { LIBCRYPT_ID(SLES, 3062), 45261 },
+    { LIBCRYPT_ID(SLES, 3189), 19404 },
+    { LIBCRYPT_ID(SLES, 3190), 28943 },
+    { LIBCRYPT_ID(SLES, 3191), 27285 },
+    { LIBCRYPT_ID(SLES, 3241), 31618 },
+    { LIBCRYPT_ID(SLES, 3242), 42856 },
+    { LIBCRYPT_ID(SLES, 3243), 10097 },
+    { LIBCRYPT_ID(SLES, 3244), 5527 },
+    { LIBCRYPT_ID(SLES, 3245), 1495 },
+    { LIBCRYPT_ID(SLES, 3324), 52529 },
+    { LIBCRYPT_ID(SLES, 3489), 37039 },
+    { LIBCRYPT_ID(SLES, 3519), 47892 },
+    { LIBCRYPT_ID(SLES, 3520), 38520 },
+    { LIBCRYPT_ID(SLES, 3521), 64288 },
+    { LIBCRYPT_ID(SLES, 3522), 51982 },
+    { LIBCRYPT_ID(SLES, 3523), 12540 },
+    { LIBCRYPT_ID(SLES, 3530), 37872 },
+    { LIBCRYPT_ID(SLES, 3603), 23241 },
+    { LIBCRYPT_ID(SLES, 3604), 6510 },
+    { LIBCRYPT_ID(SLES, 3605), 61778 },
+    { LIBCRYPT_ID(SLES, 3606), 50644 },
+    { LIBCRYPT_ID(SLES, 3607), 35387 },
+    { LIBCRYPT_ID(SLES, 3626), 20259 },
+    { LIBCRYPT_ID(SLES, 3648), 26937 },
+    { LIBCRYPT_ID(SLES, 12080), 40416 },
+    { LIBCRYPT_ID(SLES, 12081), 26679 },
+    { LIBCRYPT_ID(SLES, 12082), 27019 },
+    { LIBCRYPT_ID(SLES, 12083), 38093 },
+    { LIBCRYPT_ID(SLES, 12084), 17597 },
+    { LIBCRYPT_ID(SLES, 12328), 19180 },
+    { LIBCRYPT_ID(SLES, 12329), 40248 },
+    { LIBCRYPT_ID(SLES, 12330), 56835 },
+    { LIBCRYPT_ID(SLES, 12558), 54752 },
+    { LIBCRYPT_ID(SLES, 12559), 22293 },
+    { LIBCRYPT_ID(SLES, 12560), 56104 },
+    { LIBCRYPT_ID(SLES, 12561), 60037 },
+    { LIBCRYPT_ID(SLES, 12562), 15764 },
+    { LIBCRYPT_ID(SLES, 12965), 41427 },
+    { LIBCRYPT_ID(SLES, 12966), 38705 },
+    { LIBCRYPT_ID(SLES, 12967), 55574 },
+    { LIBCRYPT_ID(SLES, 12968), 21583 },
+    { LIBCRYPT_ID(SLES, 12969), 25691 },
+    { LIBCRYPT_ID(SLES, 22080), 40416 },
+    { LIBCRYPT_ID(SLES, 22081), 26679 },
+    { LIBCRYPT_ID(SLES, 22082), 27019 },
+    { LIBCRYPT_ID(SLES, 22083), 38093 },
+    { LIBCRYPT_ID(SLES, 22084), 17597 },
+    { LIBCRYPT_ID(SLES, 22328), 28883 },
+    { LIBCRYPT_ID(SLES, 22329), 40248 },
+    { LIBCRYPT_ID(SLES, 22330), 9067 },
+    { LIBCRYPT_ID(SLES, 22965), 28098 },
+    { LIBCRYPT_ID(SLES, 22966), 51315 },
+    { LIBCRYPT_ID(SLES, 22967), 6581 },
+    { LIBCRYPT_ID(SLES, 22968), 16847 },
+    { LIBCRYPT_ID(SLES, 22969), 26166 },
+    { LIBCRYPT_ID(SLES, 32080), 40416 },
+    { LIBCRYPT_ID(SLES, 32081), 26679 },
+    { LIBCRYPT_ID(SLES, 32082), 27019 },
+    { LIBCRYPT_ID(SLES, 32083), 38093 },
+    { LIBCRYPT_ID(SLES, 32084), 17597 },
+    { LIBCRYPT_ID(SLES, 32965), 7877 },
+    { LIBCRYPT_ID(SLES, 32966), 13777 },
+    { LIBCRYPT_ID(SLES, 32967), 21709 },
+    { LIBCRYPT_ID(SLES, 32968), 50717 },
+    { LIBCRYPT_ID(SLES, 32969), 59587 },
 };
 
-u32 searchMagicWord(char* discid){
-  return 0;
-  int lower = 0;
-  int upper = (sizeof(magic_words)/sizeof(magic_words[0]))-1;
-  
-  while (lower < upper-1){
-    int cmp1 = strcmp(magic_words[lower].discid, discid);
-    int cmp2 = strcmp(magic_words[upper].discid, discid);
-    if (cmp1 == 0) return magic_words[lower].mw;
-    else if (cmp2 == 0) return magic_words[upper].mw;
-    int half = (upper-lower)/2;
-    int cmp3 = strcmp(magic_words[lower+half].discid, discid);
-    if (cmp3 == 0) return magic_words[lower+half].mw;
-    else if (cmp3 < 0) lower += half;
-    else upper -= half;
-  }
-  return 0;
+static int packDiscId(const char *discid, u32 *id)
+{
+    u32 number = 0;
+    int prefix, i;
+
+    if (discid[0] != '_' || discid[5] != '_') return -1;
+
+    if (memcmp(discid+1, "SCES", 4) == 0) prefix = LIBCRYPT_SCES;
+    else if (memcmp(discid+1, "SLES", 4) == 0) prefix = LIBCRYPT_SLES;
+    else return -1; // no protected titles in other regions
+
+    for (i=6; i<DISCID_LEN; i++){
+        if (discid[i] < '0' || discid[i] > '9') return -1;
+        number = number * 10 + (discid[i] - '0');
+    }
+
+    *id = (prefix << 17) | number;
+
+    return 0;
+}
+
+// discid does not need to be null terminated
+u32 searchMagicWord(const char* discid){
+    int lower = 0;
+    int upper = NELEMS(magic_words) - 1;
+    u32 id;
+
+    if (packDiscId(discid, &id) < 0) return 0;
+
+    while (lower <= upper){
+        int mid = (lower + upper) / 2;
+
+        if (magic_words[mid].id == id) return magic_words[mid].mw;
+        else if (magic_words[mid].id < id) lower = mid + 1;
+        else upper = mid - 1;
+    }
+
+    return 0;
 }
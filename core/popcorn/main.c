@@ -24,9 +24,13 @@
 #include <systemctrl.h>
 #include <systemctrl_private.h>
 #include <macros.h>
+#include "psiso.h"
 
 extern unsigned char g_icon_png[6108];
 
+// libcrypt.c
+u32 searchMagicWord(const char *discid);
+
 PSP_MODULE_INFO("PROPopcornManager", 0x1007, 1, 2);
 
 static STMOD_HANDLER g_previous = NULL;
@@ -72,6 +76,33 @@ static int psiso_offsets[5] = {0, 0, 0, 0, 0}; // pops supports up to 5 discs, b
 
 static unsigned char g_keys[16];
 
+// inflated PSISOIMG blocks of custom PBPs, see psisoCacheStart
+static PsisoIndex g_psiso_index;
+static PsisoCache g_psiso_cache;
+static int g_psiso_on = 0; // 1 running, -1 could not start
+static int g_psiso_disc = -1;
+static SceUID g_psiso_fd = -1; // own descriptors, pops' file position must not move
+static SceUID g_psiso_ahead_fd = -1;
+static SceUID g_psiso_lock = -1;
+static SceUID g_psiso_work = -1;
+static SceUID g_psiso_done = -1;
+static SceUID g_psiso_pbp_fd = -1; // pops' own descriptor of the PBP
+static unsigned char *g_psiso_zbuf; // compressed data of the read-ahead block
+
+// last compressed block pops read, decompressData is called on it next
+static struct {
+    unsigned char *buf;
+    int block;
+    int skipped; // served from the cache, buf was never filled
+} g_psiso_read = { NULL, -1, 0 };
+
+// block the read-ahead thread should inflate next
+static struct {
+    int block;
+    u32 pos;
+    u32 length;
+} g_psiso_ahead = { -1, 0, 0 };
+
 // Get keys.bin path
 static int getKeysBinPath(char *keypath, unsigned int size);
 
@@ -196,6 +227,239 @@ static void readCustomConfig(){
     sceIoClose(fd);
 }
 
+static int psisoRead(void *arg, u32 pos, void *buf, u32 size)
+{
+    SceUID fd = (SceUID)arg;
+
+    if (sceIoLseek32(fd, pos, PSP_SEEK_SET) != (int)pos) return -1;
+
+    return (sceIoRead(fd, buf, size) == (int)size) ? 0 : -1;
+}
+
+// inflate the block after the one pops asked for while the game plays the current one
+static int psisoReadAheadThread(SceSize args, void *argp)
+{
+    unsigned char *buf;
+    int block, ok;
+    u32 pos, length;
+
+    while (sceKernelWaitSema(g_psiso_work, 1, NULL) >= 0){
+        sceKernelWaitSema(g_psiso_lock, 1, NULL);
+        block = g_psiso_ahead.block;
+        pos = g_psiso_ahead.pos;
+        length = g_psiso_ahead.length;
+        g_psiso_ahead.block = -1;
+        buf = (block >= 0) ? psisoCacheReserve(&g_psiso_cache, block * PSISO_BLOCK_SECTORS, 1) : NULL;
+        sceKernelSignalSema(g_psiso_lock, 1);
+
+        if (buf == NULL) continue;
+
+        ok = (psisoRead((void*)g_psiso_ahead_fd, pos, g_psiso_zbuf, length) == 0 &&
+                sceKernelDeflateDecompress(buf, PSISO_BLOCK_SIZE, g_psiso_zbuf, 0) >= 0);
+
+        sceKernelWaitSema(g_psiso_lock, 1, NULL);
+        psisoCacheCommit(&g_psiso_cache, buf, ok);
+        sceKernelSignalSema(g_psiso_lock, 1);
+        sceKernelSetEventFlag(g_psiso_done, 1);
+    }
+
+    return 0;
+}
+
+// started on the first block read, pops has made its own allocations by then.
+// The 3 blocks plus the read-ahead input need ~150KB (4 * 37632 bytes) of the
+// user partition, taken from the top so pops' later low allocations still fit;
+// without that much headroom it tries the kernel partition, then runs uncached.
+static int psisoCacheStart(void)
+{
+    u32 size = PSISO_CACHE_SLOTS * PSISO_BLOCK_SIZE + PSISO_BLOCK_SIZE + 64;
+    unsigned char *mem;
+    SceUID memid, thid;
+
+    g_psiso_on = -1;
+
+    memid = sceKernelAllocPartitionMemory(PSP_MEMORY_PARTITION_USER, "PopcornCache", PSP_SMEM_High, size, NULL);
+
+    if (memid < 0)
+        memid = sceKernelAllocPartitionMemory(PSP_MEMORY_PARTITION_KERNEL, "PopcornCache", PSP_SMEM_High, size, NULL);
+
+    if (memid < 0){
+        #if DEBUG >= 3
+        printk("%s: no memory for the block cache 0x%08X\r\n", __func__, memid);
+        #endif
+        return -1;
+    }
+
+    mem = sceKernelGetBlockHeadAddr(memid);
+    mem = (unsigned char*)((((u32)mem) & ~(64-1)) + 64);
+    g_psiso_zbuf = mem + PSISO_CACHE_SLOTS * PSISO_BLOCK_SIZE;
+    psisoCacheInit(&g_psiso_cache, mem);
+
+    g_psiso_fd = sceIoOpen(sceKernelInitFileName(), PSP_O_RDONLY, 0777);
+    g_psiso_ahead_fd = sceIoOpen(sceKernelInitFileName(), PSP_O_RDONLY, 0777);
+    g_psiso_lock = sceKernelCreateSema("PopcornCacheLock", 0, 1, 1, NULL);
+    g_psiso_work = sceKernelCreateSema("PopcornCacheWork", 0, 0, 1, NULL);
+    g_psiso_done = sceKernelCreateEventFlag("PopcornCacheDone", 0, 0, NULL);
+
+    if (g_psiso_fd < 0 || g_psiso_ahead_fd < 0 || g_psiso_lock < 0 || g_psiso_work < 0 || g_psiso_done < 0)
+        goto error;
+
+    thid = sceKernelCreateThread("PopcornReadAhead", &psisoReadAheadThread, 0x30, 0x1000, 0, NULL);
+
+    if (thid < 0 || sceKernelStartThread(thid, 0, NULL) < 0)
+        goto error;
+
+    g_psiso_on = 1;
+
+    return 0;
+
+error:
+    if (g_psiso_fd >= 0) sceIoClose(g_psiso_fd);
+    if (g_psiso_ahead_fd >= 0) sceIoClose(g_psiso_ahead_fd);
+    if (g_psiso_lock >= 0) sceKernelDeleteSema(g_psiso_lock);
+    if (g_psiso_work >= 0) sceKernelDeleteSema(g_psiso_work);
+    if (g_psiso_done >= 0) sceKernelDeleteEventFlag(g_psiso_done);
+    sceKernelFreePartitionMemory(memid);
+
+    return -1;
+}
+
+// wait out a read-ahead of lba that is in flight, called and returns with the lock held
+static int psisoWaitFill(u32 lba)
+{
+    SceUInt timeout;
+    int state;
+
+    while ((state = psisoCacheState(&g_psiso_cache, lba)) == PSISO_SLOT_FILLING){
+        sceKernelSignalSema(g_psiso_lock, 1);
+        timeout = 100000;
+        state = sceKernelWaitEventFlag(g_psiso_done, 1, PSP_EVENT_WAITOR|PSP_EVENT_WAITCLEAR, NULL, &timeout);
+        sceKernelWaitSema(g_psiso_lock, 1, NULL);
+
+        if (state < 0) return PSISO_SLOT_FILLING;
+    }
+
+    return state;
+}
+
+// remember which block pops is about to read so decompressData can look it up,
+// returns 1 if the block is inflated already and pops' read can be skipped
+static int psisoTrackRead(int fd, unsigned char *buf, u32 pos, int size)
+{
+    PsisoIndexEntry *entry;
+    int disc = -1, block, skip = 0;
+
+    g_psiso_read.buf = NULL;
+
+    for (int i=0; i<NELEMS(psiso_offsets) && psiso_offsets[i]; i++){
+        if (psiso_offsets[i] + PSISO_DATA_OFFSET <= pos && (disc < 0 || psiso_offsets[i] > psiso_offsets[disc]))
+            disc = i;
+    }
+
+    if (disc < 0) return 0;
+
+    if (g_psiso_on == 0 && psisoCacheStart() < 0) return 0;
+    if (g_psiso_on < 0) return 0;
+
+    sceKernelWaitSema(g_psiso_lock, 1, NULL);
+
+    if (disc != g_psiso_disc){
+        // blocks of the other disc are of no use anymore
+        psisoIndexInit(&g_psiso_index, psiso_offsets[disc], &psisoRead, (void*)g_psiso_fd);
+        psisoCacheReset(&g_psiso_cache);
+        g_psiso_ahead.block = -1;
+        g_psiso_disc = disc;
+    }
+
+    block = psisoIndexFind(&g_psiso_index, pos);
+    entry = psisoIndexGet(&g_psiso_index, block);
+
+    // stored blocks never reach decompressData
+    if (entry != NULL && entry->length == size && entry->length < PSISO_BLOCK_SIZE){
+        // only skip reads of the PBP itself, another file may have data at the same offset
+        skip = (fd == g_psiso_pbp_fd && psisoWaitFill(block * PSISO_BLOCK_SECTORS) == PSISO_SLOT_VALID);
+
+        // pops got here before the read-ahead thread started on this block, one read is enough
+        if (!skip && g_psiso_ahead.block == block) g_psiso_ahead.block = -1;
+
+        g_psiso_read.buf = buf;
+        g_psiso_read.block = block;
+        g_psiso_read.skipped = skip;
+
+        if (skip) g_psiso_cache.stats.skipped_reads++;
+    }
+
+    sceKernelSignalSema(g_psiso_lock, 1);
+
+    return skip;
+}
+
+static int psisoDecompress(int block, int skipped, const unsigned char *src, unsigned char *dest)
+{
+    u32 lba = block * PSISO_BLOCK_SECTORS;
+    PsisoIndexEntry *entry;
+    PsisoSlot *slot;
+    unsigned char *buf;
+    int ret = 0;
+
+    sceKernelWaitSema(g_psiso_lock, 1, NULL);
+
+    // read-ahead of this very block is in flight, let it finish
+    psisoWaitFill(lba);
+
+    slot = psisoCacheLookup(&g_psiso_cache, lba);
+
+    if (slot != NULL && slot->state == PSISO_SLOT_VALID){
+        memcpy(dest, slot->buf, PSISO_BLOCK_SIZE);
+        ret = PSISO_BLOCK_SIZE;
+    }
+    else {
+        // the block was dropped after pops' read was skipped, fetch what pops would have read
+        if (skipped){
+            entry = psisoIndexGet(&g_psiso_index, block);
+
+            if (entry == NULL || psisoRead((void*)g_psiso_fd, g_psiso_index.base + PSISO_DATA_OFFSET + entry->offset,
+                    (void*)src, entry->length) < 0){
+                sceKernelSignalSema(g_psiso_lock, 1);
+                return -1;
+            }
+        }
+
+        sceKernelSignalSema(g_psiso_lock, 1);
+        ret = sceKernelDeflateDecompress(dest, PSISO_BLOCK_SIZE, src, 0);
+        sceKernelWaitSema(g_psiso_lock, 1, NULL);
+
+        if (ret >= 0 && (buf = psisoCacheReserve(&g_psiso_cache, lba, 0)) != NULL){
+            memcpy(buf, dest, PSISO_BLOCK_SIZE);
+            psisoCacheCommit(&g_psiso_cache, buf, 1);
+        }
+    }
+
+    if (ret >= 0 && psisoCacheSequential(&g_psiso_cache, block)){
+        entry = psisoIndexGet(&g_psiso_index, block + 1);
+
+        if (entry != NULL && entry->length < PSISO_BLOCK_SIZE){
+            g_psiso_ahead.block = block + 1;
+            g_psiso_ahead.pos = g_psiso_index.base + PSISO_DATA_OFFSET + entry->offset;
+            g_psiso_ahead.length = entry->length;
+            sceKernelSignalSema(g_psiso_work, 1);
+        }
+    }
+
+    #if DEBUG >= 3
+    if ((g_psiso_cache.stats.lookups & 63) == 0){
+        printk("%s: %d lookups %d hits %d inflates %d read-ahead (%d used) %d reads skipped %d index loads\r\n", __func__,
+                (int)g_psiso_cache.stats.lookups, (int)g_psiso_cache.stats.hits, (int)g_psiso_cache.stats.inflates,
+                (int)g_psiso_cache.stats.readaheads, (int)g_psiso_cache.stats.readahead_hits,
+                (int)g_psiso_cache.stats.skipped_reads, (int)g_psiso_index.loads);
+    }
+    #endif
+
+    sceKernelSignalSema(g_psiso_lock, 1);
+
+    return ret;
+}
+
 static int checkFileDecrypted(const char *filename)
 {
     SceUID fd = -1;
@@ -308,6 +572,11 @@ static int myIoOpen(const char *file, int flag, int mode)
         else
         {
             ret = sceIoOpenPlain(file, flag, mode);
+
+            if(g_isCustomPBP && ret >= 0 && 0 == strcmp(file, sceKernelInitFileName()))
+            {
+                g_psiso_pbp_fd = ret;
+            }
         }        
     }
     else
@@ -459,8 +728,21 @@ static int myIoRead(int fd, unsigned char *buf, int size)
         }
     }
 
+    if(g_isCustomPBP && g_psiso_on >= 0 && psisoTrackRead(fd, buf, pos, size))
+    {
+        // decompressData takes this block from the cache, only move the file position
+        sceIoLseek32(fd, pos + size, PSP_SEEK_SET);
+        ret = size;
+        goto exit;
+    }
+
     ret = sceIoRead(fd, buf, size);
 
+    if(ret != size)
+    {
+        g_psiso_read.buf = NULL;
+    }
+
     // patch to inject custom config and anti-libcrypt
     for (int i=0; i<NELEMS(psiso_offsets); i++){ // check each disc
         int offset = psiso_offsets[i];
@@ -481,7 +763,7 @@ static int myIoRead(int fd, unsigned char *buf, int size)
                 if (config_size>0) memcpy(buf+0x20, custom_config, config_size);
             
                 // anti-libcrypt patch, calculate libcrypt magic and inject at 0x12B0 after PSISOIMG, 0xEB0 after given buffer
-                u32 mw = searchMagicWord(buf); // buf points to PSISOIMG+0x0400, which conviniently starts with the discid
+                u32 mw = searchMagicWord((char*)buf); // buf points to PSISOIMG+0x0400, which conviniently starts with the discid
                 if (mw != 0){ // magic word found for this title
                     mw ^= 0x72D0EE59; // needs to be xored with this constant
                     memcpy(buf+0xeb0, &mw, sizeof(mw));
@@ -631,6 +913,11 @@ static int myIoClose(SceUID fd)
         } 
         else
         {
+            if (fd == g_psiso_pbp_fd)
+            {
+                g_psiso_pbp_fd = -1;
+            }
+
             ret = sceIoClose(fd);
         }
     } 
@@ -1098,7 +1385,16 @@ int decompressData(unsigned int destSize, const unsigned char *src, unsigned cha
 
     k1 = pspSdkSetK1(0);
 
-    ret = sceKernelDeflateDecompress(dest, destSize, src, 0);
+    if(g_psiso_on > 0 && src == g_psiso_read.buf && destSize == PSISO_BLOCK_SIZE)
+    {
+        ret = psisoDecompress(g_psiso_read.block, g_psiso_read.skipped, src, dest);
+        g_psiso_read.buf = NULL;
+    }
+    else
+    {
+        ret = sceKernelDeflateDecompress(dest, destSize, src, 0);
+    }
+
     #if DEBUG >= 3
     printk("%s: 0x%08X 0x%08X 0x%08X -> 0x%08X\r\n", __func__, (uint)destSize, (uint)src, (uint)dest, ret);
     #endif
@@ -0,0 +1,293 @@
+/*
+ * This file is part of PRO CFW.
+
+ * PRO CFW is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * PRO CFW is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PRO CFW. If not, see <http://www.gnu.org/licenses/ .
+ */
+
+/*
+ * PSISOIMG block table lookup and inflated block cache.
+ * No kernel calls in here: file access goes through the read callback and
+ * locking is left to the caller, so this also builds on a PC.
+ */
+
+#include <string.h>
+#include "psiso.h"
+
+void psisoIndexInit(PsisoIndex *idx, u32 base, PsisoReadFunc read, void *arg)
+{
+    idx->base = base;
+    idx->read = read;
+    idx->arg = arg;
+    idx->first = -1;
+    idx->count = 0;
+    idx->last = -1;
+    idx->loads = 0;
+}
+
+static int psisoIndexLoad(PsisoIndex *idx, int block)
+{
+    int first = block & ~(PSISO_INDEX_WINDOW - 1);
+    int count = PSISO_INDEX_MAX - first;
+
+    if (count > PSISO_INDEX_WINDOW) count = PSISO_INDEX_WINDOW;
+
+    idx->loads++;
+
+    if (idx->read(idx->arg, idx->base + PSISO_INDEX_OFFSET + first * sizeof(PsisoIndexEntry),
+            idx->window, count * sizeof(PsisoIndexEntry)) < 0){
+        idx->first = -1;
+        return -1;
+    }
+
+    idx->first = first;
+    idx->count = count;
+
+    return 0;
+}
+
+PsisoIndexEntry *psisoIndexGet(PsisoIndex *idx, int block)
+{
+    PsisoIndexEntry *entry;
+
+    if (block < 0 || block >= (int)PSISO_INDEX_MAX) return NULL;
+
+    if (idx->first < 0 || block < idx->first || block >= idx->first + idx->count){
+        if (psisoIndexLoad(idx, block) < 0) return NULL;
+    }
+
+    entry = &idx->window[block - idx->first];
+
+    // unused entries after the last block are zeroed
+    if (entry->length == 0) return NULL;
+
+    return entry;
+}
+
+int psisoIndexFind(PsisoIndex *idx, u32 pos)
+{
+    PsisoIndexEntry *entry;
+    int low, high, mid, wlow, whigh, i, j;
+    u32 rel;
+
+    if (pos < idx->base + PSISO_DATA_OFFSET) return -1;
+
+    rel = pos - idx->base - PSISO_DATA_OFFSET;
+
+    // streaming asks for the same block again or the next one
+    for (mid = idx->last; mid <= idx->last + 1; mid++){
+        entry = psisoIndexGet(idx, mid);
+
+        if (entry != NULL && entry->offset == rel){
+            idx->last = mid;
+            return mid;
+        }
+    }
+
+    // offsets grow with the block number, missing entries sort after everything
+    low = 0;
+    high = PSISO_INDEX_MAX - 1;
+
+    while (low <= high){
+        mid = (low + high) / 2;
+
+        if (psisoIndexGet(idx, mid) == NULL && idx->first < 0) return -1;
+
+        // every load brings in a whole window, settle all of it at once
+        wlow = (low > idx->first) ? low : idx->first;
+        whigh = idx->first + idx->count - 1;
+        if (whigh > high) whigh = high;
+
+        i = wlow;
+        j = whigh;
+
+        while (i <= j){
+            mid = (i + j) / 2;
+            entry = &idx->window[mid - idx->first];
+
+            if (entry->length == 0 || entry->offset > rel){
+                j = mid - 1;
+            }
+            else if (entry->offset < rel){
+                i = mid + 1;
+            }
+            else {
+                idx->last = mid;
+                return mid;
+            }
+        }
+
+        if (i == wlow){
+            high = wlow - 1;
+        }
+        else if (i > whigh){
+            low = whigh + 1;
+        }
+        else {
+            // between two blocks, not the start of one
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+void psisoCacheInit(PsisoCache *cache, u8 *mem)
+{
+    int i;
+
+    memset(cache, 0, sizeof(*cache));
+
+    for (i=0; i<PSISO_CACHE_SLOTS; i++){
+        cache->slots[i].buf = mem + i * PSISO_BLOCK_SIZE;
+    }
+
+    cache->last_block = -1;
+}
+
+void psisoCacheReset(PsisoCache *cache)
+{
+    int i;
+
+    for (i=0; i<PSISO_CACHE_SLOTS; i++){
+        PsisoSlot *slot = &cache->slots[i];
+
+        if (slot->state == PSISO_SLOT_FILLING){
+            slot->state = PSISO_SLOT_STALE;
+        }
+        else if (slot->state == PSISO_SLOT_VALID){
+            slot->state = PSISO_SLOT_FREE;
+            slot->age = 0;
+        }
+    }
+
+    cache->last_block = -1;
+}
+
+int psisoCacheState(PsisoCache *cache, u32 lba)
+{
+    int i;
+
+    for (i=0; i<PSISO_CACHE_SLOTS; i++){
+        PsisoSlot *slot = &cache->slots[i];
+
+        if (slot->lba == lba && (slot->state == PSISO_SLOT_FILLING || slot->state == PSISO_SLOT_VALID))
+            return slot->state;
+    }
+
+    return PSISO_SLOT_FREE;
+}
+
+PsisoSlot *psisoCacheLookup(PsisoCache *cache, u32 lba)
+{
+    int i;
+
+    for (i=0; i<PSISO_CACHE_SLOTS; i++){
+        PsisoSlot *slot = &cache->slots[i];
+
+        if (slot->lba != lba) continue;
+
+        if (slot->state == PSISO_SLOT_FILLING){
+            // caller waits for the fill and asks again, count it then
+            return slot;
+        }
+
+        if (slot->state == PSISO_SLOT_VALID){
+            cache->stats.lookups++;
+            cache->stats.hits++;
+
+            if (slot->ahead){
+                cache->stats.readahead_hits++;
+                slot->ahead = 0;
+            }
+
+            slot->age = ++cache->clock;
+
+            return slot;
+        }
+    }
+
+    cache->stats.lookups++;
+
+    return NULL;
+}
+
+u8 *psisoCacheReserve(PsisoCache *cache, u32 lba, int ahead)
+{
+    PsisoSlot *victim = NULL;
+    int i;
+
+    for (i=0; i<PSISO_CACHE_SLOTS; i++){
+        PsisoSlot *slot = &cache->slots[i];
+
+        if (slot->state == PSISO_SLOT_FILLING || slot->state == PSISO_SLOT_STALE){
+            if (slot->state == PSISO_SLOT_FILLING && slot->lba == lba) return NULL;
+            continue;
+        }
+
+        if (slot->state == PSISO_SLOT_VALID && slot->lba == lba) return NULL;
+
+        // free slots have age 0 and go first
+        if (victim == NULL || slot->age < victim->age){
+            victim = slot;
+        }
+    }
+
+    if (victim == NULL) return NULL;
+
+    victim->state = PSISO_SLOT_FILLING;
+    victim->lba = lba;
+    victim->ahead = ahead;
+
+    return victim->buf;
+}
+
+void psisoCacheCommit(PsisoCache *cache, u8 *buf, int ok)
+{
+    int i;
+
+    for (i=0; i<PSISO_CACHE_SLOTS; i++){
+        PsisoSlot *slot = &cache->slots[i];
+
+        if (slot->buf != buf) continue;
+
+        if (ok){
+            cache->stats.inflates++;
+
+            if (slot->ahead){
+                cache->stats.readaheads++;
+            }
+        }
+
+        if (ok && slot->state == PSISO_SLOT_FILLING){
+            slot->state = PSISO_SLOT_VALID;
+            slot->age = ++cache->clock;
+        }
+        else {
+            slot->state = PSISO_SLOT_FREE;
+            slot->age = 0;
+            slot->ahead = 0;
+        }
+
+        break;
+    }
+}
+
+int psisoCacheSequential(PsisoCache *cache, int block)
+{
+    int sequential = (cache->last_block >= 0 && block == cache->last_block + 1);
+
+    cache->last_block = block;
+
+    return sequential;
+}
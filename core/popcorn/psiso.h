@@ -0,0 +1,128 @@
+/*
+ * This file is part of PRO CFW.
+
+ * PRO CFW is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * PRO CFW is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PRO CFW. If not, see <http://www.gnu.org/licenses/ .
+ */
+
+#ifndef PSISO_H
+#define PSISO_H
+
+#ifdef __psp__
+#include <psptypes.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+#endif
+
+// PSISOIMG layout: https://www.psdevwiki.com/psp/PSISOIMG0000
+#define PSISO_INDEX_OFFSET 0x4000       // block table, relative to PSISOIMG
+#define PSISO_DATA_OFFSET 0x100000      // first block, index offsets are relative to this
+#define PSISO_BLOCK_SECTORS 16
+#define PSISO_BLOCK_SIZE (PSISO_BLOCK_SECTORS * 2352)
+#define PSISO_INDEX_MAX ((PSISO_DATA_OFFSET - PSISO_INDEX_OFFSET) / sizeof(PsisoIndexEntry))
+
+#define PSISO_INDEX_WINDOW 64           // index entries kept in memory
+#define PSISO_CACHE_SLOTS 3             // inflated blocks kept in memory
+
+typedef struct
+{
+    u32 offset;                         // relative to PSISOIMG + PSISO_DATA_OFFSET
+    u16 length;                         // compressed size, PSISO_BLOCK_SIZE if stored
+    u16 flags;
+    u8 checksum[16];
+    u8 padding[8];
+} PsisoIndexEntry;
+
+// read size bytes at absolute file position pos, 0 on success
+typedef int (*PsisoReadFunc)(void *arg, u32 pos, void *buf, u32 size);
+
+typedef struct
+{
+    u32 base;                           // absolute PSISOIMG offset of the disc
+    PsisoReadFunc read;
+    void *arg;
+    int first;                          // block of window[0], -1 if nothing loaded
+    int count;
+    int last;                           // last block found, for sequential reads
+    u32 loads;
+    PsisoIndexEntry window[PSISO_INDEX_WINDOW];
+} PsisoIndex;
+
+enum
+{
+    PSISO_SLOT_FREE = 0,
+    PSISO_SLOT_FILLING,                 // being inflated outside of the cache lock
+    PSISO_SLOT_STALE,                   // still filling, but dropped by psisoCacheReset
+    PSISO_SLOT_VALID,
+};
+
+typedef struct
+{
+    u8 *buf;
+    u32 lba;                            // first sector of the block
+    u32 age;
+    int state;
+    int ahead;                          // filled by read-ahead and not used yet
+} PsisoSlot;
+
+typedef struct
+{
+    u32 lookups;
+    u32 hits;
+    u32 inflates;
+    u32 readaheads;
+    u32 readahead_hits;
+    u32 skipped_reads;                  // pops' reads of a cached block left out
+} PsisoStats;
+
+typedef struct
+{
+    PsisoSlot slots[PSISO_CACHE_SLOTS];
+    u32 clock;
+    int last_block;
+    PsisoStats stats;
+} PsisoCache;
+
+void psisoIndexInit(PsisoIndex *idx, u32 base, PsisoReadFunc read, void *arg);
+
+// entry of block, NULL past the last block or on read error
+PsisoIndexEntry *psisoIndexGet(PsisoIndex *idx, int block);
+
+// block whose compressed data starts at absolute file position pos, -1 if none
+int psisoIndexFind(PsisoIndex *idx, u32 pos);
+
+// mem must hold PSISO_CACHE_SLOTS * PSISO_BLOCK_SIZE bytes
+void psisoCacheInit(PsisoCache *cache, u8 *mem);
+
+// drop every block, in-flight fills are discarded when committed
+void psisoCacheReset(PsisoCache *cache);
+
+// PSISO_SLOT_VALID or PSISO_SLOT_FILLING if lba is cached or on its way, else PSISO_SLOT_FREE; not counted in stats
+int psisoCacheState(PsisoCache *cache, u32 lba);
+
+// slot holding lba (valid or still filling) or NULL
+PsisoSlot *psisoCacheLookup(PsisoCache *cache, u32 lba);
+
+// claim the least recently used slot for lba, NULL if lba is already there or all slots are filling
+u8 *psisoCacheReserve(PsisoCache *cache, u32 lba, int ahead);
+
+// finish a reserved slot, ok = 0 drops it
+void psisoCacheCommit(PsisoCache *cache, u8 *buf, int ok);
+
+// record an access to block, returns 1 if it follows the previous one
+int psisoCacheSequential(PsisoCache *cache, int block);
+
+#endif
@@ -0,0 +1,84 @@
+/*
+    host test for popcorn's libcrypt magic word lookup
+
+    Checks searchMagicWord in libcrypt.c against the string table it
+    replaced: every title gives the same magic word, from a disc id that is
+    not null terminated like the one pops has at PSISOIMG+0x400, and ids
+    that are not in the table, malformed or from other regions give 0.
+
+    libcrypttest        the checks
+    libcrypttest -b     ns per lookup, old string search against the packed ids
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pspkernel.h"
+#include "libcrypt_old.h"
+
+#define DISCID_LEN 11
+#define ROUNDS     2000000
+
+u32 searchMagicWord(const char *discid);
+
+static double bench(u32 (*search)(const char *), const char **ids, int n)
+{
+    struct timespec t0, t1;
+    volatile u32 sum = 0;
+    int k;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (k = 0; k < ROUNDS; k++) sum += search(ids[k % n]);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ROUNDS;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *missing[] = {
+        "_SLUS_00594", "_SCUS_94163", "_SLPS_01234",    // other regions
+        "_SCES_00000", "_SLES_99999", "_SLES_02085",    // not protected
+        "_SCES_0031X", "_SLES-02080", "SLES_02080__",   // malformed
+        "___________", "",
+    };
+    int n = sizeof(old_words) / sizeof(old_words[0]);
+    const char **ids;
+    char buf[DISCID_LEN + 1];
+    int i, failed = 0;
+
+    for (i = 0; i < n; i++){
+        // pops' buffer goes on with the rest of the header
+        memcpy(buf, old_words[i].discid, DISCID_LEN);
+        buf[DISCID_LEN] = 'X';
+
+        if (searchMagicWord(buf) != old_words[i].mw){
+            printf("%s: got %u, want %u\n", old_words[i].discid, searchMagicWord(buf), old_words[i].mw);
+            failed = 1;
+        }
+    }
+
+    for (i = 0; i < (int)(sizeof(missing) / sizeof(missing[0])); i++){
+        memset(buf, 0, sizeof(buf));
+        strncpy(buf, missing[i], DISCID_LEN);
+
+        if (searchMagicWord(buf) != 0){
+            printf("%s: found %u, want nothing\n", missing[i], searchMagicWord(buf));
+            failed = 1;
+        }
+    }
+
+    printf("%d titles, %s\n", n, failed ? "FAILED" : "ok");
+
+    if (argc > 1 && !strcmp(argv[1], "-b")){
+        ids = malloc(n * sizeof(*ids));
+        for (i = 0; i < n; i++) ids[i] = old_words[(i * 97) % n].discid;
+
+        printf("old string search %.1f ns/lookup, packed ids %.1f ns/lookup\n",
+               bench(oldSearchMagicWord, ids, n), bench(searchMagicWord, ids, n));
+    }
+
+    return failed;
+}
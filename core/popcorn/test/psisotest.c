@@ -0,0 +1,410 @@
+/*
+    host trace test for popcorn's PSISOIMG block cache
+
+    Builds a PSISOIMG with zlib (raw deflate, like sceKernelDeflateDecompress
+    takes) and replays pops access traces through psiso.c the way the
+    myIoRead / decompressData hooks in main.c drive it: pops reads one
+    compressed block, the read is skipped if the block is cached, then
+    decompressData serves it from the cache or inflates it and queues a
+    read-ahead of the next block. The read-ahead thread is stepped at random
+    points around each access so that reserve, fill and commit interleave
+    with pops like they can on the PSP.
+
+    Every inflated block is compared to the original sectors, and the bytes
+    read by pops and by the read-ahead are counted against an uncached run.
+
+    psisotest [-v]      fails on any mismatch
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "../psiso.h"
+
+#define DISC_BASE    0x28000            // PSISOIMG offset in the PBP
+#define DISC_BLOCKS  400
+
+typedef struct {
+    const char *name;
+    unsigned long long pops_bytes, ahead_bytes, plain_bytes;
+    unsigned int accesses, skipped, fallbacks, inflates, plain_inflates;
+} Result;
+
+static u8 *file;
+static u32 file_size;
+static u8 *blocks;                      // inflated sectors, DISC_BLOCKS * PSISO_BLOCK_SIZE
+static PsisoIndexEntry *table;
+
+static PsisoIndex idx;
+static PsisoCache cache;
+static u8 cache_mem[PSISO_CACHE_SLOTS * PSISO_BLOCK_SIZE];
+static u8 zbuf[PSISO_BLOCK_SIZE];       // the read-ahead thread's input
+static u8 popsbuf[PSISO_BLOCK_SIZE];    // pops' read buffer
+static u8 dest[PSISO_BLOCK_SIZE];
+
+static Result *res;
+static int verbose;
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static int file_read(void *arg, u32 pos, void *buf, u32 size)
+{
+    if (pos + size > file_size) return -1;
+    memcpy(buf, file + pos, size);
+    return 0;
+}
+
+static int inflate_block(u8 *out, const u8 *in, u32 length)
+{
+    z_stream z;
+    int ret;
+
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, -15) != Z_OK) return -1;
+    z.next_in = (u8 *)in;
+    z.avail_in = length;
+    z.next_out = out;
+    z.avail_out = PSISO_BLOCK_SIZE;
+    ret = inflate(&z, Z_FINISH);
+    inflateEnd(&z);
+
+    return (ret == Z_STREAM_END && z.avail_out == 0) ? PSISO_BLOCK_SIZE : -1;
+}
+
+static void make_disc(void)
+{
+    u32 data, offset = 0;
+    int b, i;
+
+    blocks = malloc(DISC_BLOCKS * PSISO_BLOCK_SIZE);
+    file_size = DISC_BASE + PSISO_DATA_OFFSET + DISC_BLOCKS * PSISO_BLOCK_SIZE;
+    file = calloc(1, file_size);
+    table = (PsisoIndexEntry *)(file + DISC_BASE + PSISO_INDEX_OFFSET);
+    data = DISC_BASE + PSISO_DATA_OFFSET;
+
+    seed = 0x504f50;
+
+    for (b = 0; b < DISC_BLOCKS; b++){
+        u8 *p = blocks + b * PSISO_BLOCK_SIZE;
+        z_stream z;
+
+        // runs of repeated bytes compress, every 37th block is noise and gets stored
+        for (i = 0; i < PSISO_BLOCK_SIZE; ){
+            int run = (b % 37 == 36) ? 1 : 1 + rnd() % 64;
+            u8 c = rnd();
+            while (run-- && i < PSISO_BLOCK_SIZE) p[i++] = c;
+        }
+
+        memset(&z, 0, sizeof(z));
+        deflateInit2(&z, 9, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+        z.next_in = p;
+        z.avail_in = PSISO_BLOCK_SIZE;
+        z.next_out = file + data + offset;
+        z.avail_out = PSISO_BLOCK_SIZE;
+
+        table[b].offset = offset;
+
+        if (deflate(&z, Z_FINISH) == Z_STREAM_END && z.total_out < PSISO_BLOCK_SIZE){
+            table[b].length = z.total_out;
+        }
+        else {
+            memcpy(file + data + offset, p, PSISO_BLOCK_SIZE);
+            table[b].length = PSISO_BLOCK_SIZE;
+        }
+
+        deflateEnd(&z);
+        offset += table[b].length;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+// the read-ahead thread, one step at a time
+////////////////////////////////////////////////////////////////////////
+
+static struct { int block; u32 pos, length; } queued = { -1 };
+static struct { u8 *buf; u32 pos, length; } inflight;
+
+static void ahead_step(void)
+{
+    if (inflight.buf != NULL){
+        int ok = (file_read(NULL, inflight.pos, zbuf, inflight.length) == 0 &&
+                inflate_block(inflight.buf, zbuf, inflight.length) >= 0);
+
+        res->ahead_bytes += inflight.length;
+        psisoCacheCommit(&cache, inflight.buf, ok);
+        inflight.buf = NULL;
+    }
+    else if (queued.block >= 0){
+        inflight.buf = psisoCacheReserve(&cache, queued.block * PSISO_BLOCK_SECTORS, 1);
+        inflight.pos = queued.pos;
+        inflight.length = queued.length;
+        queued.block = -1;
+    }
+}
+
+static void maybe_step(void)
+{
+    while (rnd() % 2) ahead_step();
+}
+
+// psisoWaitFill: the PSP blocks on the done flag, here the thread just runs
+static int wait_fill(u32 lba)
+{
+    int state;
+
+    while ((state = psisoCacheState(&cache, lba)) == PSISO_SLOT_FILLING) ahead_step();
+
+    return state;
+}
+
+////////////////////////////////////////////////////////////////////////
+// myIoRead + decompressData
+////////////////////////////////////////////////////////////////////////
+
+static int access_block(int block, int drop)
+{
+    u32 pos = DISC_BASE + PSISO_DATA_OFFSET + table[block].offset;
+    u32 size = table[block].length;
+    PsisoIndexEntry *entry;
+    PsisoSlot *slot;
+    int found, skipped = 0, ret;
+    u8 *buf;
+
+    res->accesses++;
+    res->plain_bytes += size;
+
+    // psisoTrackRead
+    found = psisoIndexFind(&idx, pos);
+    entry = psisoIndexGet(&idx, found);
+
+    if (found != block || entry == NULL || entry->length != size){
+        printf("%s: block %d found as %d\n", res->name, block, found);
+        return -1;
+    }
+
+    if (size >= PSISO_BLOCK_SIZE){
+        // stored, pops reads it and never calls decompressData
+        res->pops_bytes += size;
+        return 0;
+    }
+
+    res->plain_inflates++;
+
+    maybe_step();
+
+    skipped = (wait_fill(block * PSISO_BLOCK_SECTORS) == PSISO_SLOT_VALID);
+
+    if (skipped){
+        res->skipped++;
+        memset(popsbuf, 0xee, size);
+    }
+    else {
+        if (queued.block == block) queued.block = -1;
+        file_read(NULL, pos, popsbuf, size);
+        res->pops_bytes += size;
+    }
+
+    maybe_step();
+
+    // the block can go away before decompressData, e.g. on a disc change
+    if (drop) psisoCacheReset(&cache);
+
+    // psisoDecompress
+    wait_fill(block * PSISO_BLOCK_SECTORS);
+    slot = psisoCacheLookup(&cache, block * PSISO_BLOCK_SECTORS);
+
+    if (slot != NULL && slot->state == PSISO_SLOT_VALID){
+        memcpy(dest, slot->buf, PSISO_BLOCK_SIZE);
+        ret = PSISO_BLOCK_SIZE;
+    }
+    else {
+        if (skipped){
+            res->fallbacks++;
+            res->pops_bytes += size;
+            file_read(NULL, pos, popsbuf, size);
+        }
+
+        res->inflates++;
+        ret = inflate_block(dest, popsbuf, size);
+
+        if (ret >= 0 && (buf = psisoCacheReserve(&cache, block * PSISO_BLOCK_SECTORS, 0)) != NULL){
+            memcpy(buf, dest, PSISO_BLOCK_SIZE);
+            psisoCacheCommit(&cache, buf, 1);
+        }
+    }
+
+    if (ret >= 0 && psisoCacheSequential(&cache, block)){
+        entry = psisoIndexGet(&idx, block + 1);
+
+        if (entry != NULL && entry->length < PSISO_BLOCK_SIZE){
+            queued.block = block + 1;
+            queued.pos = DISC_BASE + PSISO_DATA_OFFSET + entry->offset;
+            queued.length = entry->length;
+        }
+    }
+
+    maybe_step();
+
+    if (ret < 0 || memcmp(dest, blocks + block * PSISO_BLOCK_SIZE, PSISO_BLOCK_SIZE) != 0){
+        printf("%s: block %d inflated wrong (%s)\n", res->name, block, skipped ? "read skipped" : "read");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void start(Result *r, const char *name)
+{
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    res = r;
+    seed = 0x1234;
+
+    psisoIndexInit(&idx, DISC_BASE, &file_read, NULL);
+    psisoCacheInit(&cache, cache_mem);
+    queued.block = -1;
+    inflight.buf = NULL;
+}
+
+static void finish(void)
+{
+    // let a pending fill commit before the next trace resets everything
+    while (inflight.buf != NULL || queued.block >= 0) ahead_step();
+}
+
+static void report(Result *r)
+{
+    unsigned long long cached = r->pops_bytes + r->ahead_bytes;
+
+    printf("%-10s %5u blocks: read %6.2f MB (pops %6.2f + ahead %6.2f) vs %6.2f MB uncached (%+.1f%%), "
+           "%u reads skipped, %u fallbacks, %u/%u inflates\n",
+           r->name, r->accesses, cached / 1e6, r->pops_bytes / 1e6, r->ahead_bytes / 1e6, r->plain_bytes / 1e6,
+           (cached * 100.0 / r->plain_bytes) - 100.0, r->skipped, r->fallbacks, r->inflates, r->plain_inflates);
+    if (verbose){
+        printf("           lookups %u hits %u inflates %u read-ahead %u (used %u) index loads %u\n",
+               cache.stats.lookups, cache.stats.hits, cache.stats.inflates, cache.stats.readaheads,
+               cache.stats.readahead_hits, idx.loads);
+    }
+}
+
+static int test_index(void)
+{
+    int b, k;
+
+    psisoIndexInit(&idx, DISC_BASE, &file_read, NULL);
+
+    for (b = 0; b < DISC_BLOCKS; b++){
+        if (psisoIndexFind(&idx, DISC_BASE + PSISO_DATA_OFFSET + table[b].offset) != b){
+            printf("index: block %d not found in order\n", b);
+            return -1;
+        }
+    }
+
+    seed = 1;
+    for (k = 0; k < 2000; k++){
+        b = rnd() % DISC_BLOCKS;
+        if (psisoIndexFind(&idx, DISC_BASE + PSISO_DATA_OFFSET + table[b].offset) != b){
+            printf("index: block %d not found at random\n", b);
+            return -1;
+        }
+    }
+
+    if (psisoIndexFind(&idx, DISC_BASE + PSISO_DATA_OFFSET + table[3].offset + 1) != -1 ||
+            psisoIndexFind(&idx, DISC_BASE + PSISO_DATA_OFFSET - 1) != -1 ||
+            psisoIndexGet(&idx, DISC_BLOCKS) != NULL){
+        printf("index: found a block that is not there\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int test_cache(void)
+{
+    u8 *buf;
+
+    psisoCacheInit(&cache, cache_mem);
+
+    // a fill that is dropped by a reset must not become valid
+    buf = psisoCacheReserve(&cache, 32, 1);
+    if (psisoCacheState(&cache, 32) != PSISO_SLOT_FILLING || psisoCacheReserve(&cache, 32, 0) != NULL){
+        printf("cache: filling slot not seen\n");
+        return -1;
+    }
+    psisoCacheReset(&cache);
+    psisoCacheCommit(&cache, buf, 1);
+    if (psisoCacheState(&cache, 32) != PSISO_SLOT_FREE || psisoCacheLookup(&cache, 32) != NULL){
+        printf("cache: stale fill became valid\n");
+        return -1;
+    }
+
+    // least recently used goes first
+    psisoCacheCommit(&cache, psisoCacheReserve(&cache, 0, 0), 1);
+    psisoCacheCommit(&cache, psisoCacheReserve(&cache, 16, 0), 1);
+    psisoCacheCommit(&cache, psisoCacheReserve(&cache, 32, 0), 1);
+    psisoCacheLookup(&cache, 0);
+    psisoCacheCommit(&cache, psisoCacheReserve(&cache, 48, 0), 1);
+    if (psisoCacheState(&cache, 16) != PSISO_SLOT_FREE || psisoCacheState(&cache, 0) != PSISO_SLOT_VALID){
+        printf("cache: wrong block evicted\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    Result r;
+    int b, k, n, failed = 0;
+
+    verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+
+    make_disc();
+
+    failed |= test_index();
+    failed |= test_cache();
+
+    // streaming: every block once, in order
+    start(&r, "stream");
+    for (b = 0; b < DISC_BLOCKS && !failed; b++) failed |= access_block(b, 0);
+    finish();
+    report(&r);
+
+    // pops going over each block twice, e.g. a sector read then the XA stream
+    start(&r, "reread");
+    for (b = 0; b < DISC_BLOCKS && !failed; b++)
+        for (k = 0; k < 2 && !failed; k++) failed |= access_block(b, 0);
+    finish();
+    report(&r);
+
+    // seeks followed by short runs, some of them back into cached blocks
+    start(&r, "seek");
+    for (k = 0; k < 300 && !failed; k++){
+        b = rnd() % DISC_BLOCKS;
+        for (n = 1 + rnd() % 12; n > 0 && b < DISC_BLOCKS && !failed; n--, b++) failed |= access_block(b, 0);
+    }
+    finish();
+    report(&r);
+
+    // streaming with the cache dropped between read and inflate now and then
+    start(&r, "dropped");
+    for (b = 0; b < DISC_BLOCKS && !failed; b++) failed |= access_block(b, rnd() % 8 == 0);
+    finish();
+    report(&r);
+
+    if (r.fallbacks == 0 && !failed){
+        printf("dropped: the fallback read never ran\n");
+        failed = 1;
+    }
+
+    printf(failed ? "FAILED\n" : "ok\n");
+
+    return failed;
+}
@@ -0,0 +1 @@
+#define NELEMS(n) ((sizeof(n)) / sizeof(n[0]))
@@ -40,6 +40,8 @@
 #include "pspcipher.h"
 #include "macros.h"
 #include "functions.h"
+#include "prx_cache.h"
+#include <ark.h>
 
 static u8 g_key_d91609f0[16] = {
     0xD0, 0x36, 0x12, 0x75, 0x80, 0x56, 0x20, 0x43,
@@ -207,7 +209,7 @@ static GameCipher *get_game_cipher(u32 tag)
 
 int (*mesgled_decrypt)(u32 *tag, u8 *key, u32 code, u8 *prx, u32 size, u32 *newsize, u32 use_polling, u8 *blacklist, u32 blacklistsize, u32 type, u8 *xor_key1, u8 *xor_key2) = NULL;
 
-static int _mesgled_decrypt(u32 *tag, u8 *key, u32 code, u8 *prx, u32 size, u32 *newsize, u32 use_polling, u8 *blacklist, u32 blacklistsize, u32 type, u8 *xor_key1, u8 *xor_key2)
+static int decrypt_prx(u32 *tag, u8 *key, u32 code, u8 *prx, u32 size, u32 *newsize, u32 use_polling, u8 *blacklist, u32 blacklistsize, u32 type, u8 *xor_key1, u8 *xor_key2)
 {
     int ret;
     u32 keytag;
@@ -243,6 +245,220 @@ static int _mesgled_decrypt(u32 *tag, u8 *key, u32 code, u8 *prx, u32 size, u32
     return -301;
 }
 
+// Decrypted module cache. Off unless a PRXCACHE folder is made in the ARK
+// folder by hand: a hit reads the slot file twice and hashes both images,
+// which is only a win where the DEBUG load times below beat KIRK
+static PrxCacheIndex g_prx_cache;
+static int g_prx_cache_open = 0; // 1 in use, -1 off until the next boot
+
+static void get_prx_cache_path(char *path, const char *name)
+{
+    ARKConfig *ark_config = sctrlArkGetConfig(NULL);
+
+    strcpy(path, ark_config->arkpath);
+    strcat(path, "PRXCACHE");
+
+    if (name != NULL) {
+        strcat(path, "/");
+        strcat(path, name);
+    }
+}
+
+static int open_prx_cache(void)
+{
+    char path[ARK_PATH_SIZE];
+    SceIoStat stat;
+    int fd;
+
+    if (g_prx_cache_open) {
+        return g_prx_cache_open > 0;
+    }
+
+    get_prx_cache_path(path, "INDEX.BIN");
+    fd = sceIoOpen(path, PSP_O_RDONLY, 0777);
+
+    if (fd >= 0) {
+        int read = sceIoRead(fd, &g_prx_cache, sizeof(g_prx_cache));
+        sceIoClose(fd);
+
+        if (read != sizeof(g_prx_cache) || !prx_cache_check(&g_prx_cache)) {
+            prx_cache_reset(&g_prx_cache);
+        }
+    } else {
+        // no PRXCACHE folder, don't look for it again on every module
+        get_prx_cache_path(path, NULL);
+
+        if (sceIoGetstat(path, &stat) < 0) {
+            g_prx_cache_open = -1;
+            return 0;
+        }
+
+        prx_cache_reset(&g_prx_cache);
+    }
+
+    g_prx_cache_open = 1;
+
+    return 1;
+}
+
+static void save_prx_cache(void)
+{
+    char path[ARK_PATH_SIZE];
+    int fd;
+
+    get_prx_cache_path(path, "INDEX.BIN");
+    fd = sceIoOpen(path, PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+
+    if (fd >= 0) {
+        sceIoWrite(fd, &g_prx_cache, sizeof(g_prx_cache));
+        sceIoClose(fd);
+    }
+}
+
+// slot files are checked through this before the encrypted image is touched
+static u8 g_prx_slot_chunk[0x4000] __attribute__((aligned(64)));
+
+// -1: unusable slot, the image is untouched. -2: read failed after the
+// check passed, the image is gone
+static int read_prx_slot(int slot, u8 *prx)
+{
+    char path[ARK_PATH_SIZE];
+    char name[16];
+    PrxCacheHash state;
+    u32 newsize = g_prx_cache.entries[slot].newsize;
+    u32 digest[2], done;
+    int fd, len, ret = -1;
+
+    sprintf(name, "SLOT%02d.BIN", slot);
+    get_prx_cache_path(path, name);
+    fd = sceIoOpen(path, PSP_O_RDONLY, 0777);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (sceIoLseek32(fd, 0, PSP_SEEK_END) == newsize) {
+        sceIoLseek32(fd, 0, PSP_SEEK_SET);
+        prx_cache_hash_begin(&state, newsize);
+
+        for (done = 0; done < newsize; done += len) {
+            len = newsize - done;
+            if (len > sizeof(g_prx_slot_chunk)) len = sizeof(g_prx_slot_chunk);
+
+            if (sceIoRead(fd, g_prx_slot_chunk, len) != len) {
+                break;
+            }
+
+            prx_cache_hash_update(&state, g_prx_slot_chunk, len);
+        }
+
+        prx_cache_hash_end(&state, digest);
+
+        if (done == newsize && prx_cache_digest_ok(&g_prx_cache, slot, digest)) {
+            sceIoLseek32(fd, 0, PSP_SEEK_SET);
+            ret = (sceIoRead(fd, prx, newsize) == newsize) ? 0 : -2;
+        }
+    }
+
+    sceIoClose(fd);
+
+    return ret;
+}
+
+static void write_prx_slot(const u32 *hash, u32 tag, u8 *prx, u32 size, u32 newsize)
+{
+    char path[ARK_PATH_SIZE];
+    char name[16];
+    u32 digest[2];
+    int slot, fd, written = -1;
+
+    slot = prx_cache_reserve(&g_prx_cache, newsize);
+
+    if (slot < 0) {
+        return;
+    }
+
+    // the index must not point at the slot while its file is rewritten
+    save_prx_cache();
+
+    sprintf(name, "SLOT%02d.BIN", slot);
+    get_prx_cache_path(path, name);
+    fd = sceIoOpen(path, PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+
+    if (fd >= 0) {
+        written = sceIoWrite(fd, prx, newsize);
+        sceIoClose(fd);
+    }
+
+    if (written == newsize) {
+        prx_cache_hash(prx, newsize, digest);
+        prx_cache_commit(&g_prx_cache, slot, hash, tag, size, newsize, digest);
+        save_prx_cache();
+    }
+}
+
+static int _mesgled_decrypt(u32 *tag, u8 *key, u32 code, u8 *prx, u32 size, u32 *newsize, u32 use_polling, u8 *blacklist, u32 blacklistsize, u32 type, u8 *xor_key1, u8 *xor_key2)
+{
+    int ret, slot = -1;
+    u32 hash[2];
+    u32 k1 = pspSdkSetK1(0);
+    int cached = open_prx_cache();
+
+    #ifdef DEBUG
+    u32 start = sceKernelGetSystemTimeLow();
+    #endif
+
+    if (cached) {
+        prx_cache_hash(prx, size, hash);
+        slot = prx_cache_find(&g_prx_cache, hash, *tag, size);
+    }
+
+    if (slot >= 0) {
+        // a cached module still has to pass the current blacklist
+        if (prx_cache_blacklisted(prx, blacklist, blacklistsize)) {
+            pspSdkSetK1(k1);
+            return -305;
+        }
+
+        ret = read_prx_slot(slot, prx);
+
+        if (ret == 0) {
+            *newsize = g_prx_cache.entries[slot].newsize;
+
+            #ifdef DEBUG
+            printk("%s: cached tag=0x%08X size=%d in %dus (%d hits, %d misses)\n", __func__, (uint)*tag, (int)size,
+                (int)(sceKernelGetSystemTimeLow() - start), (int)g_prx_cache.hits, (int)g_prx_cache.misses);
+            #endif
+
+            pspSdkSetK1(k1);
+            return 0;
+        }
+
+        // a short or changed slot file only costs the decryption below
+        prx_cache_drop(&g_prx_cache, slot);
+        save_prx_cache();
+
+        // the file passed its check and then failed to read, the image is gone
+        if (ret < -1) {
+            pspSdkSetK1(k1);
+            return -301;
+        }
+    }
+
+    ret = decrypt_prx(tag, key, code, prx, size, newsize, use_polling, blacklist, blacklistsize, type, xor_key1, xor_key2);
+
+    #ifdef DEBUG
+    printk("%s: decrypted tag=0x%08X size=%d in %dus\n", __func__, (uint)*tag, (int)size, (int)(sceKernelGetSystemTimeLow() - start));
+    #endif
+
+    if (ret == 0 && cached) {
+        write_prx_slot(hash, *tag, prx, size, *newsize);
+    }
+
+    pspSdkSetK1(k1);
+    return ret;
+}
+
 void patch_sceMesgLed()
 {
     SceModule2 *mod;
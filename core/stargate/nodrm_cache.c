@@ -0,0 +1,151 @@
+/*
+ * This file is part of PRO CFW.
+
+ * PRO CFW is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * PRO CFW is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PRO CFW. If not, see <http://www.gnu.org/licenses/ .
+ */
+
+/*
+ * NODRM file classification and its per-path cache.
+ * No kernel calls in here, locking and file access are left to the caller.
+ */
+
+#include <string.h>
+#include "nodrm_cache.h"
+
+// DRM Magic #1 "PSPEDATA"
+static const unsigned char g_drm_magic_1[8] = {
+    0x00, 0x50, 0x53, 0x50, 0x45, 0x44, 0x41, 0x54
+};
+
+// DRM Magic #2 "PGD"
+static const unsigned char g_drm_magic_2[4] = {
+    0x00, 0x50, 0x47, 0x44
+};
+
+// File Classifier
+int nodrm_classify(const void * header, int len)
+{
+    // Read Error (we assume its decrypted because of small size)
+    if(len != 8) return NODRM_PLAIN;
+
+    // DRM Magic #1 "PSPEDATA" Match
+    if(memcmp(header, g_drm_magic_1, sizeof(g_drm_magic_1)) == 0)
+        return NODRM_PSPEDATA;
+
+    // DRM Magic #2 "PGD" Match
+    if(memcmp(header, g_drm_magic_2, sizeof(g_drm_magic_2)) == 0)
+        return NODRM_PGD;
+
+    // Decrypted File
+    return NODRM_PLAIN;
+}
+
+// FNV-1a Path Hash (never 0, that means the Path is too long to remember)
+static u32 hash_path(const char * path)
+{
+    u32 hash = 0x811C9DC5;
+    const char * p = path;
+
+    for(; *p; p++)
+    {
+        hash ^= (unsigned char)*p;
+        hash *= 0x01000193;
+    }
+
+    if(p - path >= NODRM_PATH_SIZE) return 0;
+
+    return hash | 1;
+}
+
+// Entry of a Path (the Hash only filters, the Path decides)
+static NoDrmCacheEntry * find_path(NoDrmCache * cache, const char * path, u32 hash)
+{
+    int i = 0; for(; i < NODRM_CACHE_SIZE; i++)
+    {
+        NoDrmCacheEntry * e = &cache->entries[i];
+
+        if(e->used && e->hash == hash && strcmp(e->path, path) == 0)
+            return e;
+    }
+
+    return NULL;
+}
+
+// Remembered Path Check
+int nodrm_cache_known(NoDrmCache * cache, const char * path)
+{
+    u32 hash = hash_path(path);
+
+    return hash != 0 && find_path(cache, path, hash) != NULL;
+}
+
+// Cached File Type Lookup
+int nodrm_cache_find(NoDrmCache * cache, const char * path, u32 size, const void * mtime)
+{
+    u32 hash = hash_path(path);
+    NoDrmCacheEntry * e = (hash != 0) ? find_path(cache, path, hash) : NULL;
+
+    // Same Path, still the same File
+    if(e != NULL && e->size == size && memcmp(e->mtime, mtime, NODRM_MTIME_SIZE) == 0)
+    {
+        e->age = ++cache->clock;
+        cache->hits++;
+        return e->type;
+    }
+
+    cache->misses++;
+
+    return -1;
+}
+
+// Remember File Type
+void nodrm_cache_add(NoDrmCache * cache, const char * path, u32 size, const void * mtime, int type)
+{
+    u32 hash = hash_path(path);
+
+    // Path too long
+    if(hash == 0) return;
+
+    // Replace outdated Entry of the same Path
+    NoDrmCacheEntry * victim = find_path(cache, path, hash);
+
+    // Otherwise the least recently used one
+    int i = 0; for(; victim == NULL && i < NODRM_CACHE_SIZE; i++)
+    {
+        NoDrmCacheEntry * e = &cache->entries[i];
+
+        // Free Entries go first
+        if(!e->used)
+            victim = e;
+    }
+
+    if(victim == NULL)
+    {
+        victim = &cache->entries[0];
+
+        for(i = 1; i < NODRM_CACHE_SIZE; i++)
+        {
+            if(cache->entries[i].age < victim->age)
+                victim = &cache->entries[i];
+        }
+    }
+
+    victim->hash = hash;
+    victim->size = size;
+    victim->type = type;
+    victim->used = 1;
+    victim->age = ++cache->clock;
+    memcpy(victim->mtime, mtime, NODRM_MTIME_SIZE);
+    strcpy(victim->path, path);
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of PRO CFW.
+
+ * PRO CFW is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * PRO CFW is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PRO CFW. If not, see <http://www.gnu.org/licenses/ .
+ */
+
+#ifndef _NODRM_CACHE_H_
+#define _NODRM_CACHE_H_
+
+#ifdef __psp__
+#include <psptypes.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+#endif
+
+// Remembered Files (about 5KB with the Paths)
+#define NODRM_CACHE_SIZE 32
+
+// Longest remembered Path plus Terminator, longer Paths are probed every Time
+#define NODRM_PATH_SIZE 128
+
+// Modification Time Size (ScePspDateTime)
+#define NODRM_MTIME_SIZE 16
+
+// File Types
+enum {
+    NODRM_PLAIN = 0,
+    NODRM_PSPEDATA,
+    NODRM_PGD,
+};
+
+// Cached File Classification
+typedef struct NoDrmCacheEntry {
+    u32 hash;
+    u32 size;
+    u32 age;
+    u8 type;
+    u8 used;
+    u8 mtime[NODRM_MTIME_SIZE];
+    char path[NODRM_PATH_SIZE];
+} NoDrmCacheEntry;
+
+typedef struct NoDrmCache {
+    NoDrmCacheEntry entries[NODRM_CACHE_SIZE];
+    u32 clock;
+    u32 hits;
+    u32 misses;
+} NoDrmCache;
+
+// Classify File by its first Bytes (short Files are plain)
+int nodrm_classify(const void * header, int len);
+
+// Path has an Entry (worth a sceIoGetstat to check its Version)
+int nodrm_cache_known(NoDrmCache * cache, const char * path);
+
+// Cached Type of a File, -1 if unknown or changed
+int nodrm_cache_find(NoDrmCache * cache, const char * path, u32 size, const void * mtime);
+
+// Remember Type of a File, replaces the least recently used Entry (Paths that don't fit are skipped)
+void nodrm_cache_add(NoDrmCache * cache, const char * path, u32 size, const void * mtime, int type);
+
+#endif
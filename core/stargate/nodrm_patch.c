@@ -22,6 +22,7 @@
 #include <macros.h>
 #include <string.h>
 #include "nodrm_patch.h"
+#include "nodrm_cache.h"
 
 // NODRM Hook Entry
 typedef struct _NoDrmHookEntry {
@@ -47,15 +48,8 @@ static NoDrmFd * g_tail = &g_head;
 // NODRM Semaphore
 static int g_nodrm_sema = -1;
 
-// DRM Magic #1 "PSPEDATA"
-static unsigned char g_drm_magic_1[8] = {
-    0x00, 0x50, 0x53, 0x50, 0x45, 0x44, 0x41, 0x54
-};
-
-// DRM Magic #2 "PGD"
-static unsigned char g_drm_magic_2[4] = {
-    0x00, 0x50, 0x47, 0x44
-};
+// File Type Cache (protected by the NODRM Semaphore)
+static NoDrmCache g_nodrm_cache;
 
 // Original Sony Function Pointer
 static int (* _sceNpDrmRenameCheck)(char * fn);
@@ -73,8 +67,11 @@ void nodrmHookFunctions(void);
 // Helper Function Prototypes
 int check_memory(const void * addr, int size);
 int is_encrypted_flag(int flag);
+int get_file_type(int fd);
 int check_file_is_encrypted(int fd);
 int check_file_is_encrypted_by_path(const char * path);
+int find_file_type(const char * path, SceIoStat * stat);
+void remember_file_type(const char * path, SceIoStat * stat, int type);
 static void lock(void);
 static void unlock(void);
 
@@ -173,8 +170,8 @@ int is_encrypted_flag(int flag)
     return 0;
 }
 
-// File Crypto Checker
-int check_file_is_encrypted(int fd)
+// File Type Checker
+int get_file_type(int fd)
 {
     // Work Buffer (unaligned)
     char p[8 + 64];
@@ -194,55 +191,122 @@ int check_file_is_encrypted(int fd)
     // Rewind File
     sceIoLseek32(fd, 0, PSP_SEEK_SET);
     
-    // Read Error (we assume its decrypted because of small size)
-    if(result != 8) return 0;
+    // Match DRM Magic
+    return nodrm_classify(buf, result);
+}
+
+// File Crypto Checker
+int check_file_is_encrypted(int fd)
+{
+    return get_file_type(fd) != NODRM_PLAIN;
+}
+
+// Cached File Type Lookup (-1 if unknown, stat->st_size is -1 if the File wasn't looked at)
+int find_file_type(const char * path, SceIoStat * stat)
+{
+    // Result
+    int type = -1;
     
-    // DRM Magic #1 "PSPEDATA" Match
-    if(memcmp(buf, g_drm_magic_1, sizeof(g_drm_magic_1)) == 0)
-    {
-        return 1;
-    }
+    // File not looked at yet
+    stat->st_size = -1;
+    
+    // Invalid Path Buffer Memory Location
+    if(!check_memory(path, strlen(path) + 1)) return -1;
+    
+    // Unknown Path (no sceIoGetstat for Files we never saw)
+    lock();
+    int known = nodrm_cache_known(&g_nodrm_cache, path);
+    unlock();
+    if(!known) return -1;
+    
+    // Elevate Permission Level (stat is Kernel Memory, the Path was opened by the Caller before)
+    unsigned int k1 = pspSdkSetK1(0);
     
-    // DRM Magic #2 "PGD"
-    if(memcmp(buf, g_drm_magic_2, sizeof(g_drm_magic_2)) == 0)
+    // Size and Modification Time identify the File Version
+    if(sceIoGetstat(path, stat) < 0) stat->st_size = -1;
+    
+    // Restore Permission Level
+    pspSdkSetK1(k1);
+    
+    // File gone
+    if(stat->st_size < 0) return -1;
+    
+    // Cache Lookup
+    lock();
+    type = nodrm_cache_find(&g_nodrm_cache, path, (u32)stat->st_size, &stat->st_mtime);
+    unlock();
+    
+    // Return Type
+    return type;
+}
+
+// Remember File Type for the next Open
+void remember_file_type(const char * path, SceIoStat * stat, int type)
+{
+    // Path too long to remember
+    if(strlen(path) >= NODRM_PATH_SIZE) return;
+    
+    // File Version unknown
+    if(stat->st_size < 0)
     {
-        return 1;
+        // Elevate Permission Level (stat is Kernel Memory, the Caller just opened the Path)
+        unsigned int k1 = pspSdkSetK1(0);
+        
+        // Size and Modification Time identify the File Version
+        int result = sceIoGetstat(path, stat);
+        
+        // Restore Permission Level
+        pspSdkSetK1(k1);
+        
+        // File gone
+        if(result < 0) return;
     }
     
-    // Decrypted File
-    return 0;
+    lock();
+    nodrm_cache_add(&g_nodrm_cache, path, (u32)stat->st_size, &stat->st_mtime, type);
+    unlock();
 }
 
 // File Crypto Checker (Path Variant)
 int check_file_is_encrypted_by_path(const char * path)
 {
-    // Result
-    int result = 0;
-    
-    // Elevate Permission Level
-    unsigned int k1 = pspSdkSetK1(0);
+    // File Information
+    SceIoStat stat;
     
-    // Open File in Binary Mode
-    int fd = sceIoOpen(path, PSP_O_RDONLY, 0777);
+    // Known File
+    int type = find_file_type(path, &stat);
     
-    // Opened File
-    if(fd >= 0)
+    // Unknown File
+    if(type < 0)
     {
-        // 2nd Stage Crypto Check
-        result = check_file_is_encrypted(fd);
+        // Elevate Permission Level
+        unsigned int k1 = pspSdkSetK1(0);
         
-        // Close File
-        sceIoClose(fd);
+        // Open File in Binary Mode
+        int fd = sceIoOpen(path, PSP_O_RDONLY, 0777);
+        
+        // Opened File
+        if(fd >= 0)
+        {
+            // 2nd Stage Crypto Check
+            type = get_file_type(fd);
+            
+            // Close File
+            sceIoClose(fd);
+            
+            // Remember Result
+            remember_file_type(path, &stat, type);
+        }
+        
+        // Restore Permission Level
+        pspSdkSetK1(k1);
     }
     
     // Open Error (we assume its encrypted)
-    else result = 1;
-    
-    // Restore Permission Level
-    pspSdkSetK1(k1);
+    if(type < 0) return 1;
     
     // Return Result
-    return result;
+    return type != NODRM_PLAIN;
 }
 
 // Lock Semaphore
@@ -372,14 +436,33 @@ int myIoOpen(const char * file, int flag, int mode)
     // Encrypted File requested
     if(is_encrypted_flag(flag))
     {
+        // File Information
+        SceIoStat stat;
+        
+        // Known File
+        int type = find_file_type(file, &stat);
+        
+        // Known Encrypted File
+        if(type > NODRM_PLAIN) goto forward;
+        
         // Open File in Binary Mode
         fd = sceIoOpen(file, PSP_O_RDONLY, mode);
         
         // Opened File
         if(fd >= 0)
         {
+            // Unknown File
+            if(type < 0)
+            {
+                // Check Crypto Magic
+                type = get_file_type(fd);
+                
+                // Remember Result
+                remember_file_type(file, &stat, type);
+            }
+            
             // Encrypted File encountered
-            if(check_file_is_encrypted(fd))
+            if(type != NODRM_PLAIN)
             {
                 // Close Binary File Descriptor
                 sceIoClose(fd);
@@ -397,6 +480,8 @@ int myIoOpen(const char * file, int flag, int mode)
         }
     }
     
+forward:
+    
     // Forward Call
     fd = sceIoOpen(file, flag, mode);
     
@@ -418,22 +503,38 @@ int myIoOpenAsync(const char * file, int flag, int mode)
     // Encrypted File requested
     if(is_encrypted_flag(flag))
     {
-        // Open File in Binary Mode
-        fd = sceIoOpen(file, PSP_O_RDONLY, mode);
+        // File Information
+        SceIoStat stat;
         
-        // Opened File
-        if(fd >= 0)
+        // Known File
+        int type = find_file_type(file, &stat);
+        
+        // Unknown File
+        if(type < 0)
         {
-            // Decrypted File encountered
-            if(!check_file_is_encrypted(fd))
+            // Open File in Binary Mode
+            fd = sceIoOpen(file, PSP_O_RDONLY, mode);
+            
+            // Opened File
+            if(fd >= 0)
             {
-                // Set Decrypted File Flag
-                is_plain = 1;
+                // Check Crypto Magic
+                type = get_file_type(fd);
+                
+                // Remember Result
+                remember_file_type(file, &stat, type);
             }
+            
+            // Close Binary File Descriptor
+            sceIoClose(fd);
         }
         
-        // Close Binary File Descriptor
-        sceIoClose(fd);
+        // Decrypted File encountered
+        if(type == NODRM_PLAIN)
+        {
+            // Set Decrypted File Flag
+            is_plain = 1;
+        }
     }
     
     // Decrypted File encountered
@@ -0,0 +1,229 @@
+/*
+ * This file is part of PRO CFW.
+
+ * PRO CFW is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * PRO CFW is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PRO CFW. If not, see <http://www.gnu.org/licenses/ .
+ */
+
+/*
+ * Index of the decrypted module cache.
+ * No kernel calls in here, the Slot Files are read and written by the caller.
+ */
+
+#include <string.h>
+#include "prx_cache.h"
+
+// Module Image Hash (FNV-1a over words, plus a rotating sum as second half)
+void prx_cache_hash_begin(PrxCacheHash * state, u32 size)
+{
+    state->h = 0x811C9DC5 ^ size;
+    state->s = size;
+}
+
+// Chunks must be whole words, except the last one
+void prx_cache_hash_update(PrxCacheHash * state, const void * buf, u32 len)
+{
+    const u32 * p = (const u32 *)buf;
+    const u8 * tail = (const u8 *)buf + (len & ~3);
+    u32 h = state->h;
+    u32 s = state->s;
+    u32 i = 0;
+
+    for(; i < len / 4; i++)
+    {
+        h = (h ^ p[i]) * 0x01000193;
+        s = ((s << 5) | (s >> 27)) + p[i];
+    }
+
+    for(i = 0; i < (len & 3); i++)
+    {
+        h = (h ^ tail[i]) * 0x01000193;
+        s = ((s << 5) | (s >> 27)) + tail[i];
+    }
+
+    state->h = h;
+    state->s = s;
+}
+
+void prx_cache_hash_end(PrxCacheHash * state, u32 * hash)
+{
+    hash[0] = state->h;
+    hash[1] = state->s;
+}
+
+void prx_cache_hash(const void * prx, u32 size, u32 * hash)
+{
+    PrxCacheHash state;
+
+    prx_cache_hash_begin(&state, size);
+    prx_cache_hash_update(&state, prx, size);
+    prx_cache_hash_end(&state, hash);
+}
+
+// Empty Index
+void prx_cache_reset(PrxCacheIndex * index)
+{
+    memset(index, 0, sizeof(PrxCacheIndex));
+    index->magic = PRX_CACHE_MAGIC;
+    index->count = PRX_CACHE_SIZE;
+}
+
+// Index Check
+int prx_cache_check(PrxCacheIndex * index)
+{
+    u32 bytes = 0;
+    int i = 0;
+
+    if(index->magic != PRX_CACHE_MAGIC || index->count != PRX_CACHE_SIZE)
+        return 0;
+
+    for(; i < PRX_CACHE_SIZE; i++)
+    {
+        PrxCacheEntry * e = &index->entries[i];
+
+        if(!e->used) continue;
+
+        // Decrypted Images never grow
+        if(e->newsize == 0 || e->newsize > e->size || e->newsize > PRX_CACHE_MAX_BYTES)
+            return 0;
+
+        bytes += e->newsize;
+    }
+
+    return bytes == index->bytes && bytes <= PRX_CACHE_MAX_BYTES;
+}
+
+// Cached Image Lookup
+int prx_cache_find(PrxCacheIndex * index, const u32 * hash, u32 tag, u32 size)
+{
+    int i = 0;
+
+    for(; i < PRX_CACHE_SIZE; i++)
+    {
+        PrxCacheEntry * e = &index->entries[i];
+
+        if(e->used && e->hash[0] == hash[0] && e->hash[1] == hash[1] && e->tag == tag && e->size == size)
+        {
+            e->age = ++index->clock;
+            index->hits++;
+            return i;
+        }
+    }
+
+    index->misses++;
+
+    return -1;
+}
+
+// Free a Slot
+void prx_cache_drop(PrxCacheIndex * index, int slot)
+{
+    PrxCacheEntry * e = &index->entries[slot];
+
+    if(e->used) index->bytes -= e->newsize;
+
+    memset(e, 0, sizeof(PrxCacheEntry));
+}
+
+// Make Room for a new Image
+int prx_cache_reserve(PrxCacheIndex * index, u32 newsize)
+{
+    int slot = -1;
+    int i = 0;
+
+    if(newsize == 0 || newsize > PRX_CACHE_MAX_BYTES)
+        return -1;
+
+    for(; i < PRX_CACHE_SIZE; i++)
+    {
+        if(!index->entries[i].used)
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    // Evict least recently used Images until there is a Slot and enough Storage
+    while(slot < 0 || index->bytes + newsize > PRX_CACHE_MAX_BYTES)
+    {
+        int victim = -1;
+
+        for(i = 0; i < PRX_CACHE_SIZE; i++)
+        {
+            PrxCacheEntry * e = &index->entries[i];
+
+            if(e->used && (victim < 0 || e->age < index->entries[victim].age))
+                victim = i;
+        }
+
+        // Can't happen with a consistent Index
+        if(victim < 0) return -1;
+
+        prx_cache_drop(index, victim);
+
+        if(slot < 0) slot = victim;
+    }
+
+    return slot;
+}
+
+// Remember a written Slot
+void prx_cache_commit(PrxCacheIndex * index, int slot, const u32 * hash, u32 tag, u32 size, u32 newsize, const u32 * digest)
+{
+    PrxCacheEntry * e = &index->entries[slot];
+
+    e->hash[0] = hash[0];
+    e->hash[1] = hash[1];
+    e->tag = tag;
+    e->size = size;
+    e->newsize = newsize;
+    e->digest[0] = digest[0];
+    e->digest[1] = digest[1];
+    e->used = 1;
+    e->age = ++index->clock;
+
+    index->bytes += newsize;
+}
+
+// Slot File Check
+int prx_cache_digest_ok(PrxCacheIndex * index, int slot, const u32 * digest)
+{
+    PrxCacheEntry * e = &index->entries[slot];
+
+    return digest[0] == e->digest[0] && digest[1] == e->digest[1];
+}
+
+int prx_cache_verify(PrxCacheIndex * index, int slot, const void * prx)
+{
+    u32 digest[2];
+
+    prx_cache_hash(prx, index->entries[slot].newsize, digest);
+
+    return prx_cache_digest_ok(index, slot, digest);
+}
+
+// Blacklist Check (16 Byte Entries matched against the Image at 0x140)
+int prx_cache_blacklisted(const u8 * prx, const u8 * blacklist, u32 blacklistsize)
+{
+    u32 i = 0;
+
+    if(blacklist == NULL) return 0;
+
+    for(; i < blacklistsize / 16; i++)
+    {
+        if(memcmp(blacklist + i * 16, prx + 0x140, 0x10) == 0)
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of PRO CFW.
+
+ * PRO CFW is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * PRO CFW is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PRO CFW. If not, see <http://www.gnu.org/licenses/ .
+ */
+
+#ifndef _PRX_CACHE_H_
+#define _PRX_CACHE_H_
+
+#ifdef __psp__
+#include <psptypes.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint32_t u32;
+#endif
+
+// Index Magic "PXC2"
+#define PRX_CACHE_MAGIC 0x32435850
+
+// Cached Modules (one Slot File each)
+#define PRX_CACHE_SIZE 32
+
+// Storage used by all Slot Files together
+#define PRX_CACHE_MAX_BYTES (32 * 1024 * 1024)
+
+// Decrypted Module Image
+typedef struct PrxCacheEntry {
+    u32 hash[2]; // hash of the encrypted image
+    u32 tag;
+    u32 size; // encrypted size
+    u32 newsize; // decrypted size, stored in the Slot File
+    u32 digest[2]; // hash of the decrypted image, checked after the Slot File is read
+    u32 age;
+    u32 used;
+} PrxCacheEntry;
+
+// Index File, kept in Memory while the Cache is in use
+typedef struct PrxCacheIndex {
+    u32 magic;
+    u32 count;
+    u32 clock;
+    u32 bytes;
+    u32 hits;
+    u32 misses;
+    PrxCacheEntry entries[PRX_CACHE_SIZE];
+} PrxCacheIndex;
+
+// Running Hash over an Image read in Chunks
+typedef struct PrxCacheHash {
+    u32 h;
+    u32 s;
+} PrxCacheHash;
+
+// 64 Bit Hash of an encrypted Module Image (prx must be word aligned)
+void prx_cache_hash(const void * prx, u32 size, u32 * hash);
+
+// Same Hash in Chunks, all but the last must be whole Words (size is the total)
+void prx_cache_hash_begin(PrxCacheHash * state, u32 size);
+void prx_cache_hash_update(PrxCacheHash * state, const void * buf, u32 len);
+void prx_cache_hash_end(PrxCacheHash * state, u32 * hash);
+
+// Empty Index
+void prx_cache_reset(PrxCacheIndex * index);
+
+// Check an Index read from Storage, 0 if it can't be used
+int prx_cache_check(PrxCacheIndex * index);
+
+// Slot holding the decrypted Image, -1 if not cached
+int prx_cache_find(PrxCacheIndex * index, const u32 * hash, u32 tag, u32 size);
+
+// Free a Slot for a new Image, evicts the least recently used ones (-1 if it can't fit)
+int prx_cache_reserve(PrxCacheIndex * index, u32 newsize);
+
+// Mark a reserved Slot as holding the Image once its File is written
+void prx_cache_commit(PrxCacheIndex * index, int slot, const u32 * hash, u32 tag, u32 size, u32 newsize, const u32 * digest);
+
+// Check the Hash of a Slot File against the Digest taken when it was written
+int prx_cache_digest_ok(PrxCacheIndex * index, int slot, const u32 * digest);
+
+// Same for a whole decrypted Image in Memory
+int prx_cache_verify(PrxCacheIndex * index, int slot, const void * prx);
+
+// Drop a Slot whose File turned out unusable
+void prx_cache_drop(PrxCacheIndex * index, int slot);
+
+// Same Blacklist Check the Decrypter does on the encrypted Image
+int prx_cache_blacklisted(const u8 * prx, const u8 * blacklist, u32 blacklistsize);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+    host test for the NODRM file type cache (nodrm_cache.c)
+
+    Classifies PSPEDATA, PGD, plain and short headers, then checks the
+    cache: a file is only found again under its own path, size and mtime,
+    two paths with the same FNV-1a hash don't share an entry, paths that
+    don't fit aren't remembered and the least recently used entry goes
+    first.
+
+    nodrmtest           fails on the first wrong answer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../nodrm_cache.h"
+
+static int failed;
+
+#define CHECK(cond) do { if(!(cond)) { printf("line %d: %s\n", __LINE__, #cond); failed = 1; } } while(0)
+
+static u32 fnv1a(const char * s)
+{
+    u32 h = 0x811C9DC5;
+    while(*s) { h ^= (unsigned char)*s++; h *= 0x01000193; }
+    return h;
+}
+
+typedef struct {
+    u32 hash;
+    u32 n;
+} Sample;
+
+static int by_hash(const void * a, const void * b)
+{
+    u32 x = ((const Sample *)a)->hash, y = ((const Sample *)b)->hash;
+    return (x > y) - (x < y);
+}
+
+// two save paths with the same FNV-1a hash
+static void save_path(char * path, u32 n)
+{
+    static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char id[8];
+    int i;
+
+    for(i = 0; i < 7; i++, n /= 36) id[i] = digits[n % 36];
+    id[7] = 0;
+    sprintf(path, "ms0:/PSP/SAVEDATA/ULUS%s/DATA.BIN", id);
+}
+
+static int find_collision(char * a, char * b)
+{
+    const u32 n = 1 << 18;
+    Sample * s = malloc(n * sizeof(Sample));
+    char path[64];
+    u32 i;
+    int found = 0;
+
+    for(i = 0; i < n; i++)
+    {
+        save_path(path, i * 2654435761u);
+        s[i].hash = fnv1a(path);
+        s[i].n = i;
+    }
+    qsort(s, n, sizeof(Sample), by_hash);
+
+    for(i = 1; i < n && !found; i++)
+    {
+        if(s[i].hash == s[i-1].hash)
+        {
+            save_path(a, s[i-1].n * 2654435761u);
+            save_path(b, s[i].n * 2654435761u);
+            found = 1;
+        }
+    }
+
+    free(s);
+    return found;
+}
+
+static void test_classify(void)
+{
+    CHECK(nodrm_classify("\0PSPEDATA", 8) == NODRM_PSPEDATA);
+    CHECK(nodrm_classify("\0PGD\1\0\0\0", 8) == NODRM_PGD);
+    CHECK(nodrm_classify("\x7f" "ELF\1\1\1\0", 8) == NODRM_PLAIN);
+    CHECK(nodrm_classify("\0PGD", 4) == NODRM_PLAIN);         // short read
+    CHECK(nodrm_classify("\0PSPEDATA", -1) == NODRM_PLAIN);   // read error
+}
+
+static void test_cache(void)
+{
+    static NoDrmCache c;
+    u8 m1[NODRM_MTIME_SIZE] = { 1 }, m2[NODRM_MTIME_SIZE] = { 2 };
+    char a[64], b[64], path[64], longpath[NODRM_PATH_SIZE + 1];
+    int i;
+
+    memset(&c, 0, sizeof(c));
+
+    CHECK(!nodrm_cache_known(&c, "ms0:/a"));
+    CHECK(nodrm_cache_find(&c, "ms0:/a", 10, m1) == -1);
+
+    nodrm_cache_add(&c, "ms0:/a", 10, m1, NODRM_PGD);
+    CHECK(nodrm_cache_known(&c, "ms0:/a"));
+    CHECK(nodrm_cache_find(&c, "ms0:/a", 10, m1) == NODRM_PGD);
+
+    // changed file
+    CHECK(nodrm_cache_find(&c, "ms0:/a", 11, m1) == -1);
+    CHECK(nodrm_cache_find(&c, "ms0:/a", 10, m2) == -1);
+    nodrm_cache_add(&c, "ms0:/a", 10, m2, NODRM_PLAIN);
+    CHECK(nodrm_cache_find(&c, "ms0:/a", 10, m2) == NODRM_PLAIN);
+
+    // similar paths
+    CHECK(!nodrm_cache_known(&c, "ms0:/A"));
+    CHECK(!nodrm_cache_known(&c, "ms0:/a/"));
+    CHECK(!nodrm_cache_known(&c, "ms0:/"));
+
+    // same hash, different file
+    if(find_collision(a, b))
+    {
+        nodrm_cache_add(&c, a, 100, m1, NODRM_PSPEDATA);
+        CHECK(!nodrm_cache_known(&c, b));
+        CHECK(nodrm_cache_find(&c, b, 100, m1) == -1);
+        nodrm_cache_add(&c, b, 100, m1, NODRM_PLAIN);
+        CHECK(nodrm_cache_find(&c, a, 100, m1) == NODRM_PSPEDATA);
+        CHECK(nodrm_cache_find(&c, b, 100, m1) == NODRM_PLAIN);
+        printf("colliding paths: %s %s\n", a, b);
+    }
+    else
+    {
+        printf("no hash collision found\n");
+        failed = 1;
+    }
+
+    // too long to remember
+    memset(longpath, 'x', NODRM_PATH_SIZE);
+    longpath[NODRM_PATH_SIZE] = 0;
+    nodrm_cache_add(&c, longpath, 1, m1, NODRM_PGD);
+    CHECK(!nodrm_cache_known(&c, longpath));
+    CHECK(nodrm_cache_find(&c, longpath, 1, m1) == -1);
+    longpath[NODRM_PATH_SIZE - 1] = 0;
+    nodrm_cache_add(&c, longpath, 1, m1, NODRM_PGD);
+    CHECK(nodrm_cache_find(&c, longpath, 1, m1) == NODRM_PGD);
+
+    // least recently used goes, ms0:/f0 is kept busy
+    memset(&c, 0, sizeof(c));
+    for(i = 0; i < NODRM_CACHE_SIZE + 8; i++)
+    {
+        sprintf(path, "ms0:/f%d", i);
+        nodrm_cache_add(&c, path, i, m1, NODRM_PLAIN);
+        CHECK(nodrm_cache_find(&c, "ms0:/f0", 0, m1) == NODRM_PLAIN);
+    }
+    CHECK(nodrm_cache_find(&c, "ms0:/f1", 1, m1) == -1);
+    sprintf(path, "ms0:/f%d", NODRM_CACHE_SIZE + 7);
+    CHECK(nodrm_cache_find(&c, path, NODRM_CACHE_SIZE + 7, m1) == NODRM_PLAIN);
+    for(i = 0; i < NODRM_CACHE_SIZE; i++) CHECK(c.entries[i].used);
+}
+
+int main(void)
+{
+    test_classify();
+    test_cache();
+
+    printf("entry %d bytes, cache %d bytes\n", (int)sizeof(NoDrmCacheEntry), (int)sizeof(NoDrmCache));
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
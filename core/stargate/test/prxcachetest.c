@@ -0,0 +1,318 @@
+/*
+    host test for the decrypted module cache index (prx_cache.c)
+
+    Checks the hash of encrypted images, also taken in chunks, the index
+    round trip through a file and the rejection of damaged ones, slot and
+    byte budget eviction, the blacklist check and the slot file read the
+    way key_decrypt.c does it: a short, long or changed file is refused
+    before the encrypted image is touched.
+
+    prxcachetest        fails on the first wrong answer
+    prxcachetest -b     time of a cache hit on the host: hash the encrypted
+                        image, check the slot file in chunks, read it
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../prx_cache.h"
+
+#define TAG 0xD91609F0
+
+static int failed;
+
+#define CHECK(cond) do { if(!(cond)) { printf("line %d: %s\n", __LINE__, #cond); failed = 1; } } while(0)
+
+static u8 * random_image(u32 size)
+{
+    u8 * p = aligned_alloc(64, (size + 63) & ~63);
+    u32 i;
+
+    for(i = 0; i < size; i++) p[i] = rand();
+    return p;
+}
+
+static int write_file(const char * path, const void * buf, u32 size)
+{
+    FILE * fp = fopen(path, "wb");
+    if(fp == NULL) return -1;
+    int ok = fwrite(buf, 1, size, fp) == size;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+static int read_file(const char * path, void * buf, u32 size)
+{
+    FILE * fp = fopen(path, "rb");
+    if(fp == NULL) return -1;
+    int ok = fread(buf, 1, size, fp) == size;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+// read_prx_slot on stdio: check size and digest in chunks, then read
+static u8 chunk[0x4000];
+
+static int read_slot(const char * path, PrxCacheIndex * idx, int slot, u8 * prx)
+{
+    PrxCacheHash state;
+    u32 newsize = idx->entries[slot].newsize;
+    u32 digest[2], done;
+    int len, ret = -1;
+    FILE * fp = fopen(path, "rb");
+
+    if(fp == NULL) return -1;
+
+    fseek(fp, 0, SEEK_END);
+    if(ftell(fp) == newsize)
+    {
+        fseek(fp, 0, SEEK_SET);
+        prx_cache_hash_begin(&state, newsize);
+
+        for(done = 0; done < newsize; done += len)
+        {
+            len = newsize - done;
+            if(len > sizeof(chunk)) len = sizeof(chunk);
+            if(fread(chunk, 1, len, fp) != len) break;
+            prx_cache_hash_update(&state, chunk, len);
+        }
+
+        prx_cache_hash_end(&state, digest);
+
+        if(done == newsize && prx_cache_digest_ok(idx, slot, digest))
+        {
+            fseek(fp, 0, SEEK_SET);
+            ret = fread(prx, 1, newsize, fp) == newsize ? 0 : -2;
+        }
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+static void test_hash(void)
+{
+    u32 size = 1 << 20;
+    u8 * img = random_image(size);
+    u32 h[2], h2[2];
+
+    prx_cache_hash(img, size, h);
+    img[size / 2] ^= 1;
+    prx_cache_hash(img, size, h2);
+    img[size / 2] ^= 1;
+    CHECK(h[0] != h2[0] && h[1] != h2[1]);
+
+    prx_cache_hash(img, size - 1, h2);
+    CHECK(h[0] != h2[0]);
+
+    // in chunks: whole words, then an odd tail
+    u32 sizes[] = { size, size - 1, size - 3, 5 };
+    u32 steps[] = { 4, 0x4000, 0x3FFC };
+    int i, j;
+
+    for(i = 0; i < 4; i++)
+    {
+        prx_cache_hash(img, sizes[i], h);
+
+        for(j = 0; j < 3; j++)
+        {
+            PrxCacheHash state;
+            u32 done, len;
+
+            prx_cache_hash_begin(&state, sizes[i]);
+            for(done = 0; done < sizes[i]; done += len)
+            {
+                len = sizes[i] - done < steps[j] ? sizes[i] - done : steps[j];
+                prx_cache_hash_update(&state, img + done, len);
+            }
+            prx_cache_hash_end(&state, h2);
+            CHECK(h[0] == h2[0] && h[1] == h2[1]);
+        }
+    }
+
+    free(img);
+}
+
+static void test_index(const char * dir)
+{
+    static PrxCacheIndex idx, copy;
+    char path[256];
+    u32 size = 1 << 20, newsize = size - 0x150;
+    u8 * img = random_image(size);
+    u32 h[2], d[2], k[2] = { 1, 0 };
+    int s, i;
+
+    prx_cache_reset(&idx);
+    CHECK(prx_cache_check(&idx));
+
+    prx_cache_hash(img, size, h);
+    CHECK(prx_cache_find(&idx, h, TAG, size) == -1);
+
+    // image decrypts to its first newsize bytes here
+    prx_cache_hash(img, newsize, d);
+    s = prx_cache_reserve(&idx, newsize);
+    CHECK(s == 0);
+    prx_cache_commit(&idx, s, h, TAG, size, newsize, d);
+    CHECK(prx_cache_find(&idx, h, TAG, size) == 0);
+    CHECK(prx_cache_find(&idx, h, 0xD91628F0, size) == -1);
+    CHECK(prx_cache_find(&idx, h, TAG, size + 4) == -1);
+
+    // round trip through INDEX.BIN
+    snprintf(path, sizeof(path), "%s/INDEX.BIN", dir);
+    CHECK(write_file(path, &idx, sizeof(idx)) == 0);
+    CHECK(read_file(path, &copy, sizeof(copy)) == 0);
+    CHECK(prx_cache_check(&copy) && prx_cache_find(&copy, h, TAG, size) == 0);
+
+    copy.bytes++;
+    CHECK(!prx_cache_check(&copy));
+    copy.bytes--;
+    copy.entries[0].newsize = copy.entries[0].size + 1;
+    CHECK(!prx_cache_check(&copy));
+    copy.entries[0].newsize = newsize;
+    copy.magic = 0x31435850;                                // index without digests
+    CHECK(!prx_cache_check(&copy));
+
+    // slot file read back and verified like read_prx_slot
+    snprintf(path, sizeof(path), "%s/SLOT00.BIN", dir);
+    u8 * out = random_image(size);
+    u8 * enc = malloc(size);
+    memcpy(enc, out, size);
+    CHECK(write_file(path, img, newsize) == 0);
+    CHECK(read_slot(path, &idx, 0, out) == 0);
+    CHECK(memcmp(out, img, newsize) == 0);
+    CHECK(prx_cache_verify(&idx, 0, out));
+
+    // a damaged slot file doesn't get through and leaves the image alone
+    memcpy(out, enc, size);
+    CHECK(write_file(path, img, newsize - 1) == 0);
+    CHECK(read_slot(path, &idx, 0, out) == -1);
+    CHECK(write_file(path, img, newsize + 4) == 0);
+    CHECK(read_slot(path, &idx, 0, out) == -1);
+    img[newsize - 1] ^= 0x80;
+    CHECK(write_file(path, img, newsize) == 0);
+    CHECK(read_slot(path, &idx, 0, out) == -1);
+    img[newsize - 1] ^= 0x80;
+    img[0x140] ^= 1;
+    CHECK(write_file(path, img, newsize) == 0);
+    CHECK(read_slot(path, &idx, 0, out) == -1);
+    img[0x140] ^= 1;
+    CHECK(memcmp(out, enc, size) == 0);
+    free(enc);
+    free(out);
+
+    // slot eviction: fill all slots, keep slot 0 hot
+    for(i = 0; i < PRX_CACHE_SIZE + 8; i++)
+    {
+        k[1] = i;
+        s = prx_cache_reserve(&idx, 1000);
+        CHECK(s >= 0);
+        prx_cache_commit(&idx, s, k, 1, 2000, 1000, k);
+        prx_cache_find(&idx, h, TAG, size);
+        CHECK(prx_cache_check(&idx));
+    }
+    CHECK(prx_cache_find(&idx, h, TAG, size) == 0);
+    k[1] = 0;
+    CHECK(prx_cache_find(&idx, k, 1, 2000) == -1);
+    k[1] = PRX_CACHE_SIZE + 7;
+    CHECK(prx_cache_find(&idx, k, 1, 2000) >= 0);
+
+    // byte budget eviction
+    s = prx_cache_reserve(&idx, PRX_CACHE_MAX_BYTES - 500);
+    CHECK(s >= 0);
+    CHECK(idx.bytes <= 500);
+    prx_cache_commit(&idx, s, k, 9, PRX_CACHE_MAX_BYTES, PRX_CACHE_MAX_BYTES - 500, k);
+    CHECK(prx_cache_check(&idx));
+    CHECK(prx_cache_reserve(&idx, PRX_CACHE_MAX_BYTES + 1) == -1);
+    CHECK(prx_cache_reserve(&idx, 0) == -1);
+
+    // blacklist entries are matched against the image at 0x140
+    u8 bl[32] = { 0 };
+    memcpy(bl + 16, img + 0x140, 16);
+    CHECK(prx_cache_blacklisted(img, bl, 32));
+    CHECK(!prx_cache_blacklisted(img, bl, 16));
+    CHECK(!prx_cache_blacklisted(img, NULL, 0));
+
+    free(img);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char * dir)
+{
+    static PrxCacheIndex idx;
+    static const u32 sizes[] = { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+    char path[256];
+    int i, r;
+
+    snprintf(path, sizeof(path), "%s/SLOT00.BIN", dir);
+
+    for(i = 0; i < 3; i++)
+    {
+        u32 size = sizes[i], newsize = size - 0x150, h[2], d[2];
+        u8 * img = random_image(size);
+        u8 * out = random_image(size);
+        int rounds = (64 << 20) / size;
+        double t0, t1, t2;
+
+        prx_cache_reset(&idx);
+        prx_cache_hash(img, newsize, d);
+        prx_cache_commit(&idx, prx_cache_reserve(&idx, newsize), h, TAG, size, newsize, d);
+        write_file(path, img, newsize);
+
+        t0 = now();
+        for(r = 0; r < rounds; r++)
+        {
+            prx_cache_hash(img, size, h);
+            prx_cache_hash(out, newsize, d);
+        }
+        t1 = now();
+        for(r = 0; r < rounds; r++)
+        {
+            prx_cache_hash(img, size, h);
+            if(read_slot(path, &idx, 0, out) != 0) failed = 1;
+        }
+        t2 = now();
+
+        printf("%5u KB module: hashing %7.1f us, hit with slot check and read %7.1f us\n",
+               size / 1024, (t1 - t0) / rounds * 1e6, (t2 - t1) / rounds * 1e6);
+
+        free(img);
+        free(out);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    char dir[] = "/tmp/prxcacheXXXXXX";
+    char path[256];
+
+    if(mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    if(argc > 1 && strcmp(argv[1], "-b") == 0) bench(dir);
+    else
+    {
+        test_hash();
+        test_index(dir);
+    }
+
+    snprintf(path, sizeof(path), "%s/INDEX.BIN", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/SLOT00.BIN", dir);
+    unlink(path);
+    rmdir(dir);
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
@@ -30,49 +30,44 @@
 static inline void lock() {}
 static inline void unlock() {}
 
-static struct IoDirentEntry g_head = { "", -1, -1, NULL }, *g_tail = &g_head;
+static struct IoDirentEntry g_dirents[MAX_DIRENT_ENTRIES];
+static int g_dirents_ready = 0;
 
-static char *oe_strdup(const char *str)
+static void dirent_init(void)
 {
-    int len;
-    char *p;
+    int i;
 
-    len = strlen(str) + 1;
-    p = oe_malloc(len);
-
-    if(p == NULL) {
-        return p;
+    for(i = 0; i < MAX_DIRENT_ENTRIES; i++) {
+        g_dirents[i].dfd = -1;
+        g_dirents[i].iso_dfd = -1;
     }
 
-    strcpy(p, str);
-
-    return p;
+    g_dirents_ready = 1;
 }
 
 int dirent_add(SceUID dfd, SceUID iso_dfd, const char *path)
 {
     struct IoDirentEntry *p;
-   
-    p = oe_malloc(sizeof(*p));
 
-    if(p == NULL) {
+    if(dfd < 0 || dfd >= MAX_DIRENT_ENTRIES) {
         return -1;
     }
 
-    p->dfd = dfd;
-    p->iso_dfd = iso_dfd;
-    p->path = oe_strdup(path);
-
-    if(p->path == NULL) {
-        oe_free(p);
-
+    if(strlen(path) >= MAX_DIRENT_PATH) {
         return -2;
     }
 
     lock();
-    g_tail->next = p;
-    g_tail = p;
-    g_tail->next = NULL;
+
+    if(!g_dirents_ready) {
+        dirent_init();
+    }
+
+    p = &g_dirents[dfd];
+    STRCPY_S(p->path, path);
+    p->iso_dfd = iso_dfd;
+    p->dfd = dfd;
+
     unlock();
 
     return 0;
@@ -80,29 +75,15 @@ int dirent_add(SceUID dfd, SceUID iso_dfd, const char *path)
 
 int dirent_remove(struct IoDirentEntry *p)
 {
-    int ret;
-    struct IoDirentEntry *fds, *prev;
+    int ret = -1;
 
     lock();
 
-    for(prev = &g_head, fds = g_head.next; fds != NULL; prev = fds, fds = fds->next) {
-        if(p == fds) {
-            break;
-        }
-    }
-
-    if(fds != NULL) {
-        prev->next = fds->next;
-
-        if(g_tail == fds) {
-            g_tail = prev;
-        }
-
-        oe_free(fds->path);
-        oe_free(fds);
+    if(p >= g_dirents && p < g_dirents + MAX_DIRENT_ENTRIES && p->dfd >= 0) {
+        p->dfd = -1;
+        p->iso_dfd = -1;
+        p->path[0] = '\0';
         ret = 0;
-    } else {
-        ret = -1;
     }
 
     unlock();
@@ -112,15 +93,12 @@ int dirent_remove(struct IoDirentEntry *p)
 
 struct IoDirentEntry *dirent_search(SceUID dfd)
 {
-    struct IoDirentEntry *fds;
+    struct IoDirentEntry *p;
 
-    if (dfd < 0)
+    if(dfd < 0 || dfd >= MAX_DIRENT_ENTRIES || !g_dirents_ready)
         return NULL;
 
-    for(fds = g_head.next; fds != NULL; fds = fds->next) {
-        if(fds->dfd == dfd)
-            break;
-    }
+    p = &g_dirents[dfd];
 
-    return fds;
+    return (p->dfd == dfd) ? p : NULL;
 }
@@ -18,10 +18,16 @@
 #ifndef DIRENT_TRACK_H
 #define DIRENT_TRACK_H
 
+// Tracked Directories, indexed by Descriptor (IoFileMgr hands out small ones)
+#define MAX_DIRENT_ENTRIES 64
+
+// Longest tracked Path (virtual EBOOT names are built from it into 128 Bytes),
+// longer Folders are listed without their ISOs
+#define MAX_DIRENT_PATH 128
+
 struct IoDirentEntry {
-    char *path;
     SceUID dfd, iso_dfd;
-    struct IoDirentEntry *next;
+    char path[MAX_DIRENT_PATH];
 };
 
 int dirent_add(SceUID dfd, SceUID iso_dfd, const char *path);
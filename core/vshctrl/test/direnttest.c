@@ -0,0 +1,261 @@
+/*
+    host test for the ISO folder tracking (dirent_track.c) and the
+    gamedopen hook that fills it (xmbiso.c)
+
+    dirent_track.c is built as is. The Makefile cuts gamedopen out of
+    xmbiso.c into gamedopen.h; it runs here against a fake IO manager that
+    hands out the lowest free descriptor and counts what is left open.
+    - random add/search/remove over every descriptor the table holds,
+      descriptors out of range and paths too long for a slot
+    - game folders are tracked together with their ISO folder
+    - a folder that can't be tracked (path too long, descriptor past the
+      table) lists without ISOs and leaves no descriptor open; if only
+      the ISO folder opened the call fails with nothing open
+
+    direnttest      runs the checks, fails on a wrong result or a leak
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <pspsdk.h>
+#include <strsafe.h>
+
+#include "../dirent_track.h"
+
+#define MAX_FDS 128
+
+#define NELEMS(n) ((sizeof(n)) / sizeof(n[0]))
+
+static int fd_used[MAX_FDS];
+static int failed;
+
+// libs/ansi-c/strsafe.c replaces libc, so not that one
+size_t strncpy_s(char *strDest, size_t numberOfElements, const char *strSource, size_t count)
+{
+    size_t len = strlen(strSource);
+
+    if (len > count) len = count;
+    if (len >= numberOfElements) len = numberOfElements - 1;
+
+    memcpy(strDest, strSource, len);
+    strDest[len] = '\0';
+    return len;
+}
+
+size_t strncat_s(char *strDest, size_t numberOfElements, const char *strSource, size_t count)
+{
+    size_t len = strlen(strDest);
+    return len + strncpy_s(strDest + len, numberOfElements - len, strSource, count);
+}
+
+static int open_fds(void)
+{
+    int fd, n = 0;
+
+    for (fd = 0; fd < MAX_FDS; fd++)
+        n += fd_used[fd];
+
+    return n;
+}
+
+// folders named GONE don't exist outside the ISO tree
+static SceUID sceIoDopen(const char *dirname)
+{
+    int fd;
+
+    if (strstr(dirname, "/PSP/GAME/GONE") != NULL)
+        return 0x80010002;
+
+    for (fd = 3; fd < MAX_FDS && fd_used[fd]; fd++)
+        ;
+
+    if (fd == MAX_FDS)
+        return 0x80010018;
+
+    fd_used[fd] = 1;
+    return fd;
+}
+
+static int sceIoDclose(SceUID fd)
+{
+    if (fd < 0 || fd >= MAX_FDS || !fd_used[fd])
+        return 0x80020323;
+
+    fd_used[fd] = 0;
+    return 0;
+}
+
+// what gamedopen needs from the rest of vshctrl
+#define MAGIC_DFD_FOR_DELETE 0x9000
+#define MAGIC_DFD_FOR_DELETE_2 0x9001
+
+static int _150_addon_enabled = 0;
+static char g_iso_dir[128];
+static char g_temp_delete_dir[128];
+static int g_delete_eboot_injected = 0;
+static SceUID gamedfd = -1, game150dfd = -1;
+
+static void Fix150Path(const char *file) {}
+static int is_iso_dir(const char *path) { return 0; }
+static int is_video_path(const char *path) { return 0; }
+static SceUID videoIoDopen(const char *path) { return -1; }
+static int is_game_dir(const char *dirname) { return strstr(dirname, "/PSP/GAME") != NULL; }
+static SceUID vpbp_dopen(const char *dirname) { return sceIoDopen(dirname); }
+
+static int get_device_name(char *device, int size, const char *path)
+{
+    const char *p = strchr(path, '/');
+
+    if (p == NULL)
+        return -2;
+
+    snprintf(device, size, "%.*s", (int)(p - path), path);
+    return 0;
+}
+
+#include "gamedopen.h"
+
+static void fail(const char *what)
+{
+    printf("  %s\n", what);
+    failed = 1;
+}
+
+static void test_table(void)
+{
+    static int tracked[MAX_DIRENT_ENTRIES];
+    char path[64], long_path[MAX_DIRENT_PATH + 16];
+    struct IoDirentEntry *p;
+    long i, ops = 5000000;
+
+    if (dirent_search(0) != NULL || dirent_search(-1) != NULL)
+        fail("search on an empty table");
+
+    if (dirent_add(MAX_DIRENT_ENTRIES, 1, "ms0:/PSP/GAME") != -1 || dirent_add(-1, 1, "ms0:/PSP/GAME") != -1)
+        fail("descriptor out of range accepted");
+
+    memset(long_path, 'a', MAX_DIRENT_PATH);
+    long_path[MAX_DIRENT_PATH] = '\0';
+    if (dirent_add(3, 1, long_path) != -2 || dirent_search(3) != NULL)
+        fail("path too long accepted");
+
+    long_path[MAX_DIRENT_PATH - 1] = '\0';
+    if (dirent_add(3, 1, long_path) != 0 || (p = dirent_search(3)) == NULL || strcmp(p->path, long_path) != 0)
+        fail("longest path refused");
+    else
+        dirent_remove(p);
+
+    srand(1);
+
+    for (i = 0; i < ops && !failed; i++) {
+        int fd = rand() % MAX_DIRENT_ENTRIES;
+
+        snprintf(path, sizeof(path), "ms0:/PSP/GAME/%d", fd);
+
+        if (!tracked[fd]) {
+            if (dirent_add(fd, fd ^ 1, path) != 0)
+                fail("add failed");
+            tracked[fd] = 1;
+        }
+        else if (rand() % 4) {
+            p = dirent_search(fd);
+            if (p == NULL || p->dfd != fd || p->iso_dfd != (fd ^ 1) || strcmp(p->path, path) != 0)
+                fail("search returned the wrong entry");
+        }
+        else {
+            p = dirent_search(fd);
+            if (p == NULL || dirent_remove(p) != 0 || dirent_remove(p) != -1 || dirent_search(fd) != NULL)
+                fail("remove failed");
+            tracked[fd] = 0;
+        }
+    }
+
+    printf("%ld table operations\n", i);
+
+    for (i = 0; i < MAX_DIRENT_ENTRIES; i++) {
+        if ((p = dirent_search(i)) != NULL)
+            dirent_remove(p);
+    }
+}
+
+// gamedclose as far as descriptors go
+static void close_dir(SceUID fd)
+{
+    struct IoDirentEntry *entry = dirent_search(fd);
+
+    if (entry != NULL) {
+        if (entry->iso_dfd != fd)
+            sceIoDclose(entry->iso_dfd);
+        dirent_remove(entry);
+    }
+
+    sceIoDclose(fd);
+}
+
+static void check_open(const char *what, const char *dirname, int expect_ok, int expect_tracked)
+{
+    SceUID fd = gamedopen(dirname);
+    struct IoDirentEntry *entry = (fd >= 0) ? dirent_search(fd) : NULL;
+    int before = open_fds();
+
+    if ((fd >= 0) != expect_ok || (entry != NULL) != expect_tracked) {
+        printf("  %s: got 0x%08X, %stracked\n", what, fd, entry ? "" : "not ");
+        failed = 1;
+    }
+
+    // a tracked folder holds its ISO folder too, an untracked one nothing else
+    if (fd >= 0 && before != ((entry && entry->iso_dfd != fd) ? 2 : 1) + (fd >= MAX_DIRENT_ENTRIES ? MAX_DIRENT_ENTRIES - 3 : 0)) {
+        printf("  %s: %d descriptors open\n", what, before);
+        failed = 1;
+    }
+
+    if (fd < 0 && before != 0) {
+        printf("  %s: failed with %d descriptors open\n", what, before);
+        failed = 1;
+    }
+
+    if (fd >= 0)
+        close_dir(fd);
+}
+
+static void test_gamedopen(void)
+{
+    char long_game[MAX_DIRENT_PATH + 32], long_gone[MAX_DIRENT_PATH + 32];
+    SceUID fd;
+
+    snprintf(long_game, sizeof(long_game), "ms0:/PSP/GAME/%0*d", MAX_DIRENT_PATH, 0);
+    snprintf(long_gone, sizeof(long_gone), "ms0:/PSP/GAME/GONE%0*d", MAX_DIRENT_PATH, 0);
+
+    check_open("game folder", "ms0:/PSP/GAME", 1, 1);
+    check_open("game sub folder", "ms0:/PSP/GAME/CAT_A", 1, 1);
+    check_open("only in the ISO tree", "ms0:/PSP/GAME/GONE", 1, 1);
+    check_open("other folder", "ms0:/MUSIC", 1, 0);
+    check_open("path too long", long_game, 1, 0);
+    check_open("path too long, only in the ISO tree", long_gone, 0, 0);
+
+    // fill the table so the next descriptor is past it
+    for (fd = 3; fd < MAX_DIRENT_ENTRIES; fd++)
+        fd_used[fd] = 1;
+
+    check_open("descriptor past the table", "ms0:/PSP/GAME", 1, 0);
+
+    for (fd = 3; fd < MAX_DIRENT_ENTRIES; fd++)
+        fd_used[fd] = 0;
+
+    if (open_fds() != 0) {
+        printf("  %d descriptors left open\n", open_fds());
+        failed = 1;
+    }
+}
+
+int main(void)
+{
+    test_table();
+    test_gamedopen();
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
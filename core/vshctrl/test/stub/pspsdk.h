@@ -0,0 +1,15 @@
+#ifndef PSPSDK_H
+#define PSPSDK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t u32;
+typedef int SceUID;
+
+static inline unsigned int pspSdkSetK1(unsigned int k1)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef PSPTHREADMAN_KERNEL_H
+#define PSPTHREADMAN_KERNEL_H
+
+#include <pspsdk.h>
+
+#endif
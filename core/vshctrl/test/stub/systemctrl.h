@@ -0,0 +1,6 @@
+#ifndef SYSTEMCTRL_H
+#define SYSTEMCTRL_H
+
+#include <pspsdk.h>
+
+#endif
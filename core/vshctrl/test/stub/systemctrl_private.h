@@ -0,0 +1,6 @@
+#ifndef SYSTEMCTRL_PRIVATE_H
+#define SYSTEMCTRL_PRIVATE_H
+
+#include <pspsdk.h>
+
+#endif
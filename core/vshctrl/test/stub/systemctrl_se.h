@@ -0,0 +1,9 @@
+#ifndef SYSTEMCTRL_SE_H
+#define SYSTEMCTRL_SE_H
+
+#include <pspsdk.h>
+
+typedef struct { int dummy; } SEConfig;
+typedef struct SceModule SceModule;
+
+#endif
@@ -297,7 +297,17 @@ SceUID gamedopen(const char * dirname)
             #ifdef DEBUG
             printk("%s: dirent_add -> %d\n", __func__, ret);
             #endif
-            result = -1;
+
+            // untracked, list the folder without its ISOs
+            k1 = pspSdkSetK1(0);
+            sceIoDclose(iso_dfd);
+            pspSdkSetK1(k1);
+
+            // only the ISO folder was open, nothing left to list
+            if(result == iso_dfd) {
+                result = -1;
+            }
+
             goto exit;
         }
     }
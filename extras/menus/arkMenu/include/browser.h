@@ -8,6 +8,7 @@
 #include "optionsmenu.h"
 #include "system_entry.h"
 #include "lang.h"
+#include "dir_cache.h"
 
 using namespace std;
 
@@ -68,6 +69,11 @@ class Browser : public SystemEntry{
                 this->refreshDirs();
                 firstboot = false;
             }
+            else{
+                // other menus may have changed files meanwhile
+                this->loadEntries(-1);
+                DirCache::clear();
+            }
             while (animation != 0)
                 sceKernelDelayThread(0);
         }
@@ -83,11 +89,12 @@ class Browser : public SystemEntry{
 
         void drawInfo(){
             static TextScroll scroll;
+            static Translations::TranslationHandle free_size = {"Free size"};
             if (devsize.size() > 0){
                 int w = common::calcTextWidth(cwd.c_str(), SIZE_MEDIUM, 0);
                 scroll.w = 150;
                 common::printText(5, 13, cwd.c_str(), LITEGRAY, SIZE_MEDIUM, 0, NULL, 0);
-                common::printText(5+w, 13, string(" ("+TR("Free size")+": "+devsize+")").c_str(), LITEGRAY, SIZE_MEDIUM, 0, &scroll);
+                common::printText(5+w, 13, (string(" (")+Translations::translate(&free_size)+": "+devsize+")").c_str(), LITEGRAY, SIZE_MEDIUM, 0, &scroll);
             }
             else{
                 scroll.w = 200;
@@ -121,6 +128,9 @@ class Browser : public SystemEntry{
         string devsize; // device size (only if in root)
         
         vector<Entry*>* entries; // entries in the current directory
+
+        DirListing* listing; // cached listing of the current directory
+        int pending; // first record of listing without an entry yet
         
         vector<string>* clipboard; // currently selected items
         
@@ -164,7 +174,9 @@ class Browser : public SystemEntry{
         
         void update(Entry* ent, bool skip_prompt);
         
-        void refreshDirs(const char* retry=NULL);
+        void refreshDirs(const char* retry=NULL, bool reload=false);
+        
+        void loadEntries(int upto);
         
         void drawScreen();
         
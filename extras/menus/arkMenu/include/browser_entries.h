@@ -19,6 +19,7 @@ class BrowserFile : public Entry{
     
         BrowserFile(string path);
         BrowserFile(string parent, string name);
+        BrowserFile(string parent, string name, unsigned size); // size as listed, saves a stat
         
         ~BrowserFile();
         
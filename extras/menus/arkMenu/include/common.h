@@ -69,6 +69,15 @@ typedef struct TextScroll{
     float w;
 }TextScroll;
 
+// text prepared once (UCS-2 conversion) and drawn many times
+typedef struct TextRun{
+    std::string text;
+    unsigned short* ucs2;
+    int length;
+    float size;
+    unsigned generation;
+}TextRun;
+
 #define SIZE_TINY 0.4f
 #define SIZE_LITTLE 0.51f
 #define SIZE_MEDIUM 0.6f
@@ -119,6 +128,10 @@ namespace common{
     extern void playMenuSound();
     extern void printText(float x, float y, const char *text, u32 color=GRAY_COLOR, float size=SIZE_LITTLE, int glow=0, TextScroll* scroll=NULL, int translate=1);
     extern int calcTextWidth(const char* text, float size=SIZE_LITTLE, int translate=1);
+    extern void clearTextCache();
+    extern void prepareTextRun(TextRun* run, const std::string& text, float size=SIZE_LITTLE);
+    extern void printTextRun(float x, float y, TextRun* run, u32 color=GRAY_COLOR);
+    extern void freeTextRun(TextRun* run);
     extern void clearScreen(u32 color = CLEAR_COLOR);
     extern void drawBorder();
     extern void drawScreen();
@@ -0,0 +1,45 @@
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include <string>
+#include <vector>
+#include <psptypes.h>
+
+/* Listings of recently visited folders, patched by the browser's own file operations instead of rescanned */
+
+#define DIR_CACHE_SIZE 8 // folders kept in memory
+
+typedef struct DirRecord{
+    u32 key; // first four characters lowercased, big endian, so it sorts like strcasecmp
+    u32 name; // offset of the name in DirListing::names
+    u32 size;
+    u8 folder;
+}DirRecord;
+
+typedef struct DirListing{
+    std::string path;
+    std::vector<char> names; // nul terminated names, removed ones are only dropped on compaction
+    std::vector<DirRecord> records; // folders first, sorted by name if sorted is set
+    u32 folders; // number of folder records
+    u32 garbage; // bytes of removed names in names
+    u32 stamp;
+    bool sorted;
+    bool hidden;
+}DirListing;
+
+namespace DirCache{
+    // listing of path, scanned only if it isn't cached, NULL if the folder can't be opened
+    extern DirListing* get(const std::string& path, bool reload=false);
+    extern const char* getName(DirListing* dir, DirRecord* r);
+
+    // patch the listing holding path (if cached) after it was created, removed or renamed
+    extern void add(const std::string& path);
+    extern void remove(const std::string& path);
+    extern void rename(const std::string& from, const std::string& to);
+
+    // drop the listing of path and every folder inside it
+    extern void invalidate(const std::string& path);
+    extern void clear();
+};
+
+#endif
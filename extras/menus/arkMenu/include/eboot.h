@@ -38,17 +38,21 @@ class Eboot : public Entry{
         char* subtype;
 
         void readHeader();
+
+        void setSubtype(int type);
         
         void readFile(void* dst, unsigned offset, unsigned size);
         
     public:
     
         Eboot(string path);
+        Eboot(string path, PBPHeader* header, int type);
         ~Eboot();
     
         string getEbootName();
         
         void loadIcon();
+        bool readIconData(void** data, unsigned* size);
         void loadPics();
         void loadAVMedia();
         SfoInfo getSfoInfo();
@@ -57,6 +61,8 @@ class Eboot : public Entry{
         
         char* getType();
         char* getSubtype();
+        int getEbootType();
+        PBPHeader* getHeader();
         
         static bool isEboot(const char* path);
         static int getEbootType(const char* path);
@@ -106,6 +106,10 @@ class Entry{
         };
         
         virtual void loadIcon()=0;
+        // split icon loading for the icon loader: reading the PNG (IO) and decoding it
+        // returns false if the entry can't split loading (loadIcon() has to be used)
+        virtual bool readIconData(void** data, unsigned* size){ return false; };
+        void decodeIcon(void* data, unsigned size);
         virtual void loadPics()=0;
         virtual void loadAVMedia()=0;
         
@@ -0,0 +1,69 @@
+#ifndef GAME_INDEX_H
+#define GAME_INDEX_H
+
+#include <string>
+#include <vector>
+#include <pspiofilemgr.h>
+#include "eboot.h"
+
+/* On-disk index of the game list, lets the menu skip rescanning folders that haven't changed */
+
+#define GAME_INDEX_FILE "ARKGAMES.BIN"
+#define GAME_INDEX_MAGIC 0x58444947 // 'GIDX'
+#define GAME_INDEX_VERSION 1
+
+// what scanning function produced a folder
+enum{
+    INDEX_DIR_EBOOTS,
+    INDEX_DIR_ISOS,
+    INDEX_DIR_SAVES,
+    INDEX_DIR_SAVE,
+};
+
+// kind of entry
+enum{
+    INDEX_EBOOT,
+    INDEX_ISO,
+};
+
+typedef struct GameIndexDir{
+    std::string path;
+    ScePspDateTime mtime;
+    int kind;
+    int parent; // -1 for scan roots
+}GameIndexDir;
+
+typedef struct GameIndexEntry{
+    std::string path;
+    std::string name;
+    ScePspDateTime mtime;
+    u32 size;
+    int dir;
+    u8 kind;
+    u8 category;
+    u8 type;
+    PBPHeader header; // only for eboots
+}GameIndexEntry;
+
+namespace GameIndex{
+    // load the index from disk, fails if it was made with different scan options
+    extern bool load(u32 flags);
+    extern void save();
+    // force a full rescan next time
+    extern void invalidate();
+    // previous index, used to draw the menu right away
+    extern std::vector<GameIndexEntry>* getEntries();
+    // check every folder and file of the previous index against the filesystem
+    extern bool validate();
+
+    // building a new index
+    extern void begin();
+    extern int enterDir(const char* path, int kind, int parent, bool* unchanged);
+    extern void addEntry(int dir, const std::string& path, const std::string& name, int kind, int category, int type, PBPHeader* header);
+    extern void addEntry(int dir, GameIndexEntry* old);
+    // records of the previous index that belong to an unchanged folder
+    extern void getOldEntries(const char* dir, std::vector<GameIndexEntry*>& out);
+    extern void getOldSubdirs(const char* dir, std::vector<GameIndexDir*>& out);
+};
+
+#endif
@@ -13,8 +13,10 @@
 #include "animations.h"
 #include "browser.h"
 #include "umd.h"
+#include "game_index.h"
 
 #define MAX_CATEGORIES 3
+#define UMD_POLL_DELAY 500000 // how often the icon thread checks for a UMD
 
 using namespace std;
 
@@ -24,6 +26,15 @@ enum{
     ICONS_PAUSED,
 };
 
+// button pressed while the game list was still being checked
+enum{
+    ACTION_NONE,
+    ACTION_ACCEPT,
+    ACTION_START,
+    ACTION_RESCAN,
+    ACTION_OPTIONS,
+};
+
 class GameManager : public SystemEntry{
 
     private:
@@ -34,6 +45,9 @@ class GameManager : public SystemEntry{
     
         /* Array of game menus */
         Menu* categories[MAX_CATEGORIES];
+
+        /* entries found while rescanning, swapped into the menus once done */
+        vector<Entry*> pending[MAX_CATEGORIES];
         
         /* Selected game menu */
         int selectedCategory;
@@ -44,8 +58,14 @@ class GameManager : public SystemEntry{
         /* Multithreading variables */
         SceUID iconThread; // UID's of the icon thread
         SceUID iconSema; // semaphore to lock the thread when sleeping
+        SceUID entriesSema; // held while the control thread uses the menus and while their lists are swapped
         int dynamicIconRunning;
         bool scanning;
+
+        /* action pressed while scanning and the entry it was pressed on, done once the scan ends */
+        int queuedAction;
+        int queuedCategory;
+        string queuedPath;
         
         /* Screen drawing thread data */
         bool hasLoaded; // whether the main thread has finished loading or not, if not then only draw the background and animation
@@ -54,6 +74,9 @@ class GameManager : public SystemEntry{
         OptionsMenu* optionsmenu;
 
         void endAllThreads();
+
+        /* add or remove the UMD entry */
+        void checkUMD();
         
         // Entry animation
         void animAppear();
@@ -65,9 +88,20 @@ class GameManager : public SystemEntry{
             ms0:/PSP/SAVEDATA for both
          */
         void findEntries();
-        void findEboots(const char* path);
-        void findISOs(const char* path);
+        void findEboots(const char* path, int parent=-1);
+        void findISOs(const char* path, int parent=-1);
         void findSaveEntries(const char* path);
+        void findSaveFolder(const char* path, int parent);
+        void finishEntries();
+        void swapEntries();
+        void lockEntries();
+        void unlockEntries();
+
+        /* game index helpers */
+        Entry* createEntry(GameIndexEntry* rec);
+        void addEboot(int dir, string path);
+        void addIso(int dir, string path);
+        bool restoreDir(const char* path, int kind, int parent, int* dir_id);
 
         /* move the menu in the specified direction */
         void moveLeft();
@@ -0,0 +1,26 @@
+#ifndef ICON_CACHE_H
+#define ICON_CACHE_H
+
+#include <string>
+#include "gfx.h"
+
+/* ICON0 cache: decoded and swizzled icons are kept on disk (keyed by path and mtime)
+   and icons that scroll out of view are kept in a RAM LRU instead of being freed.
+   The disk cache drops files whose source is gone or changed and keeps the newest MAX_DISK_ICONS */
+
+#define ICON_CACHE_DIR "ICONS/"
+#define ICON_CACHE_MAGIC 0x4E4F4349 // 'ICON'
+#define ICON_CACHE_VERSION 1
+
+namespace IconCache{
+    // find an icon in RAM or on disk, NULL if it has to be decoded
+    extern Image* get(const std::string& path);
+    // save a freshly decoded (and swizzled) icon to disk
+    extern void store(const std::string& path, Image* icon);
+    // icon no longer drawn, keep it around in RAM (may be freed)
+    extern void release(const std::string& path, Image* icon);
+    // free every icon held in RAM
+    extern void clear();
+};
+
+#endif
@@ -72,6 +72,7 @@ class Iso : public Entry
         ~Iso();
     
         void loadIcon();
+        bool readIconData(void** data, unsigned* size);
         void loadPics();
         void loadAVMedia();
         SfoInfo getSfoInfo();
@@ -7,8 +7,20 @@
 #define TR(s) Translations::translate(s)
 
 namespace Translations{
+
+    // precomputed translation for a string that never changes (i.e. a label drawn every frame)
+    // the lookup is redone only when the language changes
+    typedef struct TranslationHandle{
+        const char* orig;
+        const char* text;
+        unsigned generation;
+    }TranslationHandle;
+
     extern bool loadLanguage(std::string lang_file);
     extern std::string translate(std::string orig);
+    // returns the translated string or orig itself when there is no translation (no copies made)
+    extern const char* lookup(const char* orig);
+    extern const char* translate(TranslationHandle* handle);
 };
 
-#endif
\ No newline at end of file
+#endif
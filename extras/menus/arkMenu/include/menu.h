@@ -30,6 +30,7 @@ class Menu{
         bool animDelay;
         bool initLoad;
         bool stopLoading;
+        u32 moveTime; // when the cursor last moved, to measure icon latency
         vector<Entry*>* entries;
         
         void freeIcons();
@@ -42,7 +43,8 @@ class Menu{
         
         void draw(bool selected);
         
-        void loadIconsDynamic(bool isSelected);
+        // returns false if there was nothing to load
+        bool loadIconsDynamic(bool isSelected);
         
         bool waitIconsLoad(bool isSelected, bool forceQuit=false);
         
@@ -52,6 +54,7 @@ class Menu{
         Entry* getEntry();
         Entry* getEntry(int index);
         void clearEntries();
+        void swapEntries(vector<Entry*>* other);
         size_t getVectorSize();
         vector<Entry*>* getVector();
         int getIndex(){ return index; };
@@ -63,6 +66,13 @@ class Menu{
         void moveUp();
         void moveDown();
         void stopFastScroll();
+
+        /* wake up the icon thread */
+        static void requestIcons();
+        /* sleep until icons are needed (or the timeout in microseconds expires) */
+        static void waitIconRequest(u32 timeout);
+        /* last measured time (in microseconds) from a cursor move until its icon was ready */
+        static u32 getIconLatency();
 };
         
 #endif
@@ -15,6 +15,14 @@
 
 void playMP3File(char* filename, void* buffer, int buffer_size);
 
+typedef struct {
+    u32 transitions;
+    u32 last_gap;    // us from the last output of a track to the first of the next
+    u32 max_gap;
+    u32 last_stall;  // us the play thread spent switching tracks
+    u32 max_stall;
+} MP3TransitionStats;
+
 class MP3{
 
     private:
@@ -23,6 +31,7 @@ class MP3{
         int buffer_size;
         int file_handle;
         int mp3_handle;
+        MP3* next;
         
         static int playThread(SceSize _args, void** _argp);
         
@@ -37,6 +46,10 @@ class MP3{
         void* getBuffer();
         int getBufferSize();
 
+        // track to open ahead of time and play right after this one
+        void setNext(MP3* next);
+        MP3* getNext();
+
         void play();
         void stop();
         void pauseResume();
@@ -44,6 +57,8 @@ class MP3{
         static int isPlaying();
         static int isPaused();
         static void fullStop();
+        static MP3* getCurrent();
+        static void getTransitionStats(MP3TransitionStats* stats);
 };
 
 #endif
@@ -6,6 +6,7 @@
 #include <kubridge.h>
 
 #include "browser.h"
+#include "dir_cache.h"
 #include "gamemgr.h"
 #include "system_mgr.h"
 #include "osk.h"
@@ -25,6 +26,7 @@
 #define MENU_W 410
 #define MENU_H 230
 #define MAX_SCROLL_TIME 50
+#define LOAD_BATCH 32 // entries created per frame while a big folder is shown
 
 #include "browser_entries.h"
 
@@ -62,6 +64,8 @@ Browser::Browser(){
     self = this;
     this->cwd = GO_ROOT; // current working directory (cwd)
     this->entries = new vector<Entry*>(); // list of files and folders in cwd
+    this->listing = NULL;
+    this->pending = 0;
     this->pasteMode = NO_MODE;
     this->index = 0;
     this->start = 0;
@@ -159,7 +163,7 @@ void Browser::update(Entry* ent, bool skip_prompt){
     BrowserFile* e = (BrowserFile*)ent;
     printf("running %s\n", e->getName().c_str());
     if (e->getName() == "./")
-        refreshDirs();
+        refreshDirs(NULL, true);
     else if (e->getName() == "../")
         moveDirUp();
     else if (e->getName() == "<Go To eh0>/"){ // why does it have a final / when it reaches this step? lol
@@ -167,7 +171,7 @@ void Browser::update(Entry* ent, bool skip_prompt){
         this->refreshDirs();
     }
     else if (e->getName() == "<refresh>"){
-        this->refreshDirs();
+        this->refreshDirs(NULL, true);
     }
     else if (e->getName() == "<disconnect>"){ // FTP disconnect entry
         if (ftp_driver != NULL) ftp_driver->disconnect();
@@ -554,6 +558,7 @@ void Browser::extractArchive(){
         draw_progress = true;
 
     unarchiveFile(this->get()->getPath().c_str(), dest.c_str(), unarchiverLogger);
+    DirCache::add(dest);
 
     if (!noRedraw)
         draw_progress = false;
@@ -570,12 +575,14 @@ void logbuffer(char* path, void* buffer, u32 size){
 }
 
 // Refresh the list of files and dirs
-void Browser::refreshDirs(const char* retry){
+void Browser::refreshDirs(const char* retry, bool reload){
 
     SystemMgr::pauseDraw();
     this->index = 0;
     this->start = 0;
     this->clearEntries();
+    this->listing = NULL;
+    this->pending = 0;
     this->animating = false;
     this->draw_progress = false;
     this->optionsmenu = NULL;
@@ -600,15 +607,13 @@ void Browser::refreshDirs(const char* retry){
         }    
     }
 
-    printf("opening dir: %s\n", this->cwd.c_str());
-
-    int dir;
+    DirListing* dir;
 
     refresh_retry:
-    dir = sceIoDopen(this->cwd.c_str());
+    dir = DirCache::get(this->cwd, reload);
 
-    if (dir < 0){ // can't open directory
-        printf("can't open\n");
+    if (dir == NULL){ // can't open directory
+        printf("can't open %s\n", this->cwd.c_str());
         if (retry){
             this->cwd = retry;
             retry = NULL;
@@ -625,77 +630,52 @@ void Browser::refreshDirs(const char* retry){
     }
     else devsize = "";
 
-    SceIoDirent dit;
-    memset(&dit, 0, sizeof(SceIoDirent));
-
-    vector<Entry*> folders;
-    vector<Entry*> files;
+    // special folders go first, the listing only has real entries
+    vector<Entry*> special;
+    if (!isRootDir(this->cwd)){
+        special.push_back(new Folder(cwd, "."));
+        special.push_back(new Folder(cwd, ".."));
+    }
+    if (cwd == GO_ROOT && common::folderExists("eh0:")){
+        special.push_back(new Folder(cwd, "<Go To eh0>"));
+    }
 
-    // scan directory
-    while ((sceIoDread(dir, &dit)) > 0){
-        printf("got entry: %s\n", dit.d_name);
+    SystemMgr::pauseDraw();
+    this->entries->insert(this->entries->end(), special.begin(), special.end());
+    this->listing = dir;
+    SystemMgr::resumeDraw();
 
-        if (dit.d_name[0] == '.' && strcmp(dit.d_name, ".") != 0 && strcmp(dit.d_name, "..") != 0 && !common::getConf()->show_hidden){
-            continue;
-        }
+    // the rest is created a batch per frame by control()
+    this->loadEntries(2*PAGE_SIZE);
 
-        if (common::isFolder(&dit)){
-            printf("is dir\n");
-            folders.push_back(new Folder(cwd, dit.d_name));
-        }
-        else{
-            printf("is file\n");
-            files.push_back(new File(cwd, dit.d_name));
-        }
-    }
-    printf("closing and cleaning\n");
-    sceIoDclose(dir);
-
-    // handle special folders
-    Entry* dot = NULL;
-    Entry* dotdot = NULL;
-    Entry* eh0 = NULL;
-    if (folders.size() > 0){
-        if (folders[0]->getName() == "./"){
-            dot = folders[0];
-            folders.erase(folders.begin());
-        }
-        if (folders[0]->getName() == "../"){
-            dotdot = folders[0];
-            folders.erase(folders.begin());
-        }
+    if (this->entries->size() == 0){
+        SystemMgr::pauseDraw();
+        this->entries->push_back(new Folder(cwd, "."));
+        SystemMgr::resumeDraw();
     }
+}
 
-    if (cwd == GO_ROOT && common::folderExists("eh0:")){
-        eh0 = new Folder(cwd, "<Go To eh0>");
-    }
+void Browser::loadEntries(int upto){
+    // create entries for the cached listing until there are upto of them (all of them if negative)
+    if (this->listing == NULL)
+        return;
 
-    // sort entries if needed
-    if (common::getConf()->sort_entries){
-        printf("sorting entries\n");
-        std::sort(folders.begin(), folders.end(), Entry::cmpEntriesForSort);
-        std::sort(files.begin(), files.end(), Entry::cmpEntriesForSort);
+    vector<Entry*> batch;
+    int count = this->listing->records.size();
+    while (this->pending < count && (upto < 0 || this->entries->size() + batch.size() < upto)){
+        DirRecord* r = &this->listing->records[this->pending++];
+        const char* name = DirCache::getName(this->listing, r);
+        if (r->folder)
+            batch.push_back(new Folder(cwd, name));
+        else
+            batch.push_back(new File(cwd, name, r->size));
     }
 
-    // insert special folders
-    if (eh0) folders.insert(folders.begin(), eh0);
-    if (!dotdot && !isRootDir(this->cwd)) dotdot = new Folder(cwd, "..");
-    if (dotdot) folders.insert(folders.begin(), dotdot);
-    if (!dot && !isRootDir(this->cwd)) dot = new Folder(cwd, ".");
-    if (dot) folders.insert(folders.begin(), dot);
-
-    // folders first, files last
-    printf("merging entries\n");
     SystemMgr::pauseDraw();
-    for (int i=0; i<folders.size(); i++)
-        entries->push_back(folders.at(i));
-    for (int i=0; i<files.size(); i++)
-        entries->push_back(files.at(i));
-    if (this->entries->size() == 0)
-        this->entries->push_back(new Folder(cwd, "."));
+    this->entries->insert(this->entries->end(), batch.begin(), batch.end());
+    if (this->pending >= count)
+        this->listing = NULL;
     SystemMgr::resumeDraw();
-    
-    printf("done\n");
 }
         
 
@@ -705,6 +685,7 @@ void Browser::drawScreen(){
     int yoffset = 50;
     bool focused = (optionsmenu==NULL);
     static TextScroll scroll;
+    static TextRun runs[PAGE_SIZE]; // non-focused entries, converted only when they change
     static float angle = 1.0;
     
     // draw scrollbar (if moving)
@@ -752,7 +733,9 @@ void Browser::drawScreen(){
         }
         // draw non-focused entry
         else{
-            common::printText(xoffset, yoffset, this->formatText(e->getName()).c_str(), GRAY_COLOR, SIZE_LITTLE, 0, 0, 0);
+            TextRun* run = &runs[i-this->start];
+            common::prepareTextRun(run, this->formatText(e->getName()), SIZE_LITTLE);
+            common::printTextRun(xoffset, yoffset, run, GRAY_COLOR);
         }
         // draw entry size and icon
         common::printText(400, yoffset, e->getSize().c_str());
@@ -910,6 +893,7 @@ void Browser::left() {
 }
 
 void Browser::right() {
+    this->loadEntries(this->index + 2*PAGE_SIZE);
     if (this->entries->size() == 2) return;
 
     if (common::getConf()->browser_icon0){
@@ -960,6 +944,8 @@ void Browser::down(){
         SystemMgr::resumeDraw();
     }
 
+    this->loadEntries(this->index + PAGE_SIZE + 1);
+
     this->moving = MAX_SCROLL_TIME;
     if (this->index == (entries->size()-1)){
         this->index = 0;
@@ -995,6 +981,7 @@ void Browser::up(){
 
     this->moving = MAX_SCROLL_TIME;
     if (this->index == 0){
+        this->loadEntries(-1); // wrapping to the last entry
         this->index = entries->size()-1;
         this->start = entries->size() - PAGE_SIZE;
         if (this->start < 0) this->start = 0;
@@ -1123,6 +1110,7 @@ void Browser::deleteFolder(string path){
     }
     else {
         recursiveFolderDelete(path);
+        DirCache::remove(path);
     }
     
     if (!noRedraw)
@@ -1145,6 +1133,7 @@ void Browser::deleteFile(string path){
     }
     else{
         sceIoRemove(path.c_str());
+        DirCache::remove(path);
     }
     
     if (!noRedraw)
@@ -1187,6 +1176,9 @@ int Browser::pspIoMove(string src, string dest)
 
     int res = sceIoDevctl((*(u32*)(src.c_str()) == EF0_PATH)?"ef0:":"ms0:", 0x02415830, data, sizeof(data), NULL, 0);
 
+    if (res >= 0)
+        DirCache::rename(src, new_dest);
+
     if (!noRedraw)
         draw_progress = false;
 
@@ -1206,7 +1198,10 @@ int Browser::copy_folder_recursive(const char * source, const char * destination
         string ftp_path = string(destination);
         ftp_driver->createFolder(ftp_path);
     }
-    else sceIoMkdir(destination, 0777);
+    else{
+        sceIoMkdir(destination, 0777);
+        DirCache::add(destination);
+    }
     
     string new_destination = destination;
     if (new_destination[new_destination.length()-1] != '/') new_destination += "/";
@@ -1377,6 +1372,9 @@ void Browser::copyFile(string path, string destination){
         sceIoClose(dst);
         delete buffer;
     }
+
+    if (ftp_driver == NULL || !ftp_driver->isDevicePath(dest))
+        DirCache::add(dest);
     
     if (!noRedraw)
         draw_progress = false;
@@ -1467,7 +1465,8 @@ void Browser::rename(){
     {
         char tmpText[51];
         osk.getText((char*)tmpText);
-        sceIoRename((this->cwd+string(oldname)).c_str(), (this->cwd+string(tmpText)).c_str());
+        if (sceIoRename((this->cwd+string(oldname)).c_str(), (this->cwd+string(tmpText)).c_str()) >= 0)
+            DirCache::rename(this->cwd+string(oldname), this->cwd+string(tmpText));
     }
     osk.end();
     free(oldname);
@@ -1527,7 +1526,10 @@ void Browser::makedir(){
         if (ftp_driver != NULL && ftp_driver->isDevicePath(this->cwd)){
             ftp_driver->createFolder(dirName);
         }
-        else sceIoMkdir((this->cwd+dirName).c_str(), 0777);
+        else{
+            sceIoMkdir((this->cwd+dirName).c_str(), 0777);
+            DirCache::add(this->cwd+dirName);
+        }
     }
     osk.end();
     SystemMgr::resumeDraw();
@@ -1547,7 +1549,10 @@ void Browser::makefile(){
         if (ftp_driver != NULL && ftp_driver->isDevicePath(this->cwd)){
             ftp_driver->createFile(fileName);
         }
-        else sceIoOpen((this->cwd+fileName).c_str(), PSP_O_WRONLY | PSP_O_CREAT, 0777);
+        else{
+            sceIoOpen((this->cwd+fileName).c_str(), PSP_O_WRONLY | PSP_O_CREAT, 0777);
+            DirCache::add(this->cwd+fileName);
+        }
     }
     osk.end();
     SystemMgr::resumeDraw();
@@ -1577,6 +1582,9 @@ void Browser::createNew(){
 void Browser::toggleUSB() {
     if (USB::is_enabled) {
         USB::disable();
+        // the host may have changed anything
+        DirCache::clear();
+        this->refreshDirs();
     }
     else {
         USB::enable();
@@ -1753,6 +1761,7 @@ void Browser::options(){
 void Browser::control(Controller* pad){
     // Control the menu through user input
     t_conf* conf = common::getConf();
+    this->loadEntries(this->entries->size() + LOAD_BATCH);
     if (pad->up())
         this->up();
     else if (pad->down())
@@ -1777,7 +1786,7 @@ void Browser::control(Controller* pad){
     }
     else if (pad->select()){
         common::playMenuSound();
-        this->refreshDirs();
+        this->refreshDirs(NULL, true);
     }
     else if (pad->start()){
         Entry* e = this->get();
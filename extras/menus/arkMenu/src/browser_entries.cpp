@@ -56,6 +56,16 @@ BrowserFile::BrowserFile(string parent, string name){
     this->filetype = fileTypeByExtension(getPath());
 }
 
+BrowserFile::BrowserFile(string parent, string name, unsigned size){
+    this->icon0 = NULL;
+    this->path = parent + name;
+    this->parent = parent;
+    this->name = name;
+    this->selected = false;
+    this->fileSize = (common::getConf()->show_size)? common::beautifySize(size) : getType();
+    this->filetype = fileTypeByExtension(getPath());
+}
+
 BrowserFile::~BrowserFile(){
 }
 
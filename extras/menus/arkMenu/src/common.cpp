@@ -38,6 +38,7 @@ extern float text_size;
 extern int altFontId;
 extern intraFont* altFont;
 extern intraFont* font;
+extern bool non_latin_filenames;
 static MP3* sound_mp3 = NULL;
 static int argc;
 static char **argv;
@@ -53,6 +54,18 @@ static int psp_model;
 
 static string theme_path = THEME_NAME;
 
+/* Cache of measured text widths, indexed by a hash of the text being measured */
+#define TEXT_CACHE_SIZE 128
+typedef struct{
+    u32 hash1;
+    u32 hash2;
+    float size;
+    intraFont* font;
+    int width;
+}TextWidthEntry;
+static TextWidthEntry text_cache[TEXT_CACHE_SIZE];
+static unsigned text_generation = 1; // changes every time the font or language changes
+
 char* fonts[] = {
     "FONT.PGF",
     "flash0:/font/ltn0.pgf",
@@ -211,6 +224,7 @@ static void loadFont(){
     if (config.font == 0 && !altFont) altFont = intraFontLoadEx(fonts[1], INTRAFONT_CACHE_ALL, 0, 0);
     font = intraFontLoadEx(fonts[config.font], INTRAFONT_CACHE_ALL, offset, size);
     intraFontSetEncoding(font, INTRAFONT_STRING_UTF8);
+    clearTextCache();
     // set alt font
     if (altFont) intraFontSetAltFont(font, altFont);
     currentFont = config.font;
@@ -696,11 +710,11 @@ void common::printText(float x, float y, const char* text, u32 color, float size
     if (font == NULL)
         return;
 
-    extern bool non_latin_filenames;
-    string translated = (translate)? TR(text) : text;
+    const char* translated = (translate)? Translations::lookup(text) : text;
     intraFont* textFont = font;
 
-    if (translated != text){
+    // a translation that reads like its key doesn't get the language's text size
+    if (translated != text && strcmp(translated, text) != 0){
         size *= text_size;
     }
     
@@ -739,25 +753,106 @@ void common::printText(float x, float y, const char* text, u32 color, float size
             scroll->y = y;
         }
         if (scroll->w <= 0 || scroll->w >= 480) scroll->w = 200;
-        scroll->tmp = intraFontPrintColumn(textFont, scroll->tmp, y, scroll->w, translated.c_str());
+        scroll->tmp = intraFontPrintColumn(textFont, scroll->tmp, y, scroll->w, translated);
     }
     else
-        intraFontPrint(textFont, x, y, translated.c_str());
+        intraFontPrint(textFont, x, y, translated);
     
 }
 
 int common::calcTextWidth(const char* text, float size, int translate){
-    string translated = (translate)? TR(text) : text;
+    const char* translated = (translate)? Translations::lookup(text) : text;
     intraFont* textFont = font;
-    if (translated != text){
+    if (translated != text && strcmp(translated, text) != 0){
         size *= text_size;
     }
     if (!translate && altFont){
         textFont = altFont;
     }
+
+    // FNV-1a and djb2 in one pass, both must match for a cache hit
+    u32 hash1 = 2166136261u;
+    u32 hash2 = 5381;
+    for (const unsigned char* p = (const unsigned char*)translated; *p; p++){
+        hash1 = (hash1 ^ *p) * 16777619u;
+        hash2 = ((hash2 << 5) + hash2) + *p;
+    }
+
+    TextWidthEntry* entry = &text_cache[(hash1 ^ (hash2>>7)) & (TEXT_CACHE_SIZE-1)];
+    if (entry->font == textFont && entry->hash1 == hash1 && entry->hash2 == hash2 && entry->size == size){
+        return entry->width;
+    }
+
     intraFontSetStyle(textFont, size, 0, 0, 0.f, INTRAFONT_WIDTH_VAR);
-    float w = intraFontMeasureText(textFont, translated.c_str());
-    return (int)ceil(w);
+    float w = intraFontMeasureText(textFont, translated);
+
+    entry->hash1 = hash1;
+    entry->hash2 = hash2;
+    entry->size = size;
+    entry->font = textFont;
+    entry->width = (int)ceil(w);
+    return entry->width;
+}
+
+void common::clearTextCache(){
+    memset(text_cache, 0, sizeof(text_cache));
+    text_generation++;
+}
+
+static int utf8ToUCS2(unsigned short* dst, const char* src, int max){
+    const unsigned char* p = (const unsigned char*)src;
+    int n = 0;
+    while (*p && n < max){
+        unsigned c = *p++;
+        if (c >= 0xE0 && (p[0]&0xC0) == 0x80 && (p[1]&0xC0) == 0x80){
+            c = ((c&0x0F)<<12) | ((p[0]&0x3F)<<6) | (p[1]&0x3F);
+            p += 2;
+        }
+        else if (c >= 0xC0 && (p[0]&0xC0) == 0x80){
+            c = ((c&0x1F)<<6) | (p[0]&0x3F);
+            p += 1;
+        }
+        dst[n++] = (unsigned short)c;
+    }
+    return n;
+}
+
+void common::prepareTextRun(TextRun* run, const std::string& text, float size){
+    if (run->ucs2 && run->generation == text_generation && run->size == size && run->text == text)
+        return;
+
+    freeTextRun(run);
+    if (font == NULL)
+        return;
+
+    // never more UCS-2 chars than bytes in the UTF-8 string
+    run->ucs2 = (unsigned short*)malloc((text.size()+1) * sizeof(unsigned short));
+    if (run->ucs2 == NULL)
+        return;
+    run->length = utf8ToUCS2(run->ucs2, text.c_str(), text.size());
+    run->ucs2[run->length] = 0;
+    run->text = text;
+    run->size = size;
+    run->generation = text_generation;
+}
+
+void common::printTextRun(float x, float y, TextRun* run, u32 color){
+    if (font == NULL || run->ucs2 == NULL || run->generation != text_generation)
+        return;
+    // text runs are file names and such, drawn the same way as untranslated text
+    intraFont* textFont = (altFont && !non_latin_filenames)? altFont : font;
+    intraFontSetStyle(textFont, run->size, color, BLACK_COLOR, 0.f, INTRAFONT_WIDTH_VAR);
+    if (altFont) intraFontSetStyle(altFont, run->size, color, BLACK_COLOR, 0.f, INTRAFONT_WIDTH_VAR);
+    intraFontPrintUCS2Ex(textFont, x, y, run->ucs2, run->length);
+}
+
+void common::freeTextRun(TextRun* run){
+    if (run->ucs2){
+        free(run->ucs2);
+        run->ucs2 = NULL;
+    }
+    run->length = 0;
+    run->text.clear();
 }
 
 void common::clearScreen(u32 color){
@@ -0,0 +1,237 @@
+/* Cached folder listings for the file browser */
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <pspiofilemgr.h>
+#include "dir_cache.h"
+#include "common.h"
+
+using namespace std;
+
+static DirListing cache[DIR_CACHE_SIZE];
+static u32 stamp = 0;
+
+// folders first, then by precomputed key, then by the whole name
+struct RecordCmp{
+    const char* names;
+    bool sorted;
+    RecordCmp(const DirListing* dir) : names(&dir->names[0]), sorted(dir->sorted) {}
+    bool operator()(const DirRecord& a, const DirRecord& b) const {
+        if (a.folder != b.folder) return a.folder > b.folder;
+        if (!sorted) return false;
+        if (a.key != b.key) return a.key < b.key;
+        return strcasecmp(names+a.name, names+b.name) < 0;
+    }
+};
+
+static u32 sortKey(const char* name){
+    u32 key = 0;
+    for (int i=0; i<4; i++){
+        key <<= 8;
+        if (*name) key |= (u8)tolower(*(u8*)name++);
+    }
+    return key;
+}
+
+static bool isHidden(DirListing* dir, const char* name){
+    return (name[0] == '.' && !dir->hidden);
+}
+
+// "ms0:/a/b/" and "ms0:/a/b" both give parent "ms0:/a/" and name "b"
+static bool splitPath(const string& path, string& parent, string& name){
+    size_t end = path.length();
+    if (end > 0 && path[end-1] == '/') end--;
+    size_t slash = path.rfind('/', (end > 0)? end-1 : 0);
+    if (slash == string::npos || slash+1 >= end) return false;
+    parent = path.substr(0, slash+1);
+    name = path.substr(slash+1, end-slash-1);
+    return true;
+}
+
+static DirListing* find(const string& path){
+    for (int i=0; i<DIR_CACHE_SIZE; i++){
+        if (cache[i].path.size() && cache[i].path == path)
+            return &cache[i];
+    }
+    return NULL;
+}
+
+static void release(DirListing* dir){
+    dir->path.clear();
+    vector<char>().swap(dir->names);
+    vector<DirRecord>().swap(dir->records);
+}
+
+static DirListing* allocate(){
+    DirListing* victim = &cache[0];
+    for (int i=0; i<DIR_CACHE_SIZE; i++){
+        if (cache[i].path.size() == 0) return &cache[i];
+        if (cache[i].stamp < victim->stamp) victim = &cache[i];
+    }
+    release(victim);
+    return victim;
+}
+
+static u32 addName(DirListing* dir, const char* name){
+    u32 offset = dir->names.size();
+    dir->names.insert(dir->names.end(), name, name+strlen(name)+1);
+    return offset;
+}
+
+static void compact(DirListing* dir){
+    vector<char> names;
+    names.reserve(dir->names.size() - dir->garbage);
+    for (int i=0; i<dir->records.size(); i++){
+        DirRecord* r = &dir->records[i];
+        const char* name = &dir->names[r->name];
+        r->name = names.size();
+        names.insert(names.end(), name, name+strlen(name)+1);
+    }
+    dir->names.swap(names);
+    dir->garbage = 0;
+}
+
+static int findRecord(DirListing* dir, const char* name){
+    for (int i=0; i<dir->records.size(); i++){
+        if (strcmp(&dir->names[dir->records[i].name], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void insertRecord(DirListing* dir, const char* name, bool folder, u32 size){
+    DirRecord r;
+    r.key = sortKey(name);
+    r.name = addName(dir, name);
+    r.size = size;
+    r.folder = folder;
+    // unsorted listings keep the new entry last in its group
+    vector<DirRecord>::iterator pos = upper_bound(dir->records.begin(), dir->records.end(), r, RecordCmp(dir));
+    dir->records.insert(pos, r);
+    if (folder) dir->folders++;
+}
+
+static void eraseRecord(DirListing* dir, int i){
+    DirRecord* r = &dir->records[i];
+    dir->garbage += strlen(&dir->names[r->name]) + 1;
+    if (r->folder) dir->folders--;
+    dir->records.erase(dir->records.begin() + i);
+    if (dir->garbage > dir->names.size()/2) compact(dir);
+}
+
+static bool scan(DirListing* dir, const string& path){
+    SceUID fd = sceIoDopen(path.c_str());
+    if (fd < 0) return false;
+
+    t_conf* conf = common::getConf();
+    dir->path = path;
+    dir->names.clear();
+    dir->records.clear();
+    dir->folders = 0;
+    dir->garbage = 0;
+    dir->sorted = conf->sort_entries;
+    dir->hidden = conf->show_hidden;
+
+    SceIoDirent dit;
+    memset(&dit, 0, sizeof(SceIoDirent));
+
+    while (sceIoDread(fd, &dit) > 0){
+        if (strcmp(dit.d_name, ".") == 0 || strcmp(dit.d_name, "..") == 0 || isHidden(dir, dit.d_name))
+            continue;
+        DirRecord r;
+        r.key = sortKey(dit.d_name);
+        r.name = addName(dir, dit.d_name);
+        r.size = dit.d_stat.st_size;
+        r.folder = common::isFolder(&dit);
+        if (r.folder) dir->folders++;
+        dir->records.push_back(r);
+    }
+    sceIoDclose(fd);
+
+    if (dir->records.size())
+        stable_sort(dir->records.begin(), dir->records.end(), RecordCmp(dir));
+
+    return true;
+}
+
+DirListing* DirCache::get(const string& path, bool reload){
+    t_conf* conf = common::getConf();
+    DirListing* dir = find(path);
+
+    if (dir != NULL && (reload || dir->sorted != (bool)conf->sort_entries || dir->hidden != (bool)conf->show_hidden)){
+        release(dir);
+        dir = NULL;
+    }
+
+    if (dir == NULL){
+        dir = allocate();
+        if (!scan(dir, path)){
+            release(dir);
+            return NULL;
+        }
+    }
+
+    dir->stamp = ++stamp;
+    return dir;
+}
+
+const char* DirCache::getName(DirListing* dir, DirRecord* r){
+    return &dir->names[r->name];
+}
+
+void DirCache::add(const string& path){
+    string parent, name;
+    if (!splitPath(path, parent, name)) return;
+
+    // whatever was cached below it may have been overwritten
+    invalidate(parent + name);
+
+    DirListing* dir = find(parent);
+    if (dir == NULL) return;
+
+    SceIoStat stat;
+    memset(&stat, 0, sizeof(SceIoStat));
+    if (sceIoGetstat((parent + name).c_str(), &stat) < 0){
+        remove(path);
+        return;
+    }
+
+    int i = findRecord(dir, name.c_str());
+    if (i >= 0) eraseRecord(dir, i);
+    if (!isHidden(dir, name.c_str()))
+        insertRecord(dir, name.c_str(), FIO_SO_ISDIR(stat.st_attr) || FIO_S_ISDIR(stat.st_mode), stat.st_size);
+}
+
+void DirCache::remove(const string& path){
+    string parent, name;
+    if (!splitPath(path, parent, name)) return;
+
+    invalidate(parent + name);
+
+    DirListing* dir = find(parent);
+    if (dir == NULL) return;
+
+    int i = findRecord(dir, name.c_str());
+    if (i >= 0) eraseRecord(dir, i);
+}
+
+void DirCache::rename(const string& from, const string& to){
+    remove(from);
+    add(to);
+}
+
+void DirCache::invalidate(const string& path){
+    string prefix = path;
+    if (prefix.size() == 0) return;
+    if (prefix[prefix.size()-1] != '/') prefix += '/';
+    for (int i=0; i<DIR_CACHE_SIZE; i++){
+        if (cache[i].path.size() && cache[i].path.compare(0, prefix.size(), prefix) == 0)
+            release(&cache[i]);
+    }
+}
+
+void DirCache::clear(){
+    for (int i=0; i<DIR_CACHE_SIZE; i++)
+        release(&cache[i]);
+}
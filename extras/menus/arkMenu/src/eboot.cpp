@@ -1,5 +1,6 @@
 #include "eboot.h"
 #include "system_mgr.h"
+#include "icon_cache.h"
 #include <systemctrl.h>
 
 Eboot::Eboot(string path){
@@ -15,6 +16,21 @@ Eboot::Eboot(string path){
     this->icon0 = common::getImage(IMAGE_WAITICON);
 }
 
+Eboot::Eboot(string path, PBPHeader* header, int type){
+
+    size_t lastSlash = path.rfind("/", string::npos);
+    size_t substrPos = path.rfind("/", lastSlash-1)+1;
+
+    this->path = path;
+    this->subtype = NULL;
+    this->ebootName = path.substr(lastSlash+1, string::npos);
+    this->name = path.substr(substrPos, lastSlash-substrPos);
+    // header and type already known (i.e. from the game index), no need to open the file
+    memcpy(&this->header, header, sizeof(PBPHeader));
+    this->setSubtype(type);
+    this->icon0 = common::getImage(IMAGE_WAITICON);
+}
+
 Eboot::~Eboot(){
     if (icon0 && icon0 != common::getImage(IMAGE_NOICON) && icon0 != common::getImage(IMAGE_WAITICON))
         delete icon0;
@@ -27,15 +43,26 @@ void Eboot::readHeader(){
 }
 
 void Eboot::loadIcon(){
-    Image* icon = NULL;
-    if ( header.magic == EBOOT_MAGIC && header.icon1_offset-header.icon0_offset)
-        icon = new Image(this->path, YA2D_PLACE_RAM, this->header.icon0_offset);
-    
-    if (icon == NULL)
-        sceKernelDelayThread(0);
-    icon = (icon == NULL)? common::getImage(IMAGE_NOICON) : icon;
-    icon->swizzle();
-    this->icon0 = icon;
+    Image* icon = IconCache::get(this->path);
+    if (icon != NULL){
+        this->icon0 = icon;
+        return;
+    }
+    void* data = NULL;
+    unsigned size = 0;
+    this->readIconData(&data, &size);
+    this->decodeIcon(data, size);
+}
+
+bool Eboot::readIconData(void** data, unsigned* size){
+    *data = NULL;
+    *size = 0;
+    if ( header.magic == EBOOT_MAGIC && header.icon1_offset-header.icon0_offset){
+        *size = header.icon1_offset-header.icon0_offset;
+        *data = malloc(*size);
+        if (*data) this->readFile(*data, this->header.icon0_offset, *size);
+    }
+    return true;
 }
         
 string Eboot::getEbootName(){
@@ -100,18 +127,23 @@ void Eboot::readFile(void* dst, unsigned offset, unsigned size){
 }
 
 int Eboot::getEbootType(const char* path){
+    Eboot e(path);
+    return e.getEbootType();
+}
+
+int Eboot::getEbootType(){
 
     int ret = UNKNOWN_TYPE;
 
+    const char* path = this->path.c_str();
     if (strcasecmp("ms0:/PSP/GAME/UPDATE/EBOOT.PBP", path) == 0 || strcasecmp("ef0:/PSP/GAME/UPDATE/EBOOT.PBP", path) == 0 || strcasecmp(("ms0:/PSP/APPS/UPDATE/"VBOOT_PBP), path) == 0 )
         return TYPE_UPDATER;
 
-    Eboot e(path);
-    u32 size = e.header.icon0_offset - e.header.param_offset;
+    u32 size = this->header.icon0_offset - this->header.param_offset;
     if (size){
 
         unsigned char* sfo_buffer = (unsigned char*)malloc(size);
-        e.readFile(sfo_buffer, e.header.param_offset, size);
+        this->readFile(sfo_buffer, this->header.param_offset, size);
 
         u16 categoryType = 0;
         int value_size = sizeof(categoryType);
@@ -171,18 +203,26 @@ char* Eboot::getType(){
     return "EBOOT";
 }
 
+void Eboot::setSubtype(int type){
+    switch(type){
+    case TYPE_HOMEBREW: this->subtype = "HOMEBREW"; break;
+    case TYPE_PSN: this->subtype = "PSN"; break;
+    case TYPE_POPS: this->subtype = "POPS"; break;
+    case TYPE_UPDATER: this->subtype = "UPDATER"; break;
+    }
+}
+
 char* Eboot::getSubtype(){
     if (subtype == NULL){
-        switch(getEbootType(this->path.c_str())){
-        case TYPE_HOMEBREW: this->subtype = "HOMEBREW"; break;
-        case TYPE_PSN: this->subtype = "PSN"; break;
-        case TYPE_POPS: this->subtype = "POPS"; break;
-        case TYPE_UPDATER: this->subtype = "UPDATER"; break;
-        }
+        setSubtype(this->getEbootType());
     }
     return this->subtype;
 }
 
+PBPHeader* Eboot::getHeader(){
+    return &this->header;
+}
+
 SfoInfo Eboot::getSfoInfo(){
     SfoInfo info = this->Entry::getSfoInfo();
     // grab PARAM.SFO
@@ -8,6 +8,7 @@
 #include "music_player.h"
 #include "pspav.h"
 #include "pspav_wrapper.h"
+#include "icon_cache.h"
 
 extern "C" int sceDisplaySetHoldMode(int);
 
@@ -101,6 +102,22 @@ int Entry::getSndSize(){
     return this->at3_size;
 }
 
+void Entry::decodeIcon(void* data, unsigned size){
+    Image* icon = NULL;
+    if (data != NULL){
+        icon = new Image(data, YA2D_PLACE_RAM);
+        free(data);
+        if (icon->getTexture() == NULL){
+            delete icon;
+            icon = NULL;
+        }
+    }
+    icon = (icon == NULL)? common::getImage(IMAGE_NOICON) : icon;
+    icon->swizzle();
+    IconCache::store(this->path, icon);
+    this->icon0 = icon;
+}
+
 void Entry::freeIcon(){
     register Image* aux = this->icon0;
     this->icon0 = common::getImage(IMAGE_WAITICON);
@@ -0,0 +1,286 @@
+/* Persistent game list index */
+
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include "game_index.h"
+
+using namespace std;
+
+typedef struct{
+    u32 magic;
+    u32 version;
+    u32 flags;
+    u32 n_dirs;
+    u32 n_entries;
+}GameIndexHeader;
+
+typedef struct __attribute__((packed)){
+    ScePspDateTime mtime;
+    int kind;
+    int parent;
+    u16 path_len;
+}GameIndexDirRecord;
+
+typedef struct __attribute__((packed)){
+    ScePspDateTime mtime;
+    u32 size;
+    int dir;
+    u8 kind;
+    u8 category;
+    u8 type;
+    u8 pad;
+    PBPHeader header;
+    u16 path_len;
+    u16 name_len;
+}GameIndexEntryRecord;
+
+static u32 index_flags = 0;
+static bool invalidated = false;
+
+// previous index (as loaded from disk)
+static vector<GameIndexDir> old_dirs;
+static vector<GameIndexEntry> old_entries;
+static map<string, int> old_dir_ids;
+static vector< vector<int> > old_dir_entries;
+static vector< vector<int> > old_dir_children;
+
+// index being built
+static vector<GameIndexDir> new_dirs;
+static vector<GameIndexEntry> new_entries;
+
+static bool getStat(const char* path, SceIoStat* stat){
+    memset(stat, 0, sizeof(SceIoStat));
+    return sceIoGetstat(path, stat) >= 0;
+}
+
+static bool sameTime(const ScePspDateTime* a, const ScePspDateTime* b){
+    return memcmp(a, b, sizeof(ScePspDateTime)) == 0;
+}
+
+static bool readString(FILE* fp, string& s, u16 len){
+    s.resize(len);
+    return (len == 0 || fread(&s[0], 1, len, fp) == len);
+}
+
+static void clearOld(){
+    old_dirs.clear();
+    old_entries.clear();
+    old_dir_ids.clear();
+    old_dir_entries.clear();
+    old_dir_children.clear();
+}
+
+bool GameIndex::load(u32 flags){
+
+    clearOld();
+    index_flags = flags;
+
+    if (invalidated){
+        invalidated = false;
+        return false;
+    }
+
+    FILE* fp = fopen(GAME_INDEX_FILE, "rb");
+    if (fp == NULL)
+        return false;
+
+    GameIndexHeader header;
+    bool ok = (fread(&header, 1, sizeof(header), fp) == sizeof(header)
+        && header.magic == GAME_INDEX_MAGIC
+        && header.version == GAME_INDEX_VERSION
+        && header.flags == flags);
+
+    for (u32 i=0; ok && i<header.n_dirs; i++){
+        GameIndexDirRecord rec;
+        GameIndexDir dir;
+        if (fread(&rec, 1, sizeof(rec), fp) != sizeof(rec) || !readString(fp, dir.path, rec.path_len)
+                || rec.parent >= (int)i){
+            ok = false;
+            break;
+        }
+        dir.mtime = rec.mtime;
+        dir.kind = rec.kind;
+        dir.parent = rec.parent;
+        old_dir_ids[dir.path] = i;
+        old_dirs.push_back(dir);
+        old_dir_entries.push_back(vector<int>());
+        old_dir_children.push_back(vector<int>());
+        if (dir.parent >= 0) old_dir_children[dir.parent].push_back(i);
+    }
+
+    for (u32 i=0; ok && i<header.n_entries; i++){
+        GameIndexEntryRecord rec;
+        GameIndexEntry entry;
+        if (fread(&rec, 1, sizeof(rec), fp) != sizeof(rec)
+                || !readString(fp, entry.path, rec.path_len) || !readString(fp, entry.name, rec.name_len)
+                || rec.dir < 0 || rec.dir >= (int)old_dirs.size()){
+            ok = false;
+            break;
+        }
+        entry.mtime = rec.mtime;
+        entry.size = rec.size;
+        entry.dir = rec.dir;
+        entry.kind = rec.kind;
+        entry.category = rec.category;
+        entry.type = rec.type;
+        entry.header = rec.header;
+        old_dir_entries[rec.dir].push_back(i);
+        old_entries.push_back(entry);
+    }
+
+    fclose(fp);
+
+    if (!ok) clearOld();
+
+    return ok;
+}
+
+void GameIndex::save(){
+
+    FILE* fp = fopen(GAME_INDEX_FILE, "wb");
+    if (fp == NULL)
+        return;
+
+    GameIndexHeader header = { GAME_INDEX_MAGIC, GAME_INDEX_VERSION, index_flags, new_dirs.size(), new_entries.size() };
+    fwrite(&header, 1, sizeof(header), fp);
+
+    for (int i=0; i<new_dirs.size(); i++){
+        GameIndexDirRecord rec;
+        rec.mtime = new_dirs[i].mtime;
+        rec.kind = new_dirs[i].kind;
+        rec.parent = new_dirs[i].parent;
+        rec.path_len = new_dirs[i].path.size();
+        fwrite(&rec, 1, sizeof(rec), fp);
+        fwrite(new_dirs[i].path.c_str(), 1, rec.path_len, fp);
+    }
+
+    for (int i=0; i<new_entries.size(); i++){
+        GameIndexEntryRecord rec;
+        GameIndexEntry* entry = &new_entries[i];
+        memset(&rec, 0, sizeof(rec));
+        rec.mtime = entry->mtime;
+        rec.size = entry->size;
+        rec.dir = entry->dir;
+        rec.kind = entry->kind;
+        rec.category = entry->category;
+        rec.type = entry->type;
+        rec.header = entry->header;
+        rec.path_len = entry->path.size();
+        rec.name_len = entry->name.size();
+        fwrite(&rec, 1, sizeof(rec), fp);
+        fwrite(entry->path.c_str(), 1, rec.path_len, fp);
+        fwrite(entry->name.c_str(), 1, rec.name_len, fp);
+    }
+
+    fclose(fp);
+}
+
+void GameIndex::invalidate(){
+    invalidated = true;
+}
+
+vector<GameIndexEntry>* GameIndex::getEntries(){
+    return &old_entries;
+}
+
+bool GameIndex::validate(){
+
+    if (old_dirs.size() == 0)
+        return false;
+
+    SceIoStat stat;
+
+    // a folder that got files added, removed or renamed
+    for (int i=0; i<old_dirs.size(); i++){
+        getStat(old_dirs[i].path.c_str(), &stat);
+        if (!sameTime(&stat.st_mtime, &old_dirs[i].mtime))
+            return false;
+    }
+
+    // a file that got replaced in place
+    for (int i=0; i<old_entries.size(); i++){
+        if (!getStat(old_entries[i].path.c_str(), &stat)
+                || (u32)stat.st_size != old_entries[i].size
+                || !sameTime(&stat.st_mtime, &old_entries[i].mtime))
+            return false;
+    }
+
+    return true;
+}
+
+void GameIndex::begin(){
+    new_dirs.clear();
+    new_entries.clear();
+}
+
+int GameIndex::enterDir(const char* path, int kind, int parent, bool* unchanged){
+
+    SceIoStat stat;
+    getStat(path, &stat);
+
+    GameIndexDir dir;
+    dir.path = path;
+    dir.mtime = stat.st_mtime;
+    dir.kind = kind;
+    dir.parent = parent;
+    new_dirs.push_back(dir);
+
+    *unchanged = false;
+    map<string, int>::iterator it = old_dir_ids.find(dir.path);
+    if (it != old_dir_ids.end()){
+        GameIndexDir* old = &old_dirs[it->second];
+        *unchanged = (old->kind == kind && sameTime(&old->mtime, &dir.mtime));
+        if (*unchanged){
+            // files replaced in place don't change the folder's mtime
+            vector<int>& ids = old_dir_entries[it->second];
+            for (int i=0; i<ids.size() && *unchanged; i++){
+                GameIndexEntry* e = &old_entries[ids[i]];
+                *unchanged = (getStat(e->path.c_str(), &stat) && (u32)stat.st_size == e->size && sameTime(&stat.st_mtime, &e->mtime));
+            }
+        }
+    }
+
+    return new_dirs.size()-1;
+}
+
+void GameIndex::addEntry(int dir, const string& path, const string& name, int kind, int category, int type, PBPHeader* header){
+    SceIoStat stat;
+    getStat(path.c_str(), &stat);
+
+    GameIndexEntry entry;
+    entry.path = path;
+    entry.name = name;
+    entry.mtime = stat.st_mtime;
+    entry.size = (u32)stat.st_size;
+    entry.dir = dir;
+    entry.kind = kind;
+    entry.category = category;
+    entry.type = type;
+    if (header) entry.header = *header;
+    else memset(&entry.header, 0, sizeof(PBPHeader));
+    new_entries.push_back(entry);
+}
+
+void GameIndex::addEntry(int dir, GameIndexEntry* old){
+    new_entries.push_back(*old);
+    new_entries.back().dir = dir;
+}
+
+void GameIndex::getOldEntries(const char* dir, vector<GameIndexEntry*>& out){
+    map<string, int>::iterator it = old_dir_ids.find(dir);
+    if (it == old_dir_ids.end()) return;
+    vector<int>& ids = old_dir_entries[it->second];
+    for (int i=0; i<ids.size(); i++){
+        out.push_back(&old_entries[ids[i]]);
+    }
+}
+
+void GameIndex::getOldSubdirs(const char* dir, vector<GameIndexDir*>& out){
+    map<string, int>::iterator it = old_dir_ids.find(dir);
+    if (it == old_dir_ids.end()) return;
+    vector<int>& ids = old_dir_children[it->second];
+    for (int i=0; i<ids.size(); i++){
+        out.push_back(&old_dirs[ids[i]]);
+    }
+}
@@ -12,6 +12,8 @@
 #include "osk.h"
 #include "lang.h"
 #include "texteditor.h"
+#include "game_index.h"
+#include "icon_cache.h"
 
 static GameManager* self = NULL;
 
@@ -31,6 +33,7 @@ GameManager::GameManager(){
     scroll.w = 0;
     this->use_categories = true;
     this->scanning = true;
+    this->queuedAction = ACTION_NONE;
     this->optionsmenu = NULL;
 
     // initialize the categories
@@ -43,6 +46,7 @@ GameManager::GameManager(){
     this->maxDraw = MAX_CATEGORIES;
     this->dynamicIconRunning = ICONS_LOADING;
     this->iconSema = sceKernelCreateSema("icon0_sema",  0, 1, 1, NULL);
+    this->entriesSema = sceKernelCreateSema("entries_sema",  0, 1, 1, NULL);
     this->iconThread = sceKernelCreateThread("icon0_thread", GameManager::loadIcons, 0x10, 0x20000, PSP_THREAD_ATTR_USER|PSP_THREAD_ATTR_VFPU, NULL);
     sceKernelStartThread(this->iconThread,  0, NULL);
 }
@@ -55,40 +59,32 @@ GameManager::~GameManager(){
 
 int GameManager::loadIcons(SceSize _args, void *_argp){
 
+    u32 last_umd_check = 0;
+
     while (self->dynamicIconRunning != ICONS_STOPPED){
         // check UMD status
-        sceKernelDelayThread(0);
-        std::vector<Entry*>* game_entries = self->categories[GAME]->getVector();
-        bool has_umd = UMD::isUMD();
-        bool umd_loaded = game_entries->size() > 0 && string("UMD") == game_entries->at(0)->getType();
-        if (has_umd && !umd_loaded && self->selectedCategory >= 0){ // UMD inserted but not loaded
-            SystemMgr::pauseDraw();
-            game_entries->insert(game_entries->begin(), new UMD());
-            SystemMgr::resumeDraw();
-            common::playMenuSound();
-        }
-        else if (umd_loaded && !has_umd){ // UMD loaded but not inserted
-            SystemMgr::pauseDraw();
-            UMD* umd = (UMD*)game_entries->at(0);
-            game_entries->erase(game_entries->begin());
-            delete umd;
-            if (game_entries->size() == 0 && self->selectedCategory == GAME){
-                self->selectedCategory = HOMEBREW;
-            }
-            SystemMgr::resumeDraw();
-            common::playMenuSound();
+        u32 now = sceKernelGetSystemTimeLow();
+        if (now - last_umd_check >= UMD_POLL_DELAY){
+            last_umd_check = now;
+            self->checkUMD();
         }
         // load icons
         if (self->selectedCategory < 0){
             if (self->selectedCategory == -1) self->findEntries();
+            else Menu::waitIconRequest(UMD_POLL_DELAY);
             continue;
         }
-        for (int i=0; i<MAX_CATEGORIES; i++){
+        // visible category first
+        bool loaded = false;
+        int selected = self->selectedCategory;
+        for (int n=0; n<MAX_CATEGORIES; n++){
+            int i = (selected+n)%MAX_CATEGORIES;
             sceKernelWaitSema(self->iconSema, 1, NULL);
-            self->categories[i]->loadIconsDynamic(i == self->selectedCategory);
+            loaded |= self->categories[i]->loadIconsDynamic(i == self->selectedCategory);
             sceKernelSignalSema(self->iconSema, 1);
-            sceKernelDelayThread(0);
         }
+        // nothing left to do, sleep until the cursor moves
+        if (!loaded) Menu::waitIconRequest(UMD_POLL_DELAY);
     }
 
     sceKernelExitDeleteThread(0);
@@ -96,6 +92,29 @@ int GameManager::loadIcons(SceSize _args, void *_argp){
     return 0;
 }
 
+void GameManager::checkUMD(){
+    std::vector<Entry*>* game_entries = this->categories[GAME]->getVector();
+    bool has_umd = UMD::isUMD();
+    bool umd_loaded = game_entries->size() > 0 && string("UMD") == game_entries->at(0)->getType();
+    if (has_umd && !umd_loaded && this->selectedCategory >= 0){ // UMD inserted but not loaded
+        this->lockEntries();
+        game_entries->insert(game_entries->begin(), new UMD());
+        this->unlockEntries();
+        common::playMenuSound();
+    }
+    else if (umd_loaded && !has_umd){ // UMD loaded but not inserted
+        this->lockEntries();
+        UMD* umd = (UMD*)game_entries->at(0);
+        game_entries->erase(game_entries->begin());
+        delete umd;
+        if (game_entries->size() == 0 && this->selectedCategory == GAME){
+            this->selectedCategory = HOMEBREW;
+        }
+        this->unlockEntries();
+        common::playMenuSound();
+    }
+}
+
 void GameManager::pauseIcons(){
     if (self->dynamicIconRunning == ICONS_PAUSED) return; // already paused
     for (int i=0; i<MAX_CATEGORIES; i++)
@@ -109,7 +128,7 @@ void GameManager::resumeIcons(){
     for (int i=0; i<MAX_CATEGORIES; i++)
         categories[i]->resumeIconLoading();
     sceKernelSignalSema(iconSema, 1);
-    sceKernelDelayThread(0);
+    Menu::requestIcons();
     self->dynamicIconRunning = ICONS_LOADING;
 }
 
@@ -130,12 +149,26 @@ void GameManager::findEntries(){
     this->scanning = true;
 
     int ms_is_ef = sctrlKernelMsIsEf();
+    t_conf* conf = common::getConf();
+    u32 index_flags = (ms_is_ef != 0) | (conf->scan_save<<1) | (conf->scan_cat<<2) | (conf->show_dlc<<3) | (conf->show_hidden<<4);
+
+    // draw the game list from the index right away
+    if (GameIndex::load(index_flags)){
+        vector<GameIndexEntry>* index_entries = GameIndex::getEntries();
+        for (int i=0; i<index_entries->size(); i++){
+            GameIndexEntry* rec = &index_entries->at(i);
+            this->pending[rec->category].push_back(this->createEntry(rec));
+        }
+        this->swapEntries();
+        if (GameIndex::validate()){
+            this->scanning = false;
+            return; // nothing changed since the index was made
+        }
+    }
+
+    // rescan the folders that changed, the rest is taken from the index
+    GameIndex::begin();
 
-    // clear entries
-    this->categories[0]->clearEntries();
-    this->categories[1]->clearEntries();
-    this->categories[2]->clearEntries();
-    
     // scan eboots
     this->findEboots("ms0:/PSP/VHBL/");
     this->findEboots("ms0:/PSP/APPS/");
@@ -150,15 +183,63 @@ void GameManager::findEntries(){
     this->findISOs("ms0:/ISO/");
     if (!ms_is_ef) this->findISOs("ef0:/ISO/");
     // scan saves
-    if (common::getConf()->scan_save){
+    if (conf->scan_save){
         this->findSaveEntries("ms0:/PSP/SAVEDATA/");
         if (!ms_is_ef) this->findSaveEntries("ef0:/PSP/SAVEDATA/");
     }
 
+    GameIndex::save();
+
+    this->swapEntries();
+
+    this->scanning = false;
+}
+
+void GameManager::lockEntries(){
+    // always entries first, then drawing
+    sceKernelWaitSema(entriesSema, 1, NULL);
+    SystemMgr::pauseDraw();
+}
+
+void GameManager::unlockEntries(){
+    SystemMgr::resumeDraw();
+    sceKernelSignalSema(entriesSema, 1);
+}
+
+void GameManager::swapEntries(){
+
+    // pending holds the complete new list, finish it before anyone can see it
+    this->finishEntries();
+
+    this->lockEntries();
+    for (int i=0; i<MAX_CATEGORIES; i++){
+        this->categories[i]->swapEntries(&this->pending[i]);
+    }
+    // keep the current category if it still has entries, otherwise find the first category with entries
+    if (this->selectedCategory < 0 || this->categories[this->selectedCategory]->empty()){
+        this->selectedCategory = -2;
+        for (int i=0; i<MAX_CATEGORIES && selectedCategory < 0; i++){
+            if (!this->categories[i]->empty())
+                this->selectedCategory = i;
+        }
+    }
+    this->unlockEntries();
+
+    // pending now holds the old list, nothing references it anymore
+    for (int i=0; i<MAX_CATEGORIES; i++){
+        for (int j=0; j<this->pending[i].size(); j++){
+            delete this->pending[i][j];
+        }
+        this->pending[i].clear();
+    }
+}
+
+void GameManager::finishEntries(){
+
     if (common::getConf()->sort_entries){
-        std::sort(this->categories[0]->getVector()->begin(), this->categories[0]->getVector()->end(), Entry::cmpEntriesForSort);
-        std::sort(this->categories[1]->getVector()->begin(), this->categories[1]->getVector()->end(), Entry::cmpEntriesForSort);
-        std::sort(this->categories[2]->getVector()->begin(), this->categories[2]->getVector()->end(), Entry::cmpEntriesForSort);
+        for (int i=0; i<MAX_CATEGORIES; i++){
+            std::sort(this->pending[i].begin(), this->pending[i].end(), Entry::cmpEntriesForSort);
+        }
     }
 
     // add recovery menu
@@ -168,26 +249,74 @@ void GameManager::findEntries(){
         if (common::fileExists(recovery_path)){
             Eboot* recovery_menu = new Eboot(recovery_path);
             recovery_menu->setName("Recovery Menu");
-            this->categories[HOMEBREW]->getVector()->insert(this->categories[HOMEBREW]->getVector()->begin(), recovery_menu);
+            this->pending[HOMEBREW].insert(this->pending[HOMEBREW].begin(), recovery_menu);
         }
         else if (common::fileExists(recovery_prx)){
             Eboot* recovery_menu = new Eboot(string(common::getArkConfig()->arkpath) + VBOOT_PBP); // fake entry
             recovery_menu->setName("Recovery Menu");
-            this->categories[HOMEBREW]->getVector()->insert(this->categories[HOMEBREW]->getVector()->begin(), recovery_menu);
+            this->pending[HOMEBREW].insert(this->pending[HOMEBREW].begin(), recovery_menu);
         }
     }
+}
 
-    // find the first category with entries
-    this->selectedCategory = -2;
-    for (int i=0; i<MAX_CATEGORIES && selectedCategory < 0; i++){
-        if (!this->categories[i]->empty())
-            this->selectedCategory = i;
+Entry* GameManager::createEntry(GameIndexEntry* rec){
+    if (rec->kind == INDEX_ISO) return new Iso(rec->path);
+    return new Eboot(rec->path, &rec->header, rec->type);
+}
+
+void GameManager::addEboot(int dir, string path){
+    Eboot* e = new Eboot(path);
+    int type = e->getEbootType();
+    int category;
+    switch (type){
+    case TYPE_PSN:         category = GAME;        break;
+    case TYPE_POPS:        category = POPS;        break;
+    default:               category = HOMEBREW;    break;
     }
+    this->pending[category].push_back(e);
+    GameIndex::addEntry(dir, path, e->getName(), INDEX_EBOOT, category, type, e->getHeader());
+}
 
-    this->scanning = false;
+void GameManager::addIso(int dir, string path){
+    Iso* e = new Iso(path);
+    this->pending[GAME].push_back(e);
+    GameIndex::addEntry(dir, path, e->getName(), INDEX_ISO, GAME, UNKNOWN_TYPE, NULL);
+}
+
+bool GameManager::restoreDir(const char* path, int kind, int parent, int* dir_id){
+
+    bool unchanged;
+    int dir = GameIndex::enterDir(path, kind, parent, &unchanged);
+    *dir_id = dir;
+
+    if (!unchanged)
+        return false;
+
+    vector<GameIndexEntry*> entries;
+    GameIndex::getOldEntries(path, entries);
+    for (int i=0; i<entries.size(); i++){
+        this->pending[entries[i]->category].push_back(this->createEntry(entries[i]));
+        GameIndex::addEntry(dir, entries[i]);
+    }
+
+    vector<GameIndexDir*> subdirs;
+    GameIndex::getOldSubdirs(path, subdirs);
+    for (int i=0; i<subdirs.size(); i++){
+        switch (subdirs[i]->kind){
+        case INDEX_DIR_EBOOTS: findEboots(subdirs[i]->path.c_str(), dir); break;
+        case INDEX_DIR_ISOS:   findISOs(subdirs[i]->path.c_str(), dir); break;
+        case INDEX_DIR_SAVE:   findSaveFolder(subdirs[i]->path.c_str(), dir); break;
+        }
+    }
+
+    return true;
 }
 
-void GameManager::findEboots(const char* path){ 
+void GameManager::findEboots(const char* path, int parent){ 
+
+    int dir_id;
+    if (this->restoreDir(path, INDEX_DIR_EBOOTS, parent, &dir_id))
+        return;
 
     struct dirent* dit;
     DIR* dir = opendir(path);
@@ -209,22 +338,21 @@ void GameManager::findEboots(const char* path){
         string fullpath = Eboot::fullEbootPath(path, dit->d_name, common::getConf()->show_dlc);
         if (fullpath == ""){
             if (common::getConf()->scan_cat){
-                findEboots((string(path) + dit->d_name + "/").c_str());
+                findEboots((string(path) + dit->d_name + "/").c_str(), dir_id);
             }
             continue;
         }
 
-        Eboot* e = new Eboot(fullpath);
-        switch (Eboot::getEbootType(fullpath.c_str())){
-        case TYPE_PSN:         this->categories[GAME]->addEntry(e);        break;
-        case TYPE_POPS:        this->categories[POPS]->addEntry(e);        break;
-        default:               this->categories[HOMEBREW]->addEntry(e);    break;
-        }
+        this->addEboot(dir_id, fullpath);
     }
     closedir(dir);
 }
 
-void GameManager::findISOs(const char* path){
+void GameManager::findISOs(const char* path, int parent){
+
+    int dir_id;
+    if (this->restoreDir(path, INDEX_DIR_ISOS, parent, &dir_id))
+        return;
 
     int dir = sceIoDopen(path);
     
@@ -245,16 +373,21 @@ void GameManager::findISOs(const char* path){
 
         if (FIO_SO_ISDIR(dit->d_stat.st_attr)){
             if (common::getConf()->scan_cat && string(dit->d_name) != string("VIDEO")){
-                findISOs((string(path) + dit->d_name + "/").c_str());
+                findISOs((string(path) + dit->d_name + "/").c_str(), dir_id);
             }
             continue;
         }
-        if (Iso::isISO(fullpath.c_str())) this->categories[GAME]->addEntry(new Iso(fullpath));
+        if (Iso::isISO(fullpath.c_str())) this->addIso(dir_id, fullpath);
     }
     sceIoDclose(dir);
 }
 
 void GameManager::findSaveEntries(const char* path){
+
+    int dir_id;
+    if (this->restoreDir(path, INDEX_DIR_SAVES, -1, &dir_id))
+        return;
+
     struct dirent* dit;
     DIR* dir = opendir(path);
     
@@ -266,31 +399,33 @@ void GameManager::findSaveEntries(const char* path){
         if (strcmp(dit->d_name, ".") == 0) continue;
         if (strcmp(dit->d_name, "..") == 0) continue;
         if (FIO_SO_ISDIR(dit->d_stat.st_attr)){
-            struct dirent* savedit;
             string fullpath = string(path)+string(dit->d_name);
-            DIR* savedir = opendir(fullpath.c_str());
-            if (savedir == NULL)
-                continue;
-            while ((savedit = readdir(savedir))){
-                if (strcmp(savedit->d_name, ".") == 0) continue;
-                if (strcmp(savedit->d_name, "..") == 0) continue;
-                string fullentrypath = fullpath + "/" + string(savedit->d_name);
-                if (Iso::isISO(fullentrypath.c_str())) this->categories[GAME]->addEntry(new Iso(fullentrypath));
-                else if (Eboot::isEboot(fullentrypath.c_str())){
-                    Eboot* e = new Eboot(fullentrypath);
-                    switch (Eboot::getEbootType(fullentrypath.c_str())){
-                    case TYPE_PSN:         this->categories[GAME]->addEntry(e);        break;
-                    case TYPE_POPS:        this->categories[POPS]->addEntry(e);        break;
-                    default:               this->categories[HOMEBREW]->addEntry(e);    break;
-                    }
-                }
-            }
-            closedir(savedir);
+            findSaveFolder(fullpath.c_str(), dir_id);
         }
     }
     closedir(dir);
 }
 
+void GameManager::findSaveFolder(const char* path, int parent){
+
+    int dir_id;
+    if (this->restoreDir(path, INDEX_DIR_SAVE, parent, &dir_id))
+        return;
+
+    struct dirent* savedit;
+    DIR* savedir = opendir(path);
+    if (savedir == NULL)
+        return;
+    while ((savedit = readdir(savedir))){
+        if (strcmp(savedit->d_name, ".") == 0) continue;
+        if (strcmp(savedit->d_name, "..") == 0) continue;
+        string fullentrypath = string(path) + "/" + string(savedit->d_name);
+        if (Iso::isISO(fullentrypath.c_str())) this->addIso(dir_id, fullentrypath);
+        else if (Eboot::isEboot(fullentrypath.c_str())) this->addEboot(dir_id, fullentrypath);
+    }
+    closedir(savedir);
+}
+
 Entry* GameManager::getEntry(){
     if (selectedCategory < 0)
         return NULL;
@@ -414,12 +549,16 @@ void GameManager::draw(){
 
 void GameManager::endAllThreads(){
     dynamicIconRunning = ICONS_STOPPED;
+    Menu::requestIcons();
     sceKernelWaitThreadEnd(iconThread, 0);
 }
 
 
 void GameManager::control(Controller* pad){
 
+    // the icon thread swaps in new lists while scanning, hold them while navigating
+    sceKernelWaitSema(entriesSema, 1, NULL);
+
     if (pad->down()){
         this->moveDown();
     }
@@ -434,26 +573,61 @@ void GameManager::control(Controller* pad){
         this->moveLeft();
     else if (pad->right())
         this->moveRight();
-    else if (pad->accept()){
+
+    int action = ACTION_NONE;
+    if (pad->accept()) action = ACTION_ACCEPT;
+    else if (pad->start()) action = ACTION_START;
+    else if (pad->select()) action = ACTION_RESCAN;
+    else if (pad->LT()) action = ACTION_OPTIONS;
+
+    // the user moved away from what they pressed on
+    if (pad->up() || pad->down() || pad->left() || pad->right())
+        this->queuedAction = ACTION_NONE;
+
+    // actions keep using the selected entry and the list can still be swapped under it,
+    // remember the press and do it once the list is final
+    if (this->scanning && action != ACTION_NONE && !pad->left() && !pad->right()){
+        Entry* e = this->getEntry();
+        this->queuedAction = action;
+        this->queuedCategory = selectedCategory;
+        this->queuedPath = (e)? e->getPath() : "";
+        common::playMenuSound();
+    }
+
+    sceKernelSignalSema(entriesSema, 1);
+
+    if (this->scanning || pad->left() || pad->right())
+        return;
+
+    if (action == ACTION_NONE && this->queuedAction != ACTION_NONE){
+        // only if the cursor is still on the same entry after the swap
+        Entry* e = this->getEntry();
+        if (selectedCategory == this->queuedCategory && ((e)? e->getPath() : "") == this->queuedPath)
+            action = this->queuedAction;
+        this->queuedAction = ACTION_NONE;
+    }
+
+    if (action == ACTION_ACCEPT){
         if (selectedCategory >= 0 && !categories[selectedCategory]->isAnimating()){
             common::playMenuSound();
             this->execApp();
         }
     }
-    else if (pad->start()){
+    else if (action == ACTION_START){
         if (selectedCategory >= 0 && !categories[selectedCategory]->isAnimating()){
             this->startBoot();
         }
     }
-    else if (pad->select()){
+    else if (action == ACTION_RESCAN){
         if (selectedCategory != -1){
             common::playMenuSound();
             this->waitIconsLoad();
+            GameIndex::invalidate(); // full rescan requested
             GameManager::updateGameList(NULL);
             this->waitIconsLoad();
         }
     }
-    else if (pad->LT()){
+    else if (action == ACTION_OPTIONS){
         if (selectedCategory >= 0 && !categories[selectedCategory]->isAnimating()){
             common::playMenuSound();
             this->gameOptionsMenu();
@@ -470,6 +644,7 @@ void GameManager::updateGameList(const char* path){
         || strncmp(path, "ms0:/PSP/GAME150/", 17) == 0
       ){
         int icon_status = self->dynamicIconRunning;
+        sceKernelWaitSema(self->entriesSema, 1, NULL);
         if (icon_status == ICONS_LOADING){
             self->pauseIcons();
         }
@@ -478,7 +653,10 @@ void GameManager::updateGameList(const char* path){
         for (int i=0; i<MAX_CATEGORIES; i++){
             self->categories[i]->clearEntries();
         }
+        IconCache::clear();
         SystemMgr::resumeDraw();
+        sceKernelSignalSema(self->entriesSema, 1);
+        Menu::requestIcons(); // rescan
         if (icon_status == ICONS_LOADING){
             self->resumeIcons();
         }
@@ -0,0 +1,308 @@
+/* ICON0 disk and RAM cache */
+
+#include <list>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <pspiofilemgr.h>
+#include <pspsysmem.h>
+#include "common.h"
+#include "icon_cache.h"
+
+using namespace std;
+
+#define ICON_TEXTURE_SIZE (256*128*4) // pow2 size of a 144x80 icon
+#define MIN_RAM_ICONS 8
+#define MAX_RAM_ICONS 64
+#define MAX_DISK_ICONS 256 // ~80KB per file, keeps ICONS/ around 20MB
+
+typedef struct{
+    u32 magic;
+    u32 version;
+    ScePspDateTime mtime;
+    u32 file_size;
+    int width;
+    int height;
+    int pow2_w;
+    int pow2_h;
+    int has_alpha;
+    u32 data_size;
+    u32 path_len;
+}IconCacheHeader;
+
+typedef struct{
+    string path;
+    Image* icon;
+}RamIcon;
+
+static list<RamIcon> ram_icons; // most recently released at the front
+static int max_ram_icons = 0;
+static bool has_cache_dir = false;
+static SceUID ram_sema = -1; // icons are loaded from both the game menu and the browser threads
+
+typedef struct{
+    string file;
+    u64 time;
+}DiskIcon;
+
+static list<string> disk_icons; // cache files, oldest first
+static bool disk_scanned = false;
+static SceUID disk_sema = -1;
+
+static void lockRamIcons(){
+    if (ram_sema < 0)
+        ram_sema = sceKernelCreateSema("icon_cache_sema", 0, 1, 1, NULL);
+    sceKernelWaitSema(ram_sema, 1, NULL);
+}
+
+static void unlockRamIcons(){
+    sceKernelSignalSema(ram_sema, 1);
+}
+
+static void lockDiskIcons(){
+    if (disk_sema < 0)
+        disk_sema = sceKernelCreateSema("icon_disk_sema", 0, 1, 1, NULL);
+    sceKernelWaitSema(disk_sema, 1, NULL);
+}
+
+static void unlockDiskIcons(){
+    sceKernelSignalSema(disk_sema, 1);
+}
+
+static int getMaxRamIcons(){
+    if (max_ram_icons == 0){
+        // use at most 1/8th of the currently free RAM (~16 icons on a PSP 1000, ~40 on slims)
+        max_ram_icons = (sceKernelTotalFreeMemSize()/8) / ICON_TEXTURE_SIZE;
+        if (max_ram_icons < MIN_RAM_ICONS) max_ram_icons = MIN_RAM_ICONS;
+        if (max_ram_icons > MAX_RAM_ICONS) max_ram_icons = MAX_RAM_ICONS;
+    }
+    return max_ram_icons;
+}
+
+static string getCachePath(const string& path){
+    // FNV-1a of the full path
+    u32 hash = 2166136261u;
+    for (int i=0; i<path.size(); i++){
+        hash = (hash ^ (unsigned char)path[i]) * 16777619u;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%08X.BIN", hash);
+    return string(ICON_CACHE_DIR) + name;
+}
+
+static bool getStat(const string& path, SceIoStat* stat){
+    memset(stat, 0, sizeof(SceIoStat));
+    return sceIoGetstat(path.c_str(), stat) >= 0;
+}
+
+static u64 getTimeKey(const ScePspDateTime* t){
+    return ((u64)t->year<<40) | ((u64)t->month<<36) | ((u64)t->day<<31)
+        | ((u64)t->hour<<26) | ((u64)t->minute<<20) | ((u64)t->second<<14) | (t->microsecond>>6);
+}
+
+static bool cmpDiskIcons(const DiskIcon& a, const DiskIcon& b){
+    return a.time < b.time;
+}
+
+// a cache file is worth keeping while the file it was made from is still there and unchanged
+static bool isCurrent(const string& file){
+
+    int fd = sceIoOpen(file.c_str(), PSP_O_RDONLY, 0777);
+    if (fd < 0)
+        return false;
+
+    IconCacheHeader header;
+    bool current = false;
+
+    if (sceIoRead(fd, &header, sizeof(header)) == sizeof(header)
+            && header.magic == ICON_CACHE_MAGIC
+            && header.version == ICON_CACHE_VERSION
+            && header.path_len > 0 && header.path_len < 256){
+        string path(header.path_len, 0);
+        SceIoStat stat;
+        current = sceIoRead(fd, &path[0], header.path_len) == header.path_len
+            && getStat(path, &stat)
+            && header.file_size == (u32)stat.st_size
+            && memcmp(&header.mtime, &stat.st_mtime, sizeof(ScePspDateTime)) == 0;
+    }
+
+    sceIoClose(fd);
+    return current;
+}
+
+static void trimDiskIcons(){
+    while (disk_icons.size() > MAX_DISK_ICONS){
+        sceIoRemove(disk_icons.front().c_str());
+        disk_icons.pop_front();
+    }
+}
+
+// drop stale files once per session, the rest is kept in write order
+static void scanDiskIcons(){
+
+    disk_scanned = true;
+
+    int dfd = sceIoDopen(ICON_CACHE_DIR);
+    if (dfd < 0)
+        return;
+
+    vector<DiskIcon> found;
+    vector<string> stale;
+    SceIoDirent dir;
+    memset(&dir, 0, sizeof(dir));
+
+    while (sceIoDread(dfd, &dir) > 0){
+        if (FIO_SO_ISDIR(dir.d_stat.st_attr)) continue;
+        DiskIcon icon = { string(ICON_CACHE_DIR) + dir.d_name, getTimeKey(&dir.d_stat.st_mtime) };
+        if (isCurrent(icon.file)) found.push_back(icon);
+        else stale.push_back(icon.file);
+    }
+    sceIoDclose(dfd);
+
+    for (int i=0; i<stale.size(); i++)
+        sceIoRemove(stale[i].c_str());
+
+    std::sort(found.begin(), found.end(), cmpDiskIcons);
+    for (int i=0; i<found.size(); i++)
+        disk_icons.push_back(found[i].file);
+
+    trimDiskIcons();
+}
+
+static Image* loadFromDisk(const string& path){
+
+    SceIoStat stat;
+    if (!getStat(path, &stat))
+        return NULL;
+
+    int fd = sceIoOpen(getCachePath(path).c_str(), PSP_O_RDONLY, 0777);
+    if (fd < 0)
+        return NULL;
+
+    IconCacheHeader header;
+    ya2d_texture* texture = NULL;
+
+    if (sceIoRead(fd, &header, sizeof(header)) == sizeof(header)
+            && header.magic == ICON_CACHE_MAGIC
+            && header.version == ICON_CACHE_VERSION
+            && header.file_size == (u32)stat.st_size
+            && memcmp(&header.mtime, &stat.st_mtime, sizeof(ScePspDateTime)) == 0
+            && header.path_len == path.size()){
+
+        // make sure it's not a hash collision
+        string cached_path(header.path_len, 0);
+        sceIoRead(fd, &cached_path[0], header.path_len);
+
+        if (cached_path == path)
+            texture = ya2d_create_texture(header.width, header.height, GU_PSM_8888, YA2D_PLACE_RAM);
+
+        if (texture && (texture->pow2_w != header.pow2_w || texture->pow2_h != header.pow2_h
+                || sceIoRead(fd, texture->data, header.data_size) != header.data_size)){
+            ya2d_free_texture(texture);
+            texture = NULL;
+        }
+    }
+
+    sceIoClose(fd);
+
+    if (texture == NULL)
+        return NULL;
+
+    texture->has_alpha = header.has_alpha;
+    texture->is_swizzled = 1;
+    Image* icon = new Image(texture);
+    icon->flush();
+    return icon;
+}
+
+Image* IconCache::get(const string& path){
+
+    lockRamIcons();
+    for (list<RamIcon>::iterator it = ram_icons.begin(); it != ram_icons.end(); it++){
+        if (it->path == path){
+            Image* icon = it->icon;
+            ram_icons.erase(it);
+            unlockRamIcons();
+            return icon;
+        }
+    }
+    unlockRamIcons();
+
+    return loadFromDisk(path);
+}
+
+void IconCache::store(const string& path, Image* icon){
+
+    if (icon == NULL || common::isSharedImage(icon))
+        return;
+
+    ya2d_texture* texture = icon->getTexture();
+    SceIoStat stat;
+    if (texture == NULL || !getStat(path, &stat))
+        return;
+
+    if (!has_cache_dir){
+        sceIoMkdir(ICON_CACHE_DIR, 0777);
+        has_cache_dir = true;
+    }
+
+    string file = getCachePath(path);
+
+    lockDiskIcons();
+    if (!disk_scanned)
+        scanDiskIcons();
+    disk_icons.remove(file);
+    disk_icons.push_back(file);
+    trimDiskIcons();
+    unlockDiskIcons();
+
+    int fd = sceIoOpen(file.c_str(), PSP_O_WRONLY|PSP_O_CREAT|PSP_O_TRUNC, 0777);
+    if (fd < 0)
+        return;
+
+    // swizzled blocks are 8 rows high, so only the rows up to the image height (aligned to 8) are needed
+    int rows = (texture->height+7)&~7;
+    if (rows > texture->pow2_h) rows = texture->pow2_h;
+    IconCacheHeader header;
+    header.magic = ICON_CACHE_MAGIC;
+    header.version = ICON_CACHE_VERSION;
+    header.mtime = stat.st_mtime;
+    header.file_size = (u32)stat.st_size;
+    header.width = texture->width;
+    header.height = texture->height;
+    header.pow2_w = texture->pow2_w;
+    header.pow2_h = texture->pow2_h;
+    header.has_alpha = texture->has_alpha;
+    header.data_size = texture->pow2_w * 4 * rows;
+    header.path_len = path.size();
+
+    sceIoWrite(fd, &header, sizeof(header));
+    sceIoWrite(fd, path.c_str(), header.path_len);
+    sceIoWrite(fd, texture->data, header.data_size);
+    sceIoClose(fd);
+}
+
+void IconCache::release(const string& path, Image* icon){
+
+    if (icon == NULL || common::isSharedImage(icon))
+        return;
+
+    RamIcon ram_icon = { path, icon };
+    lockRamIcons();
+    ram_icons.push_front(ram_icon);
+    while (ram_icons.size() > getMaxRamIcons()){
+        delete ram_icons.back().icon;
+        ram_icons.pop_back();
+    }
+    unlockRamIcons();
+}
+
+void IconCache::clear(){
+    lockRamIcons();
+    while (!ram_icons.empty()){
+        delete ram_icons.front().icon;
+        ram_icons.pop_front();
+    }
+    unlockRamIcons();
+}
@@ -1,5 +1,6 @@
 #include "iso.h"
 #include "eboot.h"
+#include "icon_cache.h"
 #include <umd.h>
 #include <systemctrl.h>
 
@@ -113,18 +114,20 @@ Iso :: ~Iso()
 };
 
 void Iso::loadIcon(){
-    Image* icon = NULL;
-    unsigned size;
-    void* buffer = Iso::fastExtract("ICON0.PNG", &size);
-    if (buffer != NULL){
-        icon = new Image(buffer, YA2D_PLACE_RAM);
-        free(buffer);
+    Image* icon = IconCache::get(this->path);
+    if (icon != NULL){
+        this->icon0 = icon;
+        return;
     }
-    if (icon == NULL)
-        sceKernelDelayThread(50000);
-    icon = (icon == NULL)? common::getImage(IMAGE_NOICON) : icon;
-    icon->swizzle();
-    this->icon0 = icon;
+    void* data = NULL;
+    unsigned size = 0;
+    this->readIconData(&data, &size);
+    this->decodeIcon(data, size);
+}
+
+bool Iso::readIconData(void** data, unsigned* size){
+    *data = Iso::fastExtract("ICON0.PNG", size);
+    return true;
 }
 
 void Iso::loadPics(){
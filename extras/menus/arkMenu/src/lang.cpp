@@ -6,7 +6,17 @@
 #define MASK2BYTES 0xC0
 #define MASK3BYTES 0xE0
 
+typedef struct{
+    u32 hash;
+    const char* key;
+    const char* value;
+}TranslationSlot;
+
 static cJSON* cur_lang = NULL;
+// open addressing hash table built from cur_lang (keys and values point into the cJSON tree)
+static TranslationSlot* lang_table = NULL;
+static u32 lang_table_mask = 0;
+static unsigned lang_generation = 1;
 intraFont* font = NULL;
 intraFont* altFont = NULL;
 int altFontId = 0;
@@ -14,6 +24,56 @@ float text_size = 1.0;
 bool non_latin_filenames = true; // allow showing file names with non-latin languages
 extern char* fonts[];
 
+// FNV-1a over lowercase chars, cJSON object lookups are case insensitive
+static u32 hashString(const char* s){
+    u32 hash = 2166136261u;
+    while (*s){
+        unsigned char c = *s++;
+        if (c >= 'A' && c <= 'Z') c += 0x20;
+        hash = (hash ^ c) * 16777619u;
+    }
+    return hash;
+}
+
+static void freeTable(){
+    if (lang_table){
+        free(lang_table);
+        lang_table = NULL;
+        lang_table_mask = 0;
+    }
+}
+
+static void buildTable(){
+    int count = 0;
+    for (cJSON* item = (cur_lang)? cur_lang->child : NULL; item; item = item->next){
+        if (item->string && cJSON_IsString(item)) count++;
+    }
+    if (count == 0) return;
+
+    // keep load factor under 50%
+    u32 size = 16;
+    while (size < (u32)count*2) size <<= 1;
+
+    lang_table = (TranslationSlot*)calloc(size, sizeof(TranslationSlot));
+    if (lang_table == NULL) return;
+    lang_table_mask = size-1;
+
+    for (cJSON* item = cur_lang->child; item; item = item->next){
+        if (item->string == NULL || !cJSON_IsString(item)) continue;
+        u32 hash = hashString(item->string);
+        u32 i = hash & lang_table_mask;
+        while (lang_table[i].key){
+            // duplicate key, first one wins (same as cJSON_GetObjectItem)
+            if (lang_table[i].hash == hash && strcasecmp(lang_table[i].key, item->string) == 0) break;
+            i = (i+1) & lang_table_mask;
+        }
+        if (lang_table[i].key) continue;
+        lang_table[i].hash = hash;
+        lang_table[i].key = item->string;
+        lang_table[i].value = item->valuestring;
+    }
+}
+
 bool Translations::loadLanguage(string lang_file){
 
     bool needs_altfont = false;
@@ -21,6 +81,8 @@ bool Translations::loadLanguage(string lang_file){
     // cleanup old language and font
     fonts[0] = "FONT.PGF";
     text_size = 1.0;
+    lang_generation++;
+    freeTable();
     if (cur_lang){
         cJSON* aux = cur_lang;
         cur_lang = NULL;
@@ -71,25 +133,47 @@ bool Translations::loadLanguage(string lang_file){
             non_latin_filenames = true;
         }
 
+        // compile translations into a hash table
+        buildTable();
+
         // free resources
         free(buf);
     }
 
+    // measured text is no longer valid
+    common::clearTextCache();
+
     return (cur_lang!=NULL);
 }
 
-string Translations::translate(string orig){
+const char* Translations::lookup(const char* orig){
 
-    if (cur_lang != NULL){
+    if (lang_table != NULL && orig != NULL){
 
-        cJSON* val = cJSON_GetObjectItem(cur_lang, orig.c_str());
-        
-        if (val != NULL){
-            char* s = cJSON_GetStringValue(val);
-            return string(s);
+        u32 hash = hashString(orig);
+        u32 i = hash & lang_table_mask;
+
+        while (lang_table[i].key){
+            if (lang_table[i].hash == hash && strcasecmp(lang_table[i].key, orig) == 0){
+                const char* s = lang_table[i].value;
+                return (s)? s : orig;
+            }
+            i = (i+1) & lang_table_mask;
         }
 
     }
 
     return orig;
 }
+
+const char* Translations::translate(TranslationHandle* handle){
+    if (handle->generation != lang_generation){
+        handle->text = lookup(handle->orig);
+        handle->generation = lang_generation;
+    }
+    return handle->text;
+}
+
+string Translations::translate(string orig){
+    return string(lookup(orig.c_str()));
+}
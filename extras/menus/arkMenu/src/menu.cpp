@@ -2,9 +2,81 @@
 
 #include "menu.h"
 #include "mp3.h"
+#include "icon_cache.h"
 
 static SceUID iconSema = -1;
 
+/* Icon loader: the icon thread decodes while this IO thread reads the next icon's PNG */
+#define ICON_EVENT_REQUEST 1 // icons needed (cursor moved, category changed, etc)
+#define ICON_IO_START 1
+#define ICON_IO_DONE 2
+
+typedef struct IconRequest{
+    Entry* entry;
+    Image* icon; // found in the icon cache
+    void* data; // PNG to decode
+    unsigned size;
+    bool split; // false if the entry has to load its own icon
+}IconRequest;
+
+static SceUID iconEvent = -1;
+static SceUID iconIOEvent = -1;
+static SceUID iconIOThread = -1;
+static IconRequest ioRequest;
+static u32 iconLatency = 0; // time from a cursor move until the icon under it is ready
+
+static int iconIOThreadFunc(SceSize _args, void *_argp){
+    while (1){
+        sceKernelWaitEventFlag(iconIOEvent, ICON_IO_START, PSP_EVENT_WAITOR|PSP_EVENT_WAITCLEAR, NULL, NULL);
+        IconRequest* req = &ioRequest;
+        req->data = NULL;
+        req->size = 0;
+        req->icon = IconCache::get(req->entry->getPath());
+        req->split = (req->icon != NULL || req->entry->readIconData(&req->data, &req->size));
+        sceKernelSetEventFlag(iconIOEvent, ICON_IO_DONE);
+    }
+    return 0;
+}
+
+static void startIconIO(Entry* e){
+    if (iconIOThread < 0){
+        iconIOThread = sceKernelCreateThread("icon0_io_thread", &iconIOThreadFunc, 0x10, 0x20000, PSP_THREAD_ATTR_USER, NULL);
+        sceKernelStartThread(iconIOThread, 0, NULL);
+    }
+    ioRequest.entry = e;
+    sceKernelSetEventFlag(iconIOEvent, ICON_IO_START);
+}
+
+static void waitIconIO(IconRequest* res){
+    sceKernelWaitEventFlag(iconIOEvent, ICON_IO_DONE, PSP_EVENT_WAITOR|PSP_EVENT_WAITCLEAR, NULL, NULL);
+    *res = ioRequest;
+}
+
+static void applyIcon(IconRequest* res){
+    if (res->icon) res->entry->setIcon(res->icon);
+    else if (res->split) res->entry->decodeIcon(res->data, res->size);
+    else res->entry->loadIcon();
+}
+
+static void discardIcon(IconRequest* res){
+    if (res->icon) IconCache::release(res->entry->getPath(), res->icon);
+    if (res->data) free(res->data);
+}
+
+void Menu::requestIcons(){
+    if (iconEvent >= 0)
+        sceKernelSetEventFlag(iconEvent, ICON_EVENT_REQUEST);
+}
+
+void Menu::waitIconRequest(u32 timeout){
+    SceUInt t = timeout;
+    sceKernelWaitEventFlag(iconEvent, ICON_EVENT_REQUEST, PSP_EVENT_WAITOR|PSP_EVENT_WAITCLEAR, NULL, &t);
+}
+
+u32 Menu::getIconLatency(){
+    return iconLatency;
+}
+
 Menu::Menu(EntryType t){
     this->type = t;
     this->index = 0;
@@ -15,9 +87,14 @@ Menu::Menu(EntryType t){
     this->animState = 0.f;
     this->initLoad = false;
     this->stopLoading = false;
+    this->moveTime = 0;
     this->entries = new vector<Entry*>();
     if (iconSema < 0)
         iconSema = sceKernelCreateSema("icon_sema",  0, 1, 1, NULL);
+    if (iconEvent < 0)
+        iconEvent = sceKernelCreateEventFlag("icon_event", 0, 0, NULL);
+    if (iconIOEvent < 0)
+        iconIOEvent = sceKernelCreateEventFlag("icon_io_event", 0, 0, NULL);
 }
 
 
@@ -26,12 +103,21 @@ Menu::~Menu(){
     delete this->entries;
 }
 
+static void releaseIcon(Entry* e){
+    // hand the icon over to the RAM cache, it might be scrolled back into view soon
+    Image* icon = e->getIcon();
+    if (icon && !common::isSharedImage(icon)){
+        e->setIcon(common::getImage(IMAGE_WAITICON));
+        IconCache::release(e->getPath(), icon);
+    }
+}
+
 void Menu::freeIcons(){
     for (int i = 0; i < this->threadIndex-5; i++)
-        this->getEntry(i)->freeIcon();
+        releaseIcon(this->getEntry(i));
 
     for (int i = this->threadIndex+6; i<this->getVectorSize(); i++)
-        this->getEntry(i)->freeIcon();
+        releaseIcon(this->getEntry(i));
 }
 
 bool Menu::checkIconsNeeded(bool isSelected){
@@ -52,10 +138,10 @@ void Menu::checkIndex(){
     }
 }
 
-void Menu::loadIconsDynamic(bool isSelected){
+bool Menu::loadIconsDynamic(bool isSelected){
 
     if (this->fastScrolling || this->getVectorSize() == 0 || stopLoading)
-        return; // we don't need to load any icons
+        return false; // we don't need to load any icons
 
     this->checkIndex();
 
@@ -63,20 +149,47 @@ void Menu::loadIconsDynamic(bool isSelected){
 
     this->stopLoading = false;
     this->threadIndex = this->index; // prevents our working index from changing
+    if (this->getEntry(this->threadIndex)->getIcon() != common::getImage(IMAGE_WAITICON))
+        this->moveTime = 0; // icon was already there, nothing to measure
     freeIcons(); // delete any icon that won't be loaded
     if (!checkIconsNeeded(isSelected)){ // check if we need to load icons
         sceKernelSignalSema(iconSema, 1);
-        return;
+        return false;
     }
-    // start loading the needed icons
-    for (int i = max(0, this->threadIndex-5); i < min((int)this->getVectorSize(), this->threadIndex+6); i++){
-        if (this->index != this->threadIndex || this->stopLoading)
-            break; // stop loading the icons if the state of the menu has changed
-        if (this->getEntry(i)->getIcon() == common::getImage(IMAGE_WAITICON))
-            this->getEntry(i)->loadIcon();
+
+    // needed icons, closest to the cursor first
+    Entry* needed[MAX_LOADED_ICONS];
+    int n_needed = 0;
+    for (int d = 0; d <= 5; d++){
+        int next = this->threadIndex+d;
+        int prev = this->threadIndex-d;
+        if (next < this->getVectorSize() && this->getEntry(next)->getIcon() == common::getImage(IMAGE_WAITICON))
+            needed[n_needed++] = this->getEntry(next);
+        if (d > 0 && prev >= 0 && this->getEntry(prev)->getIcon() == common::getImage(IMAGE_WAITICON))
+            needed[n_needed++] = this->getEntry(prev);
+    }
+
+    // read the next icon while decoding the current one
+    IconRequest cur;
+    startIconIO(needed[0]);
+    for (int i = 0; i < n_needed; i++){
+        waitIconIO(&cur);
+        bool cancel = (this->index != this->threadIndex || this->stopLoading); // state of the menu has changed
+        if (cancel){
+            discardIcon(&cur);
+            break;
+        }
+        if (i+1 < n_needed)
+            startIconIO(needed[i+1]);
+        applyIcon(&cur);
+        if (cur.entry == this->getEntry(this->threadIndex) && this->moveTime){
+            iconLatency = sceKernelGetSystemTimeLow() - this->moveTime;
+            this->moveTime = 0;
+        }
     }
     initLoad = !this->stopLoading;
     sceKernelSignalSema(iconSema, 1);
+    return true;
 }
 
 bool Menu::waitIconsLoad(bool isSelected, bool forceQuit){
@@ -130,6 +243,7 @@ void Menu::draw(bool selected){
             else
                 animating = 0;
         }
+        requestIcons(); // index changed
         if (fastScrolling){
             animState = 0.74f;
             animDelay = false;
@@ -211,6 +325,7 @@ void Menu::animStart(int direction){
     animating = direction;
     animState = 0.f;
     animDelay = false;
+    requestIcons();
 }
 
 bool Menu::isAnimating(){
@@ -245,6 +360,20 @@ void Menu::clearEntries(){
     this->initLoad = false;
 }
 
+void Menu::swapEntries(vector<Entry*>* other){
+    // keep the cursor on the same entry if it is still there
+    string selected = (this->index >= 0 && this->index < this->getVectorSize())? this->getEntry()->getPath() : "";
+    this->entries->swap(*other);
+    for (int i=0; i<this->getVectorSize() && selected.size(); i++){
+        if (this->entries->at(i)->getPath() == selected){
+            this->index = i;
+            break;
+        }
+    }
+    this->checkIndex();
+    this->initLoad = false;
+}
+
 size_t Menu::getVectorSize(){
     size_t ret = this->entries->size();
     return ret;
@@ -255,6 +384,7 @@ vector<Entry*>* Menu::getVector(){
 }
 
 void Menu::moveUp(){
+    this->moveTime = sceKernelGetSystemTimeLow();
     if (animating || fastScrolling){
         fastScrolling = true;
         if (this->index <= 0){
@@ -277,6 +407,7 @@ void Menu::moveUp(){
 }
 
 void Menu::moveDown(){
+    this->moveTime = sceKernelGetSystemTimeLow();
     if (animating || fastScrolling){
         fastScrolling = true;
         if (this->index >= this->getVectorSize()-1){
@@ -299,6 +430,9 @@ void Menu::moveDown(){
 }
 
 void Menu::stopFastScroll(){
+    // icons are skipped while fast scrolling, wake the loader once it ends
+    if (fastScrolling)
+        requestIcons();
     fastScrolling = false;
     animDelay = false;
 }
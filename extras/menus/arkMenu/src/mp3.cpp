@@ -9,40 +9,72 @@
 //static short pcmBuf[PCMBUF_SIZE]  __attribute__((aligned(64)));
 
 static bool running = false;
-static bool eof = false;
 static SceUID mp3Thread = -1;
 static SceUID mp3_mutex = sceKernelCreateSema("mp3_mutex", 0, 1, 1, 0);
 static bool paused = false;
+static MP3* volatile playing = NULL; // track being output by the play thread
+static MP3TransitionStats transition_stats;
 
-
-bool fillStreamBuffer(int fd, int handle, void* buffer, int buffer_size)
+// one open track, the play thread keeps a second one ready for the next track
+typedef struct {
+    int file_handle;
+    int mp3_handle;
+    void* buffer;
+    int buffer_size;
+    char* mp3Buf;
+    short* pcmBuf;
+    bool eof;
+    int sampling_rate;
+    int channels;
+    int max_sample;
+} MP3Stream;
+
+// SRC channel, decoded samples are queued until a whole block can be output
+// so a track change never inserts silence in the middle of a block
+typedef struct {
+    int channel;
+    int sampling_rate;
+    int channels;
+    int max_sample;
+    int fill;
+    short* buf;
+} MP3Output;
+
+typedef struct {
+    MP3* mp3;
+    MP3Stream* stream;
+    SceUID thid;
+    volatile int result; // 1 still opening, 0 ready, <0 failed
+} MP3Prefetch;
+
+static bool fillStreamBuffer(MP3Stream* s)
 {
     bool res = 0;
     char* dst;
     SceInt32 write;
     SceInt32 pos;
 
-    if (eof) return false;
+    if (s->eof) return false;
 
     // Get Info on the stream (where to fill to, how much to fill, where to fill from)
-    int status = sceMp3GetInfoToAddStreamData(handle, (SceUChar8**)&dst, &write, &pos);
+    int status = sceMp3GetInfoToAddStreamData(s->mp3_handle, (SceUChar8**)&dst, &write, &pos);
     if (status < 0){
         return 0;
     }
 
     // read from file
-    if (fd >= 0){
+    if (s->file_handle >= 0){
 
         // Seek file to position requested
-        status = sceIoLseek32( fd, pos, SEEK_SET );
+        status = sceIoLseek32( s->file_handle, pos, SEEK_SET );
         if (status < 0)
             return false;
 
         // Read the amount of data
-        int read = sceIoRead( fd, dst, write );
+        int read = sceIoRead( s->file_handle, dst, write );
         if (read <= 0){
             // End of file?
-            eof = true;
+            s->eof = true;
             return false;
         }
         write = read;
@@ -50,22 +82,22 @@ bool fillStreamBuffer(int fd, int handle, void* buffer, int buffer_size)
     }
     // read from memory buffer
     else{
-        
-        if (pos >= buffer_size){
-            eof = true;
+
+        if (pos >= s->buffer_size){
+            s->eof = true;
             return false;
         }
 
-        if (pos + write > buffer_size){
-            write = buffer_size-pos;
-            eof = true;
+        if (pos + write > s->buffer_size){
+            write = s->buffer_size-pos;
+            s->eof = true;
         }
-        memcpy(dst, (u8*)buffer+pos, write);
+        memcpy(dst, (u8*)s->buffer+pos, write);
         res = (pos > 0);
     }
 
     // Notify mp3 library about how much we really wrote to the stream buffer
-    status = sceMp3NotifyAddStreamData( handle, write);
+    status = sceMp3NotifyAddStreamData( s->mp3_handle, write);
     if (status < 0){
         return false;
     }
@@ -89,84 +121,225 @@ u32 findMP3StreamStart(int file_handle, void* buffer, int buffer_size, char* tmp
     return 0;
 }
 
-void playMP3File(char* filename, void* buffer, int buffer_size)
+static void closeMP3Stream(MP3Stream* s)
 {
+    if (s->mp3_handle >= 0)
+        sceMp3ReleaseMp3Handle( s->mp3_handle );
 
-    if (filename == NULL && buffer == NULL){
-        running = false;
-        return;
-    }
+    if (s->file_handle >= 0)
+        sceIoClose( s->file_handle );
 
-    int file_handle = -1;
-    int mp3_handle;
+    free(s->mp3Buf);
+    free(s->pcmBuf);
+
+    s->file_handle = -1;
+    s->mp3_handle = -1;
+    s->mp3Buf = NULL;
+    s->pcmBuf = NULL;
+}
 
-    int status;
+// open the file, parse its header and prime the stream buffer
+static int openMP3Stream(MP3Stream* s, char* filename, void* buffer, int buffer_size)
+{
+    SceMp3InitArg mp3Init;
 
-    eof = false;
+    memset(s, 0, sizeof(MP3Stream));
+    s->file_handle = -1;
+    s->mp3_handle = -1;
+    s->buffer = buffer;
+    s->buffer_size = buffer_size;
 
     if (filename != NULL){
-        file_handle = sceIoOpen(filename, PSP_O_RDONLY, 0777 );
-        if(file_handle < 0) {
-            running = false;
-            return;
+        s->file_handle = sceIoOpen(filename, PSP_O_RDONLY, 0777 );
+        if(s->file_handle < 0) {
+            return -1;
         }
     }
 
-    status = sceMp3InitResource();
-    if(status < 0) {
-        running = false;
-        return;
+    s->mp3Buf = (char*)memalign(64, MP3BUF_SIZE);
+    s->pcmBuf = (short*)memalign(64, PCMBUF_SIZE);
+
+    if (s->mp3Buf == NULL || s->pcmBuf == NULL){
+        closeMP3Stream(s);
+        return -1;
     }
 
+    memset(s->mp3Buf, 0, MP3BUF_SIZE);
+    memset(s->pcmBuf, 0, PCMBUF_SIZE);
 
     // Reserve a mp3 handle for our playback
-    SceMp3InitArg mp3Init;
-    char* mp3Buf = (char*)memalign(64, MP3BUF_SIZE);
-    short* pcmBuf = (short*)memalign(64, PCMBUF_SIZE);
-    memset(mp3Buf, 0, MP3BUF_SIZE);
-    memset(pcmBuf, 0, PCMBUF_SIZE);
-    mp3Init.mp3StreamStart = findMP3StreamStart(file_handle, buffer, buffer_size, mp3Buf);
-    mp3Init.mp3StreamEnd = (file_handle >= 0)? sceIoLseek32( file_handle, 0, SEEK_END ) : buffer_size;
+    mp3Init.mp3StreamStart = findMP3StreamStart(s->file_handle, buffer, buffer_size, s->mp3Buf);
+    mp3Init.mp3StreamEnd = (s->file_handle >= 0)? sceIoLseek32( s->file_handle, 0, SEEK_END ) : buffer_size;
     mp3Init.unk1 = 0;
     mp3Init.unk2 = 0;
-    mp3Init.mp3Buf = mp3Buf;
+    mp3Init.mp3Buf = s->mp3Buf;
     mp3Init.mp3BufSize = MP3BUF_SIZE;
-    mp3Init.pcmBuf = pcmBuf;
+    mp3Init.pcmBuf = s->pcmBuf;
     mp3Init.pcmBufSize = PCMBUF_SIZE;
 
-    int channel = -1;
-    int lastDecoded = 0;
-    int samplingRate, numChannels, max_sample;
-
-    mp3_handle = sceMp3ReserveMp3Handle( &mp3Init );
+    s->mp3_handle = sceMp3ReserveMp3Handle( &mp3Init );
 
-    if (mp3_handle < 0){
-        goto mp3_terminate;
+    if (s->mp3_handle < 0){
+        closeMP3Stream(s);
+        return -1;
     }
 
     // Fill the stream buffer with some data so that sceMp3Init has something to
     // work with
-    fillStreamBuffer(file_handle, mp3_handle, buffer, buffer_size);
-    
-    status = sceMp3Init( mp3_handle );
-    
-    if (status < 0){
-        goto mp3_terminate;
+    fillStreamBuffer(s);
+
+    if (sceMp3Init( s->mp3_handle ) < 0){
+        closeMP3Stream(s);
+        return -1;
     }
 
-    if (!running)
-        running = true;
+    sceMp3SetLoopNum(s->mp3_handle, 0);
 
-    sceMp3SetLoopNum(mp3_handle, 0);
+    s->sampling_rate = sceMp3GetSamplingRate(s->mp3_handle);
+    s->channels = sceMp3GetMp3ChannelNum(s->mp3_handle);
+    s->max_sample = sceMp3GetMaxOutputSample(s->mp3_handle);
+
+    return 0;
+}
+
+static void closeMP3Output(MP3Output* out)
+{
+    if (out->channel >= 0){
+        while (sceAudioSRCChRelease() < 0){ // wait for the audio to be outputted
+            sceKernelDelayThread(100);
+        }
+    }
 
-    samplingRate = sceMp3GetSamplingRate(mp3_handle);
-    numChannels = sceMp3GetMp3ChannelNum(mp3_handle);
-    max_sample = sceMp3GetMaxOutputSample(mp3_handle);
+    free(out->buf);
+    out->channel = -1;
+    out->buf = NULL;
+}
 
+static int openMP3Output(MP3Output* out, MP3Stream* s)
+{
     sceAudioSRCChRelease();
-    channel = sceAudioSRCChReserve(max_sample, samplingRate, numChannels);
+    out->channel = sceAudioSRCChReserve(s->max_sample, s->sampling_rate, s->channels);
+    out->sampling_rate = s->sampling_rate;
+    out->channels = s->channels;
+    out->max_sample = s->max_sample;
+    out->fill = 0;
+    out->buf = (short*)memalign(64, s->max_sample * s->channels * sizeof(short));
+
+    if (out->channel < 0 || out->buf == NULL){
+        closeMP3Output(out);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void outputSamples(MP3Output* out, short* pcm, int samples)
+{
+    // usual case, one whole frame and nothing queued
+    if (out->fill == 0 && samples == out->max_sample){
+        sceAudioSRCOutputBlocking(PSP_AUDIO_VOLUME_MAX, pcm);
+        return;
+    }
+
+    while (samples > 0){
+        int n = out->max_sample - out->fill;
+        if (n > samples) n = samples;
+
+        memcpy(out->buf + out->fill * out->channels, pcm, n * out->channels * sizeof(short));
+        out->fill += n;
+        pcm += n * out->channels;
+        samples -= n;
+
+        if (out->fill == out->max_sample){
+            sceAudioSRCOutputBlocking(PSP_AUDIO_VOLUME_MAX, out->buf);
+            out->fill = 0;
+        }
+    }
+}
 
-    if (channel < 0) goto mp3_terminate;
+static void flushOutput(MP3Output* out)
+{
+    if (out->fill > 0){
+        memset(out->buf + out->fill * out->channels, 0, (out->max_sample - out->fill) * out->channels * sizeof(short));
+        sceAudioSRCOutputBlocking(PSP_AUDIO_VOLUME_MAX, out->buf);
+        out->fill = 0;
+    }
+}
+
+static int prefetchThread(SceSize _args, void** _argp)
+{
+    MP3Prefetch* p = (MP3Prefetch*)(*_argp);
+    p->result = openMP3Stream(p->stream, p->mp3->getFilename(), p->mp3->getBuffer(), p->mp3->getBufferSize());
+    sceKernelExitDeleteThread(0);
+    return 0;
+}
+
+// open the next track off the play thread, it only has one block of audio queued
+static void startPrefetch(MP3Prefetch* p, MP3* mp3, MP3Stream* s)
+{
+    p->mp3 = mp3;
+    p->stream = s;
+    p->result = 1;
+    p->thid = sceKernelCreateThread("mp3_prefetch", (SceKernelThreadEntry)prefetchThread, 0x12, 0x4000, PSP_THREAD_ATTR_USER, NULL);
+
+    if (p->thid < 0){
+        p->result = -1;
+        return;
+    }
+
+    void* arg = (void*)p;
+    sceKernelStartThread(p->thid, sizeof(arg), &arg);
+}
+
+static int finishPrefetch(MP3Prefetch* p)
+{
+    if (p->mp3 == NULL) return -1;
+
+    if (p->thid >= 0)
+        sceKernelWaitThreadEnd(p->thid, NULL);
+
+    p->thid = -1;
+
+    return p->result;
+}
+
+// plays the given track and then every track queued with MP3::setNext, returns the last one
+static MP3* playTracks(MP3* cur, char* filename, void* buffer, int buffer_size)
+{
+    MP3Stream streams[2];
+    MP3Stream* s = &streams[0];
+    MP3Stream* next = &streams[1];
+    MP3Output out;
+    MP3Prefetch prefetch;
+    u32 transition_start = 0;
+    bool transition = false;
+
+    memset(&out, 0, sizeof(out));
+    memset(&prefetch, 0, sizeof(prefetch));
+    out.channel = -1;
+    prefetch.thid = -1;
+    next->file_handle = -1;
+    next->mp3_handle = -1;
+    next->mp3Buf = NULL;
+    next->pcmBuf = NULL;
+
+    if (sceMp3InitResource() < 0){
+        running = false;
+        return cur;
+    }
+
+    if (openMP3Stream(s, filename, buffer, buffer_size) < 0){
+        sceMp3TermResource();
+        running = false;
+        return cur;
+    }
+
+    if (!running)
+        running = true;
+
+    if (openMP3Output(&out, s) < 0) goto mp3_terminate;
+
+    playing = cur;
 
     while (running) {
 
@@ -174,63 +347,119 @@ void playMP3File(char* filename, void* buffer, int buffer_size)
             sceKernelDelayThread(10000);
             continue;
         }
-        
+
+        // open the next track as soon as we know it
+        if (cur != NULL && prefetch.mp3 == NULL && cur->getNext() != NULL){
+            startPrefetch(&prefetch, cur->getNext(), next);
+        }
+
          // Check if we need to fill our stream buffer
-        if (sceMp3CheckStreamDataNeeded( mp3_handle ) > 0){
-            if (!fillStreamBuffer(file_handle, mp3_handle, buffer, buffer_size)){
-                break;
-            }
+        if (sceMp3CheckStreamDataNeeded( s->mp3_handle ) > 0){
+            // once the file is fully read, keep decoding what the library still holds
+            fillStreamBuffer(s);
         }
 
         // Decode some samples
         short* buf;
-        unsigned int bytesDecoded;
+        int bytesDecoded;
 
-        bytesDecoded = sceMp3Decode(mp3_handle, &buf);
+        bytesDecoded = sceMp3Decode(s->mp3_handle, &buf);
 
         // Nothing more to decode? Must have reached end of input buffer
         if (bytesDecoded <= 0)
         {
-            break;
+            if (!running || prefetch.mp3 == NULL) break;
+
+            // switch to the prefetched track without releasing the channel
+            transition_start = sceKernelGetSystemTimeLow();
+
+            if (finishPrefetch(&prefetch) < 0){
+                closeMP3Stream(next);
+                break;
+            }
+
+            closeMP3Stream(s);
+            MP3Stream* tmp = s;
+            s = next;
+            next = tmp;
+
+            if (out.sampling_rate != s->sampling_rate || out.channels != s->channels || out.max_sample != s->max_sample){
+                flushOutput(&out);
+                closeMP3Output(&out);
+                if (openMP3Output(&out, s) < 0) break;
+            }
+
+            MP3* old = cur;
+            cur = prefetch.mp3;
+            playing = cur;
+            prefetch.mp3 = NULL;
+
+            u32 stall = sceKernelGetSystemTimeLow() - transition_start;
+            transition_stats.transitions++;
+            transition_stats.last_stall = stall;
+            if (stall > transition_stats.max_stall) transition_stats.max_stall = stall;
+            transition = true;
+
+            // old is done with, the callback may delete it and queue another track on cur
+            if (old->on_music_end) old->on_music_end(old);
+            continue;
         }
 
-        // Output the decoded samples and accumulate the 
+        // Output the decoded samples and accumulate the
         // number of played samples to get the playtime
-        sceAudioSRCOutputBlocking(PSP_AUDIO_VOLUME_MAX, buf );
+        outputSamples(&out, buf, bytesDecoded / (out.channels * sizeof(short)));
+
+        if (transition){
+            u32 gap = sceKernelGetSystemTimeLow() - transition_start;
+            transition_stats.last_gap = gap;
+            if (gap > transition_stats.max_gap) transition_stats.max_gap = gap;
+            transition = false;
+        }
     }
 
+    flushOutput(&out);
+
     mp3_terminate:
 
     // Cleanup time...
-    if (channel >= 0){
-        while (sceAudioSRCChRelease() < 0){ // wait for the audio to be outputted
-            sceKernelDelayThread(100);
-        }
+    if (prefetch.mp3 != NULL){
+        finishPrefetch(&prefetch);
+        closeMP3Stream(next);
     }
 
-    status = sceMp3ReleaseMp3Handle( mp3_handle );
-
-    status = sceMp3TermResource();
+    closeMP3Output(&out);
+    closeMP3Stream(s);
 
-    if (file_handle >= 0)
-        status = sceIoClose( file_handle );
+    sceMp3TermResource();
 
-    file_handle = -1;
-    mp3_handle = -1;
+    playing = NULL;
     running = false;
-    free(mp3Buf);
-    free(pcmBuf);
+
+    return cur;
+}
+
+void playMP3File(char* filename, void* buffer, int buffer_size)
+{
+
+    if (filename == NULL && buffer == NULL){
+        running = false;
+        return;
+    }
+
+    playTracks(NULL, filename, buffer, buffer_size);
 }
 
 MP3::MP3(void* buffer, int size){
     this->filename = NULL;
     this->buffer_size = size;
     this->buffer = buffer;
+    this->next = NULL;
     this->on_music_end = NULL;
 }
 
 MP3::MP3(char* filename, bool to_buffer){
     this->on_music_end = NULL;
+    this->next = NULL;
     if (!to_buffer){
         this->filename = filename;
         this->buffer = NULL;
@@ -260,6 +489,14 @@ int MP3::getBufferSize(){
     return this->buffer_size;
 }
 
+void MP3::setNext(MP3* next){
+    this->next = next;
+}
+
+MP3* MP3::getNext(){
+    return this->next;
+}
+
 void MP3::play(){
     sceKernelWaitSema(mp3_mutex, 1, 0);
     if (!running){
@@ -288,11 +525,19 @@ int MP3::isPaused(){
     return paused;
 }
 
+MP3* MP3::getCurrent(){
+    return playing;
+}
+
+void MP3::getTransitionStats(MP3TransitionStats* stats){
+    memcpy(stats, &transition_stats, sizeof(MP3TransitionStats));
+}
+
 int MP3::playThread(SceSize _args, void** _argp)
 {
     MP3* self = (MP3*)(*_argp);
-    playMP3File(self->filename, self->buffer, self->buffer_size);
-    if (self->on_music_end) self->on_music_end(self);
+    MP3* last = playTracks(self, self->filename, self->buffer, self->buffer_size);
+    if (last->on_music_end) last->on_music_end(last);
     sceKernelExitDeleteThread(0);
     return 0;
 }
@@ -300,4 +545,4 @@ int MP3::playThread(SceSize _args, void** _argp)
 void MP3::fullStop(){
     running = false;
     sceKernelWaitThreadEnd(mp3Thread, NULL);
-}
\ No newline at end of file
+}
@@ -7,19 +7,43 @@ static MP3* current_song = NULL;
 static vector<string> playlist = vector<string>();
 static int cur_play = 0;
 
+static void mp3_cleanup(MP3* music);
+
+// hand the next playlist entry to the player so it can open it ahead of time
+static void queue_next(){
+    if (current_song != NULL && current_song->getNext() == NULL && cur_play+1 < playlist.size()){
+        MP3* next = new MP3((char*)playlist[cur_play+1].c_str());
+        // it queues the track after it once it is playing
+        next->on_music_end = mp3_cleanup;
+        current_song->setNext(next);
+    }
+}
+
 static void mp3_cleanup(MP3* music){
     printf("cleaning up mp3\n");
     if (music == current_song){
-       if (cur_play+1 < playlist.size()){
+        MP3* next = music->getNext();
+        if (next != NULL && MP3::getCurrent() == next){
+            // the player already switched to the queued track
             cur_play++;
-            current_song = new MP3((char*)playlist[cur_play].c_str());
-            current_song->on_music_end = mp3_cleanup;
-            current_song->play();
+            current_song = next;
+            queue_next();
         }
         else{
-            current_song = NULL;
-            playlist.clear();
-            cur_play = 0;
+            if (next != NULL) delete next;
+
+            if (cur_play+1 < playlist.size()){
+                cur_play++;
+                current_song = new MP3((char*)playlist[cur_play].c_str());
+                current_song->on_music_end = mp3_cleanup;
+                queue_next();
+                current_song->play();
+            }
+            else{
+                current_song = NULL;
+                playlist.clear();
+                cur_play = 0;
+            }
         }
         
         delete music;
@@ -38,6 +62,7 @@ MusicPlayer::MusicPlayer(string path){
     scroll.w = 400;
     if (playlist.size()){
         add_playlist(path);
+        queue_next();
     }
 }
 
@@ -100,6 +125,7 @@ int MusicPlayer::control(){
     if(current_song == NULL) {
         current_song = new MP3((char*)path.c_str(), false);
         current_song->on_music_end = mp3_cleanup;
+        queue_next();
         current_song->play();
     }
 
@@ -8,6 +8,7 @@
 #include "common.h"
 #include "controller.h"
 #include "music_player.h"
+#include "menu.h"
 
 string ark_version = "";
 
@@ -365,6 +366,9 @@ void SystemMgr::drawScreen(){
                 ya2d_calc_fps();
                 fps << ya2d_get_fps();
                 common::printText(460, 260, fps.str().c_str());
+                ostringstream icon_latency;
+                icon_latency << "ICON0 " << Menu::getIconLatency()/1000 << "ms";
+                common::printText(380, 260, icon_latency.str().c_str(), GRAY_COLOR, SIZE_LITTLE, 0, NULL, 0);
             }
         }
     }
@@ -37,6 +37,7 @@ Image::Image(string filename, int place){
 
 Image::Image(void* buffer, int place){
     this->is_system_image = false;
+    this->texture = NULL;
     u32 magic = *(u32*)buffer;
     if (magic == PNG_MAGIC)
         this->texture = ya2d_load_PNG_buffer(buffer, place);
@@ -46,6 +47,7 @@ Image::Image(void* buffer, int place){
 
 Image::Image(void* buffer, unsigned long buffer_size, int place){
     this->is_system_image = false;
+    this->texture = NULL;
     if ( (*(u32*)buffer & 0x0000FFFF) == JPG_MAGIC)
         this->texture = ya2d_load_JPEG_buffer(buffer, buffer_size, place);
 }
@@ -0,0 +1,326 @@
+/*
+    host test for the browser's folder listing cache (dir_cache.cpp)
+
+    Runs dir_cache.cpp against an in-memory tree that hands out entries in
+    creation order like a FAT folder does. Random file operations are
+    applied to the tree and reported to DirCache the way the browser's
+    copy, move, delete, rename, mkdir and extract do. Every cached listing
+    that is looked at must match a fresh scan of the folder: the same names,
+    sizes and folder flags, folders first and in strcasecmp order when
+    sorting is on. Sorting and hidden files are toggled now and then, and
+    there are more folders than DIR_CACHE_SIZE so listings get evicted.
+
+    dirtest [ops]       fails on the first listing that differs
+    dirtest -b          time to list a 2000 entry folder, scanned and cached
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "dir_cache.h"
+
+typedef struct {
+    bool folder;
+    u32 size;
+    vector<string> children;                // in creation order
+} Node;
+
+static map<string, Node> tree;             // "ms0:/a/" for folders, "ms0:/a/b" for files
+static t_conf conf = { 1, 0 };
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+t_conf* common::getConf(){ return &conf; }
+bool common::isFolder(SceIoDirent* dit){ return FIO_S_ISDIR(dit->d_stat.st_mode); }
+
+////////////////////////////////////////////////////////////////////////
+// the memory stick
+////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+    string path;
+    size_t next;
+} OpenDir;
+
+static vector<OpenDir> dirs;
+
+static string folderPath(const string& path)
+{
+    return (path.size() && path[path.size()-1] == '/') ? path : path + "/";
+}
+
+SceUID sceIoDopen(const char *dirname)
+{
+    string path = folderPath(dirname);
+    if (tree.find(path) == tree.end()) return -1;
+    OpenDir d = { path, 0 };
+    dirs.push_back(d);
+    return dirs.size() - 1;
+}
+
+int sceIoDread(SceUID fd, SceIoDirent *dir)
+{
+    OpenDir* d = &dirs[fd];
+    Node* n = &tree[d->path];
+
+    if (d->next >= n->children.size()) return 0;
+
+    const string& name = n->children[d->next++];
+    Node* c = (tree.count(d->path + name + "/")) ? &tree[d->path + name + "/"] : &tree[d->path + name];
+
+    memset(dir, 0, sizeof(SceIoDirent));
+    strcpy(dir->d_name, name.c_str());
+    dir->d_stat.st_mode = c->folder ? FIO_S_IFDIR : 0x2000;
+    dir->d_stat.st_attr = c->folder ? FIO_SO_IFDIR : 0x20;
+    dir->d_stat.st_size = c->size;
+    return 1;
+}
+
+int sceIoDclose(SceUID fd)
+{
+    return 0;
+}
+
+int sceIoGetstat(const char *file, SceIoStat *stat)
+{
+    string path = file;
+    Node* n;
+
+    if (tree.count(folderPath(path))) n = &tree[folderPath(path)];
+    else if (tree.count(path)) n = &tree[path];
+    else return -1;
+
+    stat->st_mode = n->folder ? FIO_S_IFDIR : 0x2000;
+    stat->st_attr = n->folder ? FIO_SO_IFDIR : 0x20;
+    stat->st_size = n->size;
+    return 0;
+}
+
+static bool exists(const string& parent, const string& name)
+{
+    return tree.count(parent + name) || tree.count(parent + name + "/");
+}
+
+static void unlink(const string& parent, const string& name)
+{
+    vector<string>& c = tree[parent].children;
+    for (size_t i = 0; i < c.size(); i++){
+        if (c[i] == name){
+            c.erase(c.begin() + i);
+            break;
+        }
+    }
+    tree.erase(parent + name);
+
+    // a folder goes with everything in it
+    string prefix = parent + name + "/";
+    map<string, Node>::iterator it = tree.lower_bound(prefix);
+    while (it != tree.end() && it->first.compare(0, prefix.size(), prefix) == 0) tree.erase(it++);
+}
+
+static void create(const string& parent, const string& name, bool folder, u32 size)
+{
+    Node n;
+    n.folder = folder;
+    n.size = folder ? 0 : size;
+    tree[folder ? parent + name + "/" : parent + name] = n;
+    tree[parent].children.push_back(name);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static const char* stems[] = {
+    "Game", "game", "GAMES", "iso", "ISO", "Iso backup", "a", "B", "_tmp", "~x",
+    "Zelda", "zeta", "\xc3\xa9t\xc3\xa9", "\xc3\x89T\xc3\x89", ".hidden", ".Trash", "PSP", "psp2",
+};
+
+static string randomName(void)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s%s%u", stems[rnd() % (sizeof(stems) / sizeof(stems[0]))],
+             (rnd() % 2) ? "" : ".iso", rnd() % 40);
+    return buf;
+}
+
+static string randomFolder(const vector<string>& folders)
+{
+    return folders[rnd() % folders.size()];
+}
+
+static vector<string> allFolders(void)
+{
+    vector<string> folders;
+    for (map<string, Node>::iterator it = tree.begin(); it != tree.end(); ++it)
+        if (it->second.folder) folders.push_back(it->first);
+    return folders;
+}
+
+typedef struct {
+    string name;
+    bool folder;
+    u32 size;
+} Entry;
+
+static vector<Entry> snapshot(DirListing* dir)
+{
+    vector<Entry> v;
+    for (size_t i = 0; i < dir->records.size(); i++){
+        Entry e = { DirCache::getName(dir, &dir->records[i]), (bool)dir->records[i].folder, dir->records[i].size };
+        v.push_back(e);
+    }
+    return v;
+}
+
+static int compare(const string& path, int op)
+{
+    DirListing* dir = DirCache::get(path);
+    if (dir == NULL){
+        printf("op %d: %s can't be listed\n", op, path.c_str());
+        return -1;
+    }
+
+    vector<Entry> cached = snapshot(dir);
+    vector<Entry> fresh = snapshot(DirCache::get(path, true));
+
+    bool same = cached.size() == fresh.size();
+    for (size_t i = 0; same && i < cached.size(); i++)
+        same = cached[i].name == fresh[i].name && cached[i].folder == fresh[i].folder && cached[i].size == fresh[i].size;
+
+    if (!same){
+        printf("op %d: cached listing of %s differs from a scan\n", op, path.c_str());
+        for (size_t i = 0; i < cached.size() || i < fresh.size(); i++)
+            printf("  %-24s %s\n", i < cached.size() ? cached[i].name.c_str() : "-", i < fresh.size() ? fresh[i].name.c_str() : "-");
+        return -1;
+    }
+
+    for (size_t i = 1; i < fresh.size(); i++){
+        if (fresh[i-1].folder < fresh[i].folder ||
+                (conf.sort_entries && fresh[i-1].folder == fresh[i].folder && strcasecmp(fresh[i-1].name.c_str(), fresh[i].name.c_str()) > 0)){
+            printf("op %d: %s out of order in %s\n", op, fresh[i].name.c_str(), path.c_str());
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int stress(int ops)
+{
+    int compared = 0;
+
+    seed = 41;
+    tree.clear();
+    DirCache::clear();
+
+    Node root;
+    root.folder = true;
+    root.size = 0;
+    tree["ms0:/"] = root;
+    for (int i = 0; i < 12; i++) create("ms0:/", "dir" + to_string(i), true, 0);
+
+    for (int op = 0; op < ops; op++){
+        vector<string> folders = allFolders();
+        string parent = randomFolder(folders);
+        vector<string>& children = tree[parent].children;
+        int what = rnd() % 100;
+
+        if (what < 35 || children.empty()){
+            // new file, copy or extract: may overwrite one that is there
+            string name = randomName();
+            bool folder = (rnd() % 4 == 0);
+            if (exists(parent, name)) unlink(parent, name);
+            create(parent, name, folder, rnd() * 37);
+            DirCache::add(parent + name);
+        }
+        else if (what < 55){
+            string name = children[rnd() % children.size()];
+            unlink(parent, name);
+            DirCache::remove(parent + name);
+        }
+        else if (what < 80){
+            // rename in place or move to another folder
+            string name = children[rnd() % children.size()];
+            string to = (rnd() % 2) ? parent : randomFolder(folders);
+            string newname = randomName();
+            string from = parent + name;
+            if (folderPath(to).compare(0, folderPath(from).size(), folderPath(from)) == 0) continue;
+            if (exists(to, newname)) continue;
+            Node n = tree.count(from + "/") ? tree[from + "/"] : tree[from];
+            if (n.folder) continue;
+            unlink(parent, name);
+            create(to, newname, false, n.size);
+            DirCache::rename(from, to + newname);
+        }
+        else if (what < 97){
+            if (compare(parent, op) < 0) return -1;
+            compared++;
+        }
+        else if (what < 98){
+            conf.sort_entries = !conf.sort_entries;
+        }
+        else if (what < 99){
+            conf.show_hidden = !conf.show_hidden;
+        }
+        else {
+            DirCache::clear();
+        }
+
+        // browsing around keeps more folders cached than there is room for
+        if (rnd() % 3 == 0) DirCache::get(randomFolder(folders));
+    }
+
+    printf("%d operations, %d listings compared, %d folders, %d entries\n", ops, compared, (int)allFolders().size(), (int)tree.size());
+    return 0;
+}
+
+static void bench(void)
+{
+    struct timespec t0, t1, t2;
+    int rounds = 200;
+
+    seed = 7;
+    tree.clear();
+    DirCache::clear();
+    Node root;
+    root.folder = true;
+    root.size = 0;
+    tree["ms0:/"] = root;
+    create("ms0:/", "ISO", true, 0);
+    for (int i = 0; i < 2000; i++){
+        string name = randomName() + "_" + to_string(i);
+        if (!exists("ms0:/ISO/", name)) create("ms0:/ISO/", name, false, rnd());
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < rounds; i++) DirCache::get("ms0:/ISO/", true);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (int i = 0; i < rounds; i++) DirCache::get("ms0:/ISO/");
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    printf("2000 entries: scan and sort %.1f us, cached %.2f us\n",
+           ((t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3) / rounds,
+           ((t2.tv_sec - t1.tv_sec) * 1e6 + (t2.tv_nsec - t1.tv_nsec) / 1e3) / rounds);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !strcmp(argv[1], "-b")){
+        bench();
+        return 0;
+    }
+
+    int failed = stress((argc > 1) ? atoi(argv[1]) : 20000) < 0;
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
@@ -0,0 +1,135 @@
+/*
+    host test for the arkMenu music player
+
+    Builds mp3.cpp and music_player.cpp against psphost.cpp and plays a
+    playlist through MusicPlayer::control the way the browser does. The
+    tracks are made up (see psphost.cpp) so the audio log says which track
+    and sample every output sample came from. Checks that:
+    - every track of the playlist plays, in order, each sample exactly once
+    - there is no silence between tracks of the same format, only where the
+      SRC channel is reopened for another sampling rate and at the end
+    - the partial last frame of a track is joined with the next track
+    - the play thread leaves no file, mp3 handle or channel behind
+
+    mp3test         fails on the first problem
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "music_player.h"
+#include "psphost.h"
+
+typedef struct {
+    const char *name;
+    int rate;
+    int frames;
+    int last;                               // samples in the last frame
+    int id3;
+} Track;
+
+static Track tracks[] = {
+    { "ms0:/MUSIC/01.mp3", 44100, 40, 1152, 0 },
+    { "ms0:/MUSIC/02.mp3", 44100, 33, 300, 1000 },
+    { "ms0:/MUSIC/03.mp3", 44100, 25, 701, 0 },
+    { "ms0:/MUSIC/04.mp3", 48000, 30, 1152, 0 },
+    { "ms0:/MUSIC/05.mp3", 44100, 28, 17, 0 },
+    { "ms0:/MUSIC/06.mp3", 44100, 31, 1151, 0 },
+};
+
+#define NTRACKS (int)(sizeof(tracks) / sizeof(tracks[0]))
+
+// the menu around the player
+Image* common::getImage(int which){ static Image image; return &image; }
+void common::printText(float x, float y, const char *text, unsigned color, float size, int glow, TextScroll* scroll, int translate){}
+void SystemMgr::enterFullScreen(){}
+void SystemMgr::exitFullScreen(){}
+void Controller::update(int ignore){ sceKernelDelayThread(1000); }
+
+static int check(void)
+{
+    int count[NTRACKS + 1], gaps = 0, track = 0, failed = 0;
+    size_t i;
+
+    memset(count, 0, sizeof(count));
+
+    for (i = 0; i < psphost_audio.size(); i++){
+        PsphostSample *s = &psphost_audio[i];
+
+        if (s->track == 0){
+            // silence only pads the block before a format change or the end
+            if (track > 0 && track < NTRACKS && tracks[track - 1].rate == tracks[track].rate){
+                printf("silence after track %d, which has the format of the next one\n", track);
+                return 1;
+            }
+            gaps++;
+            continue;
+        }
+
+        if (s->track != track){
+            if (s->track != track + 1){
+                printf("track %d follows track %d\n", s->track, track);
+                return 1;
+            }
+            track = s->track;
+        }
+
+        if (s->rate != tracks[track - 1].rate){
+            printf("track %d output at %d Hz\n", track, s->rate);
+            return 1;
+        }
+
+        if (s->sample != (count[track] & 0x7fff)){
+            printf("track %d: sample %d where %d was due\n", track, s->sample, count[track] & 0x7fff);
+            return 1;
+        }
+        count[track]++;
+    }
+
+    for (i = 0; i < (size_t)NTRACKS; i++){
+        int want = (tracks[i].frames - 1) * PSPHOST_FRAME_SAMPLES + tracks[i].last;
+        printf("track %d: %d Hz, %d of %d samples\n", (int)i + 1, tracks[i].rate, count[i + 1], want);
+        if (count[i + 1] != want) failed = 1;
+    }
+    printf("%d samples of silence\n", gaps);
+
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    vector<string> playlist;
+    MP3TransitionStats stats;
+    int files, handles, resources, channel;
+    int failed;
+
+    for (int i = 0; i < NTRACKS; i++){
+        psphostAddTrack(tracks[i].name, i + 1, tracks[i].rate, tracks[i].frames, tracks[i].last, tracks[i].id3);
+        playlist.push_back(tracks[i].name);
+    }
+
+    MusicPlayer player(&playlist);
+    player.control();
+
+    // the last on_music_end runs after the play thread stops saying it is playing
+    MP3::fullStop();
+
+    failed = check();
+
+    MP3::getTransitionStats(&stats);
+    printf("%d track changes, longest stall %u us\n", (int)stats.transitions, stats.max_stall);
+    if ((int)stats.transitions != NTRACKS - 1){
+        printf("expected %d track changes\n", NTRACKS - 1);
+        failed = 1;
+    }
+
+    psphostLeaks(&files, &handles, &resources, &channel);
+    if (files || handles || resources || channel){
+        printf("left behind: %d files, %d mp3 handles, %d mp3 resources, %d channels\n", files, handles, resources, channel);
+        failed = 1;
+    }
+
+    printf(failed ? "FAILED\n" : "ok\n");
+
+    return failed;
+}
@@ -0,0 +1,415 @@
+/*
+    host stand-in for the PSP side of mp3.cpp
+
+    threads and semaphores are pthreads, files live in memory and the mp3
+    library decodes the made-up format written by psphostAddTrack:
+
+        "FMP3" rate channels frames last_frame_samples
+        frames * PSPHOST_FRAME_BYTES, each starting with its frame number
+
+    every decoded stereo sample is (track, sample number in the track) so
+    the audio log shows exactly what reached the SRC channel and in which
+    order.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pspkernel.h"
+#include "pspmp3.h"
+#include "pspaudio.h"
+#include "psphost.h"
+
+#define MAX_THREADS  64
+#define MAX_SEMAS    16
+#define MAX_FILES    16
+#define MAX_HANDLES  2                      // what libmp3 gives out
+#define HEADER_BYTES 20
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+////////////////////////////////////////////////////////////////////////
+// threads and semaphores
+////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+    SceKernelThreadEntry entry;
+    pthread_t thread;
+    SceSize args;
+    void *argp;
+    int started, joined;
+} HostThread;
+
+static HostThread threads[MAX_THREADS];
+static int nthreads;
+
+static void *threadMain(void *arg)
+{
+    HostThread *t = (HostThread *)arg;
+    t->entry(t->args, t->argp);
+    return NULL;
+}
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int prio, int stack, SceUInt attr, void *opt)
+{
+    pthread_mutex_lock(&lock);
+    int id = (nthreads < MAX_THREADS) ? nthreads++ : -1;
+    pthread_mutex_unlock(&lock);
+
+    if (id < 0) return -1;
+    memset(&threads[id], 0, sizeof(HostThread));
+    threads[id].entry = entry;
+    return id;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize args, void *argp)
+{
+    HostThread *t = &threads[thid];
+
+    // the kernel copies the arguments onto the new thread's stack
+    t->args = args;
+    t->argp = malloc(args);
+    memcpy(t->argp, argp, args);
+    t->started = 1;
+    return pthread_create(&t->thread, NULL, threadMain, t) ? -1 : 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, SceUInt *timeout)
+{
+    if (thid < 0 || thid >= nthreads || !threads[thid].started) return -1;
+
+    pthread_mutex_lock(&lock);
+    int join = !threads[thid].joined;
+    threads[thid].joined = 1;
+    pthread_mutex_unlock(&lock);
+
+    if (join){
+        pthread_join(threads[thid].thread, NULL);
+        free(threads[thid].argp);
+    }
+    return 0;
+}
+
+// every caller returns right after it
+int sceKernelExitDeleteThread(int status)
+{
+    return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay)
+{
+    usleep(delay);
+    return 0;
+}
+
+u32 sceKernelGetSystemTimeLow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32)(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int count;
+} HostSema;
+
+static HostSema semas[MAX_SEMAS];
+static int nsemas;
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int init, int max, void *opt)
+{
+    int id = nsemas++;
+    pthread_mutex_init(&semas[id].mutex, NULL);
+    pthread_cond_init(&semas[id].cond, NULL);
+    semas[id].count = init;
+    return id;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout)
+{
+    HostSema *s = &semas[semaid];
+    pthread_mutex_lock(&s->mutex);
+    while (s->count < signal) pthread_cond_wait(&s->cond, &s->mutex);
+    s->count -= signal;
+    pthread_mutex_unlock(&s->mutex);
+    return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal)
+{
+    HostSema *s = &semas[semaid];
+    pthread_mutex_lock(&s->mutex);
+    s->count += signal;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// files
+////////////////////////////////////////////////////////////////////////
+
+static std::map<std::string, std::vector<u8> > files;
+
+typedef struct {
+    std::vector<u8> *data;
+    u32 pos;
+} HostFile;
+
+static HostFile fds[MAX_FILES];
+static int open_files;
+
+void psphostAddTrack(const char *name, int track, int rate, int frames, int last, int id3)
+{
+    std::vector<u8> &f = files[name];
+    u32 header[5] = { 0x33504d46, (u32)rate, 2, (u32)frames, (u32)last };
+
+    f.clear();
+    if (id3 > 0){
+        f.resize(id3 + 10);
+        memcpy(&f[0], "ID3", 3);
+        f[6] = (id3 >> 21) & 0x7f;
+        f[7] = (id3 >> 14) & 0x7f;
+        f[8] = (id3 >> 7) & 0x7f;
+        f[9] = id3 & 0x7f;
+    }
+    f.insert(f.end(), (u8 *)header, (u8 *)header + HEADER_BYTES);
+    for (int i = 0; i < frames; i++){
+        std::vector<u8> frame(PSPHOST_FRAME_BYTES, 0x5a);
+        frame[0] = i & 0xff;
+        frame[1] = (i >> 8) & 0xff;
+        frame[2] = track;
+        f.insert(f.end(), frame.begin(), frame.end());
+    }
+}
+
+SceUID sceIoOpen(const char *file, int flags, int mode)
+{
+    std::map<std::string, std::vector<u8> >::iterator it = files.find(file);
+    if (it == files.end()) return -1;
+
+    pthread_mutex_lock(&lock);
+    for (int fd = 0; fd < MAX_FILES; fd++){
+        if (fds[fd].data == NULL){
+            fds[fd].data = &it->second;
+            fds[fd].pos = 0;
+            open_files++;
+            pthread_mutex_unlock(&lock);
+            return fd;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return -1;
+}
+
+int sceIoClose(SceUID fd)
+{
+    pthread_mutex_lock(&lock);
+    fds[fd].data = NULL;
+    open_files--;
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+int sceIoRead(SceUID fd, void *data, SceSize size)
+{
+    HostFile *f = &fds[fd];
+    u32 left = f->data->size() - f->pos;
+    if (f->pos >= f->data->size()) return 0;
+    if (size > left) size = left;
+    memcpy(data, &(*f->data)[f->pos], size);
+    f->pos += size;
+    return size;
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence)
+{
+    HostFile *f = &fds[fd];
+    if (whence == SEEK_CUR) offset += f->pos;
+    else if (whence == SEEK_END) offset += f->data->size();
+    f->pos = offset;
+    return offset;
+}
+
+int sceIoLseek32(SceUID fd, int offset, int whence)
+{
+    return (int)sceIoLseek(fd, offset, whence);
+}
+
+////////////////////////////////////////////////////////////////////////
+// libmp3
+////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+    int used;
+    SceMp3InitArg init;
+    u32 pos;                                // next stream byte to be added
+    std::vector<u8> queue;                  // added and not decoded yet
+    int track, rate, frames, last, frame;
+} HostMp3;
+
+static HostMp3 handles[MAX_HANDLES];
+static int resources;
+
+int sceMp3InitResource(void)
+{
+    __sync_fetch_and_add(&resources, 1);
+    return 0;
+}
+
+int sceMp3TermResource(void)
+{
+    __sync_fetch_and_sub(&resources, 1);
+    return 0;
+}
+
+int sceMp3ReserveMp3Handle(SceMp3InitArg *args)
+{
+    pthread_mutex_lock(&lock);
+    for (int h = 0; h < MAX_HANDLES; h++){
+        if (!handles[h].used){
+            handles[h].used = 1;
+            handles[h].init = *args;
+            handles[h].pos = args->mp3StreamStart;
+            handles[h].queue.clear();
+            handles[h].frame = 0;
+            handles[h].frames = -1;
+            pthread_mutex_unlock(&lock);
+            return h;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return -1;
+}
+
+int sceMp3ReleaseMp3Handle(int handle)
+{
+    handles[handle].used = 0;
+    return 0;
+}
+
+int sceMp3GetInfoToAddStreamData(int handle, SceUChar8 **dst, SceInt32 *towrite, SceInt32 *srcpos)
+{
+    HostMp3 *m = &handles[handle];
+    u32 end = m->init.mp3StreamEnd;
+
+    *dst = (SceUChar8 *)m->init.mp3Buf;
+    *towrite = (m->pos < end) ? end - m->pos : 0;
+    if (*towrite > m->init.mp3BufSize / 2) *towrite = m->init.mp3BufSize / 2;
+    *srcpos = m->pos;
+    return 0;
+}
+
+int sceMp3NotifyAddStreamData(int handle, int size)
+{
+    HostMp3 *m = &handles[handle];
+    u8 *p = (u8 *)m->init.mp3Buf;
+    m->queue.insert(m->queue.end(), p, p + size);
+    m->pos += size;
+    return 0;
+}
+
+int sceMp3Init(int handle)
+{
+    HostMp3 *m = &handles[handle];
+    u32 header[5];
+
+    if (m->queue.size() < HEADER_BYTES) return -1;
+    memcpy(header, &m->queue[0], HEADER_BYTES);
+    if (header[0] != 0x33504d46) return -1;
+    m->queue.erase(m->queue.begin(), m->queue.begin() + HEADER_BYTES);
+    m->rate = header[1];
+    m->frames = header[3];
+    m->last = header[4];
+    return 0;
+}
+
+int sceMp3SetLoopNum(int handle, int loop) { return 0; }
+int sceMp3GetSamplingRate(int handle) { return handles[handle].rate; }
+int sceMp3GetMp3ChannelNum(int handle) { return 2; }
+int sceMp3GetMaxOutputSample(int handle) { return PSPHOST_FRAME_SAMPLES; }
+
+int sceMp3CheckStreamDataNeeded(int handle)
+{
+    HostMp3 *m = &handles[handle];
+    return (m->queue.size() < 2 * PSPHOST_FRAME_BYTES && m->pos < m->init.mp3StreamEnd);
+}
+
+int sceMp3Decode(int handle, short **dst)
+{
+    HostMp3 *m = &handles[handle];
+    short *pcm = (short *)m->init.pcmBuf;
+    int samples, frame;
+
+    if (m->frame >= m->frames || m->queue.size() < PSPHOST_FRAME_BYTES) return 0;
+
+    // a frame out of place means the stream was fed from the wrong position
+    frame = m->queue[0] | (m->queue[1] << 8);
+    if (frame != m->frame){
+        fprintf(stderr, "mp3 handle %d: got frame %d, expected %d\n", handle, frame, m->frame);
+        return -1;
+    }
+    m->track = m->queue[2];
+    m->queue.erase(m->queue.begin(), m->queue.begin() + PSPHOST_FRAME_BYTES);
+
+    samples = (m->frame == m->frames - 1) ? m->last : PSPHOST_FRAME_SAMPLES;
+    for (int i = 0; i < samples; i++){
+        pcm[i * 2] = m->track;
+        pcm[i * 2 + 1] = (m->frame * PSPHOST_FRAME_SAMPLES + i) & 0x7fff;
+    }
+    m->frame++;
+
+    *dst = pcm;
+    return samples * 2 * sizeof(short);
+}
+
+////////////////////////////////////////////////////////////////////////
+// SRC channel
+////////////////////////////////////////////////////////////////////////
+
+static int src_samples = -1, src_rate;
+std::vector<PsphostSample> psphost_audio;
+
+int sceAudioSRCChReserve(int samplecount, int freq, int channels)
+{
+    if (src_samples >= 0) return -1;
+    src_samples = samplecount;
+    src_rate = freq;
+    return 0;
+}
+
+int sceAudioSRCChRelease(void)
+{
+    if (src_samples < 0) return -1;
+    src_samples = -1;
+    return 0;
+}
+
+int sceAudioSRCOutputBlocking(int vol, void *buf)
+{
+    short *pcm = (short *)buf;
+
+    if (src_samples < 0) return -1;
+    for (int i = 0; i < src_samples; i++){
+        PsphostSample s = { src_rate, pcm[i * 2], pcm[i * 2 + 1] };
+        psphost_audio.push_back(s);
+    }
+    return src_samples;
+}
+
+void psphostLeaks(int *files_open, int *mp3_handles, int *mp3_resources, int *src_channel)
+{
+    *files_open = open_files;
+    *mp3_handles = handles[0].used + handles[1].used;
+    *mp3_resources = resources;
+    *src_channel = (src_samples >= 0);
+}
@@ -0,0 +1,23 @@
+#ifndef PSPHOST_H
+#define PSPHOST_H
+
+#include <vector>
+
+#define PSPHOST_FRAME_SAMPLES 1152
+#define PSPHOST_FRAME_BYTES   418           // a 128kbps 44.1kHz frame
+
+typedef struct {
+    int rate;
+    short track;                            // 0 for silence
+    short sample;
+} PsphostSample;
+
+// everything sceAudioSRCOutputBlocking was given
+extern std::vector<PsphostSample> psphost_audio;
+
+// a file of frames whose last one decodes to last samples, behind an id3 tag of id3 bytes
+void psphostAddTrack(const char *name, int track, int rate, int frames, int last, int id3);
+
+void psphostLeaks(int *files_open, int *mp3_handles, int *mp3_resources, int *src_channel);
+
+#endif
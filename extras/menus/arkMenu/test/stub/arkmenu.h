@@ -0,0 +1,75 @@
+// forced in front of music_player.cpp and dir_cache.cpp: just enough of the
+// menu for them to build, so the real common.h, controller.h, system_mgr.h
+// and optionsmenu.h are skipped through their include guards
+#ifndef ARKMENU_STUB_H
+#define ARKMENU_STUB_H
+
+#define COMMON_H
+#define CONTROLLER_H
+#define SYSTEM_H
+#define OPTIONSMENU_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <pspiofilemgr.h>
+
+using namespace std;
+
+#define LITEGRAY 0xFFBFBFBF
+#define SIZE_TINY 0.4f
+#define SIZE_MEDIUM 0.6f
+#define IMAGE_DIALOG 0
+
+typedef struct TextScroll{
+    float x;
+    float y;
+    float tmp;
+    float w;
+}TextScroll;
+
+class Image {
+    public:
+        void draw_scale(int x, int y, int w, int h){};
+};
+
+typedef struct {
+    unsigned char sort_entries;
+    unsigned char show_hidden;
+} t_conf;
+
+namespace common {
+    t_conf* getConf();
+    bool isFolder(SceIoDirent* dit);
+    Image* getImage(int which);
+    void printText(float x, float y, const char *text, unsigned color=0, float size=0, int glow=0, TextScroll* scroll=NULL, int translate=1);
+};
+
+namespace SystemMgr {
+    void enterFullScreen();
+    void exitFullScreen();
+};
+
+class OptionsMenu {
+    protected:
+        TextScroll scroll;
+    public:
+        OptionsMenu(){};
+        virtual ~OptionsMenu(){};
+        virtual void draw(){};
+        virtual int control(){ return 0; };
+};
+
+// no buttons are ever pressed
+class Controller {
+    public:
+        void update(int ignore=3);
+        void flush(){};
+        bool accept(){ return false; };
+        bool decline(){ return false; };
+        bool triangle(){ return false; };
+        bool LT(){ return false; };
+        bool RT(){ return false; };
+};
+
+#endif
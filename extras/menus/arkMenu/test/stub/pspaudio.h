@@ -0,0 +1,10 @@
+#ifndef PSPAUDIO_H
+#define PSPAUDIO_H
+
+#define PSP_AUDIO_VOLUME_MAX 0x8000
+
+int sceAudioSRCChReserve(int samplecount, int freq, int channels);
+int sceAudioSRCChRelease(void);
+int sceAudioSRCOutputBlocking(int vol, void *buf);
+
+#endif
@@ -0,0 +1,30 @@
+// directory calls, served from the in-memory tree of dirtest.cpp
+#ifndef PSPIOFILEMGR_H
+#define PSPIOFILEMGR_H
+
+#include "pspkernel.h"
+
+#define FIO_S_IFDIR  0x1000
+#define FIO_S_ISDIR(m) (((m) & 0xF000) == FIO_S_IFDIR)
+#define FIO_SO_IFDIR 0x0010
+#define FIO_SO_ISDIR(m) (((m) & 0x0038) == FIO_SO_IFDIR)
+
+typedef struct {
+    unsigned int st_mode;
+    unsigned int st_attr;
+    SceOff st_size;
+} SceIoStat;
+
+typedef struct {
+    SceIoStat d_stat;
+    char d_name[256];
+    void *d_private;
+    int dummy;
+} SceIoDirent;
+
+SceUID sceIoDopen(const char *dirname);
+int sceIoDread(SceUID fd, SceIoDirent *dir);
+int sceIoDclose(SceUID fd);
+int sceIoGetstat(const char *file, SceIoStat *stat);
+
+#endif
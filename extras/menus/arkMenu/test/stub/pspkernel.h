@@ -0,0 +1,46 @@
+// host stand-in for the parts of the PSP SDK mp3.cpp uses, see psphost.cpp
+#ifndef PSPKERNEL_H
+#define PSPKERNEL_H
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int SceInt32;
+typedef unsigned int SceUInt;
+typedef unsigned char SceUChar8;
+typedef long long SceOff;
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+#define PSP_O_RDONLY 0x0001
+#define PSP_THREAD_ATTR_USER 0x80000000
+#define PSP_THREAD_ATTR_VFPU 0x00004000
+
+#ifndef SEEK_SET
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+#endif
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int prio, int stack, SceUInt attr, void *opt);
+int sceKernelStartThread(SceUID thid, SceSize args, void *argp);
+int sceKernelWaitThreadEnd(SceUID thid, SceUInt *timeout);
+int sceKernelExitDeleteThread(int status);
+int sceKernelDelayThread(SceUInt delay);
+u32 sceKernelGetSystemTimeLow(void);
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int init, int max, void *opt);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout);
+int sceKernelSignalSema(SceUID semaid, int signal);
+
+SceUID sceIoOpen(const char *file, int flags, int mode);
+int sceIoClose(SceUID fd);
+int sceIoRead(SceUID fd, void *data, SceSize size);
+int sceIoLseek32(SceUID fd, int offset, int whence);
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef PSPMP3_H
+#define PSPMP3_H
+
+#include "pspkernel.h"
+
+typedef struct {
+    u32 mp3StreamStart;
+    u32 unk1;
+    u32 mp3StreamEnd;
+    u32 unk2;
+    void *mp3Buf;
+    int mp3BufSize;
+    void *pcmBuf;
+    int pcmBufSize;
+} SceMp3InitArg;
+
+int sceMp3InitResource(void);
+int sceMp3TermResource(void);
+int sceMp3ReserveMp3Handle(SceMp3InitArg *args);
+int sceMp3ReleaseMp3Handle(int handle);
+int sceMp3Init(int handle);
+int sceMp3SetLoopNum(int handle, int loop);
+int sceMp3GetSamplingRate(int handle);
+int sceMp3GetMp3ChannelNum(int handle);
+int sceMp3GetMaxOutputSample(int handle);
+int sceMp3GetInfoToAddStreamData(int handle, SceUChar8 **dst, SceInt32 *towrite, SceInt32 *srcpos);
+int sceMp3NotifyAddStreamData(int handle, int size);
+int sceMp3CheckStreamDataNeeded(int handle);
+int sceMp3Decode(int handle, short **dst);
+
+#endif
@@ -21,35 +21,35 @@
 #include "spu/stdafx.h"
 #include "spu/externals.h"
 
-#define BUFFER_SIZE    22050
+#include "ring.h"
+
+#define BUFFER_SIZE    16384 // samples, power of two for the ring (~186ms of stereo 44.1KHz)
+#define BUFFER_HIGH    (BUFFER_SIZE * 3 / 4) // spu stops producing above this fill level
 #define PSP_NUM_AUDIO_SAMPLES 1024
 
 short *pSndBuffer = NULL;
-int iBufSize = 0;
-volatile int iReadPos = 0, iWritePos = 0;
+SampleRing ring;
 
 SceUID audio_thid = -1;
 int channel = -1;
 
+static u32 copy_time = 0;
+
+// event raised once the ring drains to where SoundGetBytesBuffered lets the spu produce again
+static SceUID notify_evid = -1;
+static u32 notify_bits = 0;
+static volatile u32 notify_time = 0;
+
 static void FillAudio(unsigned char *stream, int len)
 {
-    short *p = (short *)stream;
+    unsigned int n;
 
     len /= sizeof(short);
 
-    while(iReadPos != iWritePos && len > 0)
-    {
-        *p++ = pSndBuffer[iReadPos++];
-        if(iReadPos >= iBufSize) iReadPos = 0;
-        --len;
-    }
+    n = RingRead(&ring, (short *)stream, len);
 
     // Fill remaining space with zero
-    while(len > 0)
-    {
-        *p++ = 0;
-        --len;
-    }
+    if(n < (unsigned int)len) memset(stream + n * sizeof(short), 0, (len - n) * sizeof(short));
 }
 
 int audio_thread(SceSize args, void *argp)
@@ -59,6 +59,13 @@ int audio_thread(SceSize args, void *argp)
     while(1)
     {
         FillAudio(buf, sizeof(buf));
+
+        if(notify_evid >= 0 && RingFill(&ring) <= BUFFER_HIGH)
+        {
+            notify_time = sceKernelGetSystemTimeLow();
+            sceKernelSetEventFlag(notify_evid, notify_bits);
+        }
+
         sceAudioOutputPannedBlocking(channel, PSP_AUDIO_VOLUME_MAX, PSP_AUDIO_VOLUME_MAX, buf);
     }
 
@@ -69,21 +76,19 @@ void SetupSound(void)
 {
     if(pSndBuffer != NULL) return;
 
-    channel = sceAudioChReserve(PSP_AUDIO_NEXT_CHANNEL, PSP_NUM_AUDIO_SAMPLES, PSP_AUDIO_FORMAT_STEREO);
-
-    audio_thid = sceKernelCreateThread("audio_thread", audio_thread, 0x10, 0x1000, 0, NULL);
-    if(audio_thid >= 0) sceKernelStartThread(audio_thid, 0, NULL);
-
-    iBufSize = BUFFER_SIZE;
-
-    pSndBuffer = (short *)malloc(iBufSize * sizeof(short));
+    pSndBuffer = (short *)malloc(BUFFER_SIZE * sizeof(short));
     if(pSndBuffer == NULL)
     {
         return;
     }
 
-    iReadPos = 0;
-    iWritePos = 0;
+    RingInit(&ring, pSndBuffer, BUFFER_SIZE);
+    copy_time = 0;
+
+    channel = sceAudioChReserve(PSP_AUDIO_NEXT_CHANNEL, PSP_NUM_AUDIO_SAMPLES, PSP_AUDIO_FORMAT_STEREO);
+
+    audio_thid = sceKernelCreateThread("audio_thread", audio_thread, 0x10, 0x1000, 0, NULL);
+    if(audio_thid >= 0) sceKernelStartThread(audio_thid, 0, NULL);
 }
 
 void RemoveSound(void)
@@ -93,11 +98,13 @@ void RemoveSound(void)
     if(audio_thid >= 0)
     {
         sceKernelTerminateDeleteThread(audio_thid);
+        audio_thid = -1;
     }
 
     if(channel >= 0)
     {
         sceAudioChRelease(channel);
+        channel = -1;
     }
 
     free(pSndBuffer);
@@ -106,33 +113,46 @@ void RemoveSound(void)
 
 unsigned long SoundGetBytesBuffered(void)
 {
-    int size;
-
     if(pSndBuffer == NULL) return SOUNDSIZE;
 
-    size = iReadPos - iWritePos;
-    if(size <= 0) size += iBufSize;
-
-    if(size < iBufSize / 2) return SOUNDSIZE;
+    if(RingFill(&ring) > BUFFER_HIGH) return SOUNDSIZE;
 
     return 0;
 }
 
 void SoundFeedStreamData(unsigned char *pSound, long lBytes)
 {
-    short *p = (short *)pSound;
+    u32 start;
 
     if(pSndBuffer == NULL) return;
 
-    while(lBytes > 0)
-    {
-        if(((iWritePos + 1) % iBufSize) == iReadPos) break;
+    start = sceKernelGetSystemTimeLow();
+    RingWrite(&ring, (short *)pSound, lBytes / sizeof(short));
+    copy_time += sceKernelGetSystemTimeLow() - start;
+}
 
-        pSndBuffer[iWritePos] = *p++;
+void SoundGetStats(SoundStats *stats)
+{
+    memset(stats, 0, sizeof(SoundStats));
 
-        ++iWritePos;
-        if(iWritePos >= iBufSize) iWritePos = 0;
+    if(pSndBuffer == NULL) return;
 
-        lBytes -= sizeof(short);
-    }
-}
\ No newline at end of file
+    stats->size = ring.size;
+    stats->fill = RingFill(&ring);
+    stats->written = ring.written;
+    stats->consumed = ring.consumed;
+    stats->dropped = ring.dropped;
+    stats->underruns = ring.underruns;
+    stats->copy_time = copy_time;
+}
+
+void SoundSetNotify(int evid, unsigned int bits)
+{
+    notify_bits = bits;
+    notify_evid = evid;
+}
+
+unsigned int SoundGetNotifyTime(void)
+{
+    return notify_time;
+}
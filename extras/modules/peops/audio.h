@@ -19,9 +19,22 @@
 #ifndef __AUDIO_H__
 #define __AUDIO_H__
 
+typedef struct {
+    unsigned int size;      // ring size in samples
+    unsigned int fill;      // samples currently queued
+    unsigned int written;   // samples queued since SetupSound
+    unsigned int consumed;  // samples played since SetupSound
+    unsigned int dropped;   // samples lost because the ring was full
+    unsigned int underruns; // output blocks that were padded with silence
+    unsigned int copy_time; // microseconds spent queueing samples
+} SoundStats;
+
 void SetupSound(void);
 void RemoveSound(void);
 unsigned long SoundGetBytesBuffered(void);
 void SoundFeedStreamData(unsigned char *pSound, long lBytes);
+void SoundGetStats(SoundStats *stats);
+void SoundSetNotify(int evid, unsigned int bits);
+unsigned int SoundGetNotifyTime(void);
 
 #endif
\ No newline at end of file
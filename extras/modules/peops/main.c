@@ -22,6 +22,7 @@
 #include "main.h"
 
 #include "spu/stdafx.h"
+#include "spu/externals.h"
 
 PSP_MODULE_INFO("peops", 0x0007, 1, 0);
 
@@ -34,27 +35,72 @@ void (* cdrWriteRegister)(int reg, int val);
 int cdr_is_first_sector = 1;
 xa_decode_t cdr_xa;
 
+#define SPU_BLOCK_SAMPLES (NSSIZE * 2)  // samples in a 1ms block (stereo)
+#define SPU_WAIT_TIMEOUT  100000         // safety net, the ring holds ~139ms above the 3/4 mark
+
+#define SPU_EVENT_LOW     1              // output took a block, the ring is at or below 3/4
+#define SPU_EVENT_REG     2              // game wrote an spu register
+
+static SceUID spu_event = -1;
+
+SpuThreadStats spu_stats;
+
 void SPUwait()
 {
-    sceKernelDelayThread(SPU_DELAY);
+    u32 bits = 0;
+    SceUInt timeout = SPU_WAIT_TIMEOUT;
+
+    int res = sceKernelWaitEventFlag(spu_event, SPU_EVENT_LOW | SPU_EVENT_REG, PSP_EVENT_WAITOR | PSP_EVENT_WAITCLEAR, &bits, &timeout);
+
+    spu_stats.wakeups++;
+    if(res < 0)
+    {
+        spu_stats.timeouts++;
+        return;
+    }
+
+    if(bits & SPU_EVENT_LOW)
+    {
+        spu_stats.low_wakeups++;
+        spu_stats.latency_total += sceKernelGetSystemTimeLow() - SoundGetNotifyTime();
+    }
+    if(bits & SPU_EVENT_REG) spu_stats.reg_wakeups++;
 }
 
 int spu_thread(SceSize args, void *argp)
 {
+    SoundStats sound;
+
+    spu_stats.start_time = sceKernelGetSystemTimeLow();
+
     while(1)
     {
+        // mixes 1ms blocks until the ring is above 3/4 again
         SPUupdate();
+
+        SoundGetStats(&sound);
+        spu_stats.blocks = sound.written / SPU_BLOCK_SAMPLES;
+        spu_stats.underruns = sound.underruns;
+
         SPUwait();
     }
 
     return 0;
 }
 
+void spuGetThreadStats(SpuThreadStats *stats)
+{
+    *stats = spu_stats;
+}
+
 void sceMeAudioInitPatched(int (* function)(), void *stack)
 {
     SPUinit();
     SPUopen();
 
+    spu_event = sceKernelCreateEventFlag("spu_event", 0, 0, NULL);
+    SoundSetNotify(spu_event, SPU_EVENT_LOW);
+
     SceUID thid = sceKernelCreateThread("spu_thread", spu_thread, SPU_PRIORITY_VERY_HIGH, 0x4000, 0, NULL);
     if(thid >= 0) sceKernelStartThread(thid, 0, NULL);
 }
@@ -70,6 +116,11 @@ void spuWriteRegisterPatched(int reg, int val, int type)
 {
     SPUwriteRegister(reg, val);
     spuWriteRegister(reg, val, type);
+
+    // key on/off and friends should be heard now, not at the next drain.
+    // the flag stays set until the worker waits again, so a write made
+    // while it is still mixing isn't lost
+    sceKernelSetEventFlag(spu_event, SPU_EVENT_REG);
 }
 
 void cdrTransferSectorPatched(u8 *sector, int mode)
@@ -21,6 +21,19 @@
 
 #include "spu/stdafx.h"
 
+typedef struct {
+    u32 start_time;    // when the worker started, for per second figures
+    u32 wakeups;       // times the worker went back to work
+    u32 low_wakeups;   // ... because the output took a block from the ring
+    u32 reg_wakeups;   // ... because of a register write
+    u32 timeouts;      // ... because nothing happened for a while
+    u32 latency_total; // microseconds between the output's signal and the worker running
+    u32 blocks;        // 1ms blocks fed to the ring
+    u32 underruns;     // output blocks padded with silence
+} SpuThreadStats;
+
+void spuGetThreadStats(SpuThreadStats *stats);
+
 void CALLBACK SPUupdate(void);
 void CALLBACK SPUplayADPCMchannel(xa_decode_t *xap);
 void CALLBACK SPUplayCDDAchannel(unsigned char *pcm, int nbytes);
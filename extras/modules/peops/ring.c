@@ -0,0 +1,118 @@
+/*
+    Custom Emulator Firmware
+    Copyright (C) 2012-2014, ColdBird/Total_Noob/Acid_Snake
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "ring.h"
+
+// the other side may run in between, make sure the compiler
+// doesn't move sample copies across position updates
+#define RING_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+int RingInit(SampleRing *ring, short *buf, unsigned int size)
+{
+    if(buf == NULL || size == 0 || (size & (size - 1)) != 0) return -1;
+
+    ring->buf = buf;
+    ring->size = size;
+    ring->mask = size - 1;
+
+    RingReset(ring);
+
+    return 0;
+}
+
+void RingReset(SampleRing *ring)
+{
+    ring->read = 0;
+    ring->write = 0;
+    ring->written = 0;
+    ring->consumed = 0;
+    ring->dropped = 0;
+    ring->underruns = 0;
+}
+
+unsigned int RingFill(SampleRing *ring)
+{
+    return ring->write - ring->read;
+}
+
+unsigned int RingFree(SampleRing *ring)
+{
+    return ring->size - (ring->write - ring->read);
+}
+
+unsigned int RingWrite(SampleRing *ring, const short *src, unsigned int count)
+{
+    unsigned int write = ring->write;
+    unsigned int space = ring->size - (write - ring->read);
+    unsigned int pos, first;
+
+    if(count > space)
+    {
+        ring->dropped += count - space;
+        count = space;
+    }
+
+    if(count == 0) return 0;
+
+    // at most two spans: up to the end of the buffer, then from the start
+    pos = write & ring->mask;
+    first = ring->size - pos;
+    if(first > count) first = count;
+
+    memcpy(ring->buf + pos, src, first * sizeof(short));
+    if(count > first) memcpy(ring->buf, src + first, (count - first) * sizeof(short));
+
+    RING_BARRIER();
+    ring->write = write + count;
+    ring->written += count;
+
+    return count;
+}
+
+unsigned int RingRead(SampleRing *ring, short *dst, unsigned int count)
+{
+    unsigned int read = ring->read;
+    unsigned int avail = ring->write - read;
+    unsigned int pos, first;
+
+    RING_BARRIER();
+
+    if(count > avail)
+    {
+        // nothing written yet is startup, not an underrun
+        if(ring->written) ring->underruns++;
+        count = avail;
+    }
+
+    if(count == 0) return 0;
+
+    pos = read & ring->mask;
+    first = ring->size - pos;
+    if(first > count) first = count;
+
+    memcpy(dst, ring->buf + pos, first * sizeof(short));
+    if(count > first) memcpy(dst + first, ring->buf, (count - first) * sizeof(short));
+
+    RING_BARRIER();
+    ring->read = read + count;
+    ring->consumed += count;
+
+    return count;
+}
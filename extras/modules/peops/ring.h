@@ -0,0 +1,55 @@
+/*
+    Custom Emulator Firmware
+    Copyright (C) 2012-2014, ColdBird/Total_Noob/Acid_Snake
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __RING_H__
+#define __RING_H__
+
+/*
+    Single producer / single consumer ring of 16 bit samples.
+    The SPU thread is the only writer, the audio thread the only reader,
+    so no locking is needed: each side only moves its own position, and
+    positions are published after the samples they cover have been copied.
+    Positions run freely and are masked on access, so the whole buffer is
+    usable and fill level is just write - read.
+*/
+
+typedef struct {
+    short *buf;
+    unsigned int size; // in samples, power of two
+    unsigned int mask;
+    volatile unsigned int read;
+    volatile unsigned int write;
+
+    // statistics
+    unsigned int written;   // samples accepted
+    unsigned int consumed;  // samples handed to the reader
+    unsigned int dropped;   // samples rejected because the ring was full
+    unsigned int underruns; // reads that could not be fully served
+} SampleRing;
+
+int RingInit(SampleRing *ring, short *buf, unsigned int size);
+void RingReset(SampleRing *ring);
+
+unsigned int RingFill(SampleRing *ring);
+unsigned int RingFree(SampleRing *ring);
+
+// copy up to count samples in/out, returns how many were moved
+unsigned int RingWrite(SampleRing *ring, const short *src, unsigned int count);
+unsigned int RingRead(SampleRing *ring, short *dst, unsigned int count);
+
+#endif
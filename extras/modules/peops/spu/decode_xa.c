@@ -122,144 +122,73 @@ static __inline void ADPCM_DecodeBlock16( ADPCM_Decode_t *decp, u8 filter_range,
 static int headtable[4] = {0,2,8,10};
 
 //===========================================
-static void xa_decode_data( xa_decode_t *xdp, unsigned char *srcp ) {
-    const u8    *sound_groupsp;
-    const u8    *sound_datap, *sound_datap2;
-    int         i, j, k, nbits;
-    u16    		data[4096], *datap;
-    short    	*destp;
-
-    destp = xdp->pcm;
-    nbits = xdp->nbits == 4 ? 4 : 2;
-
-    if (xdp->stereo) { // stereo
-        if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
-        	for (j=0; j < 18; j++) {
-        		sound_groupsp = srcp + j * 128;		// sound groups header
-        		sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-        		for (i=0; i < nbits; i++) {
-            		datap = data;
-            		sound_datap2 = sound_datap + i;
-
-        			for (k=0; k < 14; k++, sound_datap2 += 8) {
-                   			*(datap++) = (u16)sound_datap2[0] |
-                               		     (u16)(sound_datap2[4] << 8);
-        			}
-
-            		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           			    destp+0, 2 );
-
-                	datap = data;
-                	sound_datap2 = sound_datap + i;
-                	for (k=0; k < 14; k++, sound_datap2 += 8) {
-                   			*(datap++) = (u16)sound_datap2[0] |
-                              		     (u16)(sound_datap2[4] << 8);
-        			}
-        			ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                                   	    destp+1, 2 );
-
-                	destp += 28*2;
-        		}
-            }
-        } else { // level B/C
-        	for (j=0; j < 18; j++) {
-        		sound_groupsp = srcp + j * 128;		// sound groups header
-        		sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-        		for (i=0; i < nbits; i++) {
-            		datap = data;
-            		sound_datap2 = sound_datap + i;
-
-                	for (k=0; k < 7; k++, sound_datap2 += 16) {
-                   			*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
-                               		    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
-                               		    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
-                               		    ((u16)(sound_datap2[12] & 0x0f) << 12);
-        			}
-            		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                           		    destp+0, 2 );
-
-                	datap = data;
-                	sound_datap2 = sound_datap + i;
-                	for (k=0; k < 7; k++, sound_datap2 += 16) {
-                   			*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
-                                   		((u16)(sound_datap2[ 4] >> 4) <<  4) |
-                               		    ((u16)(sound_datap2[ 8] >> 4) <<  8) |
-                               		    ((u16)(sound_datap2[12] >> 4) << 12);
-        			}
-        			ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
-                                   	    destp+1, 2 );
-
-                	destp += 28*2;
-        		}
-            }
+// every sound unit of a group decodes two 28 sample blocks: left/right
+// in stereo, or two consecutive blocks in mono. the source bytes of both
+// are gathered in one pass over the group.
+
+static __inline void xa_gather_8bit( const u8 *sound_datap2, u16 *data ) {
+    int k;
+
+    for (k=0; k < BLKSIZ/4; k++, sound_datap2 += 8) {
+        data[k] = (u16)sound_datap2[0] |
+                  (u16)(sound_datap2[4] << 8);
+    }
+}
+
+static __inline void xa_gather_4bit( const u8 *sound_datap2, u16 *data0, u16 *data1 ) {
+    int k;
+
+    for (k=0; k < BLKSIZ/4; k++, sound_datap2 += 16) {
+        u32 b0 = sound_datap2[ 0];
+        u32 b1 = sound_datap2[ 4];
+        u32 b2 = sound_datap2[ 8];
+        u32 b3 = sound_datap2[12];
+
+        data0[k] = (u16)((b0 & 0x0f) | ((b1 & 0x0f) << 4) | ((b2 & 0x0f) << 8) | ((b3 & 0x0f) << 12));
+        data1[k] = (u16)((b0 >> 4) | ((b1 >> 4) << 4) | ((b2 >> 4) << 8) | ((b3 >> 4) << 12));
+    }
+}
+
+static short *xa_decode_group( xa_decode_t *xdp, const u8 *sound_groupsp, short *destp, int nunits, int level_a ) {
+    const u8    *sound_datap = sound_groupsp + 16;	// sound data just after the header
+    u16         data0[BLKSIZ/4], data1[BLKSIZ/4];
+    const u16   *datap1;
+    int         i;
+
+    for (i=0; i < nunits; i++) {
+        if (level_a) {
+            // both blocks of a unit read the same bytes
+            xa_gather_8bit( sound_datap + i, data0 );
+            datap1 = data0;
+        } else {
+            xa_gather_4bit( sound_datap + i, data0, data1 );
+            datap1 = data1;
         }
-    } else { // mono
-        if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
-        	for (j=0; j < 18; j++) {
-            	sound_groupsp = srcp + j * 128;		// sound groups header
-            	sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-            	for (i=0; i < nbits; i++) {
-                	datap = data;
-                	sound_datap2 = sound_datap + i;
-                	for (k=0; k < 14; k++, sound_datap2 += 8) {
-                   			*(datap++) = (u16)sound_datap2[0] |
-                               		     (u16)(sound_datap2[4] << 8);
-        			}
-                	ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                                   	    destp, 1 );
-
-                	destp += 28;
-
-                	datap = data;
-                	sound_datap2 = sound_datap + i;
-                	for (k=0; k < 14; k++, sound_datap2 += 8) {
-                   			*(datap++) = (u16)sound_datap2[0] |
-                               		     (u16)(sound_datap2[4] << 8);
-        			}
-               		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                                   	    destp, 1 );
-
-        			destp += 28;
-        		}
-            }
-        } else { // level B/C
-        	for (j=0; j < 18; j++) {
-            	sound_groupsp = srcp + j * 128;		// sound groups header
-            	sound_datap = sound_groupsp + 16;	// sound data just after the header
-
-            	for (i=0; i < nbits; i++) {
-                	datap = data;
-                	sound_datap2 = sound_datap + i;
-                	for (k=0; k < 7; k++, sound_datap2 += 16) {
-                   			*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
-                               		    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
-                               		    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
-                               		    ((u16)(sound_datap2[12] & 0x0f) << 12);
-        			}
-                	ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
-                                   	    destp, 1 );
-
-                	destp += 28;
-
-                	datap = data;
-                	sound_datap2 = sound_datap + i;
-                	for (k=0; k < 7; k++, sound_datap2 += 16) {
-                    		*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
-                                   	    ((u16)(sound_datap2[ 4] >> 4) <<  4) |
-                                		((u16)(sound_datap2[ 8] >> 4) <<  8) |
-                                		((u16)(sound_datap2[12] >> 4) << 12);
-                	}
-               		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
-                                   	    destp, 1 );
-
-        			destp += 28;
-        		}
-            }
+
+        if (xdp->stereo) {
+            ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data0, destp+0, 2 );
+            ADPCM_DecodeBlock16( &xdp->right, sound_groupsp[headtable[i]+1], datap1, destp+1, 2 );
+            destp += 28*2;
+        } else {
+            ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data0, destp, 1 );
+            ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], datap1, destp+28, 1 );
+            destp += 28*2;
         }
     }
+
+    return destp;
+}
+
+//===========================================
+static void xa_decode_data( xa_decode_t *xdp, unsigned char *srcp ) {
+    short   *destp = xdp->pcm;
+    int     nunits = xdp->nbits == 4 ? 4 : 2;
+    int     level_a = (xdp->nbits == 8) && (xdp->freq == 37800);
+    int     j;
+
+    for (j=0; j < 18; j++) {
+        destp = xa_decode_group( xdp, srcp + j * 128, destp, nunits, level_a );
+    }
 }
 
 //============================================
@@ -296,9 +225,8 @@ u8  coding2;
 #define SUB_AUDIO   2
 
 //============================================
-static int parse_xa_audio_sector( xa_decode_t *xdp, 
+static int parse_xa_audio_header( xa_decode_t *xdp, 
         						  xa_subheader_t *subheadp,
-        						  unsigned char *sectorp,
         						  int is_first_sector ) {
     if ( is_first_sector ) {
         switch ( AUDIO_CODING_GET_FREQ(subheadp->coding) ) {
@@ -326,7 +254,6 @@ static int parse_xa_audio_sector( xa_decode_t *xdp,
         xdp->nsamples = 18 * 28 * 8;
         if (xdp->stereo == 1) xdp->nsamples /= 2;
     }
-    xa_decode_data( xdp, sectorp );
 
     return 0;
 }
@@ -342,9 +269,11 @@ static int parse_xa_audio_sector( xa_decode_t *xdp,
 //================================================================
 s32 xa_decode_sector( xa_decode_t *xdp,
         			   unsigned char *sectorp, int is_first_sector ) {
-    if (parse_xa_audio_sector(xdp, (xa_subheader_t *)sectorp, sectorp + sizeof(xa_subheader_t), is_first_sector))
+    if (parse_xa_audio_header(xdp, (xa_subheader_t *)sectorp, is_first_sector))
         return -1;
 
+    xa_decode_data( xdp, sectorp + sizeof(xa_subheader_t) );
+
     return 0;
 }
 
@@ -24,7 +24,15 @@
 extern "C" {
 #endif
 
+#ifdef __psp__
 #include <common.h>
+#else
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int32_t s32;
+#endif
 
 typedef struct {
     s32    y0, y1;
@@ -0,0 +1,253 @@
+/***************************************************************************
+                            mix.c  -  description
+                             -------------------
+    split out of spu.c of the P.E.Op.S. PSX SPU plugin by Pete Bernert;
+    the channel/output mixing below is his MAINThread code, regrouped
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version. See also the license.txt file for *
+ *   additional informations.                                              *
+ *                                                                         *
+ ***************************************************************************/
+
+//*************************************************************************//
+// History of changes:
+//
+// psp port
+// - ADPCM block decoder and final output mix moved here from MAINThread
+// - each voice now runs its 1 ms in three passes (decode+interpolation,
+//   ADSR, volume/reverb/fmod) instead of one sample through all of them
+// - test/spubench.c builds this on a host and checks it against golden.txt
+//
+//*************************************************************************//
+
+#include "stdafx.h"
+
+#define _IN_MIX
+
+// will be included from spu.c, after the interpolation/noise/fmod helpers
+#ifdef _IN_SPU
+
+////////////////////////////////////////////////////////////////////////
+// DECODE ONE 16 BYTE ADPCM BLOCK (28 samples)
+////////////////////////////////////////////////////////////////////////
+
+// the 4 bit sample is placed in the top nibble of an int, so one
+// arithmetic shift does the sign extension (old: <<12, or 0xffff0000)
+// and the psx shift factor at once: (n<<28)>>(16+shift) == ((n<<12)>>shift)
+
+INLINE unsigned char * DecodeADPCMBlock(unsigned char * start,int * dest,int * ps_1,int * ps_2,int * pflags)
+{
+ int predict_nr,shift_factor,f0,f1,s_1,s_2,d,fa,n;
+
+ predict_nr=(int)*start++;
+ shift_factor=(predict_nr&0xf)+16;
+ predict_nr>>=4;
+ *pflags=(int)*start++;
+
+ f0=f[predict_nr][0];                                  // filter coefs are constant for the whole block
+ f1=f[predict_nr][1];
+ s_1=*ps_1;
+ s_2=*ps_2;
+
+ for(n=0;n<14;n++)
+  {
+   d=(int)*start++;
+
+   fa=((int)((unsigned int)d<<28)>>shift_factor) + ((s_1 * f0)>>6) + ((s_2 * f1)>>6);
+   s_2=s_1;s_1=fa;
+   *dest++=fa;
+
+   fa=((int)((unsigned int)(d&0xf0)<<24)>>shift_factor) + ((s_1 * f0)>>6) + ((s_2 * f1)>>6);
+   s_2=s_1;s_1=fa;
+   *dest++=fa;
+  }
+
+ *ps_1=s_1;
+ *ps_2=s_2;
+
+ return start;
+}
+
+////////////////////////////////////////////////////////////////////////
+// PER VOICE STAGES
+// 1 ms of a voice goes through iMixVal: decode+interpolation fill it,
+// the ADSR pass envelopes it and the output pass sums it up. Nothing in
+// one pass reads state the others write, so this gives the same samples
+// as running every sample through all three in turn.
+////////////////////////////////////////////////////////////////////////
+
+static int iMixVal[NSSIZE];
+
+// returns the number of samples made: less than NSSIZE if the voice ran
+// into its "stop" sign, the caller turns it off after mixing what is there
+
+INLINE int MixChannelIpol(SPUCHAN * pChannel)
+{
+ unsigned char * start;
+ int s_1,s_2,fa,ns,flags;
+
+ for(ns=0;ns<NSSIZE;ns++)
+  {
+   if(pChannel->bFMod==1 && iFMod[ns])                 // fmod freq channel
+    FModChangeFrequency(pChannel,ns);
+
+   while(pChannel->spos>=0x10000L)
+    {
+     if(pChannel->iSBPos==28)                          // 28 reached?
+      {
+       start=pChannel->pCurr;                          // set up the current pos
+
+       if (start == (unsigned char*)-1)                // special "stop" sign
+        return ns;
+
+       pChannel->iSBPos=0;
+
+       s_1=pChannel->s_1;
+       s_2=pChannel->s_2;
+
+       start=DecodeADPCMBlock(start,pChannel->SB,&s_1,&s_2,&flags);
+
+       if((flags&4) && (!pChannel->bIgnoreLoop))
+        pChannel->pLoop=start-16;                      // loop adress
+
+       if(flags&1)                                     // 1: stop/loop
+        {
+         // We play this block out first...
+         if(flags!=3 || pChannel->pLoop==NULL)         // PETE: if we don't check exactly for 3, loop hang ups will happen (DQ4, for example)
+          start = (unsigned char*)-1;                  // and checking if pLoop is set avoids crashes, yeah
+         else
+          start = pChannel->pLoop;
+        }
+
+       pChannel->pCurr=start;                          // store values for next cycle
+       pChannel->s_1=s_1;
+       pChannel->s_2=s_2;
+      }
+
+     fa=pChannel->SB[pChannel->iSBPos++];              // get sample data
+
+     StoreInterpolationVal(pChannel,fa);               // store val for later interpolation
+
+     pChannel->spos -= 0x10000L;
+    }
+
+   if(pChannel->bNoise)
+        iMixVal[ns]=iGetNoiseVal(pChannel);            // get noise val
+   else iMixVal[ns]=iGetInterpolationVal(pChannel);    // get sample val
+
+   pChannel->spos += pChannel->sinc;
+  }
+
+ return ns;
+}
+
+INLINE void MixChannelADSR(SPUCHAN * pChannel,int n)
+{
+ int ns;
+
+ for(ns=0;ns<n;ns++)
+  iMixVal[ns]=(MixADSR(pChannel)*iMixVal[ns])/1023;
+}
+
+INLINE void MixChannelOut(SPUCHAN * pChannel,int n)
+{
+ const int lv=pChannel->iLeftVolume;                   // psx volume goes from 0 ... 0x3fff
+ const int rv=pChannel->iRightVolume;
+ int ns,sval;
+
+ if(!n) return;
+
+ if(pChannel->bFMod==2)                                // fmod freq channel
+  {
+   for(ns=0;ns<n;ns++)                                 // -> store 1T sample data, use that to do fmod on next channel
+    iFMod[ns]=iMixVal[ns];
+  }
+ else
+ if(pChannel->bRVBActive)                              // StoreREVERB takes the sample from sval
+  {
+   for(ns=0;ns<n;ns++)
+    {
+     sval=pChannel->sval=iMixVal[ns];
+     SSumL[ns]+=(sval*lv)/0x4000L;
+     SSumR[ns]+=(sval*rv)/0x4000L;
+     StoreREVERB(pChannel,ns);
+    }
+  }
+ else
+  {
+   for(ns=0;ns<n;ns++)
+    {
+     sval=iMixVal[ns];
+     SSumL[ns]+=(sval*lv)/0x4000L;
+     SSumR[ns]+=(sval*rv)/0x4000L;
+    }
+  }
+
+ pChannel->sval=iMixVal[n-1];
+}
+
+////////////////////////////////////////////////////////////////////////
+// MIX 1 MS OF SSUML/SSUMR (+ REVERB) INTO THE OUTPUT BUFFER
+////////////////////////////////////////////////////////////////////////
+
+#define CLAMP_SAMPLE(d) {if(d<-32767) d=-32767;if(d>32767) d=32767;}
+
+INLINE short * MixOutput(short * out,int voldiv)
+{
+ int ns,dl,dr,shift;
+
+ if(iUseReverb)                                        // reverb has its own state, keep the l/r call order
+  {
+   for(ns=0;ns<NSSIZE;ns++)
+    {
+     SSumL[ns]+=MixREVERBLeft(ns);
+     SSumR[ns]+=MixREVERBRight();
+    }
+  }
+
+ if(voldiv==1)                                         // default volume: no scaling at all
+  {
+   for(ns=0;ns<NSSIZE;ns++)
+    {
+     dl=SSumL[ns];dr=SSumR[ns];
+     CLAMP_SAMPLE(dl);CLAMP_SAMPLE(dr);
+     *out++=dl;*out++=dr;
+    }
+  }
+ else
+ if(voldiv>0 && !(voldiv&(voldiv-1)))                  // power of two: biased shift, rounds towards 0 like '/'
+  {
+   for(shift=0;(1<<shift)<voldiv;shift++);
+   voldiv--;
+   for(ns=0;ns<NSSIZE;ns++)
+    {
+     dl=SSumL[ns];dr=SSumR[ns];
+     dl=(dl+((dl>>31)&voldiv))>>shift;
+     dr=(dr+((dr>>31)&voldiv))>>shift;
+     CLAMP_SAMPLE(dl);CLAMP_SAMPLE(dr);
+     *out++=dl;*out++=dr;
+    }
+  }
+ else
+  {
+   for(ns=0;ns<NSSIZE;ns++)
+    {
+     dl=SSumL[ns]/voldiv;dr=SSumR[ns]/voldiv;
+     CLAMP_SAMPLE(dl);CLAMP_SAMPLE(dr);
+     *out++=dl;*out++=dr;
+    }
+  }
+
+ memset(SSumL,0,NSSIZE*sizeof(int));
+ memset(SSumR,0,NSSIZE*sizeof(int));
+
+ return out;
+}
+
+#endif
@@ -67,8 +67,6 @@ int iFMod[NSSIZE];
 int iCycle=0;
 short * pS;
 
-static int lastch=-1;      // last channel processed on spu irq in timer mode
-static int lastns=0;       // last ns pos
 static int iSecureStart=0; // secure start counter
 
 ////////////////////////////////////////////////////////////////////////
@@ -335,6 +333,8 @@ INLINE int iGetInterpolationVal(SPUCHAN * pChannel)
  return fa;
 }
 
+#include "mix.c"
+
 ////////////////////////////////////////////////////////////////////////
 // MAIN SPU FUNCTION
 // here is the main job handler... thread, timer or direct func call
@@ -343,9 +343,8 @@ INLINE int iGetInterpolationVal(SPUCHAN * pChannel)
 
 static void *MAINThread(void *arg)
 {
- int s_1,s_2,fa,ns,voldiv=iVolume;
- unsigned char * start;unsigned int nSample;
- int ch,predict_nr,shift_factor,flags,d,s;
+ int ns,voldiv=iVolume;
+ int ch;
  SPUCHAN * pChannel;
                             
 
@@ -374,15 +373,6 @@ static void *MAINThread(void *arg)
      return 0;                           // linux no-thread mode? bye
     }
 
-   //--------------------------------------------------// continue from irq handling in timer mode? 
-
-   if(lastch>=0)                                       // will be -1 if no continue is pending
-    {
-     ch=lastch; ns=lastns; lastch=-1;                  // -> setup all kind of vars to continue
-     pChannel=&s_chan[ch];
-     goto GOON;                                        // -> directly jump to the continue point
-    }
-
    //--------------------------------------------------//
    //- main channel loop                              -// 
    //--------------------------------------------------//
@@ -401,127 +391,16 @@ static void *MAINThread(void *arg)
        if(pChannel->iActFreq!=pChannel->iUsedFreq)     // new psx frequency?
         VoiceChangeFrequency(pChannel);
 
-       ns=0;
-       while(ns<NSSIZE)                                // loop until 1 ms of data is reached
-        {
-         if(pChannel->bFMod==1 && iFMod[ns])           // fmod freq channel
-          FModChangeFrequency(pChannel,ns);
+       ns=MixChannelIpol(pChannel);                    // decode + interpolate 1 ms
+       MixChannelADSR(pChannel,ns);                    // envelope it
+       MixChannelOut(pChannel,ns);                     // and sum it up (or feed fmod)
 
-         while(pChannel->spos>=0x10000L)
-          {
-           if(pChannel->iSBPos==28)                    // 28 reached?
-            {
-             start=pChannel->pCurr;                    // set up the current pos
-
-             if (start == (unsigned char*)-1)          // special "stop" sign
-              {
-               pChannel->bOn=0;                        // -> turn everything off
-               pChannel->ADSRX.lVolume=0;
-               pChannel->ADSRX.EnvelopeVol=0;
-               goto ENDX;                              // -> and done for this channel
-              }
-
-             pChannel->iSBPos=0;
-
-             //////////////////////////////////////////// spu irq handler here? mmm... do it later
-
-             s_1=pChannel->s_1;
-             s_2=pChannel->s_2;
-
-             predict_nr=(int)*start;start++;
-             shift_factor=predict_nr&0xf;
-             predict_nr >>= 4;
-             flags=(int)*start;start++;
-
-             // -------------------------------------- // 
-
-             for (nSample=0;nSample<28;start++)      
-              {
-               d=(int)*start;
-               s=((d&0xf)<<12);
-               if(s&0x8000) s|=0xffff0000;
-
-               fa=(s >> shift_factor);
-               fa=fa + ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
-               s_2=s_1;s_1=fa;
-               s=((d & 0xf0) << 8);
-
-               pChannel->SB[nSample++]=fa;
-
-               if(s&0x8000) s|=0xffff0000;
-               fa=(s>>shift_factor);              
-               fa=fa + ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
-               s_2=s_1;s_1=fa;
-
-               pChannel->SB[nSample++]=fa;
-              }     
-
-             //////////////////////////////////////////// flag handler
-
-             if((flags&4) && (!pChannel->bIgnoreLoop))
-              pChannel->pLoop=start-16;                // loop adress
-
-             if(flags&1)                               // 1: stop/loop
-              {
-               // We play this block out first...
-               //if(!(flags&2))                          // 1+2: do loop... otherwise: stop
-               if(flags!=3 || pChannel->pLoop==NULL)   // PETE: if we don't check exactly for 3, loop hang ups will happen (DQ4, for example)
-                {                                      // and checking if pLoop is set avoids crashes, yeah
-                 start = (unsigned char*)-1;
-                }
-               else
-                {
-                 start = pChannel->pLoop;
-                }
-              }
-
-             pChannel->pCurr=start;                    // store values for next cycle
-             pChannel->s_1=s_1;
-             pChannel->s_2=s_2;      
-
-GOON: ;
-
-            }
-
-           fa=pChannel->SB[pChannel->iSBPos++];        // get sample data
-
-           StoreInterpolationVal(pChannel,fa);         // store val for later interpolation
-
-           pChannel->spos -= 0x10000L;
-          }
-
-         ////////////////////////////////////////////////
-                                
-         if(pChannel->bNoise)
-              fa=iGetNoiseVal(pChannel);               // get noise val
-         else fa=iGetInterpolationVal(pChannel);       // get sample val
-
-         pChannel->sval=(MixADSR(pChannel)*fa)/1023;   // mix adsr
-
-         if(pChannel->bFMod==2)                        // fmod freq channel
-          iFMod[ns]=pChannel->sval;                    // -> store 1T sample data, use that to do fmod on next channel
-         else                                          // no fmod freq channel
-          {                                          
-           //////////////////////////////////////////////
-           // ok, left/right sound volume (psx volume goes from 0 ... 0x3fff)
-
-             SSumL[ns]+=(pChannel->sval*pChannel->iLeftVolume)/0x4000L;
-             SSumR[ns]+=(pChannel->sval*pChannel->iRightVolume)/0x4000L;
-        
-           //////////////////////////////////////////////
-           // now let us store sound data for reverb    
-                                                          
-           if(pChannel->bRVBActive) StoreREVERB(pChannel,ns);
-          }
-
-         ////////////////////////////////////////////////
-         // ok, go on until 1 ms data of this channel is collected
-                                                       
-         ns++;                                          
-         pChannel->spos += pChannel->sinc;             
-                                                              
-        }        
-ENDX:   ;                                                      
+       if(ns<NSSIZE)                                   // voice ran into the "stop" sign
+        {
+         pChannel->bOn=0;                              // -> turn everything off
+         pChannel->ADSRX.lVolume=0;
+         pChannel->ADSRX.EnvelopeVol=0;
+        }
       }
     }                                                         
    
@@ -535,20 +414,7 @@ ENDX:   ;
   ///////////////////////////////////////////////////////
   // mix all channels (including reverb) into one buffer
 
-  for(ns=0;ns<NSSIZE;ns++)
-   {            
-    SSumL[ns]+=MixREVERBLeft(ns);
-                                              
-    d=SSumL[ns]/voldiv;SSumL[ns]=0;
-    if(d<-32767) d=-32767;if(d>32767) d=32767;
-    *pS++=d;
-        
-    SSumR[ns]+=MixREVERBRight();
-
-    d=SSumR[ns]/voldiv;SSumR[ns]=0;
-    if(d<-32767) d=-32767;if(d>32767) d=32767;
-    *pS++=d;
-   }
+  pS=MixOutput(pS,voldiv);
 
   InitREVERB();
 
@@ -0,0 +1,140 @@
+/*
+    the MAINThread voice and output loops as they were before mix.c,
+    behind mix.c's functions so spubench can time both
+
+    The Makefile builds spu.c a second time with this included in place
+    of mix.c (spubase). MixChannelIpol runs the old single loop that
+    decodes, envelopes and sums one sample at a time, the other two
+    voice passes have nothing left to do. The lastch/GOON continuation
+    is left out, nothing ever set lastch.
+*/
+
+INLINE int MixChannelIpol(SPUCHAN * pChannel)
+{
+ int s_1,s_2,fa,ns;
+ unsigned char * start;unsigned int nSample;
+ int predict_nr,shift_factor,flags,d,s;
+
+ ns=0;
+ while(ns<NSSIZE)                                // loop until 1 ms of data is reached
+  {
+   if(pChannel->bFMod==1 && iFMod[ns])           // fmod freq channel
+    FModChangeFrequency(pChannel,ns);
+
+   while(pChannel->spos>=0x10000L)
+    {
+     if(pChannel->iSBPos==28)                    // 28 reached?
+      {
+       start=pChannel->pCurr;                    // set up the current pos
+
+       if (start == (unsigned char*)-1)          // special "stop" sign
+        return ns;                               // -> spu.c turns everything off
+
+       pChannel->iSBPos=0;
+
+       s_1=pChannel->s_1;
+       s_2=pChannel->s_2;
+
+       predict_nr=(int)*start;start++;
+       shift_factor=predict_nr&0xf;
+       predict_nr >>= 4;
+       flags=(int)*start;start++;
+
+       for (nSample=0;nSample<28;start++)
+        {
+         d=(int)*start;
+         s=((d&0xf)<<12);
+         if(s&0x8000) s|=0xffff0000;
+
+         fa=(s >> shift_factor);
+         fa=fa + ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
+         s_2=s_1;s_1=fa;
+         s=((d & 0xf0) << 8);
+
+         pChannel->SB[nSample++]=fa;
+
+         if(s&0x8000) s|=0xffff0000;
+         fa=(s>>shift_factor);
+         fa=fa + ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
+         s_2=s_1;s_1=fa;
+
+         pChannel->SB[nSample++]=fa;
+        }
+
+       if((flags&4) && (!pChannel->bIgnoreLoop))
+        pChannel->pLoop=start-16;                // loop adress
+
+       if(flags&1)                               // 1: stop/loop
+        {
+         if(flags!=3 || pChannel->pLoop==NULL)
+          start = (unsigned char*)-1;
+         else
+          start = pChannel->pLoop;
+        }
+
+       pChannel->pCurr=start;                    // store values for next cycle
+       pChannel->s_1=s_1;
+       pChannel->s_2=s_2;
+      }
+
+     fa=pChannel->SB[pChannel->iSBPos++];        // get sample data
+
+     StoreInterpolationVal(pChannel,fa);         // store val for later interpolation
+
+     pChannel->spos -= 0x10000L;
+    }
+
+   if(pChannel->bNoise)
+        fa=iGetNoiseVal(pChannel);               // get noise val
+   else fa=iGetInterpolationVal(pChannel);       // get sample val
+
+   pChannel->sval=(MixADSR(pChannel)*fa)/1023;   // mix adsr
+
+   if(pChannel->bFMod==2)                        // fmod freq channel
+    iFMod[ns]=pChannel->sval;                    // -> store 1T sample data, use that to do fmod on next channel
+   else                                          // no fmod freq channel
+    {
+     SSumL[ns]+=(pChannel->sval*pChannel->iLeftVolume)/0x4000L;
+     SSumR[ns]+=(pChannel->sval*pChannel->iRightVolume)/0x4000L;
+
+     if(pChannel->bRVBActive) StoreREVERB(pChannel,ns);
+    }
+
+   ns++;
+   pChannel->spos += pChannel->sinc;
+  }
+
+ return ns;
+}
+
+INLINE void MixChannelADSR(SPUCHAN * pChannel,int n)
+{
+}
+
+INLINE void MixChannelOut(SPUCHAN * pChannel,int n)
+{
+}
+
+INLINE short * MixOutput(short * out,int voldiv)
+{
+ int ns,d;
+
+ for(ns=0;ns<NSSIZE;ns++)
+  {
+   SSumL[ns]+=MixREVERBLeft(ns);
+
+   d=SSumL[ns]/voldiv;SSumL[ns]=0;
+   if(d<-32767) d=-32767;
+   if(d>32767) d=32767;
+   *out++=d;
+
+   SSumR[ns]+=MixREVERBRight();
+
+   d=SSumR[ns]/voldiv;SSumR[ns]=0;
+   if(d<-32767) d=-32767;
+   if(d>32767) d=32767;
+   *out++=d;
+  }
+
+ return out;
+}
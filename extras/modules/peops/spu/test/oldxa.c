@@ -0,0 +1,146 @@
+/*
+    xa_decode_data as it was before the sound group rewrite, for xatest
+
+    xatest.c includes decode_xa.c and then this, so it runs on the same
+    ADPCM_DecodeBlock16 and headtable and only the gathering differs.
+*/
+
+static void old_xa_decode_data( xa_decode_t *xdp, unsigned char *srcp ) {
+    const u8    *sound_groupsp;
+    const u8    *sound_datap, *sound_datap2;
+    int         i, j, k, nbits;
+    u16    		data[4096], *datap;
+    short    	*destp;
+
+    destp = xdp->pcm;
+    nbits = xdp->nbits == 4 ? 4 : 2;
+
+    if (xdp->stereo) { // stereo
+        if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
+        	for (j=0; j < 18; j++) {
+        		sound_groupsp = srcp + j * 128;		// sound groups header
+        		sound_datap = sound_groupsp + 16;	// sound data just after the header
+
+        		for (i=0; i < nbits; i++) {
+            		datap = data;
+            		sound_datap2 = sound_datap + i;
+
+        			for (k=0; k < 14; k++, sound_datap2 += 8) {
+                   			*(datap++) = (u16)sound_datap2[0] |
+                               		     (u16)(sound_datap2[4] << 8);
+        			}
+
+            		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
+                           			    destp+0, 2 );
+
+                	datap = data;
+                	sound_datap2 = sound_datap + i;
+                	for (k=0; k < 14; k++, sound_datap2 += 8) {
+                   			*(datap++) = (u16)sound_datap2[0] |
+                              		     (u16)(sound_datap2[4] << 8);
+        			}
+        			ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
+                                   	    destp+1, 2 );
+
+                	destp += 28*2;
+        		}
+            }
+        } else { // level B/C
+        	for (j=0; j < 18; j++) {
+        		sound_groupsp = srcp + j * 128;		// sound groups header
+        		sound_datap = sound_groupsp + 16;	// sound data just after the header
+
+        		for (i=0; i < nbits; i++) {
+            		datap = data;
+            		sound_datap2 = sound_datap + i;
+
+                	for (k=0; k < 7; k++, sound_datap2 += 16) {
+                   			*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
+                               		    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
+                               		    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
+                               		    ((u16)(sound_datap2[12] & 0x0f) << 12);
+        			}
+            		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
+                           		    destp+0, 2 );
+
+                	datap = data;
+                	sound_datap2 = sound_datap + i;
+                	for (k=0; k < 7; k++, sound_datap2 += 16) {
+                   			*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
+                                   		((u16)(sound_datap2[ 4] >> 4) <<  4) |
+                               		    ((u16)(sound_datap2[ 8] >> 4) <<  8) |
+                               		    ((u16)(sound_datap2[12] >> 4) << 12);
+        			}
+        			ADPCM_DecodeBlock16( &xdp->right,  sound_groupsp[headtable[i]+1], data,
+                                   	    destp+1, 2 );
+
+                	destp += 28*2;
+        		}
+            }
+        }
+    } else { // mono
+        if ((xdp->nbits == 8) && (xdp->freq == 37800)) { // level A
+        	for (j=0; j < 18; j++) {
+            	sound_groupsp = srcp + j * 128;		// sound groups header
+            	sound_datap = sound_groupsp + 16;	// sound data just after the header
+
+            	for (i=0; i < nbits; i++) {
+                	datap = data;
+                	sound_datap2 = sound_datap + i;
+                	for (k=0; k < 14; k++, sound_datap2 += 8) {
+                   			*(datap++) = (u16)sound_datap2[0] |
+                               		     (u16)(sound_datap2[4] << 8);
+        			}
+                	ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
+                                   	    destp, 1 );
+
+                	destp += 28;
+
+                	datap = data;
+                	sound_datap2 = sound_datap + i;
+                	for (k=0; k < 14; k++, sound_datap2 += 8) {
+                   			*(datap++) = (u16)sound_datap2[0] |
+                               		     (u16)(sound_datap2[4] << 8);
+        			}
+               		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
+                                   	    destp, 1 );
+
+        			destp += 28;
+        		}
+            }
+        } else { // level B/C
+        	for (j=0; j < 18; j++) {
+            	sound_groupsp = srcp + j * 128;		// sound groups header
+            	sound_datap = sound_groupsp + 16;	// sound data just after the header
+
+            	for (i=0; i < nbits; i++) {
+                	datap = data;
+                	sound_datap2 = sound_datap + i;
+                	for (k=0; k < 7; k++, sound_datap2 += 16) {
+                   			*(datap++) = (u16)(sound_datap2[ 0] & 0x0f) |
+                               		    ((u16)(sound_datap2[ 4] & 0x0f) <<  4) |
+                               		    ((u16)(sound_datap2[ 8] & 0x0f) <<  8) |
+                               		    ((u16)(sound_datap2[12] & 0x0f) << 12);
+        			}
+                	ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+0], data,
+                                   	    destp, 1 );
+
+                	destp += 28;
+
+                	datap = data;
+                	sound_datap2 = sound_datap + i;
+                	for (k=0; k < 7; k++, sound_datap2 += 16) {
+                    		*(datap++) = (u16)(sound_datap2[ 0] >> 4) |
+                                   	    ((u16)(sound_datap2[ 4] >> 4) <<  4) |
+                                		((u16)(sound_datap2[ 8] >> 4) <<  8) |
+                                		((u16)(sound_datap2[12] >> 4) << 12);
+                	}
+               		ADPCM_DecodeBlock16( &xdp->left,  sound_groupsp[headtable[i]+1], data,
+                                   	    destp, 1 );
+
+        			destp += 28;
+        		}
+            }
+        }
+    }
+}
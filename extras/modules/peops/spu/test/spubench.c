@@ -0,0 +1,299 @@
+/*
+    host harness for the peops spu core
+
+    Builds spu.c (with its dirty includes: adsr.c, reverb.c, xa.c, mix.c),
+    registers.c and decode_xa.c against stub audio/psp headers, replays a
+    spu ram image plus a register write log one millisecond at a time and
+    checksums the pcm that comes out of MAINThread.
+
+    spubench                      all interpolation/reverb/volume combos of
+                                  the built-in scene, one crc per line
+                                  (make check diffs this against golden.txt)
+    spubench -b [-n ms]           throughput of the mixing loop, best of 5
+                                  runs without the crc (make bench runs
+                                  spubase -b too: the loop before mix.c)
+    spubench -r ram.bin -l regs.txt [-n ms] [-w out.pcm] [-i ipol] [-v vol] [-e]
+                                  replay a recorded dump; regs.txt has one
+                                  "<ms> <reg> <val>" write per line (hex reg/val)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../registers.h"
+
+#define SPU_RAM_SIZE (512*1024)
+#define MAX_WRITES   65536
+
+#define CALLBACK
+
+// spu.c / registers.c
+extern unsigned char * spuMemC;
+extern unsigned char * pSpuBuffer;
+extern short * pS;
+extern int iVolume;
+extern int iUseReverb;
+extern int iUseInterpolation;
+extern unsigned long dwNoiseVal;
+long CALLBACK SPUinit(void);
+long SPUopen(void);
+long CALLBACK SPUclose(void);
+void CALLBACK SPUupdate(void);
+void CALLBACK SPUwriteRegister(unsigned long reg, unsigned short val);
+
+typedef struct {
+    unsigned int ms;
+    unsigned short reg, val;
+} RegWrite;
+
+static unsigned char ram[SPU_RAM_SIZE];                 // pristine image
+static unsigned char spu_ram[SPU_RAM_SIZE];             // what the spu runs on
+static RegWrite writes[MAX_WRITES];
+static int nwrites;
+
+static unsigned int crc_table[256];
+static unsigned int crc;
+static unsigned long long frames;
+static FILE * pcm_out;
+static int budget;
+static int no_crc;
+
+////////////////////////////////////////////////////////////////////////
+// stub audio/psp backend
+////////////////////////////////////////////////////////////////////////
+
+static void crc_update(const unsigned char * p, long n)
+{
+    while(n-- > 0) crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+}
+
+void SetupSound(void) {}
+void RemoveSound(void) {}
+void ReadConfig(void) {}
+unsigned long timeGetTime() { return 0; }
+
+// MAINThread mixes one ms per call while this reports a not-full buffer
+unsigned long SoundGetBytesBuffered(void)
+{
+    return (budget-- > 0) ? 0 : 0x7fffffff;
+}
+
+void SoundFeedStreamData(unsigned char * pSound, long lBytes)
+{
+    if(!no_crc) crc_update(pSound, lBytes);
+    frames += lBytes / 4;
+    if(pcm_out) fwrite(pSound, 1, lBytes, pcm_out);
+}
+
+////////////////////////////////////////////////////////////////////////
+// built-in scene: random adpcm samples and a scripted voice allocator
+////////////////////////////////////////////////////////////////////////
+
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static void add(unsigned int ms, unsigned short reg, unsigned short val)
+{
+    if(nwrites < MAX_WRITES) {
+        writes[nwrites].ms = ms;
+        writes[nwrites].reg = reg;
+        writes[nwrites].val = val;
+        nwrites++;
+    }
+}
+
+static void make_scene(unsigned int length)
+{
+    int i, b, blocks;
+    unsigned int ms, addr;
+
+    seed = 0x5350;
+    memset(ram, 0, sizeof(ram));
+    nwrites = 0;
+
+    for(i = 0; i < 16; i++) {                           // 16 samples, 4k apart
+        unsigned char * p = ram + 0x1000 + i * 0x1000;
+        blocks = 8 + rnd() % 248;
+        for(b = 0; b < blocks; b++, p += 16) {
+            int k;
+            p[0] = ((rnd() % 5) << 4) | (rnd() % 13);
+            p[1] = (b == 0 && (i & 1)) ? 4 : 0;
+            if(b == blocks - 1) p[1] = (i & 1) ? 3 : 1; // odd: loop, even: stop
+            for(k = 2; k < 16; k++) p[k] = rnd();
+        }
+    }
+
+    add(0, H_SPUctrl, 0xc080);                          // unmuted, reverb enabled
+    add(0, H_SPUReverbAddr, 0xe000);
+    add(0, H_Reverb, 0x0033);
+    add(0, H_SPUrvolL, 0x3000);
+    add(0, H_SPUrvolR, 0x2800);
+    add(0, H_RVBon1, 0x0f0f);
+    add(0, H_RVBon2, 0x00f0);
+    add(0, H_Noise1, 0x0020);                           // ch 5 noise
+    add(0, H_FMod1, 0x0200);                            // ch 8 modulated by ch 7
+
+    for(ms = 0; ms < length; ms += 7) {
+        int ch = rnd() % 24;
+        unsigned short base = 0x0c00 + ch * 16;
+
+        addr = 0x1000 + (rnd() % 16) * 0x1000;
+        add(ms, base + 0, rnd() & 0x3fff);
+        add(ms, base + 2, rnd() & 0x3fff);
+        add(ms, base + 4, 0x100 + rnd() % 0x3f00);
+        add(ms, base + 6, addr >> 3);
+        add(ms, base + 8, rnd() | ((rnd() & 1) << 15));
+        add(ms, base + 10, rnd() | ((rnd() & 1) << 15));
+        if(ch < 16) add(ms, H_SPUon1, 1 << ch);
+        else        add(ms, H_SPUon2, 1 << (ch - 16));
+
+        if(rnd() % 4 == 0) {                            // release a random voice
+            ch = rnd() % 24;
+            if(ch < 16) add(ms + 3, H_SPUoff1, 1 << ch);
+            else        add(ms + 3, H_SPUoff2, 1 << (ch - 16));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+// recorded dumps
+////////////////////////////////////////////////////////////////////////
+
+static int load_ram(const char * path)
+{
+    FILE * fp = fopen(path, "rb");
+    if(fp == NULL) return -1;
+    memset(ram, 0, sizeof(ram));
+    fread(ram, 1, sizeof(ram), fp);
+    fclose(fp);
+    return 0;
+}
+
+static int load_log(const char * path)
+{
+    unsigned int ms, reg, val;
+    FILE * fp = fopen(path, "r");
+    if(fp == NULL) return -1;
+    nwrites = 0;
+    while(fscanf(fp, "%u %x %x", &ms, &reg, &val) == 3)
+        add(ms, reg, val);
+    fclose(fp);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static void render(int ipol, int reverb, int vol, unsigned int length)
+{
+    unsigned int ms;
+    int w = 0;
+
+    iUseInterpolation = ipol;
+    iUseReverb = reverb;
+    iVolume = vol;
+    dwNoiseVal = 1;
+    spuMemC = spu_ram;
+
+    memcpy(spu_ram, ram, SPU_RAM_SIZE);
+    crc = 0xffffffff;
+    frames = 0;
+
+    SPUinit();
+    SPUopen();
+
+    for(ms = 0; ms < length; ms++) {
+        while(w < nwrites && writes[w].ms <= ms) {
+            SPUwriteRegister(0x1f800000 | writes[w].reg, writes[w].val);
+            w++;
+        }
+        budget = 1;
+        SPUupdate();
+    }
+    SoundFeedStreamData(pSpuBuffer, (unsigned char *)pS - pSpuBuffer);
+
+    SPUclose();
+    crc = ~crc;
+}
+
+int main(int argc, char ** argv)
+{
+    const char * ram_path = NULL, * log_path = NULL, * pcm_path = NULL;
+    unsigned int length = 2000;
+    int bench = 0, ipol = 2, vol = 1, reverb = 0;
+    int i, r, v;
+
+    for(i = 0; i < 256; i++) {
+        unsigned int c = i;
+        int k;
+        for(k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-b")) bench = 1;
+        else if(!strcmp(argv[i], "-e")) reverb = 1;
+        else if(!strcmp(argv[i], "-n") && i + 1 < argc) length = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-i") && i + 1 < argc) ipol = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-v") && i + 1 < argc) vol = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-r") && i + 1 < argc) ram_path = argv[++i];
+        else if(!strcmp(argv[i], "-l") && i + 1 < argc) log_path = argv[++i];
+        else if(!strcmp(argv[i], "-w") && i + 1 < argc) pcm_path = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [-b] [-n ms] [-r ram.bin -l regs.txt] [-w out.pcm] [-i ipol] [-v vol] [-e]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(ram_path || log_path) {
+        if(!ram_path || !log_path || load_ram(ram_path) < 0 || load_log(log_path) < 0) {
+            fprintf(stderr, "cannot load dump\n");
+            return 1;
+        }
+        if(pcm_path) pcm_out = fopen(pcm_path, "wb");
+        render(ipol, reverb, vol, length);
+        if(pcm_out) fclose(pcm_out);
+        printf("crc=%08x frames=%llu\n", crc, frames);
+        return 0;
+    }
+
+    make_scene(bench ? length * 10 : length);
+
+    if(bench) {
+        struct timespec t0, t1;
+        double sec, best = 0;
+
+        length *= 10;
+        no_crc = 1;
+        for(i = 0; i < 5; i++) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            render(ipol, 1, 3, length);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+            if(i == 0 || sec < best) best = sec;
+        }
+#ifdef OLD_MIX
+        printf("old loop: ");
+#else
+        printf("mix.c:    ");
+#endif
+        printf("%u ms of audio, %llu frames in %.3f s: %.0f frames/s (%.1fx realtime)\n",
+               length, frames, best, frames / best, length / 1000.0 / best);
+        return 0;
+    }
+
+    for(i = 0; i < 4; i++)
+        for(r = 0; r < 2; r++)
+            for(v = 1; v <= 4; v++) {
+                render(i, r, v, length);
+                printf("ipol=%d reverb=%d vol=%d crc=%08x frames=%llu\n", i, r, v, crc, frames);
+            }
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+/*
+    host stand-in for peops/audio.h, used by the spu test harness only
+*/
+
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+void SetupSound(void);
+void RemoveSound(void);
+unsigned long SoundGetBytesBuffered(void);
+void SoundFeedStreamData(unsigned char *pSound, long lBytes);
+
+#endif
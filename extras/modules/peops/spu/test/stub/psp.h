@@ -0,0 +1,11 @@
+/*
+    host stand-in for peops/psp.h, used by the spu test harness only
+*/
+
+#ifndef __PSP_H__
+#define __PSP_H__
+
+unsigned long timeGetTime();
+void ReadConfig(void);
+
+#endif
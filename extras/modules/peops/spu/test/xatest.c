@@ -0,0 +1,191 @@
+/*
+    host test for the XA decoder (decode_xa.c)
+
+    Builds decode_xa.c together with the xa_decode_data it replaced
+    (oldxa.c) and runs both on the same sectors:
+    - every coding the header can give: 37.8/18.9KHz, 4/8 bit, mono/stereo,
+      plus an invalid rate that both have to refuse
+    - streams of consecutive sectors, so the predictor state carried from
+      one sector to the next is covered, with random data and with loud
+      data that drives the decoder into its clamp
+    pcm, sample count and predictor state have to be bit-exact after each
+    sector.
+
+    xatest          runs the checks
+    xatest -b [-n sectors]
+                    decode time per sector of both, best of 5, for level A
+                    (8 bit stereo), B (4 bit 37.8KHz stereo) and C (4 bit
+                    18.9KHz mono)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../decode_xa.c"
+#include "oldxa.c"
+
+#define SECTOR_SIZE    (8 + 18 * 128)
+#define SECTOR_SAMPLES (18 * 28 * 8)            // shorts written per sector, mono or stereo
+#define STREAM_SECTORS 300
+#define BENCH_POOL     64
+
+static xa_decode_t new_xa, old_xa;
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+static s32 old_xa_decode_sector(xa_decode_t *xdp, unsigned char *sectorp, int is_first_sector)
+{
+    if (parse_xa_audio_header(xdp, (xa_subheader_t *)sectorp, is_first_sector))
+        return -1;
+
+    old_xa_decode_data(xdp, sectorp + sizeof(xa_subheader_t));
+    return 0;
+}
+
+// loud: filter 2/3 with range 0 and full scale nibbles, so the sum clamps
+static void make_sector(unsigned char *s, int coding, int loud)
+{
+    int i, j;
+
+    s[0] = s[4] = 1;
+    s[1] = s[5] = 0;
+    s[2] = s[6] = 0x64;                                 // real-time form 2 audio
+    s[3] = s[7] = coding;
+
+    for (i = 8; i < SECTOR_SIZE; i++) s[i] = rnd();
+
+    if (loud) {
+        for (j = 0; j < 18; j++) {
+            unsigned char *g = s + 8 + j * 128;
+
+            for (i = 0; i < 16; i++) g[i] = (2 + (rnd() & 1)) << 4;
+            for (i = 16; i < 128; i++) g[i] = (rnd() & 1) ? 0x77 : 0x88;
+        }
+    }
+}
+
+static int compare(const char *what, int sector)
+{
+    if (new_xa.freq != old_xa.freq || new_xa.nbits != old_xa.nbits || new_xa.stereo != old_xa.stereo
+        || new_xa.nsamples != old_xa.nsamples) {
+        printf("  %s sector %d: format differs\n", what, sector);
+        return 1;
+    }
+    if (memcmp(&new_xa.left, &old_xa.left, sizeof(old_xa.left))
+        || memcmp(&new_xa.right, &old_xa.right, sizeof(old_xa.right))) {
+        printf("  %s sector %d: predictor state differs\n", what, sector);
+        return 1;
+    }
+    if (memcmp(new_xa.pcm, old_xa.pcm, SECTOR_SAMPLES * sizeof(short))) {
+        printf("  %s sector %d: pcm differs\n", what, sector);
+        return 1;
+    }
+    return 0;
+}
+
+static int check_stream(int coding, int loud)
+{
+    unsigned char s[SECTOR_SIZE];
+    char what[32];
+    int i, r_new, r_old;
+
+    sprintf(what, "coding %02x%s", coding, loud ? " loud" : "");
+
+    for (i = 0; i < STREAM_SECTORS; i++) {
+        make_sector(s, coding, loud);
+        r_new = xa_decode_sector(&new_xa, s, i == 0);
+        r_old = old_xa_decode_sector(&old_xa, s, i == 0);
+
+        if (r_new != r_old) {
+            printf("  %s sector %d: returned %d, old %d\n", what, i, r_new, r_old);
+            return 1;
+        }
+        if (r_new < 0) return 0;
+        if (compare(what, i)) return 1;
+    }
+    return 0;
+}
+
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static double time_decoder(s32 (*decode)(xa_decode_t *, unsigned char *, int), xa_decode_t *xdp,
+                           unsigned char *pool, int sectors)
+{
+    double t0, best = 0;
+    int run, i;
+
+    for (run = 0; run < 5; run++) {
+        t0 = now();
+        for (i = 0; i < sectors; i++)
+            decode(xdp, pool + (i % BENCH_POOL) * SECTOR_SIZE, i == 0);
+        t0 = now() - t0;
+        if (run == 0 || t0 < best) best = t0;
+    }
+    return best / sectors * 1e6;
+}
+
+static void bench(int sectors)
+{
+    static const struct { const char *name; int coding; } levels[] = {
+        { "A 8 bit 37.8KHz stereo", 0x11 },
+        { "B 4 bit 37.8KHz stereo", 0x01 },
+        { "C 4 bit 18.9KHz mono  ", 0x04 },
+    };
+    static unsigned char pool[BENCH_POOL * SECTOR_SIZE];
+    double t_old, t_new;
+    int l, i;
+
+    for (l = 0; l < 3; l++) {
+        seed = 0x58410000 + l;
+        for (i = 0; i < BENCH_POOL; i++) make_sector(pool + i * SECTOR_SIZE, levels[l].coding, 0);
+
+        t_old = time_decoder(old_xa_decode_sector, &old_xa, pool, sectors);
+        t_new = time_decoder(xa_decode_sector, &new_xa, pool, sectors);
+        printf("level %s: old %.2f us/sector, new %.2f us/sector (%.2fx)\n",
+               levels[l].name, t_old, t_new, t_old / t_new);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int sectors = 100000, do_bench = 0, failed = 0;
+    int coding, loud, i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b")) do_bench = 1;
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) sectors = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-b] [-n sectors]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (do_bench) {
+        bench(sectors);
+        return 0;
+    }
+
+    // stereo (bits 0-1), rate (bits 2-3), bits per sample (bits 4-5)
+    seed = 0x5841;
+    for (coding = 0; coding < 0x40; coding++) {
+        if ((coding & 3) > 1 || ((coding >> 4) & 3) > 1) continue;
+        for (loud = 0; loud < 2; loud++)
+            failed |= check_stream(coding, loud);
+    }
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
@@ -0,0 +1,239 @@
+/*
+    host test for the peops output ring (ring.c)
+
+    ringtest        edge cases, then a producer and a consumer thread moving
+                    a counting sequence through a small ring; any lost,
+                    doubled or reordered sample fails the run
+    ringtest -b     copy throughput of SampleRing against the per-sample
+                    loops it replaced, and underruns of a paced consumer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "../ring.h"
+
+#define CHECK(c) do { if(!(c)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #c); exit(1); } } while(0)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static void test_basic(void)
+{
+    SampleRing ring;
+    short buf[16], in[32], out[32];
+    int i;
+
+    CHECK(RingInit(&ring, buf, 0) < 0);
+    CHECK(RingInit(&ring, buf, 12) < 0);
+    CHECK(RingInit(&ring, NULL, 16) < 0);
+    CHECK(RingInit(&ring, buf, 16) == 0);
+
+    for(i = 0; i < 32; i++) in[i] = i + 1;
+
+    // reading an empty ring before anything was written is not an underrun
+    CHECK(RingRead(&ring, out, 4) == 0);
+    CHECK(ring.underruns == 0);
+
+    // fill completely, the rest is dropped
+    CHECK(RingWrite(&ring, in, 20) == 16);
+    CHECK(ring.dropped == 4);
+    CHECK(RingFill(&ring) == 16 && RingFree(&ring) == 0);
+
+    // drain part, then write across the end of the buffer
+    CHECK(RingRead(&ring, out, 10) == 10);
+    for(i = 0; i < 10; i++) CHECK(out[i] == i + 1);
+    CHECK(RingWrite(&ring, in + 16, 10) == 10);
+    CHECK(RingFill(&ring) == 16);
+
+    // read across the end as well
+    CHECK(RingRead(&ring, out, 16) == 16);
+    for(i = 0; i < 16; i++) CHECK(out[i] == i + 11);
+
+    // short read after data has flowed counts as an underrun
+    CHECK(RingWrite(&ring, in, 3) == 3);
+    CHECK(RingRead(&ring, out, 8) == 3);
+    CHECK(ring.underruns == 1);
+    CHECK(ring.written == 29 && ring.consumed == 29);
+
+    // positions wrap around the 32 bit range without losing the fill level
+    RingReset(&ring);
+    ring.read = ring.write = 0xfffffff8;
+    CHECK(RingWrite(&ring, in, 12) == 12);
+    CHECK(RingFill(&ring) == 12);
+    CHECK(RingRead(&ring, out, 12) == 12);
+    for(i = 0; i < 12; i++) CHECK(out[i] == i + 1);
+    CHECK(RingFill(&ring) == 0);
+
+    printf("basic: ok\n");
+}
+
+////////////////////////////////////////////////////////////////////////
+
+#define SPSC_TOTAL 10000000u
+
+static SampleRing spsc;
+static short spsc_buf[1024];
+static volatile int producer_done;
+
+static void *producer(void *arg)
+{
+    short chunk[1530];
+    unsigned int seq = 0, seed = 1, n, i, w;
+
+    while(seq < SPSC_TOTAL) {
+        seed = seed * 1103515245 + 12345;
+        n = 1 + (seed >> 16) % 1530;                    // up to 17ms of stereo, like MAINThread
+        if(n > SPSC_TOTAL - seq) n = SPSC_TOTAL - seq;
+        for(i = 0; i < n; i++) chunk[i] = (short)(seq + i);
+
+        // a full ring drops the tail, so only count what went in
+        w = RingWrite(&spsc, chunk, n);
+        seq += w;
+        if(w == 0) sched_yield();
+    }
+    producer_done = 1;
+    return NULL;
+}
+
+static void test_spsc(void)
+{
+    pthread_t thid;
+    short out[2048];
+    unsigned int seq = 0, n, i, reads = 0;
+    double t;
+
+    CHECK(RingInit(&spsc, spsc_buf, 1024) == 0);
+
+    t = now();
+    pthread_create(&thid, NULL, producer, NULL);
+
+    while(seq < SPSC_TOTAL) {
+        n = RingRead(&spsc, out, 1 + reads++ % 2048);
+        for(i = 0; i < n; i++)
+            if(out[i] != (short)(seq + i)) {
+                printf("spsc: sample %u is %d, expected %d\n", seq + i, out[i], (short)(seq + i));
+                exit(1);
+            }
+        seq += n;
+        if(n == 0) sched_yield();
+    }
+
+    pthread_join(thid, NULL);
+    t = now() - t;
+
+    CHECK(RingFill(&spsc) == 0);
+    CHECK(spsc.consumed == SPSC_TOTAL);
+    printf("spsc: %u samples in order through a 1024 sample ring, %.1f Msamples/s, %u short reads\n",
+           seq, seq / t / 1e6, spsc.underruns);
+}
+
+////////////////////////////////////////////////////////////////////////
+// the per-sample copies SampleRing replaced (SoundFeedStreamData/FillAudio)
+
+#define OLD_SIZE 22050
+
+static short old_buf[OLD_SIZE];
+static volatile int old_read, old_write;
+
+static void old_feed(const short *p, long count)
+{
+    while(count > 0) {
+        if(((old_write + 1) % OLD_SIZE) == old_read) break;
+        old_buf[old_write] = *p++;
+        if(++old_write >= OLD_SIZE) old_write = 0;
+        count--;
+    }
+}
+
+static void old_fill(short *p, int len)
+{
+    while(old_read != old_write && len > 0) {
+        *p++ = old_buf[old_read++];
+        if(old_read >= OLD_SIZE) old_read = 0;
+        --len;
+    }
+    while(len > 0) { *p++ = 0; --len; }
+}
+
+static void bench(void)
+{
+    static short pcm[1536], out[2048], ringbuf[16384];
+    SampleRing ring;
+    const unsigned long total = 400000000ul;
+    unsigned long moved;
+    unsigned int t, fill;
+    double t0, t_old, t_new;
+    int i;
+
+    for(i = 0; i < 1536; i++) pcm[i] = i * 7;
+
+    // same pattern for both: four feeds of 1536 per three 1024 frame output
+    // blocks, so the level stays put and neither side drops or pads
+    old_feed(out, 2048);
+    t0 = now();
+    for(moved = 0; moved < total; moved += 1536) {
+        old_feed(pcm, 1536);
+        if((moved / 1536) % 4 != 3) old_fill(out, 2048);
+    }
+    t_old = now() - t0;
+
+    RingInit(&ring, ringbuf, 16384);
+    RingWrite(&ring, out, 2048);
+    t0 = now();
+    for(moved = 0; moved < total; moved += 1536) {
+        RingWrite(&ring, pcm, 1536);
+        if((moved / 1536) % 4 != 3) {
+            unsigned int n = RingRead(&ring, out, 2048);
+            if(n < 2048) memset(out + n, 0, (2048 - n) * sizeof(short));
+        }
+    }
+    t_new = now() - t0;
+    CHECK(ring.dropped == 0 && ring.underruns == 0);
+
+    printf("copy: per-sample %.1f Msamples/s, SampleRing %.1f Msamples/s (%.1fx)\n",
+           total / t_old / 1e6, total / t_new / 1e6, t_old / t_new);
+
+    // paced: 2048 samples drained every 23220us, 1530 produced every 17ms
+    // with up to +-8ms of jitter unless the ring is 3/4 full (what
+    // SoundGetBytesBuffered tells MAINThread), 60s of virtual time
+    RingInit(&ring, ringbuf, 16384);
+    srand(1);
+    for(t = 0, fill = 0; t < 60000000; t += 1000) {
+        static unsigned int next_out = 23220, next_in = 0;
+        if(t >= next_in) {
+            if(RingFill(&ring) <= 16384 * 3 / 4) RingWrite(&ring, pcm, 1530);
+            next_in += 17000 + (rand() % 16001) - 8000;
+        }
+        if(t >= next_out) {
+            RingRead(&ring, out, 2048);
+            next_out += 23220;
+        }
+        if(RingFill(&ring) > fill) fill = RingFill(&ring);
+    }
+    printf("paced: %u output blocks, %u underruns, %u dropped, peak fill %u\n",
+           ring.consumed / 2048, ring.underruns, ring.dropped, fill);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc > 1 && !strcmp(argv[1], "-b")) {
+        bench();
+        return 0;
+    }
+
+    test_basic();
+    test_spsc();
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+    host simulation of the peops SPU worker (main.c spu_thread)
+
+    Runs the real ring.c in virtual time against a model of the rest:
+    - the audio thread takes 1024 frames every 23220us and, like audio.c,
+      raises the output event when that leaves the ring at or below 3/4
+    - SPUupdate is MAINThread's gating: it makes 1ms blocks while the ring
+      is at most 3/4 full and feeds them to the ring every 18 blocks
+    - the game writes spu registers at random, in bursts
+    and compares three loops:
+    - fixed: the old SPUupdate + 100us SPUwait
+    - gated: the event wait, with register writes only signalled while
+      the worker sleeps. a write made while it mixes is seen by the next
+      block, but one made after SPUupdate's last check and before the
+      wait waits for the next wakeup
+    - event: what main.c does, the flag is set on every write and stays
+      set until the worker waits again
+
+    The costs below are assumptions to make the comparison concrete, not
+    PSP measurements; spuGetThreadStats() gives the real figures.
+
+    spusim [seconds]   all loops, without and with register traffic;
+                       fails if any underruns, or if in event mode a
+                       register write waits longer than a block, the
+                       worker times out or the output never wakes it
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../ring.h"
+
+#define NSSIZE            45
+#define SPU_BLOCK_SAMPLES (NSSIZE * 2)
+#define SPU_FEED_BLOCKS   18                // iCycle++>16 in MAINThread
+#define SPU_WAIT_TIMEOUT  100000
+#define SPU_DELAY         100               // the old fixed SPUwait
+
+#define BUFFER_SIZE       16384
+#define BUFFER_HIGH       (BUFFER_SIZE * 3 / 4)
+#define AUDIO_SAMPLES     2048
+#define AUDIO_PERIOD      23220
+
+#define COST_WAKEUP       5                 // us per thread switch
+#define COST_UPDATE       2                 // us for an SPUupdate that returns at once
+#define COST_BLOCK        60                // us per 1ms block mixed
+
+enum { FIXED, GATED, EVENT };
+
+typedef struct {
+    const char *name;
+    int mode;
+    unsigned int wakeups, updates, blocks;
+    unsigned int low_wakeups, reg_wakeups, timeouts;
+    unsigned long long low_latency, reg_latency, reg_max, busy;
+    unsigned int regs, reg_waits;
+    unsigned int underruns, min_fill;
+} Result;
+
+static short ringbuf[BUFFER_SIZE], pcm[SPU_FEED_BLOCKS * SPU_BLOCK_SAMPLES], out[AUDIO_SAMPLES];
+static SampleRing ring;
+static int pending;                         // blocks mixed, not fed yet
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+// one SPUupdate call, returns the us it took
+static unsigned int spu_update(Result *r)
+{
+    unsigned int t = COST_UPDATE;
+
+    r->updates++;
+    while(RingFill(&ring) <= BUFFER_HIGH)
+    {
+        t += COST_BLOCK;
+        r->blocks++;
+        if(++pending == SPU_FEED_BLOCKS)
+        {
+            RingWrite(&ring, pcm, pending * SPU_BLOCK_SAMPLES);
+            pending = 0;
+        }
+    }
+    return t;
+}
+
+static void reg_seen(Result *r, unsigned long long latency)
+{
+    r->reg_latency += latency;
+    if(latency > r->reg_max) r->reg_max = latency;
+    r->reg_waits++;
+}
+
+static void run(Result *r, int regs, unsigned long long length)
+{
+    unsigned long long now = 0, audio_next = AUDIO_PERIOD, reg_next = regs ? 0 : ~0ull, worker_next = 0;
+    unsigned long long low_time = 0, reg_time = 0, run_start = 0;
+    int sleeping = 0, busy = 0, low_pending = 0, reg_pending = 0, flag_low = 0, flag_reg = 0;
+    unsigned int t;
+
+    RingInit(&ring, ringbuf, BUFFER_SIZE);
+    pending = 0;
+    seed = 0x5350;
+    r->min_fill = BUFFER_SIZE;
+
+    while(now < length)
+    {
+        // next thing to happen
+        now = worker_next;
+        if(audio_next < now) now = audio_next;
+        if(reg_next < now) now = reg_next;
+
+        if(now == audio_next)
+        {
+            RingRead(&ring, out, AUDIO_SAMPLES);
+            if(RingFill(&ring) < r->min_fill) r->min_fill = RingFill(&ring);
+            if(r->mode != FIXED && RingFill(&ring) <= BUFFER_HIGH)
+            {
+                if(!low_pending) low_time = now;
+                low_pending = 1;
+                flag_low = 1;
+                if(sleeping) worker_next = now;
+            }
+            audio_next += AUDIO_PERIOD;
+            continue;
+        }
+
+        if(now == reg_next)
+        {
+            r->regs++;
+            if(busy && now + COST_UPDATE < worker_next)
+            {
+                // still mixing: the next block's checks see it
+                reg_seen(r, COST_BLOCK - (now - run_start) % COST_BLOCK);
+            }
+            else if(!reg_pending) { reg_time = now; reg_pending = 1; }
+            if(r->mode == EVENT || (r->mode == GATED && sleeping))
+            {
+                flag_reg = 1;
+                if(sleeping) worker_next = now;
+            }
+            // bursts of a few writes, then a pause of up to ~4ms
+            reg_next = now + ((rnd() % 4) ? 2 + rnd() % 20 : 500 + rnd() % 3500);
+            continue;
+        }
+
+        // worker is done mixing and waits again
+        if(busy)
+        {
+            busy = 0;
+            if(r->mode == FIXED) worker_next = now + SPU_DELAY;
+            else if(flag_low || flag_reg) worker_next = now;    // set while mixing, the wait returns at once
+            else
+            {
+                sleeping = 1;
+                worker_next = now + SPU_WAIT_TIMEOUT;
+            }
+            continue;
+        }
+
+        // worker wakes up and mixes
+        r->wakeups++;
+        sleeping = 0;
+        busy = 1;
+        now += COST_WAKEUP;
+        run_start = now;
+
+        if(r->mode != FIXED)
+        {
+            if(flag_low) r->low_wakeups++;
+            if(flag_reg) r->reg_wakeups++;
+            if(!flag_low && !flag_reg && r->wakeups > 1) r->timeouts++;
+            flag_low = flag_reg = 0;            // PSP_EVENT_WAITCLEAR
+        }
+        if(low_pending) { r->low_latency += now - low_time; low_pending = 0; }
+        if(reg_pending) { reg_seen(r, now - reg_time); reg_pending = 0; }
+
+        t = spu_update(r);
+        worker_next = now + t;
+        r->busy += t + COST_WAKEUP;
+    }
+
+    r->underruns = ring.underruns;
+}
+
+static void report(Result *r, double sec)
+{
+    printf("%-6s %8.0f wakeups/s %8.0f SPUupdate/s %6.0f blocks/s  cpu %5.1f%%  underruns %u  min fill %u\n",
+           r->name, r->wakeups / sec, r->updates / sec, r->blocks / sec,
+           r->busy / (sec * 1e6) * 100.0, r->underruns, r->min_fill);
+    if(r->mode != FIXED)
+        printf("       wakeups: %u output, %u register, %u timeout; output to worker: avg %.0f us\n",
+               r->low_wakeups, r->reg_wakeups, r->timeouts,
+               r->low_wakeups ? (double)r->low_latency / r->low_wakeups : 0.0);
+    if(r->regs)
+        printf("       register write to worker: avg %.0f us, max %llu us over %u writes\n",
+               r->reg_waits ? (double)r->reg_latency / r->reg_waits : 0.0, r->reg_max, r->regs);
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 60;
+    int regs, failed = 0;
+
+    for(regs = 0; regs < 2; regs++)
+    {
+        Result fixed = { "fixed", FIXED }, gated = { "gated", GATED }, event = { "event", EVENT };
+
+        run(&fixed, regs, seconds * 1000000ull);
+        run(&gated, regs, seconds * 1000000ull);
+        run(&event, regs, seconds * 1000000ull);
+
+        printf("%d s simulated, %s\n", seconds, regs ? "game writing spu registers" : "no register writes");
+        report(&fixed, seconds);
+        report(&gated, seconds);
+        report(&event, seconds);
+
+        failed |= fixed.underruns || gated.underruns || event.underruns;
+        failed |= event.low_wakeups == 0 || event.timeouts != 0 || event.reg_max > COST_WAKEUP + COST_BLOCK;
+    }
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
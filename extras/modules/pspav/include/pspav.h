@@ -2,8 +2,12 @@
 #define PSPAV_H
 
 #include "pspav_entry.h"
+#include "pspav_sched.h"
 
 unsigned char pspavPlayGamePMF(PSPAVEntry* e, PSPAVCallbacks* callbacks, int x, int y);
 void pspavPlayVideoFile(const char* path, PSPAVCallbacks* callbacks);
 
+// counters of the last (or current) PMF/MPS playback, any pointer may be NULL
+void pspavGetStats(PSPAVStats* reader, PSPAVStats* decoder, PSPAVStats* video);
+
 #endif
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <pspmpeg.h>
 #include "pspav_entry.h"
+#include "pspav_sched.h"
 
 enum
 {
@@ -47,6 +48,7 @@ typedef struct VideoThreadData
     SceUID                          m_SemaphoreStart;
     SceUID                          m_SemaphoreWait;
     SceUID                          m_SemaphoreLock;
+    SceUID                          m_SemaphoreFrame;
     SceUID                          m_ThreadID;
 
     ScePVoid                        m_pVideoBuffer[N_VIDEO_BUFFERS];
@@ -62,10 +64,13 @@ typedef struct VideoThreadData
     SceInt32                        m_iHeight;
     SceInt32                        m_iBufferWidth;
 
+    PSPAVStats                      m_Stats;
+
 } VideoThreadData;
 
 typedef struct {
     SceUID                          m_Semaphore;
+    SceUID                          m_SemaphoreSpace;
     SceUID                          m_ThreadID;
 
     SceInt32                        m_StreamSize;
@@ -73,6 +78,8 @@ typedef struct {
     SceInt32                        m_RingbufferPackets;
     SceInt32                        m_Status;
     SceInt32                        m_TotalBytes;
+
+    PSPAVStats                      m_Stats;
 } ReaderThreadData;
 
 typedef struct
@@ -118,6 +125,8 @@ typedef struct {
     SceInt32                        m_iAudioFrameDuration;
     SceInt32                        m_iVideoFrameDuration;
     SceInt32                        m_iLastTimeStamp;
+
+    PSPAVStats                      m_Stats;
 } DecoderThreadData;
 
 extern int retVal;
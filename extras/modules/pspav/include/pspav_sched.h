@@ -0,0 +1,43 @@
+#ifndef PSPAV_SCHED_H
+#define PSPAV_SCHED_H
+
+// no kernel calls behind this header, the threads do the waiting
+
+#ifdef __psp__
+#include <psptypes.h>
+#else
+#include <stdint.h>
+typedef int32_t SceInt32;
+typedef uint32_t SceUInt32;
+typedef uint64_t SceUInt64;
+#endif
+
+#define PSPAV_PACKET_SIZE   2048
+
+// reader puts multiples of 16 packets (32KB), the 0x3C0 packet ring wraps on one of them
+#define PSPAV_READ_ALIGN    16
+#define PSPAV_READ_MIN      64
+#define PSPAV_READ_MAX      128
+
+// longest a blocked thread sleeps before checking for abort (us)
+#define PSPAV_WAIT_TIMEOUT  20000
+
+// video ahead of audio, sleep before checking sync again (us)
+#define PSPAV_SYNC_DELAY    1000
+
+typedef struct
+{
+    SceUInt32 m_Fill;       // ring packets queued, or full video buffers
+    SceUInt32 m_FillMax;
+    SceUInt32 m_Stalls;     // times the thread had to block
+    SceUInt64 m_StallTime;  // us spent blocked
+    SceUInt32 m_Dropped;    // reader: short puts, decoder: frames not queued, video: frames skipped
+} PSPAVStats;
+
+// packets the reader should put now, 0 means wait for the decoder to free space
+SceInt32 ReaderBatchSize(SceInt32 iFreePackets, SceInt32 iPacketsLeft);
+
+void StatsFill(PSPAVStats* S, SceInt32 iFill);
+void StatsStall(PSPAVStats* S, SceUInt32 iStart, SceUInt32 iEnd);
+
+#endif
@@ -347,6 +347,13 @@ exit_reader:
     return 0;
 }
 
+void pspavGetStats(PSPAVStats* reader, PSPAVStats* decoder, PSPAVStats* video)
+{
+    if (reader) memcpy(reader, &Reader.m_Stats, sizeof(PSPAVStats));
+    if (decoder) memcpy(decoder, &Decoder.m_Stats, sizeof(PSPAVStats));
+    if (video) memcpy(video, &Video.m_Stats, sizeof(PSPAVStats));
+}
+
 SceVoid pspavShutdown()
 {
 
@@ -5,10 +5,52 @@ SceInt32 IsRingbufferFull(ReaderThreadData* D)
     int size;
     if (D->m_Status == ReaderThreadData__READER_EOF) return 1;
     size = sceMpegRingbufferAvailableSize(D->m_Ringbuffer);
-    if (size > 0) return 0;
+    // full as far as the reader is concerned, it won't put less than a batch
+    if (ReaderBatchSize(size, (D->m_StreamSize - D->m_TotalBytes) / PSPAV_PACKET_SIZE) > 0) return 0;
     return 1;
 }
 
+static void ReaderSpaceFreed(DecoderThreadData* D)
+{
+    ReaderThreadData* R = D->Reader;
+    SceInt32 iFreePackets = sceMpegRingbufferAvailableSize(R->m_Ringbuffer);
+
+    StatsFill(&D->m_Stats, R->m_RingbufferPackets - iFreePackets);
+
+    // wake the reader once a whole batch fits
+    if (R->m_Status == ReaderThreadData__READER_OK && ReaderBatchSize(iFreePackets, (R->m_StreamSize - R->m_TotalBytes) / PSPAV_PACKET_SIZE) > 0)
+        sceKernelSignalSema(R->m_SemaphoreSpace, 1);
+}
+
+static SceInt32 WaitReader(DecoderThreadData* D)
+{
+    if (!IsRingbufferFull(D->Reader))
+    {
+        if (sceKernelPollSema(D->Reader->m_Semaphore, 1) < 0)
+        {
+            SceUInt32 iStart = sceKernelGetSystemTimeLow();
+            sceKernelWaitSema(D->Reader->m_Semaphore, 1, 0);
+            StatsStall(&D->m_Stats, iStart, sceKernelGetSystemTimeLow());
+        }
+
+        if (D->Reader->m_Status == ReaderThreadData__READER_ABORT) return -1;
+    }
+
+    return 0;
+}
+
+static void AbortReader(DecoderThreadData* D)
+{
+    D->Reader->m_Status = ReaderThreadData__READER_ABORT;
+    sceKernelSignalSema(D->Reader->m_SemaphoreSpace, 1);
+}
+
+static void AbortVideo(DecoderThreadData* D)
+{
+    D->Video->m_iAbort = 1;
+    sceKernelSignalSema(D->Video->m_SemaphoreFrame, 1);
+}
+
 
 int T_Decoder(SceSize _args, void *_argp)
 {
@@ -32,8 +74,8 @@ int T_Decoder(SceSize _args, void *_argp)
             //    break;
         }
         D->Audio->m_iAbort = 1;
-        D->Video->m_iAbort = 1;
-        D->Reader->m_Status = ReaderThreadData__READER_ABORT;
+        AbortVideo(D);
+        AbortReader(D);
         work = 0;
         sceKernelExitThread(0);
         return 0;
@@ -102,11 +144,7 @@ int T_Decoder(SceSize _args, void *_argp)
             if(retVal == D->Reader->m_RingbufferPackets) break;
         }
 
-        if (!IsRingbufferFull(D->Reader))
-        {
-            sceKernelWaitSema(D->Reader->m_Semaphore, 1, 0);
-            if (D->Reader->m_Status == ReaderThreadData__READER_ABORT) break;
-        }
+        if (WaitReader(D) < 0) break;
 
         if (D->Audio->m_iFullBuffers < D->Audio->m_iNumBuffers)
         {
@@ -115,15 +153,12 @@ int T_Decoder(SceSize _args, void *_argp)
             if (retVal != 0)
             {
                 playAudio = 0;
-                if (!IsRingbufferFull(D->Reader))
-                {
-                    sceKernelWaitSema(D->Reader->m_Semaphore, 1, 0);
-
-                    if(D->Reader->m_Status == ReaderThreadData__READER_ABORT) break;
-                }
+                if (WaitReader(D) < 0) break;
             }
             else
             {
+                ReaderSpaceFreed(D);
+
                 playAudio = 1;
                 if (m_iAudioCurrentTimeStamp >= D->m_iLastTimeStamp - D->m_iVideoFrameDuration) break;
 
@@ -161,17 +196,16 @@ int T_Decoder(SceSize _args, void *_argp)
 
                     D->Audio->m_iDecodeBuffer = (D->Audio->m_iDecodeBuffer + 1) % D->Audio->m_iNumBuffers;
                 }
+                else
+                {
+                    D->m_Stats.m_Dropped++;
+                }
 
                 iInitAudio = 0;
             }
         }
 
-        if (!IsRingbufferFull(D->Reader))
-        {
-            sceKernelWaitSema(D->Reader->m_Semaphore, 1, 0);
-
-            if (D->Reader->m_Status == ReaderThreadData__READER_ABORT) break;
-        }
+        if (WaitReader(D) < 0) break;
 
         if (D->Video->m_iFullBuffers < D->Video->m_iNumBuffers)
         {
@@ -180,12 +214,7 @@ int T_Decoder(SceSize _args, void *_argp)
             //printf("sceMpegGetAvcAu: %p\n", retVal);
             if ((SceUInt32)retVal == 0x80618001)
             {
-                if (!IsRingbufferFull(D->Reader))
-                {
-                    sceKernelWaitSema(D->Reader->m_Semaphore, 1, 0);
-
-                    if (D->Reader->m_Status == ReaderThreadData__READER_ABORT) break;
-                }
+                if (WaitReader(D) < 0) break;
             }
             else if (retVal != 0)
             {
@@ -193,6 +222,8 @@ int T_Decoder(SceSize _args, void *_argp)
             }
             else
             {
+                ReaderSpaceFreed(D);
+
                 if (m_iVideoCurrentTimeStamp >= D->m_iLastTimeStamp - D->m_iVideoFrameDuration) break;
 
                 retVal = sceMpegAvcDecode(&D->m_Mpeg, D->m_MpegAuAVC, D->Video->m_iBufferWidth, &D->Video->m_pVideoBuffer[D->Video->m_iPlayBuffer], &iVideoStatus);
@@ -234,18 +265,18 @@ int T_Decoder(SceSize _args, void *_argp)
                     D->Video->m_iFullBuffers++;
 
                     sceKernelSignalSema(D->Video->m_SemaphoreLock, 1);
+                    sceKernelSignalSema(D->Video->m_SemaphoreFrame, 1);
+                }
+                else
+                {
+                    D->m_Stats.m_Dropped++;
                 }
 
                 m_iVideoLastTimeStamp = m_iVideoCurrentTimeStamp;
             }
         }
 
-        if (!IsRingbufferFull(D->Reader))
-        {
-            sceKernelWaitSema(D->Reader->m_Semaphore, 1, 0);
-
-            if(D->Reader->m_Status == ReaderThreadData__READER_ABORT) break;
-        }
+        if (WaitReader(D) < 0) break;
 
     }
 
@@ -254,7 +285,7 @@ int T_Decoder(SceSize _args, void *_argp)
     sceKernelSignalSema(D->Audio->m_SemaphoreStart, 1);
     sceKernelSignalSema(D->Video->m_SemaphoreStart, 1);
 
-    D->Reader->m_Status = ReaderThreadData__READER_ABORT;
+    AbortReader(D);
 
     if (!playAT3 || !work)
         D->Audio->m_iAbort = 1;
@@ -274,9 +305,10 @@ int T_Decoder(SceSize _args, void *_argp)
         D->Video->m_iFullBuffers++;
 
         sceKernelSignalSema(D->Video->m_SemaphoreLock, 1);
+        sceKernelSignalSema(D->Video->m_SemaphoreFrame, 1);
     }
 
-    D->Video->m_iAbort = 1;
+    AbortVideo(D);
 
     sceMpegFlushAllStream(&D->m_Mpeg);
 
@@ -309,6 +341,8 @@ SceInt32 InitDecoder()
     Decoder.m_iVideoFrameDuration = (int)(90000 / 29.97);
     Decoder.m_iLastTimeStamp      = m_iLastTimeStamp;
 
+    memset(&Decoder.m_Stats, 0, sizeof(Decoder.m_Stats));
+
     return 0;
 }
 
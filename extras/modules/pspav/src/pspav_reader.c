@@ -13,54 +13,71 @@ int T_Reader(SceSize _args, void *_argp)
     }
 
     SceInt32 iFreePackets = 0;
-    SceInt32 iFreeLast    = -1;
+    SceInt32 iPacketsLeft = 0;
     SceInt32 iReadPackets = 0;
     SceInt32 iPackets     = 0;
 
     for (;;)
     {
-    
-        iPackets = 0;
 
         if (D->m_Status == ReaderThreadData__READER_ABORT) break;
 
         iFreePackets = sceMpegRingbufferAvailableSize(D->m_Ringbuffer);
-        ////printf("iFreePackets: %p\n", iFreePackets);
-        if (iFreeLast != iFreePackets)
+        if (iFreePackets < 0)
         {
-            iFreeLast = iFreePackets;
+            D->m_Status = ReaderThreadData__READER_ABORT;
+            break;
         }
 
-        if (iFreePackets > 0)
+        StatsFill(&D->m_Stats, D->m_RingbufferPackets - iFreePackets);
+
+        // less than a packet left counts as the end too, it can never be put
+        iPacketsLeft = (D->m_StreamSize - D->m_TotalBytes) / PSPAV_PACKET_SIZE;
+
+        if (iPacketsLeft <= 0 && D->m_Status == ReaderThreadData__READER_OK)
         {
-            iReadPackets = iFreePackets;
+            D->m_Status = ReaderThreadData__READER_EOF;
+            sceKernelSignalSema(D->m_Semaphore, 1);
+        }
 
-            if (D->m_TotalBytes < D->m_StreamSize)
-            {
-                if (iReadPackets > 32) iReadPackets = 32;
+        iReadPackets = 0;
+        if (D->m_Status == ReaderThreadData__READER_OK)
+            iReadPackets = ReaderBatchSize(iFreePackets, iPacketsLeft);
 
-                int iPacketsLeft = (D->m_StreamSize - D->m_TotalBytes) / 2048;
+        if (iReadPackets == 0)
+        {
+            // sleep until the decoder frees a whole batch or tells us to quit
+            if (sceKernelPollSema(D->m_SemaphoreSpace, 1) < 0)
+            {
+                SceUInt32 iTimeout = PSPAV_WAIT_TIMEOUT;
+                SceUInt32 iStart = sceKernelGetSystemTimeLow();
 
-                if (iPacketsLeft < iReadPackets) iReadPackets = iPacketsLeft;
+                sceKernelWaitSema(D->m_SemaphoreSpace, 1, &iTimeout);
 
-                iPackets = sceMpegRingbufferPut(D->m_Ringbuffer, iReadPackets, iFreePackets);
-                ////printf("iPackets: %p\n", iPackets);
-                if (iPackets < 0)
-                {
-                    D->m_Status = ReaderThreadData__READER_ABORT;
-                    break;
-                }
+                if (D->m_Status == ReaderThreadData__READER_OK)
+                    StatsStall(&D->m_Stats, iStart, sceKernelGetSystemTimeLow());
             }
+            continue;
         }
 
-        sceKernelSignalSema(D->m_Semaphore, 1);
+        iPackets = sceMpegRingbufferPut(D->m_Ringbuffer, iReadPackets, iFreePackets);
+        ////printf("iPackets: %p\n", iPackets);
+        if (iPackets < 0)
+        {
+            D->m_Status = ReaderThreadData__READER_ABORT;
+            break;
+        }
+
+        if (iPackets < iReadPackets) D->m_Stats.m_Dropped++;
 
-        if (iPackets > 0) D->m_TotalBytes += iPackets * 2048;
+        D->m_TotalBytes += iPackets * PSPAV_PACKET_SIZE;
 
         if (D->m_TotalBytes >= D->m_StreamSize && D->m_Status != ReaderThreadData__READER_ABORT)
         {
             D->m_Status = ReaderThreadData__READER_EOF;
         }
+
+        sceKernelSignalSema(D->m_Semaphore, 1);
     }
 
     sceKernelSignalSema(D->m_Semaphore, 1);
@@ -82,8 +99,13 @@ SceInt32 InitReader()
     Reader.m_Semaphore = sceKernelCreateSema("reader_sema", 0, 0, 1, NULL);
     if (Reader.m_Semaphore < 0)
     {
-        sceKernelDeleteSema(Reader.m_Semaphore);
-        return -1;
+        goto exit0;
+    }
+
+    Reader.m_SemaphoreSpace = sceKernelCreateSema("reader_space_sema", 0, 0, 1, NULL);
+    if (Reader.m_SemaphoreSpace < 0)
+    {
+        goto exit1;
     }
 
     Reader.m_StreamSize                     = m_MpegStreamSize;
@@ -92,12 +114,22 @@ SceInt32 InitReader()
     Reader.m_Status                         = 0;
     Reader.m_TotalBytes                     = 0;
 
+    memset(&Reader.m_Stats, 0, sizeof(Reader.m_Stats));
+
     return 0;
+
+exit1:
+    sceKernelDeleteSema(Reader.m_Semaphore);
+exit0:
+    sceKernelDeleteThread(Reader.m_ThreadID);
+
+    return -1;
 }
 
 SceInt32 ShutdownReader()
 {
     sceKernelDeleteThread(Reader.m_ThreadID);
     sceKernelDeleteSema(Reader.m_Semaphore);
+    sceKernelDeleteSema(Reader.m_SemaphoreSpace);
     return 0;
 }
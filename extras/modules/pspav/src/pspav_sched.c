@@ -0,0 +1,33 @@
+#include "pspav_sched.h"
+
+SceInt32 ReaderBatchSize(SceInt32 iFreePackets, SceInt32 iPacketsLeft)
+{
+    SceInt32 iPackets;
+
+    if (iFreePackets <= 0 || iPacketsLeft <= 0) return 0;
+
+    // the end of the stream goes in one piece once it fits
+    if (iPacketsLeft <= iFreePackets && iPacketsLeft <= PSPAV_READ_MAX) return iPacketsLeft;
+
+    // wait for room for a proper batch instead of topping up every few packets
+    if (iFreePackets < PSPAV_READ_MIN) return 0;
+
+    iPackets = iFreePackets;
+    if (iPackets > PSPAV_READ_MAX) iPackets = PSPAV_READ_MAX;
+
+    return iPackets - iPackets % PSPAV_READ_ALIGN;
+}
+
+void StatsFill(PSPAVStats* S, SceInt32 iFill)
+{
+    if (iFill < 0) iFill = 0;
+    S->m_Fill = iFill;
+    if (S->m_Fill > S->m_FillMax) S->m_FillMax = S->m_Fill;
+}
+
+void StatsStall(PSPAVStats* S, SceUInt32 iStart, SceUInt32 iEnd)
+{
+    // system time low wraps every ~71 minutes, the difference doesn't care
+    S->m_Stalls++;
+    S->m_StallTime += iEnd - iStart;
+}
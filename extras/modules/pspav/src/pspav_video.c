@@ -69,6 +69,8 @@ int T_Video(SceSize _args, void *_argp)
     {
         if (D->Video->m_iAbort != 0) break;
 
+        StatsFill(&D->Video->m_Stats, D->Video->m_iFullBuffers);
+
         if (D->Video->m_iFullBuffers > 0)
         {
             iSyncStatus = AVSyncStatus(D);
@@ -76,26 +78,33 @@ int T_Video(SceSize _args, void *_argp)
             if (iSyncStatus > 0)
             {
                 if(iSyncStatus == 1) RenderFrame(D);
+                else D->Video->m_Stats.m_Dropped++;
                 sceKernelWaitSema(D->Video->m_SemaphoreLock, 1, 0);
 
                 D->Video->m_iFullBuffers--;
                 sceKernelSignalSema(D->Video->m_SemaphoreLock, 1);
             }
+            else
+            {
+                // video ahead, give the audio thread time to catch up
+                sceKernelDelayThread(PSPAV_SYNC_DELAY);
+            }
         }
-        else
+        else if (sceKernelPollSema(D->Video->m_SemaphoreFrame, 1) < 0)
         {
-            if (playAT3 || !playAudio)
-                sceKernelDelayThread(10000);
-            else
-                sceKernelDelayThread(0);
+            // sleep until the decoder queues a frame or aborts
+            SceUInt32 iTimeout = PSPAV_WAIT_TIMEOUT;
+            SceUInt32 iStart = sceKernelGetSystemTimeLow();
+
+            sceKernelWaitSema(D->Video->m_SemaphoreFrame, 1, &iTimeout);
+
+            StatsStall(&D->Video->m_Stats, iStart, sceKernelGetSystemTimeLow());
         }
 
         sceKernelSignalSema(D->Video->m_SemaphoreWait, 1);
 
         if (playAT3 || !playAudio)
             sceKernelDelayThread(10000);
-        else
-            sceKernelDelayThread(0);
     }
 
     while (D->Video->m_iFullBuffers > 0)
@@ -110,8 +119,6 @@ int T_Video(SceSize _args, void *_argp)
 
         if (playAT3 || !playAudio)
             sceKernelDelayThread(10000);
-        else
-            sceKernelDelayThread(0);
     }
 
     sceKernelExitThread(0);
@@ -146,6 +153,12 @@ SceInt32 InitVideo()
         goto exit2;
     }
 
+    Video.m_SemaphoreFrame = sceKernelCreateSema("video_frame_sema", 0, 0, 1, NULL);
+    if (Video.m_SemaphoreFrame < 0)
+    {
+        goto exit3;
+    }
+
     Video.m_iBufferTimeStamp[0]  = 0;
     Video.m_iBufferTimeStamp[1]  = 0;
     Video.m_iNumBuffers = N_VIDEO_BUFFERS;
@@ -153,6 +166,8 @@ SceInt32 InitVideo()
     Video.m_iPlayBuffer          = 0;
     Video.m_iAbort               = 0;
 
+    memset(&Video.m_Stats, 0, sizeof(Video.m_Stats));
+
     // not sure how to get these, hardcoded for now
     if (entry){
         Video.m_iWidth               = IMAGE_W;
@@ -174,6 +189,8 @@ SceInt32 InitVideo()
 
     return 0;
 
+exit3:
+    sceKernelDeleteSema(Video.m_SemaphoreLock);
 exit2:
     sceKernelDeleteSema(Video.m_SemaphoreWait);
 exit1:
@@ -190,6 +207,7 @@ SceInt32 ShutdownVideo()
     sceKernelDeleteSema(Video.m_SemaphoreStart);
     sceKernelDeleteSema(Video.m_SemaphoreWait);
     sceKernelDeleteSema(Video.m_SemaphoreLock);
+    sceKernelDeleteSema(Video.m_SemaphoreFrame);
     
     for (int i=0; i<N_VIDEO_BUFFERS; i++){
         av_callbacks->freeTexture(image[i]);
@@ -0,0 +1,339 @@
+/*
+    host simulation of the pspav reader thread (pspav_reader.c)
+
+    Runs the real T_Reader and pspav_sched.c on a pthread, pinned to one
+    core like the PSP, with pthread stand-ins for the semaphores and a
+    model of the MPEG ring:
+    - sceMpegRingbufferPut sleeps 150us plus 2us per packet, a memory
+      stick read
+    - the decoder side follows pspav_decoder.c: it takes an access unit
+      of 8-40 packets every frame period, waits on the reader when the
+      ring can't be filled, and wakes it once a whole batch fits
+    and reports what the reader costs and how late the frames come.
+
+    The costs are assumptions to make the numbers concrete, not PSP
+    measurements; pspavGetStats() gives the real figures.
+
+    readersim [-o] [frames]     500 frames at 500/s by default; -o makes
+                                the stream size not a multiple of 2048.
+                                fails unless the whole stream gets put,
+                                the reader reaches EOF and it quits on
+                                abort
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+#include "pspav_common.h"
+#include "pspav_reader.h"
+
+#define FRAME_PERIOD 2000       // us
+#define RING_PACKETS 0x3C0
+
+ReaderThreadData Reader;
+unsigned char playAV = 1;
+SceInt32 m_MpegStreamSize;
+SceInt32 m_RingbufferPackets = RING_PACKETS;
+SceMpegRingbuffer m_Ringbuffer;
+
+////////////////////////////////////////////////////////////////////////
+// kernel stand-ins
+////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    pthread_mutex_t m_Mutex;
+    pthread_cond_t m_Cond;
+    int m_Count, m_Max;
+} Sema;
+
+static Sema semas[4];
+static int num_semas;
+static pthread_t reader_thread;
+static int reader_exited;
+
+static SceUInt64 now_us(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000ull + t.tv_nsec / 1000;
+}
+
+SceUInt32 sceKernelGetSystemTimeLow(void)
+{
+    return (SceUInt32)now_us();
+}
+
+SceUID sceKernelCreateThread(const char *name, int (*entry)(SceSize, void *), int prio, int stack, SceUInt32 attr, void *opt)
+{
+    return 1;
+}
+
+int sceKernelDeleteThread(SceUID thid)
+{
+    return 0;
+}
+
+int sceKernelExitThread(int status)
+{
+    __atomic_store_n(&reader_exited, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+SceUID sceKernelCreateSema(const char *name, SceUInt32 attr, int init, int max, void *opt)
+{
+    Sema *s = &semas[num_semas];
+
+    pthread_mutex_init(&s->m_Mutex, NULL);
+    pthread_cond_init(&s->m_Cond, NULL);
+    s->m_Count = init;
+    s->m_Max = max;
+    return num_semas++;
+}
+
+int sceKernelDeleteSema(SceUID semaid)
+{
+    return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal)
+{
+    Sema *s = &semas[semaid];
+
+    pthread_mutex_lock(&s->m_Mutex);
+    if (s->m_Count + signal <= s->m_Max) s->m_Count += signal;
+    pthread_cond_signal(&s->m_Cond);
+    pthread_mutex_unlock(&s->m_Mutex);
+    return 0;
+}
+
+int sceKernelPollSema(SceUID semaid, int signal)
+{
+    Sema *s = &semas[semaid];
+    int res = -1;
+
+    pthread_mutex_lock(&s->m_Mutex);
+    if (s->m_Count >= signal)
+    {
+        s->m_Count -= signal;
+        res = 0;
+    }
+    pthread_mutex_unlock(&s->m_Mutex);
+    return res;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt32 *timeout)
+{
+    Sema *s = &semas[semaid];
+    struct timespec t;
+    int res = 0;
+
+    clock_gettime(CLOCK_REALTIME, &t);
+    if (timeout)
+    {
+        t.tv_nsec += (long)*timeout * 1000;
+        t.tv_sec += t.tv_nsec / 1000000000;
+        t.tv_nsec %= 1000000000;
+    }
+
+    pthread_mutex_lock(&s->m_Mutex);
+    while (s->m_Count < signal)
+    {
+        if (!timeout)
+            pthread_cond_wait(&s->m_Cond, &s->m_Mutex);
+        else if (pthread_cond_timedwait(&s->m_Cond, &s->m_Mutex, &t) == ETIMEDOUT)
+        {
+            res = -1;
+            break;
+        }
+    }
+    if (res == 0) s->m_Count -= signal;
+    pthread_mutex_unlock(&s->m_Mutex);
+    return res;
+}
+
+////////////////////////////////////////////////////////////////////////
+// the ring: the reader puts, the decoder below takes
+////////////////////////////////////////////////////////////////////////
+
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static int ring_used, ring_puts, ring_put_packets, ring_queries;
+
+SceInt32 sceMpegRingbufferAvailableSize(SceMpegRingbuffer *Ringbuffer)
+{
+    int iFree;
+
+    pthread_mutex_lock(&ring_lock);
+    iFree = RING_PACKETS - ring_used;
+    ring_queries++;
+    pthread_mutex_unlock(&ring_lock);
+    return iFree;
+}
+
+SceInt32 sceMpegRingbufferPut(SceMpegRingbuffer *Ringbuffer, SceInt32 iNumPackets, SceInt32 iAvailable)
+{
+    struct timespec t = { 0, (150 + 2 * iNumPackets) * 1000 };
+
+    nanosleep(&t, NULL);
+
+    pthread_mutex_lock(&ring_lock);
+    ring_used += iNumPackets;
+    ring_puts++;
+    ring_put_packets += iNumPackets;
+    pthread_mutex_unlock(&ring_lock);
+    return iNumPackets;
+}
+
+////////////////////////////////////////////////////////////////////////
+// decoder side, as pspav_decoder.c does it
+////////////////////////////////////////////////////////////////////////
+
+static SceInt32 PacketsLeft(void)
+{
+    return (Reader.m_StreamSize - Reader.m_TotalBytes) / PSPAV_PACKET_SIZE;
+}
+
+static int IsRingbufferFull(void)
+{
+    if (Reader.m_Status == ReaderThreadData__READER_EOF) return 1;
+    return ReaderBatchSize(sceMpegRingbufferAvailableSize(&m_Ringbuffer), PacketsLeft()) == 0;
+}
+
+static void WaitReader(void)
+{
+    if (!IsRingbufferFull() && sceKernelPollSema(Reader.m_Semaphore, 1) < 0)
+        sceKernelWaitSema(Reader.m_Semaphore, 1, 0);
+}
+
+static void ReaderSpaceFreed(void)
+{
+    if (Reader.m_Status == ReaderThreadData__READER_OK && ReaderBatchSize(sceMpegRingbufferAvailableSize(&m_Ringbuffer), PacketsLeft()) > 0)
+        sceKernelSignalSema(Reader.m_SemaphoreSpace, 1);
+}
+
+static void *reader_main(void *arg)
+{
+    ReaderThreadData *D = &Reader;
+
+    T_Reader(sizeof(D), &D);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = 500, odd = 0, late = 0, underruns = 0, consumed = 0, failed = 0;
+    int i, stream_packets;
+    SceUInt64 start, deadline, wall, abort_time;
+    clockid_t reader_clock;
+    struct timespec cpu;
+    cpu_set_t cpus;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-o")) odd = 1;
+        else frames = atoi(argv[i]);
+    }
+
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+
+    srand(7);
+    stream_packets = 24 * frames;
+    m_MpegStreamSize = PSPAV_PACKET_SIZE * stream_packets + (odd ? 100 : 0);
+
+    InitReader();
+    pthread_create(&reader_thread, NULL, reader_main, NULL);
+    pthread_getcpuclockid(reader_thread, &reader_clock);
+
+    // let the ring fill before the first frame
+    start = now_us();
+    deadline = start + 100000;
+
+    for (i = 0; i < frames; i++)
+    {
+        int au = 8 + rand() % 33;
+
+        // the decoder idles in 1us delays until the frame is due
+        while (now_us() < deadline)
+        {
+            struct timespec t = { 0, 1000 };
+            nanosleep(&t, NULL);
+            WaitReader();
+        }
+
+        if (now_us() > deadline + FRAME_PERIOD / 2) late++;
+
+        for (;;)
+        {
+            int ok;
+
+            pthread_mutex_lock(&ring_lock);
+            ok = ring_used >= au || Reader.m_Status != ReaderThreadData__READER_OK;
+            if (ok)
+            {
+                if (au > ring_used) au = ring_used;
+                ring_used -= au;
+                consumed += au;
+            }
+            pthread_mutex_unlock(&ring_lock);
+
+            if (ok) break;
+
+            underruns++;
+            WaitReader();
+        }
+
+        ReaderSpaceFreed();
+        deadline += FRAME_PERIOD;
+    }
+
+    wall = now_us() - start;
+    clock_gettime(reader_clock, &cpu);
+
+    if (Reader.m_Status != ReaderThreadData__READER_EOF)
+    {
+        printf("  reader status %d after the last frame, wanted EOF\n", Reader.m_Status);
+        failed = 1;
+    }
+
+    if (ring_put_packets != stream_packets)
+    {
+        printf("  %d packets put, the stream has %d\n", ring_put_packets, stream_packets);
+        failed = 1;
+    }
+
+    abort_time = now_us();
+    Reader.m_Status = ReaderThreadData__READER_ABORT;
+    sceKernelSignalSema(Reader.m_SemaphoreSpace, 1);
+
+    while (!__atomic_load_n(&reader_exited, __ATOMIC_SEQ_CST) && now_us() - abort_time < 2 * PSPAV_WAIT_TIMEOUT)
+        sched_yield();
+
+    if (!__atomic_load_n(&reader_exited, __ATOMIC_SEQ_CST))
+    {
+        printf("  reader still running %d us after abort\n", 2 * PSPAV_WAIT_TIMEOUT);
+        failed = 1;
+    }
+    else
+    {
+        printf("reader quit %llu us after abort\n", (unsigned long long)(now_us() - abort_time));
+        pthread_join(reader_thread, NULL);
+    }
+
+    printf("%d frames in %.2f s: reader cpu %.1f%%, %d puts of %.1f packets, %d ring size queries\n",
+           frames, wall / 1e6, 100.0 * (cpu.tv_sec + cpu.tv_nsec / 1e9) / (wall / 1e6),
+           ring_puts, ring_puts ? (double)ring_put_packets / ring_puts : 0.0, ring_queries);
+    printf("%d underruns, %d frames late by half a period, %d packets consumed\n", underruns, late, consumed);
+    printf("reader stats: peak fill %u, %u stalls, %.1f ms stalled, %u short puts\n",
+           Reader.m_Stats.m_FillMax, Reader.m_Stats.m_Stalls, Reader.m_Stats.m_StallTime / 1e3, Reader.m_Stats.m_Dropped);
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
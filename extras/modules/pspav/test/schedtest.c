@@ -0,0 +1,85 @@
+/*
+    host test for the reader batch policy and the thread counters
+    (pspav_sched.c)
+
+    - ReaderBatchSize: nothing until a batch fits, batches of 64-128
+      packets in steps of 16, the end of the stream in one piece
+    - every free/left combination the 0x3C0 packet ring can see stays
+      within both and keeps the alignment
+    - StatsFill clamps and tracks the peak, StatsStall survives the
+      system time wrapping
+
+    schedtest       runs the checks
+*/
+
+#include <stdio.h>
+
+#include "pspav_sched.h"
+
+static int failed;
+
+static void expect_batch(SceInt32 iFree, SceInt32 iLeft, SceInt32 iWant)
+{
+    SceInt32 iGot = ReaderBatchSize(iFree, iLeft);
+
+    if (iGot != iWant)
+    {
+        printf("  ReaderBatchSize(%d, %d) = %d, wanted %d\n", iFree, iLeft, iGot, iWant);
+        failed = 1;
+    }
+}
+
+int main(void)
+{
+    PSPAVStats S = { 0 };
+    SceInt32 iFree, iLeft;
+
+    expect_batch(0, 100, 0);
+    expect_batch(-5, 100, 0);
+    expect_batch(100, 0, 0);
+    expect_batch(63, 1000, 0);
+    expect_batch(64, 1000, 64);
+    expect_batch(79, 1000, 64);
+    expect_batch(100, 1000, 96);
+    expect_batch(960, 1000, 128);
+    expect_batch(100, 37, 37);
+    expect_batch(10, 7, 7);
+    expect_batch(10, 11, 0);
+    expect_batch(960, 200, 128);
+    expect_batch(150, 129, 128);
+
+    for (iFree = 0; iFree <= 0x3C0; iFree++)
+    {
+        for (iLeft = 0; iLeft <= 2000; iLeft++)
+        {
+            SceInt32 n = ReaderBatchSize(iFree, iLeft);
+
+            if (n < 0 || n > iFree || n > iLeft || n > PSPAV_READ_MAX || (n != iLeft && n % PSPAV_READ_ALIGN != 0))
+            {
+                printf("  ReaderBatchSize(%d, %d) = %d\n", iFree, iLeft, n);
+                failed = 1;
+                iFree = 0x3C0;
+                break;
+            }
+        }
+    }
+
+    StatsFill(&S, 5);
+    StatsFill(&S, 3);
+    StatsFill(&S, -1);
+    if (S.m_Fill != 0 || S.m_FillMax != 5)
+    {
+        printf("  StatsFill: fill %u max %u\n", S.m_Fill, S.m_FillMax);
+        failed = 1;
+    }
+
+    StatsStall(&S, 0xFFFFFF00u, 0x100);
+    if (S.m_StallTime != 0x200 || S.m_Stalls != 1)
+    {
+        printf("  StatsStall across the wrap: %llu us in %u stalls\n", (unsigned long long)S.m_StallTime, S.m_Stalls);
+        failed = 1;
+    }
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
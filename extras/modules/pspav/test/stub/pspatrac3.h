@@ -0,0 +1,6 @@
+#ifndef PSPATRAC3_H
+#define PSPATRAC3_H
+
+#include <psptypes.h>
+
+#endif
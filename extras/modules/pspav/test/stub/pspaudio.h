@@ -0,0 +1,6 @@
+#ifndef PSPAUDIO_H
+#define PSPAUDIO_H
+
+#include <psptypes.h>
+
+#endif
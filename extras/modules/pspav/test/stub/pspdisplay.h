@@ -0,0 +1,6 @@
+#ifndef PSPDISPLAY_H
+#define PSPDISPLAY_H
+
+#include <psptypes.h>
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef PSPGE_H
+#define PSPGE_H
+
+#include <psptypes.h>
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef PSPGU_H
+#define PSPGU_H
+
+#include <psptypes.h>
+
+#endif
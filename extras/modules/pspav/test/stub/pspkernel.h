@@ -0,0 +1,20 @@
+#ifndef PSPKERNEL_H
+#define PSPKERNEL_H
+
+#include <psptypes.h>
+
+#define PSP_THREAD_ATTR_USER 0x80000000
+
+SceUID sceKernelCreateThread(const char *name, int (*entry)(SceSize, void *), int prio, int stack, SceUInt32 attr, void *opt);
+int sceKernelDeleteThread(SceUID thid);
+int sceKernelExitThread(int status);
+
+SceUID sceKernelCreateSema(const char *name, SceUInt32 attr, int init, int max, void *opt);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelSignalSema(SceUID semaid, int signal);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt32 *timeout);
+int sceKernelPollSema(SceUID semaid, int signal);
+
+SceUInt32 sceKernelGetSystemTimeLow(void);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef PSPMPEG_H
+#define PSPMPEG_H
+
+#include <psptypes.h>
+
+typedef ScePVoid SceMpeg;
+typedef void SceMpegStream;
+
+typedef struct
+{
+    SceInt32 iPackets;
+    SceUInt32 iUnk[10];
+} SceMpegRingbuffer;
+
+typedef struct
+{
+    SceUInt32 iPtsMSB, iPts, iDtsMSB, iDts, iEsBuffer, iAuSize;
+} SceMpegAu;
+
+typedef struct
+{
+    SceInt32 iUnk0;
+    SceInt32 iPixelFormat;
+} SceMpegAvcMode;
+
+SceInt32 sceMpegRingbufferAvailableSize(SceMpegRingbuffer *Ringbuffer);
+SceInt32 sceMpegRingbufferPut(SceMpegRingbuffer *Ringbuffer, SceInt32 iNumPackets, SceInt32 iAvailable);
+
+#endif
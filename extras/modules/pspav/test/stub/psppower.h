@@ -0,0 +1,6 @@
+#ifndef PSPPOWER_H
+#define PSPPOWER_H
+
+#include <psptypes.h>
+
+#endif
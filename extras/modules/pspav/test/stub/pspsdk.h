@@ -0,0 +1,6 @@
+#ifndef PSPSDK_H
+#define PSPSDK_H
+
+#include <psptypes.h>
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef PSPTYPES_H
+#define PSPTYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t SceInt32;
+typedef uint32_t SceUInt32;
+typedef uint64_t SceUInt64;
+typedef int64_t SceOff;
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef void * ScePVoid;
+
+#endif
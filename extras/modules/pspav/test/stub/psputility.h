@@ -0,0 +1,6 @@
+#ifndef PSPUTILITY_H
+#define PSPUTILITY_H
+
+#include <psptypes.h>
+
+#endif
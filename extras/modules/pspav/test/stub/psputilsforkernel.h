@@ -0,0 +1,6 @@
+#ifndef PSPUTILSFORKERNEL_H
+#define PSPUTILSFORKERNEL_H
+
+#include <psptypes.h>
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef LANG_H
+#define LANG_H
+
+#include <stddef.h>
+#include <psptypes.h>
+
+#define LANG_TABLE_SIZE 256 // power of two, at least twice MAX_LANG_STRINGS
+
+typedef struct{
+    const char* key;
+    u32 hash;
+    wchar_t* text; // translation, already UTF-16
+    wchar_t* def; // shown when there is no translation
+    u16 text_len; // in bytes, terminator included
+    u16 def_len;
+} LangString;
+
+// register a translatable string, def == NULL shows the key itself
+void langAdd(const char* key, const char* def);
+
+// drop the translations, every string shows its default
+void langClear();
+
+// replace the translations with the ones in a lang_*.json file
+void langLoad(char* buf, int size);
+
+// copy the text of key into dest (size in bytes), NULL if key isn't translatable
+wchar_t* langGetText(const char* key, wchar_t* dest, int size);
+
+LangString* langFind(const char* key);
+
+#endif
@@ -140,4 +140,14 @@ int vctrlVSHExitVshMenu(void *conf);
 
 int vctrlVSHExitVSHMenu(void *conf, char *videoiso, int disctype);
 
+// registry hook traffic since the module started
+typedef struct
+{
+    u32 lookups;    // findConfigSlot calls
+    u32 writes;     // settings or plugins changed from the menu
+    u32 saves;      // files actually written by flushSettings
+} XmbConfigStats;
+
+void xmbctrlGetConfigStats(XmbConfigStats *stats);
+
 #endif
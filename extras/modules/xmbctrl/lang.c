@@ -0,0 +1,141 @@
+/*
+    Translation table: translatable strings hashed by key, with the
+    translated text kept in UTF-16 so a lookup is one probe and one copy.
+*/
+
+#include <pspsdk.h>
+#include <pspkernel.h>
+
+#include "include/main.h"
+#include "include/utils.h"
+#include "include/settings.h"
+#include "include/lang.h"
+
+static LangString lang_table[LANG_TABLE_SIZE];
+
+// FNV-1a of the string up to the first quote or control character
+static u32 langHash(const char* s, int* len)
+{
+    u32 h = 0x811C9DC5;
+    int i = 0;
+    while ((u8)s[i] >= 0x20 && s[i] != '"')
+    {
+        h ^= (u8)s[i++];
+        h *= 0x01000193;
+    }
+    if (len) *len = i;
+    return h;
+}
+
+static LangString* langProbe(const char* key, int len, u32 hash)
+{
+    u32 i = hash & (LANG_TABLE_SIZE-1);
+    while (lang_table[i].key)
+    {
+        LangString* s = &lang_table[i];
+        if (s->hash == hash && sce_paf_private_strncmp(s->key, key, len) == 0 && s->key[len] == 0)
+            return s;
+        i = (i+1) & (LANG_TABLE_SIZE-1);
+    }
+    return &lang_table[i];
+}
+
+static wchar_t* langEncode(char* text, u16* len)
+{
+    wchar_t* w = sce_paf_private_malloc((sce_paf_private_strlen(text)+1) * sizeof(wchar_t));
+    if (w) *len = utf8_to_unicode(w, text) * sizeof(wchar_t);
+    return w;
+}
+
+void langAdd(const char* key, const char* def)
+{
+    int len;
+    u32 hash = langHash(key, &len);
+    LangString* s = langProbe(key, len, hash);
+
+    if (s->key) return; // options share "Disabled", "Enabled"...
+
+    s->key = key;
+    s->hash = hash;
+    s->def = langEncode((char*)((def)? def : key), &s->def_len);
+}
+
+LangString* langFind(const char* key)
+{
+    int len;
+    u32 hash = langHash(key, &len);
+    if (key[len]) return NULL; // keys never hold quotes
+    LangString* s = langProbe(key, len, hash);
+    return (s->key)? s : NULL;
+}
+
+wchar_t* langGetText(const char* key, wchar_t* dest, int size)
+{
+    LangString* s = langFind(key);
+    if (!s) return NULL;
+
+    wchar_t* text = (s->text)? s->text : s->def;
+    int len = (s->text)? s->text_len : s->def_len;
+    if (!text) return NULL;
+    if (len > size) len = size;
+
+    sce_paf_private_memcpy(dest, text, len);
+    dest[len/sizeof(wchar_t) - 1] = 0;
+
+    return dest;
+}
+
+void langClear()
+{
+    int i;
+    for (i=0; i<LANG_TABLE_SIZE; i++)
+    {
+        sce_paf_private_free(lang_table[i].text);
+        lang_table[i].text = NULL;
+        lang_table[i].text_len = 0;
+    }
+}
+
+void langLoad(char* buf, int size)
+{
+    char* end = buf + size;
+
+    langClear();
+
+    // one "key": "value" per line
+    while (buf < end)
+    {
+        char* line = buf;
+        while (buf < end && (u8)*buf >= 0x20) buf++;
+        char* eol = buf;
+        while (buf < end && (u8)*buf < 0x20) buf++;
+
+        char* key = line;
+        while (key < eol && *key != '"') key++;
+        if (key++ >= eol) continue;
+
+        int len;
+        u32 hash = langHash(key, &len);
+        if (key + len >= eol) continue;
+
+        LangString* s = langProbe(key, len, hash);
+        if (!s->key) continue;
+
+        char* value = key + len + 1;
+        while (value < eol && *value != ':') value++;
+        while (value < eol && *value != '"') value++;
+        if (value++ >= eol) continue;
+
+        // the value ends at the last quote of the line
+        char* vend = eol;
+        while (vend > value && vend[-1] != '"') vend--;
+        if (vend > value) vend--;
+        else vend = eol;
+
+        char saved = *vend;
+        *vend = 0;
+        sce_paf_private_free(s->text);
+        s->text = langEncode(value, &s->text_len);
+        *vend = saved;
+    }
+}
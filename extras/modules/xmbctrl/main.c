@@ -37,6 +37,7 @@
 #include "list.h"
 #include "settings.h"
 #include "plugins.h"
+#include "lang.h"
 
 PSP_MODULE_INFO("XmbControl", 0x0007, 1, 5);
 
@@ -191,13 +192,6 @@ struct {
 
 #define N_ITEMS (sizeof(GetItemes) / sizeof(GetItem))
 
-typedef struct {
-    char* orig;
-    char* translated;
-} StringContainer;
-StringContainer language_strings[MAX_LANG_STRINGS];
-int n_translated = 0;
-
 #define N_STRINGS ((sizeof(string) / sizeof(char **)))
 
 int count = 0;
@@ -219,6 +213,8 @@ void (* OnInitMenuPspConfig)();
 extern int readLine(char* source, char *str);
 extern int utf8_to_unicode(wchar_t *dest, char *src);
 
+void flushSettings();
+
 u32 sysconf_unk, sysconf_option;
 
 int is_cfw_config = 0;
@@ -391,60 +387,22 @@ SceOff findPkgOffset(const char* filename, unsigned* size, const char* pkgpath){
 }
 
 static void findAllTranslatableStrings(){
-    sce_paf_private_memset(language_strings, 0, sizeof(language_strings));
-    n_translated = 0;
-
-    language_strings[n_translated++].orig = "xmbmsg_system_update";
-    language_strings[n_translated++].orig = "xmbmsgtop_sysconf_configuration";
-    language_strings[n_translated++].orig = "xmbmsgtop_sysconf_plugins";
-    language_strings[n_translated++].orig = "xmbmsgtop_custom_launcher";
-    language_strings[n_translated++].orig = "xmbmsgtop_custom_app";
-    language_strings[n_translated++].orig = "xmbmsgtop_150_reboot";
+    langAdd("xmbmsg_system_update", "ARK-4 Updater");
+    langAdd("xmbmsgtop_sysconf_configuration", "Custom Firmware Settings");
+    langAdd("xmbmsgtop_sysconf_plugins", "Plugins Manager");
+    langAdd("xmbmsgtop_custom_launcher", "Custom Launcher");
+    langAdd("xmbmsgtop_custom_app", "Custom App");
+    langAdd("xmbmsgtop_150_reboot", "Reboot to 1.50 ARK");
     
     for (int i=0; i<NELEMS(GetItemes); i++){
-        language_strings[n_translated++].orig = GetItemes[i].item;
+        langAdd(GetItemes[i].item, NULL);
     }
 
     for (int i=0; i<NELEMS(item_opts); i++){
         for (int j=0; j<item_opts[i].n; j++){
-            language_strings[n_translated++].orig = item_opts[i].c[j];
-        }
-    }
-}
-
-static int findTranslatableStringIndex(char* line){
-    char* txt_start = sce_paf_private_strchr(line, '"');
-    if (!txt_start) return -1;
-    for (int i=0; i<n_translated; i++){
-        char* item = language_strings[i].orig;
-        if (sce_paf_private_strcmp(line, item) == 0) return i;
-        char* sub = strstr(line, item);
-        if (sub == NULL) continue;
-        int l = sce_paf_private_strlen(item);
-        if (sub == txt_start+1 && sub[l] == '"')
-            return i;
-    }
-    return -1;
-}
-
-static char* findTranslation(char* text){
-    for (int i=0; i<n_translated; i++)
-    {
-        if (sce_paf_private_strcmp(text, language_strings[i].orig) == 0){
-            return language_strings[i].translated;
+            langAdd(item_opts[i].c[j], NULL);
         }
     }
-    return NULL;
-}
-
-static int isTranslatableString(char* text){
-    for (int i=0; i<n_translated; i++)
-    {
-        if (sce_paf_private_strcmp(text, language_strings[i].orig) == 0){
-            return 1;
-        }
-    }
-    return 0;
 }
 
 int LoadTextLanguage(int new_id)
@@ -459,11 +417,6 @@ int LoadTextLanguage(int new_id)
         id = new_id;
     }
 
-    for (int i=0; i<n_translated; i++){
-        sce_paf_private_free(language_strings[i].translated);
-        language_strings[i].translated = NULL;
-    }
-
     SceUID fd = -1;
     SceOff offset = 0;
     unsigned size = 0;
@@ -481,7 +434,10 @@ int LoadTextLanguage(int new_id)
         fd = sceIoOpen(pkgpath, PSP_O_RDONLY, 0);
     }
 
-    if(fd < 0) return 0;
+    if(fd < 0){
+        langClear();
+        return 0;
+    }
 
     u8* buf = sce_paf_private_malloc(size+1);
     sceIoLseek(fd, offset, PSP_SEEK_SET);
@@ -490,49 +446,14 @@ int LoadTextLanguage(int new_id)
     buf[size] = 0;
     
 
-    int counter = 0;
-    char line[LINE_BUFFER_SIZE];
-    int buf_pos = 0;
-
     // Skip UTF8 magic
+    int buf_pos = 0;
     u32 magic = *(u32*)buf;
     if ((magic & 0xFFFFFF) == 0xBFBBEF){
         buf_pos = 3;
     }
 
-    while (counter < n_translated)
-    {
-        if (buf_pos >= size) break;
-
-        int n_read = readLine(buf+buf_pos, line);
-        buf_pos += n_read;
-
-        if (n_read == 0) break;
-        if (sce_paf_private_strchr(line, '"') == NULL) continue;
-
-        char* sep = NULL;
-        int text_idx = findTranslatableStringIndex(line);
-
-        if (text_idx>=0){
-            char* aux = language_strings[text_idx].orig;
-            sep = sce_paf_private_strchr(sce_paf_private_strchr(line, '"')+sce_paf_private_strlen(aux)+1, ':');
-            if (!sep) continue;
-        }
-        else continue;
-
-        char* start = sce_paf_private_strchr(sep, '"');
-        if (!start) continue;
-
-        char* translated = sce_paf_private_malloc(strlen(start+1)+1);
-        sce_paf_private_strcpy(translated, start+1);
-
-        char* ending = sce_paf_private_strrchr(translated, '"');
-        if (ending) *ending = 0;
-
-        language_strings[text_idx].translated = translated;
-        counter++;
-
-    }
+    langLoad((char*)buf+buf_pos, size-buf_pos);
 
     sce_paf_private_free(buf);
 
@@ -636,6 +557,7 @@ int OnXmbPushPatched(void *arg0, void *arg1)
 {
     xmb_arg0 = arg0;
     xmb_arg1 = arg1;
+    flushSettings();
     return OnXmbPush(arg0, arg1);
 }
 
@@ -677,6 +599,7 @@ int ExecuteActionPatched(int action, int action_arg)
     }
     if(old_is_cfw_config != is_cfw_config)
     {
+        flushSettings();
         sce_paf_private_memset(backup, 0, sizeof(backup));
         context_mode = 0;
 
@@ -688,6 +611,9 @@ int ExecuteActionPatched(int action, int action_arg)
 
 int UnloadModulePatched(int skip)
 {
+    // leaving a settings page
+    flushSettings();
+
     if(unload)
     {
         skip = -1;
@@ -755,6 +681,7 @@ void OnInitMenuPspConfigPatched()
     {
         if(((u32 *)sysconf_option)[2] == 0)
         {
+            flushSettings(); // don't reload over pending changes
             loadSettings();
             int i;
             for(i = 0; i < N_ITEMS; i++)
@@ -771,6 +698,7 @@ void OnInitMenuPspConfigPatched()
     else if (is_cfw_config == 2){
         if(((u32 *)sysconf_option)[2] == 0)
         {
+            flushSettings();
             loadPlugins();
             for (int i=0; i<plugins.count; i++){
                 Plugin* plugin = (Plugin*)(plugins.table[i]);
@@ -786,19 +714,111 @@ void OnInitMenuPspConfigPatched()
     }
 }
 
+// config value of each GetItemes entry
+static int *config_values[] =
+{
+    &config.usbcharge,
+    &config.clock_game,
+    &config.clock_vsh,
+    &config.wpa2,
+    &config.launcher,
+    &config.highmem,
+    &config.mscache,
+    &config.infernocache,
+    &config.disablepause,
+    &config.oldplugin,
+    &config.hibblock,
+    &config.skiplogos,
+    &config.hidepics,
+    &config.hidemac,
+    &config.hidedlc,
+    &config.noled,
+    &config.noumd,
+    &config.noanalog,
+    &config.umdregion,
+    &config.vshregion,
+    &config.qaflags,
+};
+
+// GetItemes slot + 1 by name hash, 0 is empty
+#define CONFIG_INDEX_SIZE 64
+static u8 config_index[CONFIG_INDEX_SIZE];
+
+// settings changed since the last write, saved once the page is left
+static int settings_dirty = 0;
+static int plugins_dirty = 0;
+
+static XmbConfigStats config_stats;
+
+static u32 configHash(const char *name)
+{
+    u32 h = 0x811C9DC5;
+    while (*name)
+    {
+        h ^= (u8)*name++;
+        h *= 0x01000193;
+    }
+    return h;
+}
+
+static void buildConfigIndex()
+{
+    for (int i=0; i<N_ITEMS; i++)
+    {
+        u32 h = configHash(GetItemes[i].item) & (CONFIG_INDEX_SIZE-1);
+        while (config_index[h]) h = (h+1) & (CONFIG_INDEX_SIZE-1);
+        config_index[h] = i+1;
+    }
+}
+
+static int findConfigSlot(char *name)
+{
+    u32 h = configHash(name) & (CONFIG_INDEX_SIZE-1);
+
+    config_stats.lookups++;
+
+    while (config_index[h])
+    {
+        int i = config_index[h]-1;
+        // sysconf hands back our own regkey pointer
+        if (name == GetItemes[i].item || sce_paf_private_strcmp(name, GetItemes[i].item) == 0)
+            return i;
+        h = (h+1) & (CONFIG_INDEX_SIZE-1);
+    }
+    return -1;
+}
+
+void flushSettings()
+{
+    if (settings_dirty)
+    {
+        saveSettings();
+        settings_dirty = 0;
+        config_stats.saves++;
+    }
+    if (plugins_dirty)
+    {
+        savePlugins();
+        plugins_dirty = 0;
+        config_stats.saves++;
+    }
+}
+
+void xmbctrlGetConfigStats(XmbConfigStats *stats)
+{
+    sce_paf_private_memcpy(stats, &config_stats, sizeof(XmbConfigStats));
+}
+
 SceSysconfItem *GetSysconfItemPatched(void *a0, void *a1)
 {
     SceSysconfItem *item = GetSysconfItem(a0, a1);
 
     if(is_cfw_config == 1)
     {
-        int i;
-        for(i = 0; i < N_ITEMS; i++)
+        int i = findConfigSlot(item->text);
+        if (i >= 0)
         {
-            if(sce_paf_private_strcmp(item->text, GetItemes[i].item) == 0)
-            {
-                context_mode = GetItemes[i].mode;
-            }
+            context_mode = GetItemes[i].mode;
         }
     }
     else if (is_cfw_config == 2){
@@ -813,25 +833,9 @@ wchar_t *scePafGetTextPatched(void *a0, char *name)
     {
         if(is_cfw_config == 1 || sce_paf_private_strncmp(name, "xmbmsg", 6)==0)
         {
-            char* translated = findTranslation(name);
-            if (!translated){
-                if(sce_paf_private_strcmp(name, "xmbmsgtop_sysconf_configuration") == 0)
-                    translated = "Custom Firmware Settings";
-                else if(sce_paf_private_strcmp(name, "xmbmsgtop_sysconf_plugins") == 0)
-                    translated = "Plugins Manager";
-                else if(sce_paf_private_strcmp(name, "xmbmsgtop_custom_launcher") == 0)
-                    translated = "Custom Launcher";
-                else if(sce_paf_private_strcmp(name, "xmbmsgtop_custom_app") == 0)
-                    translated = "Custom App";
-                else if(sce_paf_private_strcmp(name, "xmbmsgtop_150_reboot") == 0)
-                    translated = "Reboot to 1.50 ARK";
-                else if (isTranslatableString(name))
-                    translated = name; // should have been translated but wasn't
-            }
-            if (translated){
-                utf8_to_unicode((wchar_t *)user_buffer, translated);
-                return (wchar_t *)user_buffer;
-            }
+            // untranslated strings fall back to their english text
+            wchar_t* text = langGetText(name, (wchar_t *)user_buffer, sizeof(user_buffer));
+            if (text) return text;
         }
         else if (is_cfw_config == 2){
             if(sce_paf_private_strncmp(name, "plugin_", 7) == 0){
@@ -878,10 +882,7 @@ wchar_t *scePafGetTextPatched(void *a0, char *name)
         }
         else if(sce_paf_private_strcmp(name, "msg_system_update") == 0 && se_config.custom_update)
         {
-            char* translated = findTranslation("xmbmsg_system_update");
-            if (!translated) translated = "ARK-4 Updater";
-            utf8_to_unicode((wchar_t *)user_buffer, translated);
-        	return (wchar_t *)user_buffer;
+            return langGetText("xmbmsg_system_update", (wchar_t *)user_buffer, sizeof(user_buffer));
         }
     }
 
@@ -895,42 +896,13 @@ int vshGetRegistryValuePatched(u32 *option, char *name, void *arg2, int size, in
 
         if(is_cfw_config == 1)
         {
-            int configs[] =
-            {
-                config.usbcharge,        
-                config.clock_game,        
-                config.clock_vsh, 
-                config.wpa2,           
-                config.launcher,        
-                config.highmem,        	
-                config.mscache,        	
-                config.infernocache,   
-                config.disablepause,     
-                config.oldplugin,        
-                config.hibblock,    
-                config.skiplogos,        
-                config.hidepics,         	
-                config.hidemac,         
-                config.hidedlc,        	
-                config.noled,        	
-                config.noumd,        	
-                config.noanalog,
-                config.umdregion,
-                config.vshregion,  
-                config.qaflags,            
-            };
-            
-            int i;
-            for(i = 0; i < N_ITEMS; i++)
+            int i = findConfigSlot(name);
+            if (i >= 0)
             {
-                if(sce_paf_private_strcmp(name, GetItemes[i].item) == 0)
-                {
-                    context_mode = GetItemes[i].mode;
-                    *value = configs[i];
-                    return 0;
-                }
+                context_mode = GetItemes[i].mode;
+                *value = *config_values[i];
+                return 0;
             }
-
         }
         else if (is_cfw_config == 2){
             if(sce_paf_private_strncmp(name, "plugin_", 7) == 0)
@@ -955,41 +927,14 @@ int vshSetRegistryValuePatched(u32 *option, char *name, int size, int *value)
     {
         if(is_cfw_config == 1)
         {
-            static int *configs[] =
+            int i = findConfigSlot(name);
+            if (i >= 0)
             {
-                &config.usbcharge,
-                &config.clock_game,
-                &config.clock_vsh,
-                &config.wpa2,
-                &config.launcher,
-                &config.highmem,
-                &config.mscache,
-                &config.infernocache,
-                &config.disablepause,
-                &config.oldplugin,
-                &config.hibblock,
-                &config.skiplogos,
-                &config.hidepics,
-                &config.hidemac,
-                &config.hidedlc,
-                &config.noled,
-                &config.noumd,
-                &config.noanalog,
-                &config.umdregion,
-                &config.vshregion,
-                &config.qaflags,
-            };
-            
-            int i;
-            for(i = 0; i < N_ITEMS; i++)
-            {
-                if(sce_paf_private_strcmp(name, GetItemes[i].item) == 0)
-                {
-                    *configs[i] = GetItemes[i].negative ? !(*value) : *value;
-                    saveSettings();
-                    if (i == UMD_REGION && config.umdregion) recreate_umd_keys();
-                    return 0;
-                }
+                *config_values[i] = GetItemes[i].negative ? !(*value) : *value;
+                settings_dirty = 1;
+                config_stats.writes++;
+                if (i == UMD_REGION && config.umdregion) recreate_umd_keys();
+                return 0;
             }
         }
         else if (is_cfw_config == 2){
@@ -999,8 +944,10 @@ int vshSetRegistryValuePatched(u32 *option, char *name, int size, int *value)
                 Plugin* plugin = (Plugin*)(plugins.table[i]);
         		context_mode = PLUGINS_CONTEXT;
         		plugin->active = *value;
-                savePlugins();
+                plugins_dirty = 1;
+                config_stats.writes++;
                 if (*value == PLUGIN_REMOVED){
+                    flushSettings();
                     sctrlKernelExitVSH(NULL);
                 }
                 return 0;
@@ -1045,12 +992,11 @@ void HijackContext(SceRcoEntry *src, char **options, int n)
         int i;
         for(i = 0; i < n; i++)
         {
-            char* opt = options[i];
-            char* translated = findTranslation(opt);
             sce_paf_private_memcpy(item, base, base->next_entry);
 
+            // resolved through the translation table
             item_param[0] = 0xDEAD;
-            item_param[1] = (u32)((translated)? translated : opt);
+            item_param[1] = (u32)options[i];
 
             if(i != 0) item->prev_entry = item->next_entry;
             if(i == n - 1) item->next_entry = 0;
@@ -1093,7 +1039,8 @@ int PAF_Resource_ResolveRefWString_Patched(void *resource, u32 *data, int *a2, c
 {
     if(data[0] == 0xDEAD)
     {
-        utf8_to_unicode((wchar_t *)user_buffer, (char *)data[1]);
+        if (!langGetText((char *)data[1], (wchar_t *)user_buffer, sizeof(user_buffer)))
+            utf8_to_unicode((wchar_t *)user_buffer, (char *)data[1]);
         *(wchar_t **)string = (wchar_t *)user_buffer;
         return 0;
     }
@@ -1289,6 +1236,7 @@ int module_start(SceSize args, void *argp)
     sctrlArkGetConfig(&_arkconf);
 
     findAllTranslatableStrings();
+    buildConfigIndex();
     
     previous = sctrlHENSetStartModuleHandler(OnModuleStart);
 
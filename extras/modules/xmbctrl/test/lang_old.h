@@ -0,0 +1,146 @@
+/*
+    the translation lookup main.c did before lang.c, kept as the
+    reference for langtest: a strstr scan of the json for every string
+    and a strcmp scan of the strings for every lookup
+*/
+
+typedef struct {
+    char* orig;
+    char* translated;
+} StringContainer;
+
+static StringContainer language_strings[MAX_LANG_STRINGS];
+static int n_translated = 0;
+
+// xmbmsg_system_update was only ever asked for by the msg_system_update path
+static const char* old_defaults[][2] = {
+    {"xmbmsg_system_update", "ARK-4 Updater"},
+    {"xmbmsgtop_sysconf_configuration", "Custom Firmware Settings"},
+    {"xmbmsgtop_sysconf_plugins", "Plugins Manager"},
+    {"xmbmsgtop_custom_launcher", "Custom Launcher"},
+    {"xmbmsgtop_custom_app", "Custom App"},
+    {"xmbmsgtop_150_reboot", "Reboot to 1.50 ARK"},
+};
+
+static int readLine(char* source, char *str)
+{
+    u8 ch = 0;
+    int n = 0;
+    int i = 0;
+    while(1)
+    {
+        if( (ch = source[i]) == 0){
+            *str = 0;
+            return n;
+        }
+        n++; i++;
+        if(ch < 0x20)
+        {
+            *str = 0;
+            return n;
+        }
+        else
+        {
+            *str++ = ch;
+        }
+    }
+}
+
+static int findTranslatableStringIndex(char* line){
+    char* txt_start = strchr(line, '"');
+    if (!txt_start) return -1;
+    for (int i=0; i<n_translated; i++){
+        char* item = language_strings[i].orig;
+        if (strcmp(line, item) == 0) return i;
+        char* sub = strstr(line, item);
+        if (sub == NULL) continue;
+        int l = strlen(item);
+        if (sub == txt_start+1 && sub[l] == '"')
+            return i;
+    }
+    return -1;
+}
+
+static void oldClear(void)
+{
+    for (int i=0; i<n_translated; i++){
+        free(language_strings[i].translated);
+        language_strings[i].translated = NULL;
+    }
+}
+
+static void oldLoad(char* buf, int size)
+{
+    int counter = 0;
+    char line[LINE_BUFFER_SIZE];
+    int buf_pos = 0;
+
+    oldClear();
+
+    while (counter < n_translated)
+    {
+        if (buf_pos >= size) break;
+
+        int n_read = readLine(buf+buf_pos, line);
+        buf_pos += n_read;
+
+        if (n_read == 0) break;
+        if (strchr(line, '"') == NULL) continue;
+
+        char* sep = NULL;
+        int text_idx = findTranslatableStringIndex(line);
+
+        if (text_idx>=0){
+            char* aux = language_strings[text_idx].orig;
+            sep = strchr(strchr(line, '"')+strlen(aux)+1, ':');
+            if (!sep) continue;
+        }
+        else continue;
+
+        char* start = strchr(sep, '"');
+        if (!start) continue;
+
+        char* translated = malloc(strlen(start+1)+1);
+        strcpy(translated, start+1);
+
+        char* ending = strrchr(translated, '"');
+        if (ending) *ending = 0;
+
+        language_strings[text_idx].translated = translated;
+        counter++;
+    }
+}
+
+// what scePafGetTextPatched returned for name, NULL when it fell through to the XMB
+static wchar_t* oldGetText(char* name, wchar_t* dest)
+{
+    char* text = NULL;
+    int i;
+
+    for (i=0; i<n_translated; i++){
+        if (strcmp(name, language_strings[i].orig) == 0){
+            text = language_strings[i].translated;
+            break;
+        }
+    }
+    if (!text){
+        for (i=0; i<NELEMS(old_defaults); i++){
+            if (strcmp(name, old_defaults[i][0]) == 0){
+                text = (char*)old_defaults[i][1];
+                break;
+            }
+        }
+    }
+    if (!text){
+        for (i=0; i<n_translated; i++){
+            if (strcmp(name, language_strings[i].orig) == 0){
+                text = name;
+                break;
+            }
+        }
+    }
+    if (!text) return NULL;
+
+    utf8_to_unicode(dest, text);
+    return dest;
+}
@@ -0,0 +1,215 @@
+/*
+    host test for the xmbctrl translation table (lang.c)
+
+    Registers the strings main.c registers (keys.h is cut out of ../main.c
+    by the Makefile) in lang.c and in the strstr/strcmp lookup main.c used
+    before, loads every lang_*.json with both and checks that every key and
+    a few names that aren't translatable come out the same. Built with
+    -fshort-wchar so wchar_t is 16 bits like on the PSP.
+
+    langtest [dir]      dir defaults to arkMenu's translations
+    langtest -b [dir]   load and lookup time, old and new
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <time.h>
+#include <pspsdk.h>
+
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../include/settings.h"
+#include "../include/lang.h"
+
+#define NELEMS(a) (sizeof(a) / sizeof(a[0]))
+
+typedef struct
+{
+    int mode;
+    int negative;
+    char *item;
+} GetItem;
+
+#include "keys.h"
+#include "lang_old.h"
+
+#define LANG_DIR "../../../menus/arkMenu/themes/translations/resources"
+#define MAX_QUERIES 256
+
+////////////////////////////////////////////////////////////////////////
+// the paf string functions main.h declares
+////////////////////////////////////////////////////////////////////////
+
+void *sce_paf_private_memcpy(void *d, void *s, int n) { return memcpy(d, s, n); }
+int sce_paf_private_strlen(char *s) { return strlen(s); }
+int sce_paf_private_strncmp(const char *a, const char *b, int n) { return strncmp(a, b, n); }
+int sce_paf_private_strtoul(const char *s, char **end, int base) { return strtoul(s, end, base); }
+void *sce_paf_private_malloc(int size) { return malloc(size); }
+void sce_paf_private_free(void *p) { free(p); }
+
+////////////////////////////////////////////////////////////////////////
+
+static char* queries[MAX_QUERIES];
+static int n_queries;
+
+static void addString(const char* key, const char* def)
+{
+    int i;
+    for (i=0; i<n_translated; i++)
+        if (strcmp(language_strings[i].orig, key) == 0) break;
+    if (i == n_translated) language_strings[n_translated++].orig = (char*)key;
+    langAdd(key, def);
+}
+
+// same order as findAllTranslatableStrings
+static void registerStrings(void)
+{
+    static char* others[] = {
+        "msgtop_sysconf_console", "msg_system_update", "xmbmsg_unknown", "msg_theme",
+        "msgshare_ok", "msg_bgm", "Autoboot", "usb charge", "Enabled ", "",
+    };
+    int i, j;
+
+    for (i=0; i<NELEMS(old_defaults); i++)
+        addString(old_defaults[i][0], old_defaults[i][1]);
+    for (i=0; i<NELEMS(GetItemes); i++)
+        addString(GetItemes[i].item, NULL);
+    for (i=0; i<NELEMS(item_opts); i++)
+        for (j=0; j<item_opts[i].n; j++)
+            addString(item_opts[i].c[j], NULL);
+
+    for (i=0; i<n_translated; i++) queries[n_queries++] = language_strings[i].orig;
+    for (i=0; i<NELEMS(others); i++) queries[n_queries++] = others[i];
+}
+
+static int wlen(wchar_t* s)
+{
+    int n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+// every query must give the same text (or none) both ways
+static int compareAll(const char* file)
+{
+    wchar_t a[512], b[512];
+    int i, failed = 0;
+
+    for (i=0; i<n_queries; i++){
+        wchar_t* ra = oldGetText(queries[i], a);
+        wchar_t* rb = langGetText(queries[i], b, sizeof(b));
+        if (!ra != !rb || (ra && (wlen(ra) != wlen(rb) || memcmp(ra, rb, wlen(ra) * sizeof(wchar_t))))){
+            printf("%s: \"%s\" differs\n", file, queries[i]);
+            failed = 1;
+        }
+    }
+
+    // the copy is clamped to the caller's buffer and terminated
+    for (i=0; i<n_queries; i++){
+        wchar_t small[8];
+        wchar_t* ra = oldGetText(queries[i], a);
+        wchar_t* rb = langGetText(queries[i], small, sizeof(small));
+        if (ra && (wlen(rb) != (wlen(ra) < 7 ? wlen(ra) : 7) || memcmp(ra, rb, wlen(rb) * sizeof(wchar_t)))){
+            printf("%s: \"%s\" not clamped\n", file, queries[i]);
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
+
+static char* readFile(const char* path, int* size)
+{
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char* buf = malloc(*size + 1);
+    *size = fread(buf, 1, *size, fp);
+    buf[*size] = 0;
+    fclose(fp);
+    return buf;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    int bench = (argc > 1 && strcmp(argv[1], "-b") == 0);
+    const char* dir = (argc > 1 + bench) ? argv[1 + bench] : LANG_DIR;
+    double load_old = 0, load_new = 0, get_old = 0, get_new = 0;
+    long lookups = 0;
+    int files = 0, failed = 0;
+    struct dirent* e;
+
+    registerStrings();
+
+    // no language file: every string shows its default
+    langClear();
+    oldClear();
+    failed |= compareAll("no file");
+
+    DIR* d = opendir(dir);
+    if (d == NULL){
+        printf("can't open %s\n", dir);
+        return 1;
+    }
+
+    while ((e = readdir(d))){
+        char path[512];
+        int size, i, r;
+
+        if (strncmp(e->d_name, "lang_", 5) || !strstr(e->d_name, ".json")) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+
+        char* buf = readFile(path, &size);
+        if (buf == NULL) continue;
+
+        // skip UTF8 magic like LoadTextLanguage
+        int pos = ((*(u32*)buf & 0xFFFFFF) == 0xBFBBEF) ? 3 : 0;
+
+        oldLoad(buf + pos, size - pos);
+        langLoad(buf + pos, size - pos);
+        failed |= compareAll(e->d_name);
+        files++;
+
+        if (bench){
+            wchar_t out[128];
+            double t0 = now();
+            for (r=0; r<20; r++) oldLoad(buf + pos, size - pos);
+            double t1 = now();
+            for (r=0; r<20; r++) langLoad(buf + pos, size - pos);
+            double t2 = now();
+            for (r=0; r<20000; r++) for (i=0; i<n_queries; i++) oldGetText(queries[i], out);
+            double t3 = now();
+            for (r=0; r<20000; r++) for (i=0; i<n_queries; i++) langGetText(queries[i], out, sizeof(out));
+            double t4 = now();
+            load_old += (t1 - t0) / 20;
+            load_new += (t2 - t1) / 20;
+            get_old += t3 - t2;
+            get_new += t4 - t3;
+            lookups += 20000L * n_queries;
+        }
+
+        free(buf);
+    }
+    closedir(d);
+
+    printf("%d files, %d strings, %d names looked up\n", files, n_translated, n_queries);
+    if (bench && files){
+        printf("load:   old %.1f us, new %.1f us per file\n", load_old / files * 1e6, load_new / files * 1e6);
+        printf("lookup: old %.1f ns, new %.1f ns\n", get_old / lookups * 1e9, get_new / lookups * 1e9);
+    }
+
+    if (files == 0) failed = 1;
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
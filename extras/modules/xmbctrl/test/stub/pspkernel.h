@@ -0,0 +1,6 @@
+#ifndef PSPKERNEL_H
+#define PSPKERNEL_H
+
+#include <psptypes.h>
+
+#endif
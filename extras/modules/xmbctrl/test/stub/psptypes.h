@@ -0,0 +1,11 @@
+#ifndef PSPTYPES_H
+#define PSPTYPES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+#endif
@@ -21,11 +21,22 @@ char filename[256], filename2[256];
 
 MsFatFile thefile; // Only opened file
 
+#define FAT_CACHE_SIZE 4 // FAT sectors kept around, power of two
+
+static u8 fat_cache[FAT_CACHE_SIZE][0x200];
+static u32 fat_cache_sector[FAT_CACHE_SIZE];
+
+#ifdef FAT_DEBUG
+static u32 sectors_read, fat_hits, fat_misses;
+#endif
+
 int MsFatReadLogicalSector(int sector, void *buf)
 {
     int res = pspMsReadSector(boot_sector+sector, buf);
 
 #ifdef FAT_DEBUG
+    sectors_read++;
+
     if (res < 0)
     {
         printf("Hardware error.\n");
@@ -35,52 +46,82 @@ int MsFatReadLogicalSector(int sector, void *buf)
     return res;
 }
 
+// Sector of the FAT, read once for all the clusters it describes
+static u8 *MsFatGetFatSector(u32 sector)
+{
+    int i = sector & (FAT_CACHE_SIZE-1);
+
+    if (fat_cache_sector[i] == sector)
+    {
+#ifdef FAT_DEBUG
+        fat_hits++;
+#endif
+        return fat_cache[i];
+    }
+
+#ifdef FAT_DEBUG
+    fat_misses++;
+#endif
+
+    if (MsFatReadLogicalSector(first_fat_sector + sector, fat_cache[i]) < 0)
+    {
+        fat_cache_sector[i] = 0xFFFFFFFF;
+        return NULL;
+    }
+
+    fat_cache_sector[i] = sector;
+    return fat_cache[i];
+}
+
+static int MsFatGetFatByte(u32 offset)
+{
+    u8 *buf = MsFatGetFatSector(offset / 0x200);
+
+    return (buf)? buf[offset % 0x200] : -1;
+}
+
 u32 MsFatGetNextCluster(u32 cluster)
 {
-    u32    nextcluster = 0, offset, local_offset;
+    u32    nextcluster = 0, offset;
+    u8 *buf;
+    int lo, hi;
     
     switch (fat_type)
     {
         case FAT_TYPE_12:
         	offset = cluster + (cluster / 2);
-        	local_offset = offset % 0x200;
-        
-        	MsFatReadLogicalSector(first_fat_sector + (offset / 0x200), sector_buf);
+
+        	// The 12 bit entry may straddle two sectors
+        	lo = MsFatGetFatByte(offset);
+        	hi = MsFatGetFatByte(offset + 1);
+
+        	if (lo < 0 || hi < 0)
+        		return 0;
 
         	if (cluster & 1)
         	{
-        		nextcluster = (sector_buf[local_offset] & 0x0F) << 8;
-
-        		if (local_offset == 0x1FF)
-        		{
-        			// Special case, read another sector
-        			MsFatReadLogicalSector(first_fat_sector + (offset / 0x200) + 1, sector_buf);
-        			nextcluster |= sector_buf[0];
-        		}
-        		else
-        		{
-        			nextcluster |= sector_buf[local_offset+1];
-        		}
+        		nextcluster = (lo >> 4) | (hi << 4);
         	}
-
         	else
         	{
-        		nextcluster = (sector_buf[local_offset]<<4) | (sector_buf[local_offset+1]>>4);
-        	}			
+        		nextcluster = lo | ((hi & 0x0F) << 8);
+        	}
 
         break;
     
         case FAT_TYPE_16:
 
-        	MsFatReadLogicalSector(first_fat_sector + ((cluster * 2) / 0x200), sector_buf);
-        	nextcluster = *(u16 *)&sector_buf[(cluster * 2) % 0x200];
+        	buf = MsFatGetFatSector((cluster * 2) / 0x200);
+        	if (buf)
+        		nextcluster = *(u16 *)&buf[(cluster * 2) % 0x200];
 
         break;
     
         case FAT_TYPE_32:
 
-        	MsFatReadLogicalSector(first_fat_sector + ((cluster * 4) / 0x200), sector_buf);			
-        	nextcluster = *(u32 *)&sector_buf[(cluster * 4) % 0x200];
+        	buf = MsFatGetFatSector((cluster * 4) / 0x200);
+        	if (buf)
+        		nextcluster = *(u32 *)&buf[(cluster * 4) % 0x200];
         
         break;		
     }
@@ -100,6 +141,8 @@ int MsFatMount()
     
     pspMsInit();
 
+    memset(fat_cache_sector, 0xFF, sizeof(fat_cache_sector));
+
     if (pspMsReadSector(0, sector_buf) < 0)
     {
         return -1;
@@ -208,7 +251,8 @@ static void MsFatFillFileStruct(u8 *entry, MsFatFile *file)
         file->cur_cluster |= ((*(u16 *)&entry[0x14]) << 16);
     }
     
-    file->cur_sector = 0;    
+    file->cur_sector = 0;
+    file->cur_offset = 0;
 }
 
 int MsFatFindFile(u32 dir_cluster, char *filename, int rootcase, MsFatFile *file)
@@ -433,43 +477,57 @@ int MsFatOpen(char *path)
 
 int MsFatRead(void *buf, u32 size)
 {
-    u32 remaining = size, sector;
+    u32 remaining = size, sector, done;
     int read = 0;
     u8 *p = buf;
 
-    if (thefile.remaining_bytes == 0)
-        return 0;
+    while (remaining > 0 && thefile.remaining_bytes > 0)
+    {
+        sector = ((thefile.cur_cluster - 2) * sec_per_cluster) + first_data_sector + thefile.cur_sector;
 
-    sector = ((thefile.cur_cluster - 2) * sec_per_cluster) + first_data_sector + thefile.cur_sector;
+        if (thefile.cur_offset == 0 && remaining >= 0x200 && thefile.remaining_bytes >= 0x200)
+        {
+        	// Whole sector, straight into buf
+        	if (MsFatReadLogicalSector(sector, p) < 0)
+        		break;
 
-    while (remaining > 0)
-    {
-        if (thefile.remaining_bytes < 0x200)
+        	done = 0x200;
+        }
+        else
         {
-        	if (MsFatReadLogicalSector(sector, sector_buf) < 0)
-        		return read;
+        	// Part of a sector goes through sector_buf, which keeps the rest
+        	// of it for the next read
+        	if (thefile.cur_offset == 0 && MsFatReadLogicalSector(sector, sector_buf) < 0)
+        		break;
 
-        	memcpy(p, sector_buf, thefile.remaining_bytes);
-        	read += thefile.remaining_bytes;
+        	done = 0x200 - thefile.cur_offset;
 
-        	thefile.remaining_bytes = 0;
-        	break;
+        	if (done > remaining)
+        		done = remaining;
+
+        	if (done > thefile.remaining_bytes)
+        		done = thefile.remaining_bytes;
+
+        	memcpy(p, sector_buf + thefile.cur_offset, done);
         }
 
-        if (MsFatReadLogicalSector(sector, p) < 0)
+        read += done;
+        p += done;
+        remaining -= done;
+        thefile.remaining_bytes -= done;
+        thefile.cur_offset += done;
+
+        if (thefile.cur_offset < 0x200)
         	break;
 
-        read += 0x200;
-        p += 0x200;
-        remaining -= 0x200;
-        thefile.remaining_bytes -= 0x200;
+        thefile.cur_offset = 0;
         thefile.cur_sector++;
 
         if (thefile.cur_sector == sec_per_cluster)
         {
         	thefile.cur_sector = 0;
         	thefile.cur_cluster = MsFatGetNextCluster(thefile.cur_cluster);
-        	
+
         	if (!MsFatIsValidCluster(thefile.cur_cluster))
         	{
         		if (thefile.remaining_bytes != 0)
@@ -482,12 +540,6 @@ int MsFatRead(void *buf, u32 size)
 
         		break;
         	}
-        	
-        	sector = ((thefile.cur_cluster - 2) * sec_per_cluster) + first_data_sector;
-        }
-        else
-        {
-        	sector++;
         }
     }
 
@@ -496,7 +548,11 @@ int MsFatRead(void *buf, u32 size)
 
 int MsFatClose()
 {
-    // Implementation not needed
+#ifdef FAT_DEBUG
+    printf("%d sectors read, FAT cache %d hits %d misses.\n", sectors_read, fat_hits, fat_misses);
+#endif
+
+    // Nothing else to release
     return 0;
 }
 
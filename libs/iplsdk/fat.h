@@ -19,10 +19,11 @@ typedef struct
     u32 remaining_bytes;
     u32 cur_cluster;
     u32 cur_sector; // Sector offset within the current cluster
+    u32 cur_offset; // Byte offset within the current sector, the sector is in sector_buf when not 0
 } MsFatFile;
 
 int MsFatMount();
-int MsFatReadLogicalSector();
+int MsFatReadLogicalSector(int sector, void *buf);
 u32 MsFatGetNextCluster(u32 cluster);
 int MsFatIsValidCluster(u32 cluster);
 int MsFatFindFile(u32 dir_cluster, char *filename, int rootcase, MsFatFile *file);
@@ -1,7 +1,6 @@
 #include "lflash.h"
 
 #include <emcsm.h>
-#include <model.h>
 
 #include <stddef.h>
 #include <stdint.h>
@@ -37,6 +36,12 @@ static const SmartMediaProperties g_sm_flash_properties[] = {
 #define EMCSM_NUM_PAGE_PER_BLOCK        	(0x20)
 #define EMCSM_BLOCK_SIZE        			(0x20 * 0x200)
 
+// blocks held back so that scattered sector writes (FAT, directory and
+// file data) land in one rewrite per block instead of one per switch.
+// each one is a whole block plus its spares (~16.5KB), so the four take
+// ~66KB of bss, ~50KB more than the single cached block did
+#define NUM_WRITE_BUFFERS        			(4)
+
 typedef struct
 {
     uint8_t status;
@@ -82,15 +87,27 @@ typedef struct
 
 typedef struct
 {
+    uint8_t block_buffer[EMCSM_BLOCK_SIZE] __attribute__( ( aligned ( 64 ) ) ) ;
+    EmcSmBlockMetadata spare_buffer[EMCSM_NUM_PAGE_PER_BLOCK] __attribute__( ( aligned ( 64 ) ) ) ;
+    size_t cache_lbn, cache_pbn;
+    size_t last_use;
+    size_t first_write; // when the buffer last went from clean to dirty
+    int dirty;
+} WriteBuffer;
+
+typedef struct
+{
+    const LflashBackend *nand;
     size_t page_size;
     size_t pages_per_block;
     const SmartMediaProperties *properties;
     Segment segments[MAX_NUM_SEGMENTS];
     PartitionInfo part_info[MAX_PARTITIONS];
     size_t num_partitions;
-    size_t cache_lbn, cache_pbn;
-    uint8_t block_buffer[EMCSM_BLOCK_SIZE] __attribute__( ( aligned ( 64 ) ) ) ;
-    EmcSmBlockMetadata spare_buffer[EMCSM_NUM_PAGE_PER_BLOCK] __attribute__( ( aligned ( 64 ) ) ) ;
+    WriteBuffer buffers[NUM_WRITE_BUFFERS];
+    size_t use_clock;
+    size_t write_clock;
+    LflashStats stats;
 } FlashTranslationLayer;
 
 enum LflashError read_sector(FlashTranslationLayer *ftl, size_t sector, void *);
@@ -121,10 +138,10 @@ enum LflashError map_emcsm_err(enum EmcSmError res)
     return LFLASH_ERR_EMCSM_ERR;
 }
 
-enum LflashError read_extra_meta(size_t ppn, EmcSmBlockMetadata *meta, size_t num_pages)
+enum LflashError read_extra_meta(FlashTranslationLayer *ftl, size_t ppn, EmcSmBlockMetadata *meta, size_t num_pages)
 {
     EmcSmBlockMetadataWithEcc meta_with_ecc;
-    int res = emcsm_read_extra_only(ppn, &meta_with_ecc, num_pages);
+    int res = ftl->nand->read_extra_only(ppn, &meta_with_ecc, num_pages);
     memcpy(meta, &meta_with_ecc.metadata, sizeof(*meta));
     return map_emcsm_err(emcsm_int_to_err(res));
 }
@@ -163,7 +180,9 @@ void add_block_to_unused_list(FlashTranslationLayer *ftl, Segment *segment, size
         return;
     }
 
-    if (emcsm_erase_block(pbn_to_flash_ppn(ftl, pbn)) < 0) {
+    ftl->stats.erases++;
+
+    if (ftl->nand->erase_block(pbn_to_flash_ppn(ftl, pbn)) < 0) {
         return;
     }
 
@@ -271,15 +290,15 @@ void init_segment(FlashTranslationLayer *ftl, Segment *segment, size_t num)
     segment->unused_blocks.bottom = NULL;
 
     // don't use a scramble for these operations
-    emcsm_set_scramble(0);
+    ftl->nand->set_scramble(0);
 
     for (size_t pbn = segment->pbn_start; pbn < segment->pbn_end; ++pbn) {
-        if (emcsm_is_bad_block((FLASH_AREA_START_BLOCK + pbn) * ftl->pages_per_block)) {
+        if (ftl->nand->is_bad_block((FLASH_AREA_START_BLOCK + pbn) * ftl->pages_per_block)) {
         	continue;
         }
 
         EmcSmBlockMetadata meta;
-        if (read_extra_meta((FLASH_AREA_START_BLOCK + pbn) * ftl->pages_per_block, &meta, 1) < 0) {
+        if (read_extra_meta(ftl, (FLASH_AREA_START_BLOCK + pbn) * ftl->pages_per_block, &meta, 1) < 0) {
         	continue;
         }
 
@@ -303,7 +322,7 @@ void init_segment(FlashTranslationLayer *ftl, Segment *segment, size_t num)
         if (other_pbn != INVALID_PBN) {
         	// TODO: should we ignore errors here?
         	EmcSmBlockMetadata other_meta;
-        	read_extra_meta(pbn_to_flash_ppn(ftl, other_pbn), &other_meta, 1);
+        	read_extra_meta(ftl, pbn_to_flash_ppn(ftl, other_pbn), &other_meta, 1);
 
         	if ((meta.flags & 0x10) == (other_meta.flags & 0x10))
         	{
@@ -330,9 +349,9 @@ void init_segment(FlashTranslationLayer *ftl, Segment *segment, size_t num)
     }
 }
 
-static const SmartMediaProperties *get_properties(void)
+static const SmartMediaProperties *get_properties(const LflashBackend *nand)
 {
-    if (model_get_identity()->model == PSP_MODEL_01G) {
+    if (nand->is_01g) {
         return &g_sm_flash_properties[0];
     }
     else {
@@ -340,14 +359,24 @@ static const SmartMediaProperties *get_properties(void)
     }
 }
 
-void init_ftl(FlashTranslationLayer *ftl)
+void init_ftl(FlashTranslationLayer *ftl, const LflashBackend *nand)
 {
     // TODO: derive this from somewhere? held assumption?
+    ftl->nand = nand;
     ftl->page_size = 0x200;
     ftl->pages_per_block = 32;
-    ftl->properties = get_properties();
-    ftl->cache_lbn = INVALID_LBN;
-    ftl->cache_pbn = INVALID_PBN;
+    ftl->properties = get_properties(nand);
+    ftl->use_clock = 0;
+    ftl->write_clock = 0;
+    memset(&ftl->stats, 0, sizeof(ftl->stats));
+
+    for (size_t i = 0; i < NUM_WRITE_BUFFERS; ++i) {
+        ftl->buffers[i].cache_lbn = INVALID_LBN;
+        ftl->buffers[i].cache_pbn = INVALID_PBN;
+        ftl->buffers[i].last_use = 0;
+        ftl->buffers[i].first_write = 0;
+        ftl->buffers[i].dirty = 0;
+    }
 
     for (size_t i = 0; i < ftl->properties->num_segments; ++i) {
         init_segment(ftl, &ftl->segments[i], i);
@@ -364,7 +393,7 @@ static uint32_t bitwise_rotate32(uint32_t value, int shift)
 static void gen_partition_scrambles(FlashTranslationLayer *ftl, PartitionInfo *part_info, size_t part_num)
 {
     // TODO: implement
-    uint32_t fuse_id[2] = { *(volatile uint32_t *)0xBC100090, *(volatile uint32_t *)0xBC100094 };
+    const uint32_t *fuse_id = ftl->nand->fuse_id;
     uint32_t rotate1 = (part_num * 3) % 32;
     uint32_t rotate2 = (32 - (part_num * 2)) % 32;
 
@@ -500,21 +529,34 @@ uint32_t read_scramble(FlashTranslationLayer *ftl, size_t sector)
     return 0;
 }
 
+static WriteBuffer *find_write_buffer(FlashTranslationLayer *ftl, size_t lbn)
+{
+    for (size_t i = 0; i < NUM_WRITE_BUFFERS; ++i) {
+        if (ftl->buffers[i].cache_lbn == lbn) {
+        	return &ftl->buffers[i];
+        }
+    }
+
+    return NULL;
+}
+
 enum LflashError read_sector(FlashTranslationLayer *ftl, size_t sector, void *buff)
 {
-    enum LflashError err = sync_write(ftl);
+    // sectors still waiting in a write buffer are newer than the flash
+    WriteBuffer *wb = find_write_buffer(ftl, lpn_to_lbn(ftl, sector));
 
-    if (err != LFLASH_ERR_NONE) {
-        return err;
+    if (wb) {
+        memcpy(buff, wb->block_buffer + (sector % ftl->pages_per_block) * ftl->page_size, ftl->page_size);
+        return LFLASH_ERR_NONE;
     }
 
     size_t pbn = lbn_to_pbn(ftl, lpn_to_lbn(ftl, sector));
     size_t ppn = pbn_to_flash_ppn(ftl, pbn) + (sector % ftl->pages_per_block);
 
     uint32_t scramble = read_scramble(ftl, sector);
-    emcsm_set_scramble(scramble);
+    ftl->nand->set_scramble(scramble);
 
-    int res = emcsm_read_pages(ppn, buff, NULL, 1);
+    int res = ftl->nand->read_pages(ppn, buff, NULL, 1);
 
     if (res < 0) {
         return map_emcsm_err(emcsm_int_to_err(res));
@@ -523,13 +565,13 @@ enum LflashError read_sector(FlashTranslationLayer *ftl, size_t sector, void *bu
     return LFLASH_ERR_NONE;
 }
 
-enum LflashError read_pbn_spare_data(FlashTranslationLayer *ftl, size_t pbn, uint32_t scramble)
+enum LflashError read_pbn_spare_data(FlashTranslationLayer *ftl, WriteBuffer *wb, size_t pbn, uint32_t scramble)
 {
-    if (scramble) {
-        emcsm_set_scramble(scramble);
-    }
+    // the previous flush may have left another partition's scramble behind
+    ftl->nand->set_scramble(scramble);
+    ftl->stats.block_reads++;
 
-    int res = emcsm_read_block_with_retry(pbn_to_flash_ppn(ftl, pbn), ftl->block_buffer, ftl->spare_buffer);
+    int res = ftl->nand->read_block_with_retry(pbn_to_flash_ppn(ftl, pbn), wb->block_buffer, wb->spare_buffer);
     return map_emcsm_err(emcsm_int_to_err(res));
 }
 
@@ -559,16 +601,20 @@ void spare_set_lbn(EmcSmBlockMetadata *spare, size_t lbn)
     spare->lbn[1] = (uint8_t)(lbn);
 }
 
-enum LflashError write_new_block(FlashTranslationLayer *ftl, size_t pbn, size_t lbn)
+enum LflashError write_new_block(FlashTranslationLayer *ftl, WriteBuffer *wb, size_t pbn, size_t lbn)
 {
     for (size_t page = 0; page < ftl->pages_per_block; ++page) {
-        spare_set_active_flag(&ftl->spare_buffer[page]);
-        spare_set_mapped_flag(&ftl->spare_buffer[page]);
-        spare_set_inuse_flag(&ftl->spare_buffer[page]);
-        spare_set_lbn(&ftl->spare_buffer[page], lbn);
+        spare_set_active_flag(&wb->spare_buffer[page]);
+        spare_set_mapped_flag(&wb->spare_buffer[page]);
+        spare_set_inuse_flag(&wb->spare_buffer[page]);
+        spare_set_lbn(&wb->spare_buffer[page], lbn);
     }
 
-    int res = emcsm_write_block_with_verify(pbn_to_flash_ppn(ftl, pbn), ftl->block_buffer, ftl->spare_buffer);
+    // the write erases the block itself before programming it
+    ftl->stats.block_writes++;
+    ftl->stats.erases++;
+
+    int res = ftl->nand->write_block_with_verify(pbn_to_flash_ppn(ftl, pbn), wb->block_buffer, wb->spare_buffer);
 
     if (res < 0) {
         return map_emcsm_err(emcsm_int_to_err(res));
@@ -577,23 +623,37 @@ enum LflashError write_new_block(FlashTranslationLayer *ftl, size_t pbn, size_t
     return LFLASH_ERR_NONE;
 }
 
-enum LflashError sync_write(FlashTranslationLayer *ftl)
+static void release_write_buffer(WriteBuffer *wb)
 {
-    if (ftl->cache_lbn == INVALID_LBN) {
+    wb->cache_lbn = INVALID_LBN;
+    wb->cache_pbn = INVALID_PBN;
+    wb->dirty = 0;
+}
+
+enum LflashError flush_write_buffer(FlashTranslationLayer *ftl, WriteBuffer *wb)
+{
+    if (wb->cache_lbn == INVALID_LBN) {
         return LFLASH_ERR_NONE;
     }
 
-    size_t lbn = ftl->cache_lbn;
-    size_t pbn = ftl->cache_pbn;
+    // every sector written matched the flash, no need to move the block
+    if (!wb->dirty) {
+        ftl->stats.clean_flushes++;
+        release_write_buffer(wb);
+        return LFLASH_ERR_NONE;
+    }
+
+    size_t lbn = wb->cache_lbn;
+    size_t pbn = wb->cache_pbn;
 
     uint32_t scramble = read_scramble(ftl, lbn * ftl->pages_per_block);
-    emcsm_set_scramble(scramble);
+    ftl->nand->set_scramble(scramble);
 
     EmcSmBlockMetadata spare;
     memset(&spare, 0xFF, sizeof(spare));
     spare.flags &= ~0x10;
 
-    int res = emcsm_write_pages_raw_extra(pbn_to_flash_ppn(ftl, pbn), NULL, &spare, 1);
+    int res = ftl->nand->write_pages_raw_extra(pbn_to_flash_ppn(ftl, pbn), NULL, &spare, 1);
 
     if (res < 0) {
         return map_emcsm_err(emcsm_int_to_err(res));
@@ -618,41 +678,107 @@ enum LflashError sync_write(FlashTranslationLayer *ftl)
         	return LFLASH_ERR_BLOCK_EXHAUSTION;
         }
 
-        // attempt to erase this new block. if we fail just try a new block
-        if (emcsm_erase_block(pbn_to_flash_ppn(ftl, new_pbn)) < 0) {
-        	continue;
-        }
-
-        // success, this block is probably good. try to write the data. if
-        // we fail then we try another block
-        if (write_new_block(ftl, new_pbn, lbn) == LFLASH_ERR_NONE) {
+        // blocks in the pool were erased on their way in and the write erases
+        // again, so just try to write the data. if we fail then we try another block
+        if (write_new_block(ftl, wb, new_pbn, lbn) == LFLASH_ERR_NONE) {
         	break;
         }
     }
 
     map_lbn_to_pbn(segment, lbn, new_pbn);
     add_block_to_unused_list(ftl, segment, pbn);
-    ftl->cache_lbn = INVALID_LBN;
-    ftl->cache_pbn = INVALID_PBN;
+    release_write_buffer(wb);
     return LFLASH_ERR_NONE;
 }
 
-enum LflashError write_sectors(FlashTranslationLayer *ftl, size_t sector, const void *buff, size_t num_sectors, size_t *num_written_sectors)
+// flush the dirty buffers first written no later than first_write, oldest
+// first, so blocks reach the flash in the order the file system dirtied
+// them: a FAT or directory update never lands before the data it follows
+// from. writes into a block after it went dirty travel with that block
+static enum LflashError flush_in_write_order(FlashTranslationLayer *ftl, size_t first_write)
 {
-    uint32_t scramble = read_scramble(ftl, sector);
-    emcsm_set_scramble(scramble);
+    while (1) {
+        WriteBuffer *oldest = NULL;
 
-    size_t lbn = lpn_to_lbn(ftl, sector);
-    size_t pbn = lbn_to_pbn(ftl, lbn);
+        for (size_t i = 0; i < NUM_WRITE_BUFFERS; ++i) {
+        	WriteBuffer *wb = &ftl->buffers[i];
 
-    if (ftl->cache_lbn != lbn) {
-        sync_write(ftl);
+        	if (wb->dirty && wb->first_write <= first_write && (!oldest || wb->first_write < oldest->first_write)) {
+        		oldest = wb;
+        	}
+        }
+
+        if (!oldest) {
+        	return LFLASH_ERR_NONE;
+        }
+
+        enum LflashError err = flush_write_buffer(ftl, oldest);
+
+        if (err != LFLASH_ERR_NONE) {
+        	return err;
+        }
+    }
+}
+
+enum LflashError sync_write(FlashTranslationLayer *ftl)
+{
+    enum LflashError err = flush_in_write_order(ftl, ftl->write_clock);
+
+    if (err != LFLASH_ERR_NONE) {
+        return err;
+    }
+
+    // only clean buffers are left, drop them
+    for (size_t i = 0; i < NUM_WRITE_BUFFERS; ++i) {
+        enum LflashError err = flush_write_buffer(ftl, &ftl->buffers[i]);
+
+        if (err != LFLASH_ERR_NONE) {
+        	return err;
+        }
+    }
+
+    return LFLASH_ERR_NONE;
+}
+
+static enum LflashError get_write_buffer(FlashTranslationLayer *ftl, size_t lbn, WriteBuffer **out)
+{
+    WriteBuffer *wb = find_write_buffer(ftl, lbn);
+
+    if (!wb) {
+        // take a free buffer, else flush the one left alone the longest
+        wb = &ftl->buffers[0];
+
+        for (size_t i = 0; i < NUM_WRITE_BUFFERS; ++i) {
+        	if (ftl->buffers[i].cache_lbn == INVALID_LBN) {
+        		wb = &ftl->buffers[i];
+        		break;
+        	}
+
+        	if (ftl->buffers[i].last_use < wb->last_use) {
+        		wb = &ftl->buffers[i];
+        	}
+        }
+
+        enum LflashError err = LFLASH_ERR_NONE;
+
+        if (wb->dirty) {
+        	err = flush_in_write_order(ftl, wb->first_write);
+        }
+        else {
+        	err = flush_write_buffer(ftl, wb);
+        }
+
+        if (err != LFLASH_ERR_NONE) {
+        	return err;
+        }
+
+        size_t pbn = lbn_to_pbn(ftl, lbn);
 
         if (pbn == INVALID_PBN) {
         	return LFLASH_ERR_INVALID_PBN;
         }
 
-        enum LflashError err = read_pbn_spare_data(ftl, pbn, scramble);
+        err = read_pbn_spare_data(ftl, wb, pbn, read_scramble(ftl, lbn * ftl->pages_per_block));
 
         // ignore all ECC errors
         if (err == LFLASH_ERR_DATA_ECC || err == LFLASH_ERR_SPARE_ECC) {
@@ -663,14 +789,39 @@ enum LflashError write_sectors(FlashTranslationLayer *ftl, size_t sector, const
         	return err;
         }
 
-        ftl->cache_lbn = lbn;
-        ftl->cache_pbn = pbn;
+        wb->cache_lbn = lbn;
+        wb->cache_pbn = pbn;
+        wb->dirty = 0;
+    }
+
+    wb->last_use = ++ftl->use_clock;
+    *out = wb;
+    return LFLASH_ERR_NONE;
+}
+
+enum LflashError write_sectors(FlashTranslationLayer *ftl, size_t sector, const void *buff, size_t num_sectors, size_t *num_written_sectors)
+{
+    size_t lbn = lpn_to_lbn(ftl, sector);
+    WriteBuffer *wb = NULL;
+
+    enum LflashError err = get_write_buffer(ftl, lbn, &wb);
+
+    if (err != LFLASH_ERR_NONE) {
+        return err;
     }
 
     size_t max_possible_copy = ftl->pages_per_block - (sector % ftl->pages_per_block);
     size_t copylen = num_sectors > max_possible_copy ? (max_possible_copy) : (num_sectors);
+    uint8_t *dst = wb->block_buffer + (sector % ftl->pages_per_block) * ftl->page_size;
+
+    // rewriting what is already there doesn't cost a block rewrite
+    if (!wb->dirty && memcmp(dst, buff, copylen * ftl->page_size) != 0) {
+        wb->dirty = 1;
+        wb->first_write = ++ftl->write_clock;
+    }
 
-    memcpy(ftl->block_buffer + (sector % ftl->pages_per_block) * ftl->page_size, buff, copylen * ftl->page_size);
+    memcpy(dst, buff, copylen * ftl->page_size);
+    ftl->stats.sectors_written += copylen;
 
     if (num_written_sectors) {
         *num_written_sectors = copylen;
@@ -679,11 +830,9 @@ enum LflashError write_sectors(FlashTranslationLayer *ftl, size_t sector, const
     return LFLASH_ERR_NONE;
 }
 
-enum LflashError lflash_init(void)
+enum LflashError lflash_init_backend(const LflashBackend *backend)
 {
-    emcsm_init();
-    emcsm_set_write_protect(EMCSM_DISABLE_WRITE_PROTECT);
-    init_ftl(&g_ftl);
+    init_ftl(&g_ftl, backend);
     read_partitions(&g_ftl);
     return LFLASH_ERR_NONE;
 }
@@ -701,7 +850,7 @@ enum LflashError lflash_write_sectors(size_t sector, const void *buff, size_t nu
 size_t lflash_get_sector_count(void)
 {
     // TODO: remove this constant. its pages per block...
-    const SmartMediaProperties *properties = get_properties();
+    const SmartMediaProperties *properties = g_ftl.properties;
     return properties->num_blocks * 32;
 }
 
@@ -719,6 +868,11 @@ enum LflashError lflash_sync(void)
 size_t lflash_get_size(void)
 {
     // TODO: remove this constant. its pages per block...
-    const SmartMediaProperties *properties = get_properties();
+    const SmartMediaProperties *properties = g_ftl.properties;
     return (properties->num_logical_blocks - 2) * 32;
 }
+
+const LflashStats *lflash_get_stats(void)
+{
+    return &g_ftl.stats;
+}
@@ -18,13 +18,41 @@ enum LflashError
     LFLASH_ERR_BLOCK_EXHAUSTION
 };
 
+// NAND access used by the translation layer. lflash_init() plugs in the
+// emcsm driver, anything else (e.g. an image file) can be given to
+// lflash_init_backend().
+typedef struct
+{
+    int (*read_pages)(size_t ppn, void *user, void *spare, size_t num_pages);
+    int (*read_extra_only)(size_t ppn, void *spare, size_t num_pages);
+    int (*read_block_with_retry)(size_t ppn, void *user, void *spare);
+    int (*is_bad_block)(size_t ppn);
+    void (*set_scramble)(uint32_t scramble);
+    int (*erase_block)(size_t ppn);
+    int (*write_pages_raw_extra)(size_t ppn, const void *user, const void *spare, size_t num_pages);
+    int (*write_block_with_verify)(size_t ppn, const void *user, const void *spare);
+    uint32_t fuse_id[2];
+    int is_01g; // smaller 01g flash layout
+} LflashBackend;
+
+typedef struct
+{
+    size_t sectors_written;
+    size_t block_reads;
+    size_t block_writes;
+    size_t clean_flushes; // buffered blocks that matched the flash
+    size_t erases;
+} LflashStats;
+
 enum LflashError lflash_init(void);
+enum LflashError lflash_init_backend(const LflashBackend *backend);
 enum LflashError lflash_read_sector(size_t sector, void *buff);
 enum LflashError lflash_write_sectors(size_t sector, const void *buff, size_t num_sectors, size_t *num_written);
 size_t lflash_get_sector_count(void);
 size_t lflash_get_block_size(void);
 enum LflashError lflash_sync(void);
 size_t lflash_get_size(void);
+const LflashStats *lflash_get_stats(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,30 @@
+#include "lflash.h"
+
+#include <emcsm.h>
+#include <model.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+static LflashBackend g_emcsm_backend = {
+    .read_pages = emcsm_read_pages,
+    .read_extra_only = emcsm_read_extra_only,
+    .read_block_with_retry = emcsm_read_block_with_retry,
+    .is_bad_block = emcsm_is_bad_block,
+    .set_scramble = emcsm_set_scramble,
+    .erase_block = emcsm_erase_block,
+    .write_pages_raw_extra = emcsm_write_pages_raw_extra,
+    .write_block_with_verify = emcsm_write_block_with_verify,
+};
+
+enum LflashError lflash_init(void)
+{
+    emcsm_init();
+    emcsm_set_write_protect(EMCSM_DISABLE_WRITE_PROTECT);
+
+    g_emcsm_backend.fuse_id[0] = *(volatile uint32_t *)0xBC100090;
+    g_emcsm_backend.fuse_id[1] = *(volatile uint32_t *)0xBC100094;
+    g_emcsm_backend.is_01g = (model_get_identity()->model == PSP_MODEL_01G);
+
+    return lflash_init_backend(&g_emcsm_backend);
+}
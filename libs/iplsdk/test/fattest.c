@@ -0,0 +1,205 @@
+/*
+    host harness for the memory stick FAT reader (fat.c)
+
+    Builds fat.c against a memory stick that is an image file made by
+    mkimg.py, mounts it and reads files back through MsFatOpen/MsFatRead:
+    - the payload in one read, then in 4KB and 512 byte pieces
+    - sizes that aren't a multiple of 512, alone and mixed: every read
+      must stop at the size asked for and the next one goes on at the
+      following byte
+    - long names, short names, any case and '\' as separator
+    - paths that don't exist or name a folder
+    Bytes past what MsFatRead returns must stay untouched.
+
+    fattest <image>     checks the image, prints sectors read per MB
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <pspsdk.h>
+
+#include "../fat.h"
+
+#define GUARD 0xA5
+#define SLACK 1024
+
+static FILE *img;
+static long sectors;
+static int failed;
+
+void pspMsInit(void)
+{
+}
+
+int mspro_read_sector(uint32_t sector, void *data)
+{
+    sectors++;
+    if (fseek(img, (long)sector * 0x200, SEEK_SET) != 0) return -1;
+    return (fread(data, 1, 0x200, img) == 0x200)? 0 : -1;
+}
+
+static unsigned char *load(const char *path, long *size)
+{
+    FILE *fp = fopen(path, "rb");
+    unsigned char *buf;
+
+    if (fp == NULL)
+    {
+        printf("can't open %s\n", path);
+        exit(1);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc(*size + 1);
+    if (fread(buf, 1, *size, fp) != *size) *size = -1;
+    fclose(fp);
+    return buf;
+}
+
+// read path in pieces of sizes[0], sizes[1], ... bytes (cycling) and compare with ref
+static void check_sizes(const char *path, const char *image, const char *ref_suffix, const u32 *sizes, int nsizes)
+{
+    char ref_path[512];
+    long size, pos = 0;
+    unsigned char *want, *got;
+    u32 chunk, biggest = 0;
+    int r, n = 0;
+
+    snprintf(ref_path, sizeof(ref_path), "%s.%s", image, ref_suffix);
+    want = load(ref_path, &size);
+
+    for (r = 0; r < nsizes; r++)
+        if (sizes[r] > biggest) biggest = sizes[r];
+    got = malloc(biggest + SLACK);
+
+    if (MsFatOpen((char *)path) < 0)
+    {
+        printf("  %s: open failed\n", path);
+        failed = 1;
+        free(want);
+        free(got);
+        return;
+    }
+
+    do
+    {
+        long expect;
+        int i;
+
+        chunk = sizes[n++ % nsizes];
+        expect = (size - pos < (long)chunk)? size - pos : chunk;
+
+        memset(got, GUARD, chunk + SLACK);
+        r = MsFatRead(got, chunk);
+
+        if (r != (expect < 0 ? 0 : expect) || (r > 0 && memcmp(got, want + pos, r) != 0))
+        {
+            printf("  %s, %u byte reads: at %ld got %d bytes, wanted %ld\n", path, chunk, pos, r, expect);
+            failed = 1;
+            break;
+        }
+
+        for (i = (r > 0)? r : 0; i < chunk + SLACK; i++)
+        {
+            if (got[i] != GUARD)
+            {
+                printf("  %s, %u byte reads: byte %d past the %d read was written\n", path, chunk, i, r);
+                failed = 1;
+                break;
+            }
+        }
+
+        pos += r;
+    } while ((r > 0 || chunk == 0) && !failed && n < 1000000);
+
+    if (!failed && pos != size)
+    {
+        printf("  %s: read %ld bytes of %ld\n", path, pos, size);
+        failed = 1;
+    }
+
+    MsFatClose();
+    free(want);
+    free(got);
+}
+
+static void check(const char *path, const char *image, const char *ref_suffix, u32 chunk)
+{
+    check_sizes(path, image, ref_suffix, &chunk, 1);
+}
+
+static void expect_missing(const char *path)
+{
+    if (MsFatOpen((char *)path) >= 0)
+    {
+        printf("  %s: opened\n", path);
+        failed = 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct timespec t0, t1;
+    long size;
+    int i, reps = 20;
+    double mb, ms;
+
+    if (argc < 2)
+    {
+        printf("usage: %s <image>\n", argv[0]);
+        return 1;
+    }
+
+    img = fopen(argv[1], "rb");
+    if (img == NULL || MsFatMount() < 0)
+    {
+        printf("%s: mount failed\n", argv[1]);
+        return 1;
+    }
+
+    // whole payload in one read, how the loaders use it
+    char ref_path[512];
+    snprintf(ref_path, sizeof(ref_path), "%s.payload", argv[1]);
+    free(load(ref_path, &size));
+
+    sectors = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < reps; i++)
+        check("/TM/DCARK/ARK_Payload_Image.bin", argv[1], "payload", (size + 0x1FF) & ~0x1FF);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    mb = (double)size * reps / (1024 * 1024);
+    ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    printf("%s: %ld sectors per MB of payload, %.2f ms/MB\n", argv[1], (long)(sectors / mb), ms / mb);
+
+    check("TM/DCARK/ark_payload_image.BIN", argv[1], "payload", 4096);
+    check("/TM/DCARK/ARK_Payload_Image.bin", argv[1], "payload", 512);
+    check("/TM/DCARK/ARK_Payload_Image.bin", argv[1], "payload", 1000);
+    check("/TM/DCARK/ARK_Payload_Image.bin", argv[1], "payload", 0x10001);
+    check("/TM/DCARK/IPL.BIN", argv[1], "ipl", 0x100000);
+    check("/TM/DCARK/IPL.BIN", argv[1], "ipl", 7000);
+    check("\\TM\\DCARK\\tiny", argv[1], "tiny", 512);
+    check("\\TM\\DCARK\\tiny", argv[1], "tiny", 50);
+    check("/PSP/GAME/file_07.txt", argv[1], "game", 0x100000);
+    check("/PSP/GAME/file_07.txt", argv[1], "game", 1);
+
+    // odd pieces that cross sector and cluster ends, then whole sectors off the boundary
+    static const u32 mixed[] = { 1000, 24, 0x200, 3, 0x10001, 0, 511, 0x1000, 1 };
+    check_sizes("/TM/DCARK/ARK_Payload_Image.bin", argv[1], "payload", mixed, 9);
+    check_sizes("/TM/DCARK/IPL.BIN", argv[1], "ipl", mixed + 1, 8);
+
+    expect_missing("/TM/nothing");
+    expect_missing("/TM/DCARK");
+    expect_missing("/TM/DCARK/IPL.BIN/");
+
+    fclose(img);
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
@@ -0,0 +1,345 @@
+/*
+    host harness for the flash translation layer (lflash.c)
+
+    Runs lflash.c on an LflashBackend that keeps a factory formatted 01g
+    NAND in memory: 512 byte pages with 12 spare bytes, xor scrambled.
+    - write order: blocks must reach the flash in the order they were
+      first dirtied, whichever buffer gets evicted and on lflash_sync
+    - rewriting sectors with what the flash already holds costs nothing
+    - a 24MB flash0 partition written as one image, then copied FAT style
+      (cluster data, both FATs and a directory sector per file) twice;
+      the NAND is remounted and every sector read back
+
+    The times printed assume 2ms per erase, 200us per page program and
+    25us per page read; they are not PSP measurements.
+
+    lflashtest      runs everything, fails on a wrong order or readback
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../lflash.h"
+
+#define PAGE_SIZE        0x200
+#define SPARE_SIZE       12
+#define PAGES_PER_BLOCK  32
+#define NUM_BLOCKS       (0x40 + 0x7C0)
+#define RAW_PAGE         (PAGE_SIZE + SPARE_SIZE)
+
+#define F0_LBA           0x40
+#define F0_SECTORS       (24 * 1024 * 2)
+
+static uint8_t *nand, *image, *shadow;
+static uint32_t scramble;
+static long erases, programmed, read_pages;
+static size_t write_log[64];
+static int num_logged, failed;
+
+static uint8_t *page(size_t ppn)
+{
+    return nand + ppn * RAW_PAGE;
+}
+
+static void xor_page(uint8_t *dst, const uint8_t *src)
+{
+    for (int i = 0; i < PAGE_SIZE; i += 4) {
+        uint32_t w;
+        memcpy(&w, src + i, 4);
+        w ^= scramble;
+        memcpy(dst + i, &w, 4);
+    }
+}
+
+static int nand_read_pages(size_t ppn, void *user, void *spare, size_t num_pages)
+{
+    for (size_t i = 0; i < num_pages; ++i) {
+        read_pages++;
+        if (user) xor_page((uint8_t *)user + i * PAGE_SIZE, page(ppn + i));
+        if (spare) memcpy((uint8_t *)spare + i * SPARE_SIZE, page(ppn + i) + PAGE_SIZE, SPARE_SIZE);
+    }
+    return 0;
+}
+
+static int nand_read_extra_only(size_t ppn, void *spare, size_t num_pages)
+{
+    // user ecc word first, like the controller returns it
+    for (size_t i = 0; i < num_pages; ++i) {
+        memset((uint8_t *)spare + i * 16, 0, 4);
+        memcpy((uint8_t *)spare + i * 16 + 4, page(ppn + i) + PAGE_SIZE, SPARE_SIZE);
+    }
+    return 0;
+}
+
+static int nand_read_block(size_t ppn, void *user, void *spare)
+{
+    return nand_read_pages(ppn, user, spare, PAGES_PER_BLOCK);
+}
+
+static int nand_is_bad_block(size_t ppn)
+{
+    return 0;
+}
+
+static void nand_set_scramble(uint32_t s)
+{
+    scramble = s;
+}
+
+static int nand_erase_block(size_t ppn)
+{
+    if (ppn % PAGES_PER_BLOCK) return -1;
+    erases++;
+    memset(page(ppn), 0xFF, RAW_PAGE * PAGES_PER_BLOCK);
+    return 0;
+}
+
+// programming can only clear bits
+static int nand_write_pages_raw_extra(size_t ppn, const void *user, const void *spare, size_t num_pages)
+{
+    for (size_t i = 0; i < num_pages; ++i) {
+        uint8_t *p = page(ppn + i);
+        programmed++;
+
+        if (user) {
+            uint8_t t[PAGE_SIZE];
+            xor_page(t, (const uint8_t *)user + i * PAGE_SIZE);
+            for (int j = 0; j < PAGE_SIZE; ++j) p[j] &= t[j];
+        }
+
+        if (spare) {
+            for (int j = 0; j < SPARE_SIZE; ++j) p[PAGE_SIZE + j] &= ((const uint8_t *)spare)[i * SPARE_SIZE + j];
+        }
+    }
+    return 0;
+}
+
+static int nand_write_block(size_t ppn, const void *user, const void *spare)
+{
+    const uint8_t *meta = spare;
+
+    if (num_logged < sizeof(write_log) / sizeof(*write_log)) {
+        write_log[num_logged++] = (meta[2] << 8) | meta[3];
+    }
+
+    nand_erase_block(ppn);
+    return nand_write_pages_raw_extra(ppn, user, spare, PAGES_PER_BLOCK);
+}
+
+static const LflashBackend g_backend = {
+    .read_pages = nand_read_pages,
+    .read_extra_only = nand_read_extra_only,
+    .read_block_with_retry = nand_read_block,
+    .is_bad_block = nand_is_bad_block,
+    .set_scramble = nand_set_scramble,
+    .erase_block = nand_erase_block,
+    .write_pages_raw_extra = nand_write_pages_raw_extra,
+    .write_block_with_verify = nand_write_block,
+    .fuse_id = { 0x12345678, 0x9ABCDEF0 },
+    .is_01g = 1,
+};
+
+// 4 segments of 0x1F0 blocks, the first 0x1E0 of each mapped in order
+static void nand_format(void)
+{
+    memset(nand, 0xFF, (size_t)NUM_BLOCKS * PAGES_PER_BLOCK * RAW_PAGE);
+
+    for (size_t seg = 0; seg < 4; ++seg) {
+        for (size_t i = 0; i < 0x1E0; ++i) {
+            size_t pbn = seg * 0x1F0 + i, lbn = seg * 0x1E0 + i;
+
+            for (size_t p = 0; p < PAGES_PER_BLOCK; ++p) {
+                uint8_t *spare = page((0x40 + pbn) * PAGES_PER_BLOCK + p) + PAGE_SIZE;
+                spare[2] = lbn >> 8;
+                spare[3] = lbn;
+            }
+        }
+    }
+}
+
+static void write(size_t sector, const uint8_t *buf, size_t num_sectors)
+{
+    memcpy(shadow + sector * PAGE_SIZE, buf, num_sectors * PAGE_SIZE);
+
+    while (num_sectors) {
+        size_t written = 0;
+
+        if (lflash_write_sectors(sector, buf, num_sectors, &written) != LFLASH_ERR_NONE || !written) {
+            printf("write error at sector %zu\n", sector);
+            exit(1);
+        }
+
+        sector += written;
+        buf += written * PAGE_SIZE;
+        num_sectors -= written;
+    }
+}
+
+static void write_block_sector(size_t lbn, uint8_t fill)
+{
+    uint8_t sector[PAGE_SIZE];
+    memset(sector, fill, sizeof(sector));
+    write(lbn * PAGES_PER_BLOCK + 5, sector, 1);
+}
+
+static void expect_log(const char *what, const size_t *lbns, int n)
+{
+    int ok = (num_logged == n);
+
+    for (int i = 0; ok && i < n; ++i) {
+        ok = (write_log[i] == lbns[i]);
+    }
+
+    if (!ok) {
+        printf("  %s: blocks written", what);
+        for (int i = 0; i < num_logged; ++i) printf(" %zu", write_log[i]);
+        printf(", wanted");
+        for (int i = 0; i < n; ++i) printf(" %zu", lbns[i]);
+        printf("\n");
+        failed = 1;
+    }
+
+    num_logged = 0;
+}
+
+static void test_write_order(void)
+{
+    static const size_t evict[] = { 10, 11 };
+    static const size_t sync[] = { 12, 13, 14 };
+    static const size_t same[] = { 11 };
+
+    nand_format();
+    lflash_init_backend(&g_backend);
+    num_logged = 0;
+
+    // 10 is dirtied first, but touching it again leaves 11 the least
+    // recently used. evicting 11 has to take 10 out ahead of it
+    write_block_sector(10, 1);
+    write_block_sector(11, 2);
+    write_block_sector(12, 3);
+    write_block_sector(13, 4);
+    write_block_sector(10, 5);
+    write_block_sector(14, 6);
+    expect_log("evicting a buffer", evict, 2);
+
+    lflash_sync();
+    expect_log("lflash_sync", sync, 3);
+
+    // same data again: read into a buffer, never rewritten
+    write_block_sector(12, 3);
+    write_block_sector(11, 2);
+    write_block_sector(11, 7);
+    lflash_sync();
+    expect_log("unchanged sectors", same, 1);
+}
+
+// FAT16 style copy: 8 sector clusters, both FATs updated per cluster and
+// the directory sector per file
+static void fat_copy(void)
+{
+    size_t fat = F0_LBA + 1, dir = F0_LBA + 1 + 2 * 96, data = dir + 32, end = F0_LBA + F0_SECTORS;
+    size_t off = 0, cluster = 0;
+
+    while (data + off + 8 <= end) {
+        size_t file_clusters = 1 + (off / 8 % 37);
+
+        for (size_t c = 0; c < file_clusters && data + off + 8 <= end; ++c, ++cluster) {
+            size_t fs = fat + (cluster * 2) / PAGE_SIZE;
+
+            write(data + off, image + (data + off - F0_LBA) * PAGE_SIZE, 8);
+            off += 8;
+            write(fs, image + (fs - F0_LBA) * PAGE_SIZE, 1);
+            write(fs + 96, image + (fs + 96 - F0_LBA) * PAGE_SIZE, 1);
+        }
+
+        size_t ds = dir + (cluster / 37) % 32;
+        write(ds, image + (ds - F0_LBA) * PAGE_SIZE, 1);
+    }
+
+    write(F0_LBA, image, 1);
+}
+
+static void run(const char *name, void (*fn)(void))
+{
+    long e0 = erases, p0 = programmed, r0 = read_pages;
+
+    fn();
+    lflash_sync();
+
+    e0 = erases - e0;
+    p0 = programmed - p0;
+    r0 = read_pages - r0;
+    printf("  %-18s erases %6ld  programmed pages %7ld  read pages %7ld  ~%.1f s\n",
+           name, e0, p0, r0, e0 * 0.002 + p0 * 0.0002 + r0 * 0.000025);
+}
+
+static void write_image(void)
+{
+    write(F0_LBA, image, F0_SECTORS);
+}
+
+static void test_partition(void)
+{
+    uint8_t mbr[PAGE_SIZE] = { 0 }, sector[PAGE_SIZE];
+    uint32_t lba = F0_LBA, count = F0_SECTORS;
+
+    srand(1);
+    for (size_t i = 0; i < F0_SECTORS * PAGE_SIZE; ++i) {
+        image[i] = ((i / 4096) % 3)? rand() : 0;
+    }
+
+    nand_format();
+    memset(shadow, 0, (F0_LBA + F0_SECTORS) * PAGE_SIZE);
+    lflash_init_backend(&g_backend);
+
+    mbr[0x1BE + 4] = 0x0E;
+    memcpy(mbr + 0x1BE + 8, &lba, 4);
+    memcpy(mbr + 0x1BE + 12, &count, 4);
+    mbr[0x1FE] = 0x55;
+    mbr[0x1FF] = 0xAA;
+    write(0, mbr, 1);
+    lflash_sync();
+
+    // remount so the partition scrambles are picked up
+    lflash_init_backend(&g_backend);
+
+    run("image", write_image);
+    for (size_t i = 0; i < F0_SECTORS * PAGE_SIZE; i += 700) {
+        image[i] ^= 0x5A;
+    }
+    run("FAT style copy", fat_copy);
+    run("same copy again", fat_copy);
+
+    const LflashStats *stats = lflash_get_stats();
+    printf("  %zu sectors written, %zu block reads, %zu block writes, %zu clean flushes\n",
+           stats->sectors_written, stats->block_reads, stats->block_writes, stats->clean_flushes);
+
+    lflash_init_backend(&g_backend);
+
+    for (size_t s = 0; s < F0_LBA + F0_SECTORS; ++s) {
+        if (s > 0 && s < F0_LBA) continue;
+
+        lflash_read_sector(s, sector);
+
+        if (memcmp(sector, shadow + s * PAGE_SIZE, PAGE_SIZE) != 0) {
+            printf("  readback: sector %zu differs\n", s);
+            failed = 1;
+            break;
+        }
+    }
+}
+
+int main(void)
+{
+    nand = malloc((size_t)NUM_BLOCKS * PAGES_PER_BLOCK * RAW_PAGE);
+    image = malloc(F0_SECTORS * PAGE_SIZE);
+    shadow = malloc((F0_LBA + F0_SECTORS) * PAGE_SIZE);
+
+    test_write_order();
+    test_partition();
+
+    printf(failed ? "FAILED\n" : "ok\n");
+    return failed;
+}
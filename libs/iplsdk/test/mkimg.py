@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Builds a partitioned FAT12/16/32 memory stick image for fattest.
+
+    mkimg.py <12|16|32> <sectors> <sectors per cluster> <frag|contig> <out> [payload size]
+
+Files are laid out with random gaps between cluster runs when "frag" is
+given, so MsFatRead has to follow the chain. Every file that fattest reads
+back is also written next to the image as <out>.<name> to compare with.
+"""
+
+import random
+import struct
+import sys
+
+SECTOR = 512
+PARTITION_START = 63
+
+
+def lfn_checksum(short_name):
+    s = 0
+    for c in short_name:
+        s = (((s & 1) << 7) + (s >> 1) + c) & 0xFF
+    return s
+
+
+class Image:
+    def __init__(self, fat_type, total, sec_per_cluster, seed):
+        self.fat_type = fat_type
+        self.total = total
+        self.spc = sec_per_cluster
+        self.rnd = random.Random(seed)
+
+        self.reserved = 32 if fat_type == 32 else 1
+        self.nfats = 2
+        self.root_entries = 0 if fat_type == 32 else 512
+        self.root_sectors = (self.root_entries * 32 + SECTOR - 1) // SECTOR
+
+        entry_bytes = {12: 1.5, 16: 2, 32: 4}[fat_type]
+        self.fat_sectors = int((total // sec_per_cluster + 2) * entry_bytes + SECTOR - 1) // SECTOR
+        self.data_start = self.reserved + self.nfats * self.fat_sectors + self.root_sectors
+        self.nclusters = (total - self.data_start) // sec_per_cluster
+
+        self.fat = [0] * (self.nclusters + 2)
+        self.fat[0] = 0xFFFFFF8
+        self.fat[1] = 0xFFFFFFF
+        self.eoc = {12: 0xFFF, 16: 0xFFFF, 32: 0x0FFFFFFF}[fat_type]
+        self.next_free = 3 if fat_type == 32 else 2
+        self.root_cluster = 0
+
+        self.img = bytearray((PARTITION_START + total) * SECTOR)
+
+    def alloc(self, n, frag):
+        chain = []
+        while len(chain) < n:
+            run = self.rnd.randint(1, 12) if frag else n
+            for _ in range(min(run, n - len(chain))):
+                chain.append(self.next_free)
+                self.next_free += 1
+            if frag:
+                self.next_free += self.rnd.randint(1, 3)
+        for a, b in zip(chain, chain[1:]):
+            self.fat[a] = b
+        self.fat[chain[-1]] = self.eoc
+        return chain
+
+    def cluster_offset(self, cluster):
+        return (PARTITION_START + self.data_start + (cluster - 2) * self.spc) * SECTOR
+
+    def write_chain(self, chain, data):
+        size = self.spc * SECTOR
+        for i, cluster in enumerate(chain):
+            chunk = data[i * size:(i + 1) * size]
+            o = self.cluster_offset(cluster)
+            self.img[o:o + len(chunk)] = chunk
+
+    def dir_entries(self, name, attr, chain, size, index):
+        base, _, ext = name.partition('.')
+        is_short = name.upper() == name and len(base) <= 8 and len(ext) <= 3
+
+        if is_short:
+            short_name = (base.ljust(8) + ext.ljust(3)).encode()
+        else:
+            short_name = (base.upper().replace(' ', '')[:6] + '~%d' % index).ljust(8).encode()
+            short_name += ext.upper()[:3].ljust(3).encode()
+
+        entries = []
+        if not is_short:
+            u = name.encode('utf-16-le') + b'\0\0'
+            while len(u) % 26:
+                u += b'\xff\xff'
+            chunks = [u[i:i + 26] for i in range(0, len(u), 26)]
+            checksum = lfn_checksum(short_name)
+            for n in range(len(chunks), 0, -1):
+                c = chunks[n - 1]
+                seq = n | (0x40 if n == len(chunks) else 0)
+                entries.append(bytes([seq]) + c[0:10] + bytes([0x0F, 0, checksum]) + c[10:22] + b'\0\0' + c[22:26])
+
+        first = chain[0] if chain else 0
+        entries.append(short_name + bytes([attr, 0, 0]) + b'\0' * 6 + struct.pack('<H', first >> 16)
+                       + b'\0' * 4 + struct.pack('<HI', first & 0xFFFF, size))
+        return b''.join(entries)
+
+    def build_dir(self, tree, frag):
+        items = []
+        cluster_size = self.spc * SECTOR
+        for name, value in tree.items():
+            if isinstance(value, dict):
+                data = self.build_dir(value, frag)
+                chain = self.alloc(max(1, (len(data) + cluster_size - 1) // cluster_size), frag)
+                self.write_chain(chain, data)
+                items.append((name, 0x10, chain, 0))
+            else:
+                n = (len(value) + cluster_size - 1) // cluster_size
+                chain = self.alloc(n, frag) if n else []
+                self.write_chain(chain, value)
+                items.append((name, 0x20, chain, len(value)))
+        return b''.join(self.dir_entries(*item, i + 1) for i, item in enumerate(items))
+
+    def build(self, tree, frag):
+        root = self.build_dir(tree, frag)
+        cluster_size = self.spc * SECTOR
+
+        if self.fat_type == 32:
+            chain = self.alloc(max(1, (len(root) + cluster_size - 1) // cluster_size), False)
+            self.write_chain(chain, root)
+            self.root_cluster = chain[0]
+        else:
+            o = (PARTITION_START + self.reserved + self.nfats * self.fat_sectors) * SECTOR
+            self.img[o:o + len(root)] = root
+
+        fat = bytearray(self.fat_sectors * SECTOR)
+        for cluster, value in enumerate(self.fat):
+            if self.fat_type == 16:
+                struct.pack_into('<H', fat, cluster * 2, value & 0xFFFF)
+            elif self.fat_type == 32:
+                struct.pack_into('<I', fat, cluster * 4, value & 0x0FFFFFFF)
+            else:
+                o = cluster + cluster // 2
+                value &= 0xFFF
+                if cluster & 1:
+                    fat[o] = (fat[o] & 0x0F) | ((value & 0xF) << 4)
+                    fat[o + 1] = value >> 4
+                else:
+                    fat[o] = value & 0xFF
+                    fat[o + 1] = (fat[o + 1] & 0xF0) | (value >> 8)
+        for n in range(self.nfats):
+            o = (PARTITION_START + self.reserved + n * self.fat_sectors) * SECTOR
+            self.img[o:o + len(fat)] = fat
+
+        boot = bytearray(SECTOR)
+        boot[0:3] = b'\xEB\x3C\x90'
+        boot[3:11] = b'MSDOS5.0'
+        struct.pack_into('<HBHBHHBH', boot, 11, SECTOR, self.spc, self.reserved, self.nfats, self.root_entries,
+                         self.total if self.total < 65536 else 0, 0xF8, 0 if self.fat_type == 32 else self.fat_sectors)
+        struct.pack_into('<I', boot, 0x20, self.total)
+        if self.fat_type == 32:
+            struct.pack_into('<IHHI', boot, 0x24, self.fat_sectors, 0, 0, self.root_cluster)
+        boot[510:512] = b'\x55\xAA'
+        o = PARTITION_START * SECTOR
+        self.img[o:o + SECTOR] = boot
+
+        mbr = bytearray(SECTOR)
+        mbr[0x1BE + 4] = 0x0C if self.fat_type == 32 else 0x06
+        struct.pack_into('<II', mbr, 0x1C6, PARTITION_START, self.total)
+        mbr[510:512] = b'\x55\xAA'
+        self.img[0:SECTOR] = mbr
+
+
+def main():
+    if len(sys.argv) < 6:
+        sys.exit(__doc__)
+
+    fat_type, total, spc = int(sys.argv[1]), int(sys.argv[2]), int(sys.argv[3])
+    frag = sys.argv[4] == 'frag'
+    out = sys.argv[5]
+    payload_size = int(sys.argv[6]) if len(sys.argv) > 6 else 600000
+
+    rnd = random.Random(7)
+
+    def blob(n):
+        return bytes(rnd.getrandbits(8) for _ in range(n))
+
+    payload = blob(payload_size)
+    tree = {
+        'PSP': {'GAME': {'file_%02d.txt' % i: blob(rnd.randint(0, 3000)) for i in range(40)}},
+        'TM': {'DCARK': {'ARK_Payload_Image.bin': payload, 'IPL.BIN': blob(7777), 'tiny': blob(100)}},
+        'README.TXT': blob(1234),
+    }
+
+    image = Image(fat_type, total, spc, 3)
+    image.build(tree, frag)
+
+    with open(out, 'wb') as f:
+        f.write(image.img)
+    for suffix, data in (('payload', payload), ('ipl', tree['TM']['DCARK']['IPL.BIN']),
+                         ('tiny', tree['TM']['DCARK']['tiny']), ('game', tree['PSP']['GAME']['file_07.txt'])):
+        with open(out + '.' + suffix, 'wb') as f:
+            f.write(data)
+
+    print('%s: FAT%d, %d clusters' % (out, fat_type, image.nclusters))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,11 @@
+#ifndef PSPSDK_H
+#define PSPSDK_H
+
+#include <stdint.h>
+#include <strings.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+#endif
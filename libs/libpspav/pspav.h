@@ -43,6 +43,17 @@ int pspavPlayAT3(unsigned int argc, void* argv);
 unsigned char pspavPlayGamePMF(PSPAVEntry* e, PSPAVCallbacks* callbacks, int x, int y);
 void pspavPlayVideoFile(const char* path, PSPAVCallbacks* callbacks);
 
+// Playback counters
+typedef struct{
+    unsigned int fill;          // ring packets queued, or full video buffers
+    unsigned int fill_max;
+    unsigned int stalls;        // times the thread had to block
+    unsigned long long stall_time; // us spent blocked
+    unsigned int dropped;
+} PSPAVStats;
+
+void pspavGetStats(PSPAVStats* reader, PSPAVStats* decoder, PSPAVStats* video);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,207 @@
+/*
+    host stress test for libpspvram
+
+    Replays allocation traces against vram.c and against the block table
+    walking allocator it replaced (vram_old.c). For vram.c, every few
+    thousand calls the live allocations are checked against each other
+    and against what the allocator reports: no overlaps, 512 byte aligned,
+    inside the 2MB, vmemavail, vlargestblock and the vstats free region
+    count equal to what the allocations leave. At the end everything is
+    freed and VRAM has to be one free block again.
+
+    vramtest [calls]    both traces, fails on the first inconsistency
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../vram.h"
+
+#define MEM_START   0x04000000u
+#define MEM_SIZE    0x00200000u
+#define BLOCK       512u
+#define SLOTS       400
+#define CHECK_EVERY 5000
+
+void* old_valloc( size_t size );
+void old_vfree( void* ptr );
+size_t old_vmemavail();
+size_t old_vlargestblock();
+
+typedef struct {
+    const char *name;
+    void* (*alloc)(size_t);
+    void (*free)(void*);
+    size_t (*avail)(void);
+    size_t (*largest)(void);
+    int check;
+} Allocator;
+
+typedef struct {
+    uintptr_t addr;
+    size_t size;
+} Live;
+
+static Allocator allocators[] = {
+    { "old", old_valloc, old_vfree, old_vmemavail, old_vlargestblock, 0 },
+    { "new", valloc, vfree, vmemavail, vlargestblock, 1 },
+};
+
+static void *ptrs[SLOTS];
+static size_t sizes[SLOTS];
+static unsigned int seed;
+
+static unsigned int rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+// textures as the menus load them: pow2 sides, 16 or 32 bit
+static size_t texture_size(void)
+{
+    size_t w = 16 << (rnd() % 5), h = 16 << (rnd() % 5);
+    return w * h * ((rnd() % 3) ? 4 : 2);
+}
+
+static size_t random_size(void)
+{
+    return (rnd() % 4 == 0) ? rnd() * 2 % 65536 + 1 : rnd() % 8192 + 1;
+}
+
+static int cmp_live(const void *a, const void *b)
+{
+    const Live *x = a, *y = b;
+    return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+static int check(Allocator *a)
+{
+    Live live[SLOTS];
+    size_t used = 0, largest = 0, gap;
+    uintptr_t end = MEM_START;
+    unsigned int regions = 0;
+    vram_stats_t stats;
+    int i, n = 0;
+
+    for (i = 0; i < SLOTS; i++){
+        if (ptrs[i] == NULL) continue;
+        live[n].addr = (uintptr_t)ptrs[i];
+        live[n].size = (sizes[i] + BLOCK - 1) & ~(BLOCK - 1);
+        if (live[n].addr & (BLOCK - 1) || live[n].addr < MEM_START || live[n].addr + live[n].size > MEM_START + MEM_SIZE){
+            printf("%s: block 0x%08lx+%zu out of place\n", a->name, (unsigned long)live[n].addr, sizes[i]);
+            return -1;
+        }
+        used += live[n].size;
+        n++;
+    }
+
+    qsort(live, n, sizeof(Live), cmp_live);
+
+    for (i = 0; i <= n; i++){
+        uintptr_t start = (i < n) ? live[i].addr : MEM_START + MEM_SIZE;
+        if (start < end){
+            printf("%s: blocks at 0x%08lx and 0x%08lx overlap\n", a->name, (unsigned long)live[i - 1].addr, (unsigned long)start);
+            return -1;
+        }
+        gap = start - end;
+        if (gap > 0) regions++;
+        if (gap > largest) largest = gap;
+        if (i < n) end = live[i].addr + live[i].size;
+    }
+
+    vstats(&stats);
+
+    if (a->avail() != MEM_SIZE - used || a->largest() != largest || stats.free_blocks != regions || stats.used != used){
+        printf("%s: reports %zu free, largest %zu, %u regions, %zu used; the blocks leave %zu, %zu, %u, %zu\n",
+               a->name, a->avail(), a->largest(), stats.free_blocks, stats.used, MEM_SIZE - used, largest, regions, used);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int run(Allocator *a, const char *trace, long calls, size_t (*size)(void))
+{
+    long ok = 0, failed = 0, c;
+    struct timespec t0, t1;
+    double sec;
+    int i;
+
+    memset(ptrs, 0, sizeof(ptrs));
+    seed = 3;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (c = 0; c < calls; c++){
+        i = rnd() % SLOTS;
+        if (ptrs[i] != NULL){
+            a->free(ptrs[i]);
+            ptrs[i] = NULL;
+        }
+        else {
+            sizes[i] = size();
+            ptrs[i] = a->alloc(sizes[i]);
+            if (ptrs[i] != NULL) ok++;
+            else failed++;
+        }
+        if (a->check && c % CHECK_EVERY == 0 && check(a) < 0) return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    if (a->check && check(a) < 0) return -1;
+
+    for (i = 0; i < SLOTS; i++){
+        if (ptrs[i] != NULL) a->free(ptrs[i]);
+        ptrs[i] = NULL;
+    }
+
+    printf("%-8s %s: %ld calls in %.3f s (%.0f ns/call), %ld allocations, %ld failed",
+           trace, a->name, calls, sec, sec * 1e9 / calls, ok, failed);
+
+    if (a->check){
+        vram_stats_t stats;
+        vstats(&stats);
+        printf(", peak %zu KB", stats.peak / 1024);
+        if (a->avail() != MEM_SIZE || a->largest() != MEM_SIZE || stats.free_blocks != 1){
+            printf("\n%s: %zu free, largest %zu, %u regions after freeing everything\n",
+                   a->name, a->avail(), a->largest(), stats.free_blocks);
+            return -1;
+        }
+    }
+    printf("\n");
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    long calls = (argc > 1) ? atol(argv[1]) : 1000000;
+    int i, failed = 0;
+
+    // the odd calls: nothing, too big, a pointer that was never handed out
+    if (valloc(0) != NULL || valloc(MEM_SIZE + 1) != NULL){
+        printf("new: valloc of 0 or more than VRAM succeeded\n");
+        failed = 1;
+    }
+    vfree((void *)(uintptr_t)(MEM_START + 0x1000));
+    vfree((void *)(uintptr_t)(MEM_START + 0x10));
+    if (vmemavail() != MEM_SIZE || vlargestblock() != MEM_SIZE){
+        printf("new: freeing pointers that were never allocated changed VRAM\n");
+        failed = 1;
+    }
+
+    for (i = 0; i < 2 && !failed; i++){
+        failed |= run(&allocators[i], "random", calls, random_size) < 0;
+    }
+    for (i = 0; i < 2 && !failed; i++){
+        failed |= run(&allocators[i], "textures", calls, texture_size) < 0;
+    }
+
+    printf(failed ? "FAILED\n" : "ok\n");
+
+    return failed;
+}
@@ -10,6 +10,7 @@
  */
 #include "vram.h"
 #include <stdio.h>
+#include <string.h>
 
 // Configure the memory to be managed
 #define __MEM_SIZE 0x00200000
@@ -54,9 +55,23 @@
 unsigned int    __mem_blocks[__MEM_BLOCKS] = { 0 };
 
 
-static int __largest_update = 0;
-static int __largest_block = __MEM_BLOCKS;
+// Free blocks are kept on segregated lists so valloc doesn't have to walk the block table:
+// the first level is the power of two of the block count, the second level splits that
+// range in __SL_COUNT equal parts. Two bitmaps tell which lists are not empty, so finding
+// a fitting block is O(1). A free block's list links are stored under its block index.
+#define __SL_LOG2 4
+#define __SL_COUNT (1<<__SL_LOG2)
+#define __FL_COUNT 10           // __MEM_BLOCKS == 1<<(__FL_COUNT+__SL_LOG2-2)
+#define __NIL 0xFFFF
+
+static unsigned short __free_next[__MEM_BLOCKS];
+static unsigned short __free_prev[__MEM_BLOCKS];
+static unsigned short __free_lists[__FL_COUNT][__SL_COUNT];
+static unsigned int __fl_bitmap = 0;
+static unsigned int __sl_bitmap[__FL_COUNT];
+
 static int __mem_free = __MEM_BLOCKS;
+static vram_stats_t __stats;
 
 
 inline void* vrelptr( void *ptr )
@@ -70,25 +85,84 @@ inline void* vabsptr( void *ptr )
 }
 
 
-static void __find_largest_block()
+static inline int __msb(unsigned int x)
 {
-    int i = 0;
-    __largest_block = 0;
-    while (i<__MEM_BLOCKS)
+    return 31 - __builtin_clz(x);
+}
+
+// list a free block of this size is filed under
+static inline void __mapping_insert(int size, int *fl, int *sl)
+{
+    if (size < __SL_COUNT)
+    {
+        *fl = 0;
+        *sl = size;
+    }
+    else
+    {
+        int t = __msb(size);
+        *sl = (size >> (t - __SL_LOG2)) ^ __SL_COUNT;
+        *fl = t - __SL_LOG2 + 1;
+    }
+}
+
+// first list whose blocks are all at least this size
+static inline void __mapping_search(int size, int *fl, int *sl)
+{
+    if (size >= __SL_COUNT)
+        size += (1 << (__msb(size) - __SL_LOG2)) - 1;
+    __mapping_insert(size, fl, sl);
+}
+
+static void __free_insert(int i)
+{
+    int fl, sl;
+    __mapping_insert(__BLOCK_GET_SIZE(__mem_blocks[i]), &fl, &sl);
+
+    __free_prev[i] = __NIL;
+    __free_next[i] = __free_lists[fl][sl];
+    if (__free_next[i]!=__NIL)
+        __free_prev[__free_next[i]] = i;
+    __free_lists[fl][sl] = i;
+
+    __fl_bitmap |= 1 << fl;
+    __sl_bitmap[fl] |= 1 << sl;
+    __stats.free_blocks++;
+}
+
+static void __free_remove(int i)
+{
+    int fl, sl;
+    __mapping_insert(__BLOCK_GET_SIZE(__mem_blocks[i]), &fl, &sl);
+
+    if (__free_prev[i]!=__NIL)
+        __free_next[__free_prev[i]] = __free_next[i];
+    else
+        __free_lists[fl][sl] = __free_next[i];
+    if (__free_next[i]!=__NIL)
+        __free_prev[__free_next[i]] = __free_prev[i];
+
+    if (__free_lists[fl][sl]==__NIL)
     {
-        int csize = __BLOCK_GET_SIZE(__mem_blocks[i]);
-        if (__BLOCK_GET_FREEBLOCK(__mem_blocks[i])==3 && csize>__largest_block)
-            __largest_block = csize;
-        i += csize;
+        __sl_bitmap[fl] &= ~(1 << sl);
+        if (__sl_bitmap[fl]==0)
+            __fl_bitmap &= ~(1 << fl);
     }
-    __largest_update = 0;
+    __stats.free_blocks--;
+}
+
+static void __mem_init()
+{
+    memset(__free_lists, 0xFF, sizeof(__free_lists));
+    __mem_blocks[0] = __BLOCK0;
+    __free_insert(0);
 }
 
 #ifdef _DEBUG
 void __memwalk()
 {
     int i = 0;
-    if (__mem_blocks[0]==0) __mem_blocks[0] = __BLOCK0;
+    if (__mem_blocks[0]==0) __mem_init();
     while (i<__MEM_BLOCKS)
     {
         printf("BLOCK %i:\n", i);
@@ -103,58 +177,43 @@ void __memwalk()
 void* valloc( size_t size )
 {
     // Initialize memory block, if not yet done
-    if (__mem_blocks[0]==0) __mem_blocks[0] = __BLOCK0;
-    
-    int i = 0;
-    int j = 0;
-    int bsize = __BLOCKS(size);
+    if (__mem_blocks[0]==0) __mem_init();
     
-    if (__largest_update==0 && __largest_block<bsize)
+    if (size==0 || size>__MEM_SIZE)
     {
-        #ifdef _DEBUG
-        printf("Not enough memory to allocate %i bytes (largest: %i)!\n",size,vlargestblock());
-        #endif
+        __stats.failed++;
         return(0);
     }
 
+    int bsize = __BLOCKS(size);
+    int fl, sl;
+    
     #ifdef _DEBUG
     printf("allocating %i bytes, in %i blocks\n", size, bsize);
     #endif
-    // Find smallest block that still fits the requested size
-    int bestblock = -1;
-    int bestblock_prev = 0;
-    int bestblock_size = __MEM_BLOCKS+1;
-    while (i<__MEM_BLOCKS)
+    // Find the first non empty list whose blocks all fit the requested size
+    __mapping_search(bsize, &fl, &sl);
+    unsigned int sl_map = (fl<__FL_COUNT) ? (__sl_bitmap[fl] & (~0u << sl)) : 0;
+    if (sl_map==0)
     {
-        int csize = __BLOCK_GET_SIZE(__mem_blocks[i]);
-        if (__BLOCK_GET_FREEBLOCK(__mem_blocks[i])==3 && csize>=bsize)
+        unsigned int fl_map = (fl+1<__FL_COUNT) ? (__fl_bitmap & (~0u << (fl+1))) : 0;
+        if (fl_map==0)
         {
-            if (csize<bestblock_size)
-            {
-                bestblock = i;
-                bestblock_prev = j;
-                bestblock_size = csize;
-            }
-            
-            if (csize==bsize)
-                break;
+            #ifdef _DEBUG
+            printf("Not enough memory to allocate %i bytes (largest: %i)!\n",size,vlargestblock());
+            #endif
+            __stats.failed++;
+            return(0);
         }
-        j = i;
-        i += csize;
-    }
-    
-    if (bestblock<0)
-    {
-        #ifdef _DEBUG
-        printf("Not enough memory to allocate %i bytes (largest: %i)!\n",size,vlargestblock());
-        #endif
-        return(0);
+        fl = __builtin_ctz(fl_map);
+        sl_map = __sl_bitmap[fl];
     }
+    sl = __builtin_ctz(sl_map);
     
-    i = bestblock;
-    j = bestblock_prev;    
-    int csize = bestblock_size;
-    __mem_blocks[i] = __BLOCK_MAKE(bsize,j,0,1);
+    int i = __free_lists[fl][sl];
+    int csize = __BLOCK_GET_SIZE(__mem_blocks[i]);
+    __free_remove(i);
+    __mem_blocks[i] = __BLOCK_MAKE(bsize,__BLOCK_GET_PREV(__mem_blocks[i]),0,1);
     
     int next = i+bsize;
     if (csize>bsize && next<__MEM_BLOCKS)
@@ -165,26 +224,24 @@ void* valloc( size_t size )
         {
             __BLOCK_SET_PREV(__mem_blocks[nextnext], next);
         }
+        __free_insert(next);
     }
 
     __mem_free -= bsize;
-    if (__largest_block==csize)        // if we just allocated from one of the largest blocks
-    {
-        if ((csize-bsize)>(__mem_free/2))
-            __largest_block = (csize-bsize);        // there can't be another largest block
-        else
-            __largest_update = 1;
-    }
+    __stats.allocs++;
+    __stats.used = (__MEM_BLOCKS-__mem_free) * __BLOCK_SIZE;
+    if (__stats.used>__stats.peak)
+        __stats.peak = __stats.used;
     return ((void*)(__MEM_START + (i*__BLOCK_SIZE)));
 }
 
 
 void vfree( void* ptr )
 {
-    if (ptr==0) return;
+    if (ptr==0 || __mem_blocks[0]==0) return;
 
     int block = ((unsigned int)ptr - __MEM_START)/__BLOCK_SIZE;
-    if (block<0 || block>__MEM_BLOCKS)
+    if (block<0 || block>=__MEM_BLOCKS || ((unsigned int)ptr & (__BLOCK_SIZE-1)))
     {
         #ifdef _DEBUG
         printf("Block is out of range: %i (0x%x)\n", block, (int)ptr);
@@ -207,6 +264,8 @@ void vfree( void* ptr )
     // Mark block as free
     __BLOCK_SET_FREE(__mem_blocks[block],1);
     __mem_free += csize;
+    __stats.frees++;
+    __stats.used = (__MEM_BLOCKS-__mem_free) * __BLOCK_SIZE;
     
     int next = block+csize;
     // Merge with previous block if possible
@@ -215,6 +274,7 @@ void vfree( void* ptr )
     {
         if (__BLOCK_GET_FREEBLOCK(__mem_blocks[prev])==3)
         {
+            __free_remove(prev);
             __BLOCK_ADD_SIZE(__mem_blocks[prev], csize);
             __BLOCK_SET_BLOCK(__mem_blocks[block],0);    // mark current block as inter block
             if (next<__MEM_BLOCKS)
@@ -228,6 +288,7 @@ void vfree( void* ptr )
     {
         if (__BLOCK_GET_FREEBLOCK(__mem_blocks[next])==3)
         {
+            __free_remove(next);
             __BLOCK_ADD_SIZE(__mem_blocks[block], __BLOCK_GET_SIZE(__mem_blocks[next]));
             __BLOCK_SET_BLOCK(__mem_blocks[next],0);    // mark next block as inter block
             int nextnext = next + __BLOCK_GET_SIZE(__mem_blocks[next]);
@@ -236,12 +297,7 @@ void vfree( void* ptr )
         }
     }
 
-    // Update if a new largest block emerged
-    if (__largest_block<__BLOCK_GET_SIZE(__mem_blocks[block])) 
-    {
-        __largest_block = __BLOCK_GET_SIZE(__mem_blocks[block]);
-        __largest_update = 0;        // No update necessary any more, because update only necessary when largest has shrinked at most
-    }
+    __free_insert(block);
 }
 
 
@@ -253,7 +309,29 @@ size_t vmemavail()
 
 size_t vlargestblock()
 {
-    if (__largest_update) __find_largest_block();
-    return __largest_block * __BLOCK_SIZE;
+    if (__mem_blocks[0]==0) return __MEM_SIZE;
+    if (__fl_bitmap==0) return 0;
+
+    // The largest block is on the highest non empty list
+    int fl = __msb(__fl_bitmap);
+    int sl = __msb(__sl_bitmap[fl]);
+    int largest = 0;
+    int i;
+    for (i = __free_lists[fl][sl]; i!=__NIL; i = __free_next[i])
+    {
+        if (__BLOCK_GET_SIZE(__mem_blocks[i])>largest)
+            largest = __BLOCK_GET_SIZE(__mem_blocks[i]);
+    }
+    return largest * __BLOCK_SIZE;
 }
 
+
+void vstats( vram_stats_t *stats )
+{
+    if (__mem_blocks[0]==0) __mem_init();
+
+    size_t avail = vmemavail();
+    memcpy(stats, &__stats, sizeof(vram_stats_t));
+    stats->largest_free = vlargestblock();
+    stats->fragmentation = (avail==0) ? 0 : 100 - (stats->largest_free * 100) / avail;
+}
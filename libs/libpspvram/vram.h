@@ -25,6 +25,19 @@ void vfree( void* ptr );
 size_t vmemavail();
 size_t vlargestblock();
 
+typedef struct {
+    size_t used;                // bytes allocated right now
+    size_t peak;                // highest value of used
+    size_t largest_free;
+    unsigned int allocs;
+    unsigned int frees;
+    unsigned int failed;        // valloc calls that returned NULL
+    unsigned int free_blocks;   // free regions VRAM is split into
+    unsigned int fragmentation; // percent of free memory outside the largest free block
+} vram_stats_t;
+
+void vstats( vram_stats_t *stats );
+
 
 #ifdef _DEBUG
 // Debug printf (to stdout) a trace of the current Memblocks